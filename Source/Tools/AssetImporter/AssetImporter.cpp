@@ -24,6 +24,7 @@
 
 #include <Urho3D/Graphics/AnimatedModel.h>
 #include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Audio/Audio.h>
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Graphics/DebugRenderer.h>
 #include <Urho3D/IO/File.h>
@@ -33,8 +34,13 @@
 #include <Urho3D/Graphics/IndexBuffer.h>
 #include <Urho3D/Graphics/Light.h>
 #include <Urho3D/Graphics/Material.h>
+#include <Urho3D/IO/MemoryBuffer.h>
 #include <Urho3D/Graphics/Model.h>
+#ifdef URHO3D_NAVIGATION
+#include <Urho3D/Navigation/NavigationMesh.h>
+#endif
 #include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/ParticleEffect.h>
 #ifdef URHO3D_PHYSICS
 #include <Urho3D/Physics/PhysicsWorld.h>
 #endif
@@ -43,7 +49,14 @@
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Scene/UnknownComponent.h>
+#ifdef URHO3D_URHO2D
+#include <Urho3D/Urho2D/Urho2D.h>
+#endif
 #include <Urho3D/Math/Vector3.h>
+#include <Urho3D/IO/VectorBuffer.h>
 #include <Urho3D/Graphics/VertexBuffer.h>
 #include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/Resource/XMLFile.h>
@@ -60,6 +73,7 @@
 #include <assimp/postprocess.h>
 #include <assimp/DefaultLogger.hpp>
 
+#include <cstdio>
 #include <cstring>
 
 #include <Urho3D/DebugNew.h>
@@ -123,6 +137,7 @@ bool noOverwriteTexture_ = false;
 bool noOverwriteNewerTexture_ = false;
 bool checkUniqueModel_ = true;
 unsigned maxBones_ = 64;
+unsigned numBenchmarkLoads_ = 0;
 Vector<String> nonSkinningBoneIncludes_;
 Vector<String> nonSkinningBoneExcludes_;
 
@@ -156,6 +171,10 @@ void CopyTextures(const HashSet<String>& usedTextures, const String& sourcePath)
 
 void CombineLods(const PODVector<float>& lodDistances, const Vector<String>& modelNames, const String& outName);
 
+void CookResource(const String& inFile, const String& outFile);
+bool LoadCookableResource(const String& type, const PODVector<unsigned char>& data, bool cooked);
+float BenchmarkLoad(const String& type, const PODVector<unsigned char>& data, bool cooked);
+
 void GetMeshesUnderNode(Vector<Pair<aiNode*, aiMesh*> >& meshes, aiNode* node);
 unsigned GetMeshIndex(aiMesh* mesh);
 unsigned GetBoneIndex(OutModel& model, const String& boneName);
@@ -217,6 +236,9 @@ void Run(const Vector<String>& arguments)
             "dump       Dump scene node structure. No output file is generated\n"
             "lod        Combine several Urho3D models as LOD levels of the output model\n"
             "           Syntax: lod <dist0> <mdl0> <dist1 <mdl1> ... <output file>\n"
+            "cook       Convert an Urho3D material, technique, particle effect or scene XML file\n"
+            "           to the binary format that loads faster. The output file can replace the\n"
+            "           XML file under the same name, as the format is detected on load\n"
             "\n"
             "Options:\n"
             "-b          Save scene in binary format, default format is XML\n"
@@ -233,7 +255,8 @@ void Run(const Vector<String>& arguments)
             "-nf         Do not fix infacing normals\n"
             "-ne         Do not save empty nodes (scene mode only)\n"
             "-mb <x>     Maximum number of bones per submesh. Default 64\n"
-            "-p <path>   Set path for scene resources. Default is output file path\n"
+            "-p <path>   Set path for scene resources. Default is output file path, or in\n"
+            "            cook mode the parent of the input file path\n"
             "-r <name>   Use the named scene node as root node\n"
             "-f <freq>   Animation tick frequency to use if unspecified. Default 4800\n"
             "-o          Optimize redundant submeshes. Loses scene hierarchy and animations\n"
@@ -248,6 +271,7 @@ void Run(const Vector<String>& arguments)
             "-ct         Check and do not overwrite if texture exists\n"
             "-ctn        Check and do not overwrite if texture has newer timestamp\n"
             "-am         Export all meshes even if identical (scene mode only)\n"
+            "-bench <n>  Compare XML and binary load times over n loads (cook mode only)\n"
         );
     }
     
@@ -259,6 +283,14 @@ void Run(const Vector<String>& arguments)
 #ifdef URHO3D_PHYSICS
     RegisterPhysicsLibrary(context_);
 #endif
+    // Register the rest of the scene components so that any scene can be cooked
+    RegisterAudioLibrary(context_);
+#ifdef URHO3D_NAVIGATION
+    RegisterNavigationLibrary(context_);
+#endif
+#ifdef URHO3D_URHO2D
+    RegisterUrho2DLibrary(context_);
+#endif
     
     String command = arguments[0].ToLower();
     String rootNodeName;
@@ -362,6 +394,11 @@ void Run(const Vector<String>& arguments)
                 defaultTicksPerSecond_ = ToFloat(value);
                 ++i;
             }
+            else if (argument == "bench" && !value.Empty())
+            {
+                numBenchmarkLoads_ = ToUInt(value);
+                ++i;
+            }
             else if (argument == "s")
             {
                 includeNonSkinningBones_ = true;
@@ -504,6 +541,13 @@ void Run(const Vector<String>& arguments)
         
         CombineLods(lodDistances, modelNames, outFile);
     }
+    else if (command == "cook")
+    {
+        if (arguments.Size() < 3 || arguments[2][0] == '-')
+            ErrorExit("No output file defined");
+        
+        CookResource(GetInternalPath(arguments[1]), GetInternalPath(arguments[2]));
+    }
     else
         ErrorExit("Unrecognized command " + command);
 }
@@ -1846,6 +1890,138 @@ void CombineLods(const PODVector<float>& lodDistances, const Vector<String>& mod
     outModel->Save(outFile);
 }
 
+void CookResource(const String& inFile, const String& outFile)
+{
+    // Resources referred to by the file are needed to save their types and names, but do not need to actually exist
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    if (resourcePath_.Empty())
+    {
+        resourcePath_ = GetParentPath(GetPath(inFile));
+        if (resourcePath_.Empty())
+            resourcePath_ = "./";
+    }
+    cache->AddResourceDir(resourcePath_);
+    cache->SetReturnFailedResources(true);
+    
+    File srcFile(context_);
+    if (!srcFile.Open(inFile))
+        ErrorExit("Could not open input file " + inFile);
+    PODVector<unsigned char> xmlData(srcFile.GetSize());
+    if (xmlData.Empty() || srcFile.Read(&xmlData[0], xmlData.Size()) != xmlData.Size())
+        ErrorExit("Could not read input file " + inFile);
+    srcFile.Close();
+    
+    MemoryBuffer xmlBuffer(xmlData);
+    SharedPtr<XMLFile> xml(new XMLFile(context_));
+    if (!xml->Load(xmlBuffer))
+        ErrorExit("Could not parse input file " + inFile);
+    
+    XMLElement rootElem = xml->GetRoot();
+    String type = rootElem.GetName();
+    VectorBuffer cookedData;
+    bool success = false;
+    
+    PrintLine("Cooking " + type + " " + inFile);
+    if (type == "material")
+    {
+        SharedPtr<Material> material(new Material(context_));
+        success = material->Load(rootElem) && material->SaveBinary(cookedData);
+    }
+    else if (type == "technique")
+    {
+        SharedPtr<Technique> technique(new Technique(context_));
+        xmlBuffer.Seek(0);
+        success = technique->Load(xmlBuffer) && technique->SaveBinary(cookedData);
+    }
+    else if (type == "particleeffect" || type == "particleemitter")
+    {
+        type = "particleeffect";
+        SharedPtr<ParticleEffect> effect(new ParticleEffect(context_));
+        success = effect->Load(rootElem) && effect->SaveBinary(cookedData);
+    }
+    else if (type == "scene")
+    {
+        SharedPtr<Scene> scene(new Scene(context_));
+        if (!scene->LoadXML(rootElem))
+            ErrorExit("Could not load scene " + inFile);
+        
+        // Components of unknown type can only be stored as XML
+        PODVector<UnknownComponent*> unknownComponents;
+        scene->GetComponents<UnknownComponent>(unknownComponents, true);
+        if (unknownComponents.Size())
+            ErrorExit("Scene contains a component of unregistered type " + unknownComponents[0]->GetTypeName() + ", can not cook");
+        
+        success = scene->Save(cookedData);
+    }
+    else
+        ErrorExit("Unsupported resource type " + type + " in " + inFile);
+    
+    if (!success)
+        ErrorExit("Could not convert " + inFile);
+    
+    File destFile(context_);
+    if (!destFile.Open(outFile, FILE_WRITE))
+        ErrorExit("Could not open output file " + outFile);
+    if (destFile.Write(cookedData.GetData(), cookedData.GetSize()) != cookedData.GetSize())
+        ErrorExit("Could not write output file " + outFile);
+    PrintLine("Wrote " + outFile + ", " + String(xmlData.Size()) + " bytes XML to " + String(cookedData.GetSize()) +
+        " bytes binary");
+    
+    if (numBenchmarkLoads_)
+    {
+        float xmlTime = BenchmarkLoad(type, xmlData, false);
+        float cookedTime = BenchmarkLoad(type, cookedData.GetBuffer(), true);
+        char line[256];
+        sprintf(line, "Average load time over %u loads: XML %.2f us, binary %.2f us (%.1fx)", numBenchmarkLoads_, xmlTime,
+            cookedTime, cookedTime > 0.0f ? xmlTime / cookedTime : 0.0f);
+        PrintLine(line);
+    }
+}
+
+bool LoadCookableResource(const String& type, const PODVector<unsigned char>& data, bool cooked)
+{
+    MemoryBuffer buffer(data);
+    
+    if (type == "material")
+    {
+        // Material::BeginLoad() does nothing without the Graphics subsystem, so load synchronously
+        SharedPtr<Material> material(new Material(context_));
+        if (cooked)
+            return material->LoadBinary(buffer);
+        
+        SharedPtr<XMLFile> xml(new XMLFile(context_));
+        return xml->Load(buffer) && material->Load(xml->GetRoot());
+    }
+    else if (type == "scene")
+    {
+        SharedPtr<Scene> scene(new Scene(context_));
+        return cooked ? scene->Load(buffer) : scene->LoadXML(buffer);
+    }
+    else if (type == "technique")
+    {
+        SharedPtr<Technique> technique(new Technique(context_));
+        return technique->Load(buffer);
+    }
+    else
+    {
+        SharedPtr<ParticleEffect> effect(new ParticleEffect(context_));
+        return effect->Resource::Load(buffer);
+    }
+}
+
+float BenchmarkLoad(const String& type, const PODVector<unsigned char>& data, bool cooked)
+{
+    // Load once untimed so that the referred resources are in the cache for both formats
+    if (!LoadCookableResource(type, data, cooked))
+        ErrorExit(String("Could not load the ") + (cooked ? "binary" : "XML") + " data for benchmarking");
+    
+    HiresTimer timer;
+    for (unsigned i = 0; i < numBenchmarkLoads_; ++i)
+        LoadCookableResource(type, data, cooked);
+    
+    return (float)timer.GetUSec(false) / (float)numBenchmarkLoads_;
+}
+
 void GetMeshesUnderNode(Vector<Pair<aiNode*, aiMesh*> >& dest, aiNode* node)
 {
     for (unsigned i = 0; i < node->mNumMeshes; ++i)
@@ -0,0 +1,607 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+static const unsigned short DEFAULT_PORT = 2345;
+static const unsigned CTRL_FORWARD = 1;
+static const float MOVE_SPEED = 5.0f;
+static const float TURN_SPEED = 90.0f;
+
+/// Percentile statistics of timing samples in milliseconds.
+struct TimingSummary
+{
+    /// Construct from samples.
+    TimingSummary(PODVector<float>& samples) :
+        average_(0.0f),
+        p50_(0.0f),
+        p90_(0.0f),
+        p99_(0.0f),
+        max_(0.0f),
+        count_(samples.Size())
+    {
+        if (samples.Empty())
+            return;
+
+        Sort(samples.Begin(), samples.End());
+        for (unsigned i = 0; i < samples.Size(); ++i)
+            average_ += samples[i];
+        average_ /= (float)samples.Size();
+        p50_ = samples[samples.Size() * 50 / 100];
+        p90_ = samples[samples.Size() * 90 / 100];
+        p99_ = samples[samples.Size() * 99 / 100];
+        max_ = samples.Back();
+    }
+
+    /// Return as a table row.
+    String ToString(const char* name) const
+    {
+        char line[256];
+        sprintf(line, "%-28s %8u %8.3f %8.3f %8.3f %8.3f %8.3f", name, count_, average_, p50_, p90_, p99_, max_);
+        return String(line);
+    }
+
+    /// Average.
+    float average_;
+    /// 50th percentile.
+    float p50_;
+    /// 90th percentile.
+    float p90_;
+    /// 99th percentile.
+    float p99_;
+    /// Maximum.
+    float max_;
+    /// Number of samples.
+    unsigned count_;
+};
+
+/// Load test server. Replicates one node per connected client, moved according to the client's controls, and a number of autonomously moving nodes.
+class LoadTestServer : public Object
+{
+    OBJECT(LoadTestServer);
+
+public:
+    /// Construct.
+    LoadTestServer(Context* context) :
+        Object(context),
+        scene_(new Scene(context)),
+        time_(0.0f)
+    {
+    }
+
+    /// Create the scene and start the server. Return true if successful.
+    bool Start(unsigned short port, unsigned numNodes)
+    {
+        for (unsigned i = 0; i < numNodes; ++i)
+        {
+            Node* node = scene_->CreateChild("Node");
+            node->SetPosition(Vector3(Random(-100.0f, 100.0f), 0.0f, Random(-100.0f, 100.0f)));
+            node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+            nodes_.Push(WeakPtr<Node>(node));
+        }
+
+        SubscribeToEvent(E_CLIENTCONNECTED, HANDLER(LoadTestServer, HandleClientConnected));
+        SubscribeToEvent(E_CLIENTDISCONNECTED, HANDLER(LoadTestServer, HandleClientDisconnected));
+        SubscribeToEvent(E_NETWORKUPDATE, HANDLER(LoadTestServer, HandleNetworkUpdate));
+        SubscribeToEvent(E_NETWORKUPDATESENT, HANDLER(LoadTestServer, HandleNetworkUpdateSent));
+        SubscribeToEvent(scene_, E_SCENEUPDATE, HANDLER(LoadTestServer, HandleSceneUpdate));
+
+        return GetSubsystem<Network>()->StartServer(port);
+    }
+
+    /// Return total bytes sent to and received from clients.
+    void GetTraffic(unsigned long long& bytesIn, unsigned long long& bytesOut) const
+    {
+        bytesIn = 0;
+        bytesOut = 0;
+        Vector<SharedPtr<Connection> > connections = GetSubsystem<Network>()->GetClientConnections();
+        for (unsigned i = 0; i < connections.Size(); ++i)
+        {
+            bytesIn += connections[i]->GetStatistics().bytesIn_;
+            bytesOut += connections[i]->GetStatistics().bytesOut_;
+        }
+    }
+
+    /// Return number of connected clients.
+    unsigned GetNumClients() const { return players_.Size(); }
+
+    /// Replication update times in milliseconds.
+    PODVector<float> updateTimes_;
+
+private:
+    /// Handle a client connecting: assign the scene and create the client's node.
+    void HandleClientConnected(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace ClientConnected;
+
+        Connection* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+        connection->SetScene(scene_);
+        Node* node = scene_->CreateChild("Player");
+        node->SetOwner(connection);
+        players_[connection] = node;
+    }
+
+    /// Handle a client disconnecting: remove the client's node.
+    void HandleClientDisconnected(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace ClientDisconnected;
+
+        Connection* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+        HashMap<Connection*, WeakPtr<Node> >::Iterator i = players_.Find(connection);
+        if (i != players_.End())
+        {
+            if (i->second_)
+                i->second_->Remove();
+            players_.Erase(i);
+        }
+    }
+
+    /// Handle scene update: move the nodes.
+    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace SceneUpdate;
+
+        float timeStep = eventData[P_TIMESTEP].GetFloat();
+        time_ += timeStep;
+
+        for (HashMap<Connection*, WeakPtr<Node> >::Iterator i = players_.Begin(); i != players_.End(); ++i)
+        {
+            Node* node = i->second_;
+            if (!node)
+                continue;
+            const Controls& controls = i->first_->GetControls();
+            node->SetRotation(Quaternion(controls.yaw_, Vector3::UP));
+            if (controls.IsDown(CTRL_FORWARD))
+                node->Translate(Vector3::FORWARD * MOVE_SPEED * timeStep);
+        }
+
+        for (unsigned i = 0; i < nodes_.Size(); ++i)
+        {
+            Node* node = nodes_[i];
+            if (!node)
+                continue;
+            node->Yaw(TURN_SPEED * timeStep);
+            node->Translate(Vector3::FORWARD * MOVE_SPEED * timeStep);
+        }
+    }
+
+    /// Handle the start of a network update.
+    void HandleNetworkUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        updateTimer_.Reset();
+    }
+
+    /// Handle the end of a network update: record the time spent in replication.
+    void HandleNetworkUpdateSent(StringHash eventType, VariantMap& eventData)
+    {
+        updateTimes_.Push(updateTimer_.GetUSec(false) / 1000.0f);
+    }
+
+    /// Scene.
+    SharedPtr<Scene> scene_;
+    /// Client nodes by connection.
+    HashMap<Connection*, WeakPtr<Node> > players_;
+    /// Autonomously moving nodes.
+    Vector<WeakPtr<Node> > nodes_;
+    /// Replication update timer.
+    HiresTimer updateTimer_;
+    /// Elapsed time.
+    float time_;
+};
+
+/// Simulated headless load test client. Sends scripted controls and measures the replication latency, ie. the time from sending controls until the server acknowledges them in a scene update.
+class LoadTestClient : public Object
+{
+    OBJECT(LoadTestClient);
+
+public:
+    /// Construct.
+    LoadTestClient(Context* context, unsigned index) :
+        Object(context),
+        scene_(new Scene(context)),
+        time_(index * 0.37f)
+    {
+        for (unsigned i = 0; i < 256; ++i)
+            sent_[i] = false;
+    }
+
+    /// Connect to the server. Return true if connection process successfully started.
+    bool Connect(const String& address, unsigned short port)
+    {
+        SubscribeToEvent(E_UPDATE, HANDLER(LoadTestClient, HandleUpdate));
+        SubscribeToEvent(E_NETWORKUPDATE, HANDLER(LoadTestClient, HandleNetworkUpdate));
+        SubscribeToEvent(E_NETWORKUPDATESENT, HANDLER(LoadTestClient, HandleNetworkUpdateSent));
+
+        return GetSubsystem<Network>()->Connect(address, port, scene_);
+    }
+
+    /// Return whether connected and the scene is loaded.
+    bool IsReady() const
+    {
+        Connection* connection = GetSubsystem<Network>()->GetServerConnection();
+        return connection && connection->IsSceneLoaded();
+    }
+
+    /// Replication latencies in milliseconds.
+    PODVector<float> latencies_;
+
+private:
+    /// Handle the frame update: check for new acknowledged controls.
+    void HandleUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace Update;
+
+        time_ += eventData[P_TIMESTEP].GetFloat();
+
+        Connection* connection = GetSubsystem<Network>()->GetServerConnection();
+        if (!connection || !connection->IsSceneLoaded())
+            return;
+
+        unsigned char timeStamp = connection->GetServerTimeStamp();
+        if (sent_[timeStamp])
+        {
+            latencies_.Push((timer_.GetUSec(false) - sendTimes_[timeStamp]) / 1000.0f);
+            sent_[timeStamp] = false;
+        }
+    }
+
+    /// Handle the start of a network update: set the scripted controls.
+    void HandleNetworkUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        Connection* connection = GetSubsystem<Network>()->GetServerConnection();
+        if (!connection)
+            return;
+
+        // Alternate between moving forward and standing still while turning back and forth
+        Controls controls;
+        controls.Set(CTRL_FORWARD, fmodf(time_, 4.0f) < 3.0f);
+        controls.yaw_ = Sin(time_ * 45.0f) * 180.0f;
+        connection->SetControls(controls);
+    }
+
+    /// Handle the end of a network update: record the send time of the controls.
+    void HandleNetworkUpdateSent(StringHash eventType, VariantMap& eventData)
+    {
+        Connection* connection = GetSubsystem<Network>()->GetServerConnection();
+        if (!connection || !connection->IsSceneLoaded())
+            return;
+
+        unsigned char timeStamp = (unsigned char)(connection->GetTimeStamp() - 1);
+        sendTimes_[timeStamp] = timer_.GetUSec(false);
+        sent_[timeStamp] = true;
+    }
+
+    /// Replicated scene.
+    SharedPtr<Scene> scene_;
+    /// Latency timer.
+    HiresTimer timer_;
+    /// Send times of controls by timestamp.
+    long long sendTimes_[256];
+    /// Controls sent and not yet acknowledged flags by timestamp.
+    bool sent_[256];
+    /// Elapsed time for the scripted controls.
+    float time_;
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+SharedPtr<Context> CreateContext();
+void RunFrame(Context* context, float timeStep);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned numClients = 8;
+    unsigned numNodes = 100;
+    float duration = 30.0f;
+    int updateFps = 30;
+    int frameRate = 60;
+    int latency = 0;
+    float packetLoss = 0.0f;
+    unsigned short port = DEFAULT_PORT;
+    String address = "127.0.0.1";
+    bool runServer = true;
+    bool statistics = false;
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if (argument == "-clients" && !value.Empty())
+        {
+            numClients = ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-nodes" && !value.Empty())
+        {
+            numNodes = ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-time" && !value.Empty())
+        {
+            duration = ToFloat(value);
+            ++i;
+        }
+        else if (argument == "-updatefps" && !value.Empty())
+        {
+            updateFps = ToInt(value);
+            ++i;
+        }
+        else if (argument == "-fps" && !value.Empty())
+        {
+            frameRate = Max(ToInt(value), 1);
+            ++i;
+        }
+        else if (argument == "-latency" && !value.Empty())
+        {
+            latency = ToInt(value);
+            ++i;
+        }
+        else if (argument == "-loss" && !value.Empty())
+        {
+            packetLoss = ToFloat(value);
+            ++i;
+        }
+        else if (argument == "-port" && !value.Empty())
+        {
+            port = (unsigned short)ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-connect" && !value.Empty())
+        {
+            address = value;
+            runServer = false;
+            ++i;
+        }
+        else if (argument == "-stats")
+            statistics = true;
+        else
+        {
+            ErrorExit(
+                "Usage: NetworkLoadTest [options]\n"
+                "\n"
+                "Runs a replication server and simulated headless clients in one process over the\n"
+                "loopback interface and reports server update times, bandwidth and replication\n"
+                "latency percentiles.\n"
+                "\n"
+                "Options:\n"
+                "-clients <num>   Number of simulated clients, default 8\n"
+                "-nodes <num>     Number of server-side moving nodes besides the client nodes, default 100\n"
+                "-time <sec>      Test duration in seconds, default 30\n"
+                "-updatefps <num> Network update FPS, default 30\n"
+                "-fps <num>       Frame rate of the test loop, default 60\n"
+                "-latency <ms>    Simulated latency on both server and clients\n"
+                "-loss <prob>     Simulated packet loss probability on both server and clients\n"
+                "-port <port>     Server port, default 2345\n"
+                "-connect <addr>  Run only the clients, connecting to a server at the address\n"
+                "-stats           Print per-message and per-component traffic statistics of the server\n"
+            );
+        }
+    }
+
+    // Each simulated peer needs its own context, as the Network subsystem supports only one server connection
+    SharedPtr<Context> serverContext = CreateContext();
+    SharedPtr<Log> log(new Log(serverContext));
+    serverContext->RegisterSubsystem(log);
+    log->SetLevel(LOG_WARNING);
+
+    SharedPtr<LoadTestServer> server;
+    if (runServer)
+    {
+        Network* network = serverContext->GetSubsystem<Network>();
+        network->SetUpdateFps(updateFps);
+        network->SetSimulatedLatency(latency);
+        network->SetSimulatedPacketLoss(packetLoss);
+        network->SetStatisticsEnabled(statistics);
+        server = new LoadTestServer(serverContext);
+        if (!server->Start(port, numNodes))
+            ErrorExit("Failed to start server on port " + String(port));
+        PrintLine("Started server on port " + String(port) + " with " + String(numNodes) + " nodes");
+    }
+
+    Vector<SharedPtr<Context> > clientContexts;
+    Vector<SharedPtr<LoadTestClient> > clients;
+    for (unsigned i = 0; i < numClients; ++i)
+    {
+        SharedPtr<Context> clientContext = CreateContext();
+        Network* network = clientContext->GetSubsystem<Network>();
+        network->SetUpdateFps(updateFps);
+        network->SetSimulatedLatency(latency);
+        network->SetSimulatedPacketLoss(packetLoss);
+        SharedPtr<LoadTestClient> client(new LoadTestClient(clientContext, i));
+        if (!client->Connect(address, port))
+            ErrorExit("Failed to connect client " + String(i) + " to " + address + ":" + String(port));
+        clientContexts.Push(clientContext);
+        clients.Push(client);
+    }
+    PrintLine("Connecting " + String(numClients) + " clients to " + address + ":" + String(port));
+
+    PODVector<float> frameTimes;
+    HiresTimer frameTimer;
+    HiresTimer testTimer;
+    Timer loopTimer;
+    float frameTime = 1.0f / (float)frameRate;
+    float timeStep = frameTime;
+    bool measuring = false;
+    float elapsed = 0.0f;
+
+    for (;;)
+    {
+        loopTimer.Reset();
+
+        frameTimer.Reset();
+        RunFrame(serverContext, timeStep);
+        float serverFrameTime = frameTimer.GetUSec(false) / 1000.0f;
+
+        for (unsigned i = 0; i < clientContexts.Size(); ++i)
+            RunFrame(clientContexts[i], timeStep);
+
+        // Start measuring once all clients have joined the scene
+        if (!measuring)
+        {
+            bool ready = true;
+            for (unsigned i = 0; i < clients.Size(); ++i)
+                ready &= clients[i]->IsReady();
+            if (ready)
+            {
+                measuring = true;
+                testTimer.Reset();
+                for (unsigned i = 0; i < clients.Size(); ++i)
+                    clients[i]->latencies_.Clear();
+                if (server)
+                {
+                    server->updateTimes_.Clear();
+                    // Also resets the traffic counters of the client connections
+                    serverContext->GetSubsystem<Network>()->ResetStatistics();
+                }
+                PrintLine("All clients joined, running test for " + String(duration) + " seconds");
+            }
+        }
+        else
+        {
+            frameTimes.Push(serverFrameTime);
+            elapsed = testTimer.GetUSec(false) / 1000000.0f;
+            if (elapsed >= duration)
+                break;
+        }
+
+        // Keep the frame rate
+        unsigned loopMSec = loopTimer.GetMSec(false);
+        unsigned frameMSec = (unsigned)(frameTime * 1000.0f);
+        if (loopMSec < frameMSec)
+            Time::Sleep(frameMSec - loopMSec);
+        timeStep = loopTimer.GetMSec(false) / 1000.0f;
+    }
+
+    PODVector<float> latencies;
+    for (unsigned i = 0; i < clients.Size(); ++i)
+        latencies.Insert(latencies.End(), clients[i]->latencies_);
+
+    char line[256];
+    sprintf(line, "%-28s %8s %8s %8s %8s %8s %8s", "Times (ms)", "Samples", "Average", "50%", "90%", "99%", "Max");
+    PrintLine("");
+    PrintLine(line);
+    if (server)
+    {
+        PrintLine(TimingSummary(frameTimes).ToString("Server frame"));
+        PrintLine(TimingSummary(server->updateTimes_).ToString("Server replication update"));
+    }
+    PrintLine(TimingSummary(latencies).ToString("Replication latency"));
+
+    if (server && elapsed > 0.0f)
+    {
+        unsigned long long bytesIn;
+        unsigned long long bytesOut;
+        server->GetTraffic(bytesIn, bytesOut);
+        float kbIn = bytesIn / 1024.0f / elapsed;
+        float kbOut = bytesOut / 1024.0f / elapsed;
+        unsigned connected = Max((int)server->GetNumClients(), 1);
+
+        sprintf(line, "Server in %.3f KB/s (%.3f KB/s per client), out %.3f KB/s (%.3f KB/s per client)", kbIn, kbIn / connected,
+            kbOut, kbOut / connected);
+        PrintLine("");
+        PrintLine(line);
+
+        if (statistics)
+        {
+            PrintLine("");
+            PrintLine(serverContext->GetSubsystem<Network>()->PrintStatistics());
+        }
+    }
+
+    for (unsigned i = 0; i < clientContexts.Size(); ++i)
+        clientContexts[i]->GetSubsystem<Network>()->Disconnect(100);
+    if (server)
+        serverContext->GetSubsystem<Network>()->StopServer();
+
+    clients.Clear();
+    server.Reset();
+}
+
+SharedPtr<Context> CreateContext()
+{
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    // The client side of scene loading accesses the file system and the resource cache
+    context->RegisterSubsystem(new FileSystem(context));
+    context->RegisterSubsystem(new ResourceCache(context));
+    context->RegisterSubsystem(new Network(context));
+    RegisterSceneLibrary(context);
+    RegisterNetworkLibrary(context);
+    return context;
+}
+
+void RunFrame(Context* context, float timeStep)
+{
+    // Perform the same per-frame event sequence as the engine, without rendering
+    Time* time = context->GetSubsystem<Time>();
+    time->BeginFrame(timeStep);
+
+    using namespace Update;
+
+    VariantMap& eventData = context->GetEventDataMap();
+    eventData[P_TIMESTEP] = timeStep;
+    time->SendEvent(E_UPDATE, eventData);
+    time->SendEvent(E_POSTUPDATE, eventData);
+    time->SendEvent(E_RENDERUPDATE, eventData);
+    time->SendEvent(E_POSTRENDERUPDATE, eventData);
+
+    time->EndFrame();
+}
@@ -23,10 +23,15 @@
 #include <Urho3D/Urho3D.h>
 
 #include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/Container/ArrayPtr.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/PackageFile.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/Checksum.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
 
 #ifdef WIN32
 #include <windows.h>
@@ -42,6 +47,9 @@
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+static const unsigned MAX_DICTIONARY_SIZE = 65536;
+static const unsigned MIN_STREAM_BUFFER_SIZE = 196608;
+static const unsigned MAX_BATCH_SIZE = 64 * 1024 * 1024;
 
 struct FileEntry
 {
@@ -49,16 +57,34 @@ struct FileEntry
     unsigned offset_;
     unsigned size_;
     unsigned checksum_;
+    // Index of an earlier entry with identical contents, or M_MAX_UNSIGNED if unique
+    unsigned duplicateOf_;
+    // Name of the entry in the old package whose compressed data is reused, or empty if compressed now
+    String reuseName_;
+};
+
+struct CompressWork
+{
+    const unsigned char* src_;
+    unsigned srcSize_;
+    unsigned char* dest_;
+    unsigned packedSize_;
 };
 
 SharedPtr<Context> context_(new Context());
 SharedPtr<FileSystem> fileSystem_(new FileSystem(context_));
+SharedPtr<WorkQueue> workQueue_(new WorkQueue(context_));
+SharedPtr<PackageFile> oldPackage_;
 String basePath_;
 Vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool compressFast_ = false;
+bool update_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+unsigned numThreads_ = M_MAX_UNSIGNED;
+PODVector<unsigned char> dictionary_;
 
 String ignoreExtensions_[] = {
     ".bak",
@@ -69,8 +95,18 @@ String ignoreExtensions_[] = {
 int main(int argc, char** argv);
 void Run(const Vector<String>& arguments);
 void ProcessFile(const String& fileName, const String& rootDir);
+void OpenOldPackage(const String& fileName);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+void LoadDictionary(const String& fileName);
+void ReadFileData(const String& fileName, unsigned char* dest, unsigned size);
+bool IsSameData(File& file, const unsigned char* data, unsigned size);
+unsigned FindDuplicate(unsigned index, const unsigned char* data, const HashMap<unsigned, PODVector<unsigned> >& entriesByChecksum,
+    const Vector<SharedArrayPtr<unsigned char> >& batchData, unsigned batchStart, const String& rootDir);
+String FindReusable(const FileEntry& entry, const unsigned char* data, const HashMap<unsigned, Vector<String> >& oldEntriesByChecksum);
+void CompressBlocks(PODVector<CompressWork>& blocks);
+void CompressBlockWork(const WorkItem* item, unsigned threadIndex);
+unsigned CompressBlock(const unsigned char* src, unsigned srcSize, unsigned char* dest);
 
 int main(int argc, char** argv)
 {
@@ -94,6 +130,11 @@ void Run(const Vector<String>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-f      Use fast LZ4 compression instead of LZ4 HC. Implies -c\n"
+            "-b <x>  Compressed block size in bytes, default 32768. Implies -c\n"
+            "-d <x>  Use the last 64 KB of a file as the compression dictionary. Implies -c\n"
+            "-u      Update an existing compressed package: reuse the compressed data of unchanged files\n"
+            "-t <x>  Number of compression worker threads, default number of CPU cores minus one\n"
             "-q      Enable quiet mode\n"
         );
 
@@ -114,6 +155,27 @@ void Run(const Vector<String>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 'f':
+                        compress_ = true;
+                        compressFast_ = true;
+                        break;
+                    case 'b':
+                        compress_ = true;
+                        if (i + 1 < arguments.Size())
+                            blockSize_ = Max(ToInt(arguments[++i]), 1);
+                        break;
+                    case 'd':
+                        compress_ = true;
+                        if (i + 1 < arguments.Size())
+                            LoadDictionary(arguments[++i]);
+                        break;
+                    case 'u':
+                        update_ = true;
+                        break;
+                    case 't':
+                        if (i + 1 < arguments.Size())
+                            numThreads_ = ToUInt(arguments[++i]);
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -123,6 +185,12 @@ void Run(const Vector<String>& arguments)
         }
     }
 
+    // The main thread also compresses while waiting for the worker threads
+    if (numThreads_ == M_MAX_UNSIGNED)
+        numThreads_ = (unsigned)Max((int)GetNumPhysicalCPUs() - 1, 0);
+    context_->RegisterSubsystem(workQueue_);
+    workQueue_->CreateThreads(numThreads_);
+
     if (!quiet_)
         PrintLine("Scanning directory " + dirName + " for files");
 
@@ -149,6 +217,9 @@ void Run(const Vector<String>& arguments)
     for (unsigned i = 0; i < fileNames.Size(); ++i)
         ProcessFile(fileNames[i], dirName);
 
+    if (update_)
+        OpenOldPackage(packageName);
+
     WritePackageFile(packageName, dirName);
 }
 
@@ -166,17 +237,54 @@ void ProcessFile(const String& fileName, const String& rootDir)
     newEntry.offset_ = 0; // Offset not yet known
     newEntry.size_ = file.GetSize();
     newEntry.checksum_ = 0; // Will be calculated later
+    newEntry.duplicateOf_ = M_MAX_UNSIGNED;
     entries_.Push(newEntry);
 }
 
+void OpenOldPackage(const String& fileName)
+{
+    if (!fileSystem_->FileExists(fileName))
+    {
+        if (!quiet_)
+            PrintLine("No existing package to update, compressing all files");
+        return;
+    }
+
+    oldPackage_ = new PackageFile(context_);
+    if (!oldPackage_->Open(fileName))
+        ErrorExit("Could not open existing package " + fileName);
+
+    // The compressed data can only be reused if the blocks would be compressed identically
+    if (!compress_ || oldPackage_->GetBlockSize() != blockSize_ || oldPackage_->GetDictionary() != dictionary_)
+    {
+        if (!quiet_)
+            PrintLine("Existing package has different compression settings, compressing all files");
+        oldPackage_.Reset();
+    }
+}
+
 void WritePackageFile(const String& fileName, const String& rootDir)
 {
     if (!quiet_)
         PrintLine("Writing package");
 
+    // When updating, the old package is read while writing, so write to a temporary file and replace the old package last
+    String destFileName = oldPackage_ ? fileName + ".tmp" : fileName;
     File dest(context_);
-    if (!dest.Open(fileName, FILE_WRITE))
-        ErrorExit("Could not open output file " + fileName);
+    if (!dest.Open(destFileName, FILE_WRITE))
+        ErrorExit("Could not open output file " + destFileName);
+
+    File oldPackageFile(context_);
+    HashMap<unsigned, Vector<String> > oldEntriesByChecksum;
+    if (oldPackage_)
+    {
+        if (!oldPackageFile.Open(oldPackage_->GetName()))
+            ErrorExit("Could not open existing package " + oldPackage_->GetName());
+
+        const HashMap<String, PackageEntry>& oldEntries = oldPackage_->GetEntries();
+        for (HashMap<String, PackageEntry>::ConstIterator i = oldEntries.Begin(); i != oldEntries.End(); ++i)
+            oldEntriesByChecksum[i->second_.checksum_].Push(i->first_);
+    }
 
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
@@ -191,64 +299,142 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     }
 
     unsigned totalDataSize = 0;
-
-    // Write file data, calculate checksums & correct offsets
-    for (unsigned i = 0; i < entries_.Size(); ++i)
+    Checksum packageChecksum;
+    unsigned numDuplicates = 0;
+    unsigned numReused = 0;
+    HashMap<unsigned, PODVector<unsigned> > entriesByChecksum;
+
+    // Process the files in batches, so that the blocks of many small files can be compressed in parallel while memory use
+    // stays bounded
+    unsigned index = 0;
+    while (index < entries_.Size())
     {
-        entries_[i].offset_ = dest.GetSize();
-        String fileFullPath = rootDir + "/" + entries_[i].name_;
+        unsigned batchStart = index;
+        unsigned batchSize = 0;
+        Vector<SharedArrayPtr<unsigned char> > batchData;
+        PODVector<unsigned> firstBlocks;
+        PODVector<CompressWork> blocks;
+
+        // Read files and calculate checksums
+        while (index < entries_.Size() && (!batchSize || batchSize + entries_[index].size_ <= MAX_BATCH_SIZE))
+        {
+            FileEntry& entry = entries_[index];
+            unsigned dataSize = entry.size_;
+            SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
+            ReadFileData(rootDir + "/" + entry.name_, buffer.Get(), dataSize);
+
+            // Use the same algorithm as File::GetChecksum(), so that packaged and loose files can be compared
+            entry.checksum_ = Checksum::Calculate(buffer.Get(), dataSize);
+            packageChecksum.Update(buffer.Get(), dataSize);
+            totalDataSize += dataSize;
+
+            // Identical files are stored once, with all their entries pointing to the same data
+            entry.duplicateOf_ = FindDuplicate(index, buffer.Get(), entriesByChecksum, batchData, batchStart, rootDir);
+            if (entry.duplicateOf_ != M_MAX_UNSIGNED)
+                buffer.Reset();
+            else
+            {
+                entriesByChecksum[entry.checksum_].Push(index);
+                batchSize += dataSize;
+                if (oldPackage_)
+                    entry.reuseName_ = FindReusable(entry, buffer.Get(), oldEntriesByChecksum);
+            }
 
-        File srcFile(context_, fileFullPath);
-        if (!srcFile.IsOpen())
-            ErrorExit("Could not open file " + fileFullPath);
+            // Split into blocks to compress
+            firstBlocks.Push(blocks.Size());
+            if (compress_ && buffer && entry.reuseName_.Empty())
+            {
+                for (unsigned pos = 0; pos < dataSize; pos += blockSize_)
+                {
+                    CompressWork work;
+                    work.src_ = &buffer[pos];
+                    work.srcSize_ = Min((int)blockSize_, (int)(dataSize - pos));
+                    work.dest_ = 0;
+                    work.packedSize_ = 0;
+                    blocks.Push(work);
+                }
+            }
 
-        unsigned dataSize = entries_[i].size_;
-        totalDataSize += dataSize;
-        SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
+            batchData.Push(buffer);
+            ++index;
+        }
+        firstBlocks.Push(blocks.Size());
 
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
-            ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
+        PODVector<unsigned char> packedBuffer(blocks.Size() * blockSize_);
+        for (unsigned j = 0; j < blocks.Size(); ++j)
+            blocks[j].dest_ = &packedBuffer[j * blockSize_];
+        CompressBlocks(blocks);
 
-        for (unsigned j = 0; j < dataSize; ++j)
+        // Write file data in the original order and correct offsets
+        for (unsigned i = batchStart; i < index; ++i)
         {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
-        }
+            FileEntry& entry = entries_[i];
+            unsigned dataSize = entry.size_;
+            const unsigned char* data = batchData[i - batchStart].Get();
 
-        if (!compress_)
-        {
-            if (!quiet_)
-                PrintLine(entries_[i].name_ + " size " + String(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
-        }
-        else
-        {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            if (entry.duplicateOf_ != M_MAX_UNSIGNED)
+            {
+                entry.offset_ = entries_[entry.duplicateOf_].offset_;
+                ++numDuplicates;
+                if (!quiet_)
+                    PrintLine(entry.name_ + " duplicate of " + entries_[entry.duplicateOf_].name_);
+                continue;
+            }
 
-            unsigned pos = 0;
-            unsigned totalPackedBytes = 0;
+            entry.offset_ = dest.GetSize();
 
-            while (pos < dataSize)
+            if (!compress_)
+            {
+                if (!quiet_)
+                    PrintLine(entry.name_ + " size " + String(dataSize));
+                dest.Write(data, dataSize);
+            }
+            else if (!entry.reuseName_.Empty())
+            {
+                // Copy the block offset table and the compressed blocks as is. The last table entry is the total size
+                const PackageEntry* oldEntry = oldPackage_->GetEntry(entry.reuseName_);
+                unsigned numBlocks = (dataSize + blockSize_ - 1) / blockSize_;
+                oldPackageFile.Seek(oldEntry->offset_ + numBlocks * sizeof(unsigned));
+                unsigned totalPackedBytes = oldPackageFile.ReadUInt();
+                SharedArrayPtr<unsigned char> packedData(new unsigned char[totalPackedBytes]);
+                oldPackageFile.Seek(oldEntry->offset_);
+                if (oldPackageFile.Read(packedData.Get(), totalPackedBytes) != totalPackedBytes)
+                    ErrorExit("Could not read existing package " + oldPackage_->GetName());
+                dest.Write(packedData.Get(), totalPackedBytes);
+
+                ++numReused;
+                if (!quiet_)
+                    PrintLine(entry.name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes) + " (unchanged)");
+            }
+            else
             {
-                unsigned unpackedSize = blockSize_;
-                if (pos + unpackedSize > dataSize)
-                    unpackedSize = dataSize - pos;
+                // Compress blocks independently so that they can be decompressed in any order. The block offset table
+                // precedes the compressed data
+                unsigned numBlocks = firstBlocks[i - batchStart + 1] - firstBlocks[i - batchStart];
+                unsigned tableSize = (numBlocks + 1) * sizeof(unsigned);
+                unsigned blockOffset = tableSize;
 
-                unsigned packedSize = LZ4_compressHC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize);
-                if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + pos);
+                for (unsigned j = 0; j < numBlocks; ++j)
+                {
+                    const CompressWork& work = blocks[firstBlocks[i - batchStart] + j];
+                    dest.WriteUInt(blockOffset);
+                    // Blocks that compression does not make smaller are stored uncompressed
+                    blockOffset += work.packedSize_ ? work.packedSize_ : work.srcSize_;
+                }
+                dest.WriteUInt(blockOffset);
 
-                dest.WriteUShort(unpackedSize);
-                dest.WriteUShort(packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
-                totalPackedBytes += 6 + packedSize;
+                for (unsigned j = 0; j < numBlocks; ++j)
+                {
+                    const CompressWork& work = blocks[firstBlocks[i - batchStart] + j];
+                    if (work.packedSize_)
+                        dest.Write(work.dest_, work.packedSize_);
+                    else
+                        dest.Write(work.src_, work.srcSize_);
+                }
 
-                pos += unpackedSize;
+                if (!quiet_)
+                    PrintLine(entry.name_ + " in " + String(dataSize) + " out " + String(blockOffset));
             }
-
-            if (!quiet_)
-                PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes));
         }
     }
 
@@ -257,6 +443,7 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     dest.WriteUInt(currentSize + sizeof(unsigned));
 
     // Write header again with correct offsets & checksums
+    checksum_ = packageChecksum.GetValue();
     dest.Seek(0);
     WriteHeader(dest);
 
@@ -268,11 +455,26 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         dest.WriteUInt(entries_[i].checksum_);
     }
 
+    unsigned packageSize = dest.GetSize();
+    dest.Close();
+
+    if (oldPackage_)
+    {
+        oldPackageFile.Close();
+        oldPackage_.Reset();
+        if (!fileSystem_->Delete(fileName) || !fileSystem_->Rename(destFileName, fileName))
+            ErrorExit("Could not replace " + fileName + " with " + destFileName);
+    }
+
     if (!quiet_)
     {
         PrintLine("Number of files " + String(entries_.Size()));
+        if (numDuplicates)
+            PrintLine("Duplicate files " + String(numDuplicates));
+        if (numReused)
+            PrintLine("Unchanged files reused " + String(numReused));
         PrintLine("File data size " + String(totalDataSize));
-        PrintLine("Package size " + String(dest.GetSize()));
+        PrintLine("Package size " + String(packageSize));
     }
 }
 
@@ -281,7 +483,182 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZB");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+
+    if (compress_)
+    {
+        dest.WriteUInt(blockSize_);
+        dest.WriteUInt(dictionary_.Size());
+        if (dictionary_.Size())
+            dest.Write(&dictionary_[0], dictionary_.Size());
+    }
+}
+
+void LoadDictionary(const String& fileName)
+{
+    File file(context_);
+    if (!file.Open(fileName))
+        ErrorExit("Could not open dictionary file " + fileName);
+
+    // Only the last 64 KB are reachable by LZ4 back-references
+    unsigned size = Min((int)file.GetSize(), (int)MAX_DICTIONARY_SIZE);
+    dictionary_.Resize(size);
+    file.Seek(file.GetSize() - size);
+    if (size && file.Read(&dictionary_[0], size) != size)
+        ErrorExit("Could not read dictionary file " + fileName);
+}
+
+void ReadFileData(const String& fileName, unsigned char* dest, unsigned size)
+{
+    File file(context_, fileName);
+    if (!file.IsOpen())
+        ErrorExit("Could not open file " + fileName);
+    if (file.Read(dest, size) != size)
+        ErrorExit("Could not read file " + fileName);
+}
+
+bool IsSameData(File& file, const unsigned char* data, unsigned size)
+{
+    if (!file.IsOpen() || file.GetSize() != size)
+        return false;
+
+    SharedArrayPtr<unsigned char> buffer(new unsigned char[size]);
+    return file.Read(buffer.Get(), size) == size && !memcmp(buffer.Get(), data, size);
+}
+
+unsigned FindDuplicate(unsigned index, const unsigned char* data, const HashMap<unsigned, PODVector<unsigned> >& entriesByChecksum,
+    const Vector<SharedArrayPtr<unsigned char> >& batchData, unsigned batchStart, const String& rootDir)
+{
+    const FileEntry& entry = entries_[index];
+    HashMap<unsigned, PODVector<unsigned> >::ConstIterator i = entriesByChecksum.Find(entry.checksum_);
+    if (i == entriesByChecksum.End())
+        return M_MAX_UNSIGNED;
+
+    // The checksum is only 32 bits, so compare the contents of the candidates. Files of earlier batches are read again
+    for (unsigned j = 0; j < i->second_.Size(); ++j)
+    {
+        unsigned candidate = i->second_[j];
+        if (entries_[candidate].size_ != entry.size_)
+            continue;
+
+        if (candidate >= batchStart)
+        {
+            if (!memcmp(batchData[candidate - batchStart].Get(), data, entry.size_))
+                return candidate;
+        }
+        else
+        {
+            File file(context_, rootDir + "/" + entries_[candidate].name_);
+            if (IsSameData(file, data, entry.size_))
+                return candidate;
+        }
+    }
+
+    return M_MAX_UNSIGNED;
+}
+
+String FindReusable(const FileEntry& entry, const unsigned char* data, const HashMap<unsigned, Vector<String> >& oldEntriesByChecksum)
+{
+    HashMap<unsigned, Vector<String> >::ConstIterator i = oldEntriesByChecksum.Find(entry.checksum_);
+    if (i == oldEntriesByChecksum.End())
+        return String::EMPTY;
+
+    // Prefer the entry with the same name, which is the common case of an unchanged file. Decompressing and comparing is
+    // much faster than compressing again
+    for (unsigned j = 0; j < i->second_.Size(); ++j)
+    {
+        if (i->second_[j] == entry.name_)
+        {
+            File file(context_, oldPackage_, entry.name_);
+            if (IsSameData(file, data, entry.size_))
+                return entry.name_;
+        }
+    }
+
+    // Otherwise the file may have been renamed or copied
+    for (unsigned j = 0; j < i->second_.Size(); ++j)
+    {
+        if (i->second_[j] != entry.name_ && oldPackage_->GetEntry(i->second_[j])->size_ == entry.size_)
+        {
+            File file(context_, oldPackage_, i->second_[j]);
+            if (IsSameData(file, data, entry.size_))
+                return i->second_[j];
+        }
+    }
+
+    return String::EMPTY;
+}
+
+void CompressBlocks(PODVector<CompressWork>& blocks)
+{
+    if (workQueue_->GetNumThreads() && blocks.Size() > 1)
+    {
+        for (unsigned i = 0; i < blocks.Size(); ++i)
+        {
+            SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = CompressBlockWork;
+            item->start_ = &blocks[i];
+            workQueue_->AddWorkItem(item);
+        }
+
+        workQueue_->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i = 0; i < blocks.Size(); ++i)
+            blocks[i].packedSize_ = CompressBlock(blocks[i].src_, blocks[i].srcSize_, blocks[i].dest_);
+    }
+}
+
+void CompressBlockWork(const WorkItem* item, unsigned threadIndex)
+{
+    CompressWork* work = reinterpret_cast<CompressWork*>(item->start_);
+    work->packedSize_ = CompressBlock(work->src_, work->srcSize_, work->dest_);
+}
+
+unsigned CompressBlock(const unsigned char* src, unsigned srcSize, unsigned char* dest)
+{
+    // Output is limited to less than the input size, so that 0 is returned for incompressible blocks
+    int maxPackedSize = (int)srcSize - 1;
+    if (maxPackedSize <= 0)
+        return 0;
+
+    if (dictionary_.Empty())
+    {
+        return compressFast_ ? LZ4_compress_limitedOutput((const char*)src, (char*)dest, srcSize, maxPackedSize) :
+            LZ4_compressHC_limitedOutput((const char*)src, (char*)dest, srcSize, maxPackedSize);
+    }
+
+    // Lay out the dictionary and the block consecutively in a stream buffer, and compress the dictionary first so
+    // that the block can reference it. The decompressor places the dictionary right before the output in the same way
+    unsigned dictSize = dictionary_.Size();
+    unsigned bufferSize = (unsigned)Max((int)(dictSize + srcSize), (int)MIN_STREAM_BUFFER_SIZE);
+    SharedArrayPtr<unsigned char> streamBuffer(new unsigned char[bufferSize]);
+    SharedArrayPtr<unsigned char> dictOutput(new unsigned char[LZ4_compressBound(dictSize)]);
+    memcpy(streamBuffer.Get(), &dictionary_[0], dictSize);
+    memcpy(streamBuffer.Get() + dictSize, src, srcSize);
+
+    const char* dictPtr = (const char*)streamBuffer.Get();
+    const char* srcPtr = dictPtr + dictSize;
+    int packedSize;
+
+    if (compressFast_)
+    {
+        void* stream = LZ4_create(dictPtr);
+        LZ4_compress_continue(stream, dictPtr, (char*)dictOutput.Get(), dictSize);
+        packedSize = LZ4_compress_limitedOutput_continue(stream, srcPtr, (char*)dest, srcSize, maxPackedSize);
+        LZ4_free(stream);
+    }
+    else
+    {
+        void* stream = LZ4_createHC(dictPtr);
+        LZ4_compressHC_continue(stream, dictPtr, (char*)dictOutput.Get(), dictSize);
+        packedSize = LZ4_compressHC_limitedOutput_continue(stream, srcPtr, (char*)dest, srcSize, maxPackedSize);
+        LZ4_freeHC(stream);
+    }
+
+    return (unsigned)packedSize;
 }
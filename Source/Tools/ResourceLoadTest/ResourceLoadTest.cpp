@@ -0,0 +1,339 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Audio/Audio.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/AsyncIO.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/PackageFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/ResourceEvents.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+/// Resource to load.
+struct LoadEntry
+{
+    /// Resource type.
+    StringHash type_;
+    /// Resource name.
+    String name_;
+};
+
+/// Resource type to load by file extension.
+struct ExtensionType
+{
+    /// File extension.
+    const char* extension_;
+    /// Resource type name.
+    const char* typeName_;
+};
+
+static const ExtensionType extensionTypes[] = {
+    {".png", "Image"},
+    {".jpg", "Image"},
+    {".jpeg", "Image"},
+    {".tga", "Image"},
+    {".bmp", "Image"},
+    {".dds", "Image"},
+    {".ktx", "Image"},
+    {".pvr", "Image"},
+    {".xml", "XMLFile"},
+    {".json", "JSONFile"},
+    {".mdl", "Model"},
+    {".ani", "Animation"},
+    {".wav", "Sound"},
+    {".ogg", "Sound"},
+    {0, 0}
+};
+
+/// Background loading benchmark. Counts the finished resources.
+class LoadTest : public Object
+{
+    OBJECT(LoadTest);
+
+public:
+    /// Construct.
+    LoadTest(Context* context) :
+        Object(context),
+        numLoaded_(0),
+        numFailed_(0)
+    {
+        SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, HANDLER(LoadTest, HandleResourceBackgroundLoaded));
+    }
+
+    /// Background load all entries and wait until finished. Return elapsed time in seconds.
+    float Run(const Vector<LoadEntry>& entries, unsigned numThreads)
+    {
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+        Time* time = GetSubsystem<Time>();
+
+        cache->ReleaseAllResources(true);
+        cache->SetNumBackgroundLoadThreads(numThreads);
+        numLoaded_ = 0;
+        numFailed_ = 0;
+
+        HiresTimer timer;
+        for (unsigned i = 0; i < entries.Size(); ++i)
+            cache->BackgroundLoadResource(entries[i].type_, entries[i].name_, false);
+
+        // Finishing the resources happens on the begin frame event
+        while (cache->GetNumBackgroundLoadResources())
+        {
+            time->BeginFrame(0.0f);
+            time->EndFrame();
+            Time::Sleep(1);
+        }
+
+        return timer.GetUSec(false) / 1000000.0f;
+    }
+
+    /// Number of successfully loaded resources in the last run.
+    unsigned numLoaded_;
+    /// Number of failed resources in the last run.
+    unsigned numFailed_;
+
+private:
+    /// Handle a background loaded resource.
+    void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace ResourceBackgroundLoaded;
+
+        if (eventData[P_SUCCESS].GetBool())
+            ++numLoaded_;
+        else
+            ++numFailed_;
+    }
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+        ErrorExit(
+            "Usage: ResourceLoadTest <resource directory or package file> [options]\n"
+            "\n"
+            "Background loads all recognized resources (images, XML and JSON files, models, animations\n"
+            "and sounds) from the directory or package file and reports the loading throughput.\n"
+            "\n"
+            "Options:\n"
+            "-threads <list>  Comma-separated background load thread counts to test, default 1 and the\n"
+            "                 number of physical CPU cores minus one\n"
+            "-repeat <num>    Number of load passes per thread count, default 3\n"
+            "-limit <type> <num>  Maximum number of concurrent loads for a resource type\n"
+            "-mmap            Map the package file into memory instead of reading it through file I/O\n"
+            "-sync            Read files in the load threads instead of queuing asynchronous reads\n"
+            "-iothreads <num> Number of asynchronous I/O threads, default 2\n"
+            "-trace <file>    Save per-resource load timings of the last pass. Saved as comma-separated\n"
+            "                 values if the file extension is .csv, otherwise as a Chrome trace JSON file\n"
+            "\n"
+            "The first pass of each thread count may be served from the operating system's file cache\n"
+            "if the files were read recently. To measure cold loading, drop the file cache before running.\n"
+        );
+
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    context->RegisterSubsystem(new FileSystem(context));
+    AsyncIO* asyncIO = new AsyncIO(context);
+    context->RegisterSubsystem(asyncIO);
+    SharedPtr<Log> log(new Log(context));
+    context->RegisterSubsystem(log);
+    log->SetLevel(LOG_WARNING);
+    ResourceCache* cache = new ResourceCache(context);
+    context->RegisterSubsystem(cache);
+    RegisterGraphicsLibrary(context);
+    RegisterAudioLibrary(context);
+
+    FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+    bool isPackage = fileSystem->FileExists(arguments[0]);
+    String dirName = isPackage ? arguments[0] : AddTrailingSlash(arguments[0]);
+    PODVector<unsigned> threadCounts;
+    unsigned numRepeats = 3;
+    String traceFileName;
+
+    for (unsigned i = 1; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        if (argument == "-threads" && i + 1 < arguments.Size())
+        {
+            Vector<String> counts = arguments[++i].Split(',');
+            for (unsigned j = 0; j < counts.Size(); ++j)
+                threadCounts.Push(Max(ToInt(counts[j]), 1));
+        }
+        else if (argument == "-repeat" && i + 1 < arguments.Size())
+            numRepeats = Max(ToInt(arguments[++i]), 1);
+        else if (argument == "-limit" && i + 2 < arguments.Size())
+        {
+            String typeName = arguments[++i];
+            cache->SetMaxConcurrentBackgroundLoads(typeName, ToUInt(arguments[++i]));
+        }
+        else if (argument == "-mmap")
+            cache->SetMemoryMapPackages(true);
+        else if (argument == "-sync")
+            cache->SetAsyncFileReads(false);
+        else if (argument == "-iothreads" && i + 1 < arguments.Size())
+            asyncIO->SetNumThreads(ToUInt(arguments[++i]));
+        else if (argument == "-trace" && i + 1 < arguments.Size())
+            traceFileName = arguments[++i];
+        else
+            ErrorExit("Unknown option " + arguments[i]);
+    }
+
+    if (threadCounts.Empty())
+    {
+        threadCounts.Push(1);
+        if (cache->GetNumBackgroundLoadThreads() > 1)
+            threadCounts.Push(cache->GetNumBackgroundLoadThreads());
+    }
+
+    // Collect the resources to load
+    Vector<String> fileNames;
+    SharedPtr<PackageFile> package;
+    if (isPackage)
+    {
+        package = new PackageFile(context);
+        if (!package->Open(dirName) || !cache->AddPackageFile(package))
+            ErrorExit("Could not add package file " + dirName);
+        fileNames = package->GetEntryNames();
+    }
+    else
+    {
+        if (!cache->AddResourceDir(dirName))
+            ErrorExit("Could not add resource directory " + dirName);
+        fileSystem->ScanDir(fileNames, dirName, "*.*", SCAN_FILES, true);
+    }
+
+    Vector<LoadEntry> entries;
+    unsigned long long totalSize = 0;
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        String extension = GetExtension(fileNames[i]);
+        for (unsigned j = 0; extensionTypes[j].extension_; ++j)
+        {
+            if (extension == extensionTypes[j].extension_)
+            {
+                LoadEntry entry;
+                entry.type_ = extensionTypes[j].typeName_;
+                entry.name_ = fileNames[i];
+                entries.Push(entry);
+
+                if (package)
+                    totalSize += package->GetEntry(fileNames[i])->size_;
+                else
+                {
+                    File file(context, dirName + fileNames[i]);
+                    totalSize += file.GetSize();
+                }
+                break;
+            }
+        }
+    }
+
+    if (entries.Empty())
+        ErrorExit("No resources found in " + dirName);
+
+    PrintLine("Loading " + String(entries.Size()) + " resources, " + String((unsigned)(totalSize / 1024)) + " KB");
+    if (package)
+        PrintLine(package->IsMemoryMapped() ? "Package file is memory mapped" : "Package file is read through file I/O");
+    if (cache->GetAsyncFileReads())
+        PrintLine("Files are read asynchronously with " + String(asyncIO->GetNumThreads()) + " I/O threads");
+    else
+        PrintLine("Files are read synchronously in the load threads");
+    char line[256];
+    sprintf(line, "%-8s %-6s %10s %8s %8s %12s %10s", "Threads", "Pass", "Time (ms)", "Loaded", "Failed", "Resources/s", "MB/s");
+    PrintLine(line);
+
+    SharedPtr<LoadTest> test(new LoadTest(context));
+    for (unsigned i = 0; i < threadCounts.Size(); ++i)
+    {
+        float totalTime = 0.0f;
+        for (unsigned j = 0; j < numRepeats; ++j)
+        {
+            // Restart the trace so that only the last pass remains
+            if (!traceFileName.Empty())
+            {
+                cache->SetLoadTraceEnabled(false);
+                cache->SetLoadTraceEnabled(true);
+            }
+
+            float elapsed = Max(test->Run(entries, threadCounts[i]), M_EPSILON);
+            totalTime += elapsed;
+            sprintf(line, "%-8u %-6u %10.1f %8u %8u %12.1f %10.2f", threadCounts[i], j + 1, elapsed * 1000.0f,
+                test->numLoaded_, test->numFailed_, entries.Size() / elapsed, totalSize / 1048576.0f / elapsed);
+            PrintLine(line);
+        }
+
+        float average = totalTime / numRepeats;
+        sprintf(line, "%-8u %-6s %10.1f %8s %8s %12.1f %10.2f", threadCounts[i], "avg", average * 1000.0f, "", "",
+            entries.Size() / average, totalSize / 1048576.0f / average);
+        PrintLine(line);
+    }
+
+    if (asyncIO->GetNumReads())
+        PrintLine("Asynchronous I/O performed " + String(asyncIO->GetNumReads()) + " reads of " + String((unsigned)(asyncIO->GetNumBytesRead() /
+            1024)) + " KB");
+
+    if (!traceFileName.Empty())
+    {
+        cache->SetLoadTraceEnabled(false);
+
+        File traceFile(context);
+        bool success = traceFile.Open(traceFileName, FILE_WRITE);
+        if (success)
+            success = GetExtension(traceFileName) == ".csv" ? cache->SaveLoadRecordsCSV(traceFile) : cache->SaveLoadTrace(traceFile);
+        if (!success)
+            ErrorExit("Could not save load trace " + traceFileName);
+        PrintLine("Saved " + String(cache->GetNumLoadRecords()) + " load records to " + traceFileName);
+    }
+}
@@ -0,0 +1,605 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Scene/LogicComponent.h>
+#include <Urho3D/Scene/Prefab.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/ValueAnimation.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+/// Logic component that moves its node on each update.
+class BenchmarkLogic : public LogicComponent
+{
+    OBJECT(BenchmarkLogic);
+
+public:
+    /// Construct.
+    BenchmarkLogic(Context* context) :
+        LogicComponent(context),
+        phase_(Random(M_PI))
+    {
+        SetUpdateEventMask(USE_UPDATE);
+    }
+
+    /// Register object factory and attributes.
+    static void RegisterObject(Context* context)
+    {
+        context->RegisterFactory<BenchmarkLogic>();
+
+        ATTRIBUTE("Phase", float, phase_, 0.0f, AM_DEFAULT);
+    }
+
+    /// Move along a circle.
+    virtual void Update(float timeStep)
+    {
+        phase_ += timeStep;
+        node_->SetPosition(Vector3(Cos(phase_ * M_RADTODEG), 0.0f, Sin(phase_ * M_RADTODEG)));
+        node_->Rotate(Quaternion(timeStep * 90.0f, Vector3::UP));
+    }
+
+private:
+    /// Current phase in radians.
+    float phase_;
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void CreateHierarchy(Node* parent, unsigned depth, unsigned numChildren, PODVector<Node*>& nodes);
+float RunTransformTest(Scene* scene, const PODVector<Node*>& nodes, unsigned numFrames, float movedFraction, bool batching);
+float RunLogicTest(Context* context, unsigned numNodes, unsigned numFrames, bool threadSafe);
+float RunAnimationTest(Context* context, unsigned numFrames, bool batched);
+void RunSaveLoadTest(Scene* scene, const char* name, unsigned format);
+void RunReplicationTest(Scene* scene);
+float RunLookupTest(Scene* scene, const PODVector<Node*>& nodes, unsigned numRounds, bool components);
+float RunQueryTest(Scene* scene, unsigned numComponents, unsigned numRounds, bool byType);
+float RunSpawnTest(Context* context, unsigned numSpawns, unsigned method);
+
+/// Scene persistence formats compared by the save and load test.
+enum SaveFormat
+{
+    FORMAT_SNAPSHOT = 0,
+    FORMAT_BINARY,
+    FORMAT_XML,
+    MAX_SAVE_FORMATS
+};
+
+static const char* saveFormatNames[] =
+{
+    "Save/load, snapshot",
+    "Save/load, binary",
+    "Save/load, XML"
+};
+
+/// Object spawning methods compared by the spawn test.
+enum SpawnMethod
+{
+    SPAWN_BINARY = 0,
+    SPAWN_XML,
+    SPAWN_PREFAB,
+    SPAWN_POOLED,
+    SPAWN_PREPARED,
+    MAX_SPAWN_METHODS
+};
+
+static const char* spawnMethodNames[] =
+{
+    "Spawn, binary",
+    "Spawn, XML",
+    "Spawn, prefab",
+    "Spawn, prefab pooled",
+    "Spawn, prefab prepared"
+};
+
+/// Number of child nodes in the spawned object.
+static const unsigned SPAWN_CHILDREN = 8;
+/// Number of animated attributes in the attribute animation test.
+static const unsigned ANIMATED_ATTRIBUTES = 10000;
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    context->RegisterSubsystem(new WorkQueue(context));
+    SharedPtr<Log> log(new Log(context));
+    context->RegisterSubsystem(log);
+    log->SetLevel(LOG_WARNING);
+    RegisterSceneLibrary(context);
+    BenchmarkLogic::RegisterObject(context);
+
+    unsigned numNodes = 100000;
+    unsigned depth = 4;
+    unsigned numFrames = 100;
+    unsigned numThreads = GetNumPhysicalCPUs() > 1 ? GetNumPhysicalCPUs() - 1 : 0;
+    float movedFraction = 1.0f;
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        if (argument == "-nodes" && i + 1 < arguments.Size())
+            numNodes = Max(ToInt(arguments[++i]), 1);
+        else if (argument == "-depth" && i + 1 < arguments.Size())
+            depth = Max(ToInt(arguments[++i]), 1);
+        else if (argument == "-frames" && i + 1 < arguments.Size())
+            numFrames = Max(ToInt(arguments[++i]), 1);
+        else if (argument == "-threads" && i + 1 < arguments.Size())
+            numThreads = ToUInt(arguments[++i]);
+        else if (argument == "-moved" && i + 1 < arguments.Size())
+            movedFraction = Clamp(ToFloat(arguments[++i]) / 100.0f, 0.0f, 1.0f);
+        else
+        {
+            ErrorExit(
+                "Usage: SceneBenchmark [options]\n"
+                "\n"
+                "Measures the per-frame cost of scene updates on a large generated node hierarchy, and the time to save\n"
+                "and load it as a snapshot, in the binary format and as XML.\n"
+                "\n"
+                "Options:\n"
+                "-nodes <num>     Approximate number of nodes to create, default 100000\n"
+                "-depth <num>     Depth of the node hierarchy, default 4\n"
+                "-frames <num>    Number of frames to measure per test, default 100\n"
+                "-threads <num>   Number of worker threads, default the number of physical CPU cores minus one\n"
+                "-moved <percent> Percentage of nodes moved each frame, default 100\n"
+            );
+        }
+    }
+
+    if (numThreads)
+        context->GetSubsystem<WorkQueue>()->CreateThreads(numThreads);
+
+    // Choose the number of children per node so that the hierarchy holds roughly the requested number of nodes
+    unsigned numChildren = Max((int)(powf((float)numNodes, 1.0f / depth) + 0.5f), 1);
+
+    SharedPtr<Scene> scene(new Scene(context));
+    PODVector<Node*> nodes;
+    CreateHierarchy(scene, depth, numChildren, nodes);
+
+    char line[256];
+    sprintf(line, "%u nodes, depth %u, %u children per node, %u worker threads, %.0f%% moved per frame", nodes.Size(), depth,
+        numChildren, numThreads, movedFraction * 100.0f);
+    PrintLine(line);
+    sprintf(line, "%-28s %12s %14s", "Test", "ms/frame", "Nodes/s");
+    PrintLine(line);
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool batching = i == 1;
+        float elapsed = Max(RunTransformTest(scene, nodes, numFrames, movedFraction, batching), M_EPSILON);
+        sprintf(line, "%-28s %12.3f %14.0f", batching ? "Transforms, batched" : "Transforms, on demand", elapsed * 1000.0f /
+            numFrames, nodes.Size() * numFrames / elapsed);
+        PrintLine(line);
+    }
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool threadSafe = i == 1;
+        float elapsed = Max(RunLogicTest(context, nodes.Size(), numFrames, threadSafe), M_EPSILON);
+        sprintf(line, "%-28s %12.3f %14.0f", threadSafe ? "Logic, thread-safe" : "Logic, update events", elapsed * 1000.0f /
+            numFrames, nodes.Size() * numFrames / elapsed);
+        PrintLine(line);
+    }
+
+    PrintLine("");
+    sprintf(line, "%-28s %12s %14s", "Test", "ms/frame", "Attributes/s");
+    PrintLine(line);
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool batched = i == 1;
+        float elapsed = Max(RunAnimationTest(context, numFrames, batched), M_EPSILON);
+        sprintf(line, "%-28s %12.3f %14.0f", batched ? "Animation, batched" : "Animation, per attribute", elapsed * 1000.0f /
+            numFrames, ANIMATED_ATTRIBUTES * numFrames / elapsed);
+        PrintLine(line);
+    }
+
+    // Give each node a component for the save and load test
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+        nodes[i]->CreateComponent<BenchmarkLogic>(LOCAL);
+
+    PrintLine("");
+    sprintf(line, "%-28s %12s %12s %14s", "Test", "Write ms", "Read ms", "Bytes");
+    PrintLine(line);
+    for (unsigned i = 0; i < MAX_SAVE_FORMATS; ++i)
+        RunSaveLoadTest(scene, saveFormatNames[i], i);
+    RunReplicationTest(scene);
+
+    // Look up every node and component by ID in random order, as scene loading and client replication do
+    const unsigned numRounds = 10;
+    PrintLine("");
+    sprintf(line, "%-28s %12s %14s", "Test", "ms", "Lookups/s");
+    PrintLine(line);
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool components = i == 1;
+        float elapsed = RunLookupTest(scene, nodes, numRounds, components);
+        if (elapsed < 0.0f)
+            sprintf(line, "%-28s %12s", components ? "Lookup, components" : "Lookup, nodes", "failed");
+        else
+        {
+            sprintf(line, "%-28s %12.3f %14.0f", components ? "Lookup, components" : "Lookup, nodes", elapsed * 1000.0f,
+                nodes.Size() * numRounds / Max(elapsed, M_EPSILON));
+        }
+        PrintLine(line);
+    }
+
+    // Get all components of a type, by searching the hierarchy and from the scene's type lists
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool byType = i == 1;
+        float elapsed = RunQueryTest(scene, nodes.Size(), numRounds, byType);
+        if (elapsed < 0.0f)
+            sprintf(line, "%-28s %12s", byType ? "Query, by type" : "Query, hierarchy", "failed");
+        else
+        {
+            sprintf(line, "%-28s %12.3f %14.0f", byType ? "Query, by type" : "Query, hierarchy", elapsed * 1000.0f,
+                nodes.Size() * numRounds / Max(elapsed, M_EPSILON));
+        }
+        PrintLine(line);
+    }
+
+    // Spawn objects totaling a tenth of the nodes
+    unsigned numSpawns = Max((int)(nodes.Size() / (SPAWN_CHILDREN + 1) / 10), 1);
+    PrintLine("");
+    sprintf(line, "%-28s %12s %14s", "Test", "ms", "Spawns/s");
+    PrintLine(line);
+    for (unsigned i = 0; i < MAX_SPAWN_METHODS; ++i)
+    {
+        float elapsed = RunSpawnTest(context, numSpawns, i);
+        if (elapsed < 0.0f)
+            sprintf(line, "%-28s %12s", spawnMethodNames[i], "failed");
+        else
+            sprintf(line, "%-28s %12.3f %14.0f", spawnMethodNames[i], elapsed * 1000.0f, numSpawns / Max(elapsed, M_EPSILON));
+        PrintLine(line);
+    }
+}
+
+void CreateHierarchy(Node* parent, unsigned depth, unsigned numChildren, PODVector<Node*>& nodes)
+{
+    for (unsigned i = 0; i < numChildren; ++i)
+    {
+        Node* node = parent->CreateChild(String::EMPTY, LOCAL);
+        node->SetPosition(Vector3(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)));
+        nodes.Push(node);
+        if (depth > 1)
+            CreateHierarchy(node, depth - 1, numChildren, nodes);
+    }
+}
+
+float RunTransformTest(Scene* scene, const PODVector<Node*>& nodes, unsigned numFrames, float movedFraction, bool batching)
+{
+    scene->SetTransformBatching(batching);
+    SetRandomSeed(1);
+
+    // Read the world transforms of all nodes each frame, like rendering would
+    HiresTimer timer;
+    Vector3 sum;
+    for (unsigned i = 0; i < numFrames; ++i)
+    {
+        Quaternion rotation(i * 0.1f, Vector3::UP);
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+        {
+            if (Random() < movedFraction)
+                nodes[j]->SetRotation(rotation);
+        }
+
+        scene->UpdateTransforms();
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+            sum += nodes[j]->GetWorldPosition();
+    }
+
+    // Use the result so that the reads are not optimized away
+    if (sum.x_ == M_INFINITY)
+        PrintLine("Invalid transforms");
+
+    scene->SetTransformBatching(false);
+    return timer.GetUSec(false) / 1000000.0f;
+}
+
+float RunLogicTest(Context* context, unsigned numNodes, unsigned numFrames, bool threadSafe)
+{
+    // Use a flat hierarchy, as thread-safe components must not move nodes of the same hierarchy
+    SharedPtr<Scene> scene(new Scene(context));
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        BenchmarkLogic* logic = scene->CreateChild(String::EMPTY, LOCAL)->CreateComponent<BenchmarkLogic>(LOCAL);
+        logic->SetThreadSafeUpdate(threadSafe);
+    }
+
+    // The first update calls the delayed start functions, so leave it out of the measurement
+    const float timeStep = 1.0f / 60.0f;
+    scene->Update(timeStep);
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numFrames; ++i)
+        scene->Update(timeStep);
+
+    return timer.GetUSec(false) / 1000000.0f;
+}
+
+float RunAnimationTest(Context* context, unsigned numFrames, bool batched)
+{
+    // Animate the position of each node linearly and its scale along a spline
+    SharedPtr<ValueAnimation> positionAnimation(new ValueAnimation(context));
+    SharedPtr<ValueAnimation> scaleAnimation(new ValueAnimation(context));
+    scaleAnimation->SetInterpolationMethod(IM_SPLINE);
+    for (unsigned i = 0; i < 5; ++i)
+    {
+        positionAnimation->SetKeyFrame(i * 0.25f, Vector3(Random(10.0f), Random(10.0f), Random(10.0f)));
+        scaleAnimation->SetKeyFrame(i * 0.25f, Vector3::ONE * Random(0.5f, 2.0f));
+    }
+
+    SharedPtr<Scene> scene(new Scene(context));
+    PODVector<Node*> nodes;
+    PODVector<float> speeds;
+    for (unsigned i = 0; i < ANIMATED_ATTRIBUTES / 2; ++i)
+    {
+        Node* node = scene->CreateChild(String::EMPTY, LOCAL);
+        float speed = Random(0.5f, 2.0f);
+        if (batched)
+        {
+            node->SetAttributeAnimation("Position", positionAnimation, WM_LOOP, speed);
+            node->SetAttributeAnimation("Scale", scaleAnimation, WM_LOOP, speed);
+        }
+        nodes.Push(node);
+        speeds.Push(speed);
+    }
+
+    // Compare against evaluating and setting each attribute on its own through variants
+    const float timeStep = 1.0f / 60.0f;
+    float time = 0.0f;
+    HiresTimer timer;
+    for (unsigned i = 0; i < numFrames; ++i)
+    {
+        if (batched)
+            scene->Update(timeStep);
+        else
+        {
+            time += timeStep;
+            for (unsigned j = 0; j < nodes.Size(); ++j)
+            {
+                float scaledTime = fmodf(time * speeds[j], 1.0f);
+                nodes[j]->SetAttribute("Position", positionAnimation->GetAnimationValue(scaledTime));
+                nodes[j]->SetAttribute("Scale", scaleAnimation->GetAnimationValue(scaledTime));
+            }
+        }
+    }
+
+    return timer.GetUSec(false) / 1000000.0f;
+}
+
+void RunSaveLoadTest(Scene* scene, const char* name, unsigned format)
+{
+    VectorBuffer buffer;
+    HiresTimer timer;
+    bool success;
+    if (format == FORMAT_SNAPSHOT)
+        success = scene->SaveSnapshot(buffer);
+    else if (format == FORMAT_BINARY)
+        success = scene->Save(buffer);
+    else
+        success = scene->SaveXML(buffer);
+    float saveTime = timer.GetUSec(true) / 1000.0f;
+
+    // Load into a new scene, so that the source scene is left intact for the next test
+    SharedPtr<Scene> loadScene(new Scene(scene->GetContext()));
+    buffer.Seek(0);
+    timer.Reset();
+    if (format == FORMAT_SNAPSHOT)
+        success &= loadScene->LoadSnapshot(buffer);
+    else if (format == FORMAT_BINARY)
+        success &= loadScene->Load(buffer);
+    else
+        success &= loadScene->LoadXML(buffer);
+    float loadTime = timer.GetUSec(false) / 1000.0f;
+
+    char line[256];
+    if (!success || loadScene->GetNumChildren(true) != scene->GetNumChildren(true))
+        sprintf(line, "%-28s %12s", name, "failed");
+    else
+        sprintf(line, "%-28s %12.3f %12.3f %14u", name, saveTime, loadTime, buffer.GetSize());
+    PrintLine(line);
+}
+
+void RunReplicationTest(Scene* scene)
+{
+    // Copy the scene to receive the updates, as a client would have it
+    VectorBuffer snapshot;
+    scene->SaveSnapshot(snapshot);
+    SharedPtr<Scene> clientScene(new Scene(scene->GetContext()));
+    snapshot.Seek(0);
+    clientScene->LoadSnapshot(snapshot);
+
+    PODVector<Node*> nodes;
+    PODVector<Node*> clientNodes;
+    scene->GetChildren(nodes, true);
+    clientScene->GetChildren(clientNodes, true);
+
+    // Check the network attributes of each node and component for changes and write their initial updates like the server
+    VectorBuffer buffer;
+    HiresTimer timer;
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        Node* node = nodes[i];
+        node->PrepareNetworkUpdate();
+        node->WriteInitialDeltaUpdate(buffer, 0);
+
+        const Vector<SharedPtr<Component> >& components = node->GetComponents();
+        for (unsigned j = 0; j < components.Size(); ++j)
+        {
+            components[j]->PrepareNetworkUpdate();
+            components[j]->WriteInitialDeltaUpdate(buffer, 0);
+        }
+    }
+    float writeTime = timer.GetUSec(true) / 1000.0f;
+
+    // Then apply them to the copy like the client
+    buffer.Seek(0);
+    timer.Reset();
+    for (unsigned i = 0; i < clientNodes.Size(); ++i)
+    {
+        Node* node = clientNodes[i];
+        node->ReadDeltaUpdate(buffer);
+
+        const Vector<SharedPtr<Component> >& components = node->GetComponents();
+        for (unsigned j = 0; j < components.Size(); ++j)
+            components[j]->ReadDeltaUpdate(buffer);
+    }
+    float readTime = timer.GetUSec(false) / 1000.0f;
+
+    char line[256];
+    if (buffer.GetPosition() != buffer.GetSize() || clientNodes.Size() != nodes.Size())
+        sprintf(line, "%-28s %12s", "Replication, initial", "failed");
+    else
+        sprintf(line, "%-28s %12.3f %12.3f %14u", "Replication, initial", writeTime, readTime, buffer.GetSize());
+    PrintLine(line);
+}
+
+float RunLookupTest(Scene* scene, const PODVector<Node*>& nodes, unsigned numRounds, bool components)
+{
+    PODVector<unsigned> ids(nodes.Size());
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+        ids[i] = components ? nodes[i]->GetComponents()[0]->GetID() : nodes[i]->GetID();
+    for (unsigned i = ids.Size() - 1; i > 0; --i)
+        Swap(ids[i], ids[((unsigned)Rand() << 15 | Rand()) % (i + 1)]);
+
+    unsigned found = 0;
+    HiresTimer timer;
+    for (unsigned i = 0; i < numRounds; ++i)
+    {
+        if (components)
+        {
+            for (unsigned j = 0; j < ids.Size(); ++j)
+                found += scene->GetComponent(ids[j]) ? 1 : 0;
+        }
+        else
+        {
+            for (unsigned j = 0; j < ids.Size(); ++j)
+                found += scene->GetNode(ids[j]) ? 1 : 0;
+        }
+    }
+    float elapsed = timer.GetUSec(false) / 1000000.0f;
+
+    return found == ids.Size() * numRounds ? elapsed : -1.0f;
+}
+
+float RunQueryTest(Scene* scene, unsigned numComponents, unsigned numRounds, bool byType)
+{
+    PODVector<BenchmarkLogic*> components;
+    unsigned found = 0;
+    HiresTimer timer;
+    for (unsigned i = 0; i < numRounds; ++i)
+    {
+        if (byType)
+            components = scene->GetComponentsByType<BenchmarkLogic>();
+        else
+            scene->GetComponents<BenchmarkLogic>(components, true);
+        found += components.Size();
+    }
+    float elapsed = timer.GetUSec(false) / 1000000.0f;
+
+    return found == numComponents * numRounds ? elapsed : -1.0f;
+}
+
+float RunSpawnTest(Context* context, unsigned numSpawns, unsigned method)
+{
+    // Define the object as a node with child nodes that each have a logic component
+    SharedPtr<Scene> scene(new Scene(context));
+    Node* source = scene->CreateChild("Object", LOCAL);
+    for (unsigned i = 0; i < SPAWN_CHILDREN; ++i)
+    {
+        Node* child = source->CreateChild(String::EMPTY, LOCAL);
+        child->SetPosition(Vector3((float)i, 0.0f, 0.0f));
+        child->CreateComponent<BenchmarkLogic>(LOCAL);
+    }
+
+    VectorBuffer binary;
+    VectorBuffer xml;
+    source->Save(binary);
+    source->SaveXML(xml);
+    SharedPtr<Prefab> prefab(new Prefab(context));
+    prefab->Define(source);
+    source->Remove();
+
+    // Fill the pool before the measurement, either by releasing spawned objects or by preparing them
+    if (method == SPAWN_POOLED)
+    {
+        PODVector<Node*> spawned;
+        prefab->SetMaxPoolSize(numSpawns);
+        for (unsigned i = 0; i < numSpawns; ++i)
+            spawned.Push(prefab->Instantiate(scene, Vector3::ZERO, Quaternion::IDENTITY, LOCAL));
+        for (unsigned i = 0; i < spawned.Size(); ++i)
+            prefab->Release(spawned[i]);
+    }
+    else if (method == SPAWN_PREPARED)
+        prefab->Prepare(numSpawns);
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numSpawns; ++i)
+    {
+        if (method == SPAWN_BINARY)
+        {
+            binary.Seek(0);
+            scene->Instantiate(binary, Vector3::ZERO, Quaternion::IDENTITY, LOCAL);
+        }
+        else if (method == SPAWN_XML)
+        {
+            xml.Seek(0);
+            scene->InstantiateXML(xml, Vector3::ZERO, Quaternion::IDENTITY, LOCAL);
+        }
+        else
+            prefab->Instantiate(scene, Vector3::ZERO, Quaternion::IDENTITY, LOCAL);
+    }
+    float elapsed = timer.GetUSec(false) / 1000000.0f;
+
+    return scene->GetNumChildren(true) == numSpawns * (SPAWN_CHILDREN + 1) ? elapsed : -1.0f;
+}
@@ -0,0 +1,288 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/Decompress.h>
+#include <Urho3D/Resource/Image.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void Benchmark(Image* image, CompressedFormat format, WorkQueue* queue, unsigned numRepeats);
+void BenchmarkDecompress(Image* image, WorkQueue* queue, unsigned numRepeats);
+void PrintResultHeader();
+void PrintResult(const char* operation, unsigned numThreads, unsigned numPixels, unsigned numRepeats, long long usec);
+const char* GetFormatName(CompressedFormat format);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+        ErrorExit(
+            "Usage: TextureCompressor <input file> [output file] [options]\n"
+            "\n"
+            "Compresses an uncompressed image to a DXT compressed DDS file including the full mip chain.\n"
+            "If the input image is already compressed (DDS, KTX or PVR), the first mip level is\n"
+            "decompressed instead and saved as a PNG file.\n"
+            "\n"
+            "Options:\n"
+            "-format <fmt>    Compression format dxt1, dxt3 or dxt5. Default dxt5 for images with alpha,\n"
+            "                 otherwise dxt1\n"
+            "-bench <num>     Measure compression and decompression throughput of the first mip level\n"
+            "                 over the given number of passes, single-threaded and multithreaded\n"
+            "-threads <num>   Number of worker threads, default the number of physical CPU cores minus one\n"
+        );
+
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    context->RegisterSubsystem(new FileSystem(context));
+    SharedPtr<Log> log(new Log(context));
+    context->RegisterSubsystem(log);
+    log->SetLevel(LOG_WARNING);
+    WorkQueue* queue = new WorkQueue(context);
+    context->RegisterSubsystem(queue);
+
+    String inputFile = arguments[0];
+    String outputFile;
+    String formatName;
+    unsigned numRepeats = 0;
+    unsigned numThreads = Max((int)GetNumPhysicalCPUs() - 1, 1);
+
+    for (unsigned i = 1; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        if (argument == "-format" && i + 1 < arguments.Size())
+            formatName = arguments[++i].ToLower();
+        else if (argument == "-bench" && i + 1 < arguments.Size())
+            numRepeats = Max(ToInt(arguments[++i]), 1);
+        else if (argument == "-threads" && i + 1 < arguments.Size())
+            numThreads = ToUInt(arguments[++i]);
+        else if (argument[0] != '-' && outputFile.Empty())
+            outputFile = arguments[i];
+        else
+            ErrorExit("Unknown option " + arguments[i]);
+    }
+
+    queue->CreateThreads(numThreads);
+
+    File inFile(context, inputFile);
+    if (!inFile.IsOpen())
+        ErrorExit("Could not open input file " + inputFile);
+    SharedPtr<Image> image(new Image(context));
+    if (!image->Load(inFile))
+        ErrorExit("Could not load image " + inputFile);
+
+    if (image->IsCompressed())
+    {
+        PrintLine(ToString("Image is %dx%d %s with %u mip levels", image->GetWidth(), image->GetHeight(),
+            GetFormatName(image->GetCompressedFormat()), image->GetNumCompressedLevels()));
+
+        if (numRepeats)
+            BenchmarkDecompress(image, queue, numRepeats);
+
+        if (!outputFile.Empty())
+        {
+            SharedPtr<Image> decompressed = image->GetDecompressedImage();
+            if (!decompressed || !decompressed->SavePNG(outputFile))
+                ErrorExit("Could not save output file " + outputFile);
+        }
+        return;
+    }
+
+    CompressedFormat format;
+    if (formatName.Empty())
+        format = (image->GetComponents() == 2 || image->GetComponents() == 4) ? CF_DXT5 : CF_DXT1;
+    else if (formatName == "dxt1")
+        format = CF_DXT1;
+    else if (formatName == "dxt3")
+        format = CF_DXT3;
+    else if (formatName == "dxt5")
+        format = CF_DXT5;
+    else
+        ErrorExit("Unsupported compression format " + formatName);
+
+    if (image->GetDepth() > 1)
+        ErrorExit("Can not compress 3D image");
+
+    PrintLine(ToString("Image is %dx%d with %u components", image->GetWidth(), image->GetHeight(), image->GetComponents()));
+
+    if (numRepeats)
+        Benchmark(image, format, queue, numRepeats);
+
+    if (!outputFile.Empty())
+    {
+        HiresTimer timer;
+        if (!image->Compress(format))
+            ErrorExit("Could not compress image");
+        PrintLine(ToString("Compressed to %s with %u mip levels in %u ms", GetFormatName(format), image->GetNumCompressedLevels(),
+            (unsigned)(timer.GetUSec(false) / 1000)));
+        if (!image->SaveDDS(outputFile))
+            ErrorExit("Could not save output file " + outputFile);
+    }
+}
+
+void PrintResultHeader()
+{
+    char line[256];
+    sprintf(line, "%-12s %-8s %10s %10s", "Operation", "Threads", "Time (ms)", "MP/s");
+    PrintLine(line);
+}
+
+void PrintResult(const char* operation, unsigned numThreads, unsigned numPixels, unsigned numRepeats, long long usec)
+{
+    float elapsed = Max(usec / 1000000.0f, M_EPSILON);
+    char line[256];
+    sprintf(line, "%-12s %-8u %10.2f %10.1f", operation, numThreads, elapsed * 1000.0f / numRepeats,
+        (float)numPixels * numRepeats / 1000000.0f / elapsed);
+    PrintLine(line);
+}
+
+void Benchmark(Image* image, CompressedFormat format, WorkQueue* queue, unsigned numRepeats)
+{
+    SharedPtr<Image> rgbaImage = image->ConvertToRGBA();
+    if (!rgbaImage)
+        ErrorExit("Could not convert image to RGBA");
+
+    int width = rgbaImage->GetWidth();
+    int height = rgbaImage->GetHeight();
+    unsigned numPixels = (unsigned)(width * height);
+    PODVector<unsigned char> blocks(((width + 3) / 4) * ((height + 3) / 4) * (format == CF_DXT1 ? 8 : 16));
+    PODVector<unsigned char> decompressed(numPixels * 4);
+
+    PrintResultHeader();
+
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        // First pass runs single-threaded, second on the work queue
+        WorkQueue* passQueue = pass ? queue : 0;
+        unsigned numThreads = pass ? queue->GetNumThreads() + 1 : 1;
+        if (pass && !queue->GetNumThreads())
+            break;
+
+        HiresTimer timer;
+        for (unsigned i = 0; i < numRepeats; ++i)
+            CompressImageDXT(&blocks[0], rgbaImage->GetData(), width, height, format, passQueue);
+        PrintResult("Compress", numThreads, numPixels, numRepeats, timer.GetUSec(false));
+
+        timer.Reset();
+        for (unsigned i = 0; i < numRepeats; ++i)
+            DecompressImageDXT(&decompressed[0], &blocks[0], width, height, 1, format, passQueue);
+        PrintResult("Decompress", numThreads, numPixels, numRepeats, timer.GetUSec(false));
+    }
+
+    // Report the compression error of the first mip level
+    const unsigned char* original = rgbaImage->GetData();
+    double squaredError = 0.0;
+    for (unsigned i = 0; i < numPixels * 4; ++i)
+    {
+        // Alpha is not stored by DXT1
+        if (format == CF_DXT1 && (i & 3) == 3)
+            continue;
+        int difference = (int)decompressed[i] - (int)original[i];
+        squaredError += difference * difference;
+    }
+    double meanSquaredError = squaredError / (numPixels * (format == CF_DXT1 ? 3 : 4));
+    PrintLine("RMS error " + String((float)sqrt(meanSquaredError)));
+}
+
+void BenchmarkDecompress(Image* image, WorkQueue* queue, unsigned numRepeats)
+{
+    CompressedLevel level = image->GetCompressedLevel(0);
+    if (!level.data_ || image->GetCompressedFormat() == CF_RGBA)
+        ErrorExit("Can not decompress the image format");
+
+    unsigned numPixels = (unsigned)(level.width_ * level.height_ * level.depth_);
+    PODVector<unsigned char> decompressed(numPixels * 4);
+
+    PrintResultHeader();
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numRepeats; ++i)
+        level.Decompress(&decompressed[0]);
+    PrintResult("Decompress", 1, numPixels, numRepeats, timer.GetUSec(false));
+
+    if (queue->GetNumThreads())
+    {
+        timer.Reset();
+        for (unsigned i = 0; i < numRepeats; ++i)
+            level.Decompress(&decompressed[0], queue);
+        PrintResult("Decompress", queue->GetNumThreads() + 1, numPixels, numRepeats, timer.GetUSec(false));
+    }
+}
+
+const char* GetFormatName(CompressedFormat format)
+{
+    switch (format)
+    {
+    case CF_RGBA:
+        return "RGBA";
+    case CF_DXT1:
+        return "DXT1";
+    case CF_DXT3:
+        return "DXT3";
+    case CF_DXT5:
+        return "DXT5";
+    case CF_ETC1:
+        return "ETC1";
+    case CF_PVRTC_RGB_2BPP:
+        return "PVRTC RGB 2bpp";
+    case CF_PVRTC_RGBA_2BPP:
+        return "PVRTC RGBA 2bpp";
+    case CF_PVRTC_RGB_4BPP:
+        return "PVRTC RGB 4bpp";
+    case CF_PVRTC_RGBA_4BPP:
+        return "PVRTC RGBA 4bpp";
+    default:
+        return "uncompressed";
+    }
+}
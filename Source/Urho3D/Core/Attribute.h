@@ -47,7 +47,9 @@ static const unsigned AM_COMPONENTID = 0x20;
 /// Attribute is a node ID vector where first element is the amount of nodes.
 static const unsigned AM_NODEIDVECTOR = 0x40;
 
+class Deserializer;
 class Serializable;
+class Serializer;
 
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
@@ -57,6 +59,10 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+    /// Write the attribute to a stream in the same format as its variant data. Default implementation writes the variant returned by Get(). Return true if successful.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const;
+    /// Read the attribute from a stream in the same format as its variant data and set it. Default implementation reads a variant and calls Set().
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type);
 };
 
 /// Description of an automatically serializable variable.
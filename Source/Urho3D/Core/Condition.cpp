@@ -61,6 +61,7 @@ void Condition::Wait()
 
 Condition::Condition() :
     mutex_(new pthread_mutex_t),
+    signaled_(false),
     event_(new pthread_cond_t)
 {
     pthread_mutex_init((pthread_mutex_t*)mutex_, 0);
@@ -82,7 +83,12 @@ Condition::~Condition()
 
 void Condition::Set()
 {
+    pthread_mutex_t* mutex = (pthread_mutex_t*)mutex_;
+
+    pthread_mutex_lock(mutex);
+    signaled_ = true;
     pthread_cond_signal((pthread_cond_t*)event_);
+    pthread_mutex_unlock(mutex);
 }
 
 void Condition::Wait()
@@ -90,8 +96,11 @@ void Condition::Wait()
     pthread_cond_t* cond = (pthread_cond_t*)event_;
     pthread_mutex_t* mutex = (pthread_mutex_t*)mutex_;
 
+    // Like an auto-reset event, stay set until a waiting thread wakes up
     pthread_mutex_lock(mutex);
-    pthread_cond_wait(cond, mutex);
+    while (!signaled_)
+        pthread_cond_wait(cond, mutex);
+    signaled_ = false;
     pthread_mutex_unlock(mutex);
 }
 
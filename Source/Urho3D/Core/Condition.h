@@ -51,6 +51,8 @@ private:
 #ifndef WIN32
     /// Mutex for the event, necessary for pthreads-based implementation.
     void* mutex_;
+    /// Set flag, necessary for pthreads-based implementation so that a Set() while no thread is waiting is not lost.
+    bool signaled_;
 #endif
     /// Operating system specific event.
     void* event_;
@@ -33,6 +33,7 @@
 #include "../Engine/Engine.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
+#include "../IO/AsyncIO.h"
 #include "../IO/FileSystem.h"
 #include "../Input/Input.h"
 #include "../IO/Log.h"
@@ -115,6 +116,7 @@ Engine::Engine(Context* context) :
     context_->RegisterSubsystem(new Profiler(context_));
 #endif
     context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new AsyncIO(context_));
 #ifdef URHO3D_LOGGING
     context_->RegisterSubsystem(new Log(context_));
 #endif
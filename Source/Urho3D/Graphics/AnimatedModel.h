@@ -49,6 +49,8 @@ public:
 
     /// Load from binary data. Return true if successful.
     virtual bool Load(Deserializer& source, bool setInstanceDefault = false);
+    /// Return false, as attribute changes are deferred while loading.
+    virtual bool AllowRawAttributeAccess() const { return false; }
     /// Load from XML data. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, bool setInstanceDefault = false);
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
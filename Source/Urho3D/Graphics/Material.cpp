@@ -33,6 +33,7 @@
 #include "../Graphics/TextureCube.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../IO/VectorBuffer.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLFile.h"
@@ -122,6 +123,8 @@ TextureUnit ParseTextureUnitName(String name)
 
 static TechniqueEntry noEntry;
 
+static const unsigned MATERIAL_BINARY_VERSION = 1;
+
 bool CompareTechniqueEntries(const TechniqueEntry& lhs, const TechniqueEntry& rhs)
 {
     if (lhs.lodDistance_ != rhs.lodDistance_)
@@ -197,6 +200,13 @@ bool Material::BeginLoad(Deserializer& source)
     if (!graphics)
         return true;
 
+    // Check for the cooked binary format
+    unsigned start = source.GetPosition();
+    bool isBinary = source.ReadFileID() == "UMAT";
+    source.Seek(start);
+    if (isBinary)
+        return BeginLoadBinary(source);
+
     loadXMLFile_ = new XMLFile(context_);
     if (loadXMLFile_->Load(source))
     {
@@ -261,8 +271,14 @@ bool Material::EndLoad()
         XMLElement rootElem = loadXMLFile_->GetRoot();
         success = Load(rootElem);
     }
+    else if (loadBinaryData_.Size())
+    {
+        MemoryBuffer buffer(loadBinaryData_);
+        success = LoadBinary(buffer);
+    }
 
     loadXMLFile_.Reset();
+    loadBinaryData_.Clear();
     return success;
 }
 
@@ -471,6 +487,164 @@ bool Material::Save(XMLElement& dest) const
     return true;
 }
 
+bool Material::LoadBinary(Deserializer& source)
+{
+    if (source.ReadFileID() != "UMAT")
+    {
+        LOGERROR(source.GetName() + " is not a valid cooked material file");
+        return false;
+    }
+
+    unsigned version = source.ReadUInt();
+    if (version != MATERIAL_BINARY_VERSION)
+    {
+        LOGERROR("Unsupported cooked material version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    ResetToDefaults();
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    techniques_.Clear();
+    unsigned numTechniques = source.ReadVLE();
+    for (unsigned i = 0; i < numTechniques; ++i)
+    {
+        Technique* tech = cache->GetResource<Technique>(source.ReadString());
+        TechniqueEntry newTechnique;
+        newTechnique.technique_ = tech;
+        newTechnique.qualityLevel_ = source.ReadUByte();
+        newTechnique.lodDistance_ = source.ReadFloat();
+        if (tech)
+            techniques_.Push(newTechnique);
+    }
+
+    SortTechniques();
+
+    unsigned numTextures = source.ReadVLE();
+    for (unsigned i = 0; i < numTextures; ++i)
+    {
+        TextureUnit unit = (TextureUnit)source.ReadUByte();
+        StringHash type = source.ReadStringHash();
+        String name = source.ReadString();
+        if (unit < MAX_TEXTURE_UNITS)
+            SetTexture(unit, dynamic_cast<Texture*>(cache->GetResource(type, name)));
+    }
+
+    batchedParameterUpdate_ = true;
+    unsigned numParameters = source.ReadVLE();
+    for (unsigned i = 0; i < numParameters; ++i)
+    {
+        String name = source.ReadString();
+        SetShaderParameter(name, source.ReadVariant());
+    }
+    batchedParameterUpdate_ = false;
+
+    unsigned numAnimations = source.ReadVLE();
+    for (unsigned i = 0; i < numAnimations; ++i)
+    {
+        String name = source.ReadString();
+        WrapMode wrapMode = (WrapMode)source.ReadUByte();
+        float speed = source.ReadFloat();
+        MemoryBuffer animationData(source.ReadBuffer());
+        SharedPtr<ValueAnimation> animation(new ValueAnimation(context_));
+        if (!animation->Load(animationData))
+        {
+            LOGERROR("Could not load parameter animation");
+            return false;
+        }
+
+        SetShaderParameterAnimation(name, animation, wrapMode, speed);
+    }
+
+    SetCullMode((CullMode)source.ReadUByte());
+    SetShadowCullMode((CullMode)source.ReadUByte());
+    SetFillMode((FillMode)source.ReadUByte());
+    float constantBias = source.ReadFloat();
+    float slopeScaledBias = source.ReadFloat();
+    SetDepthBias(BiasParameters(constantBias, slopeScaledBias));
+
+    RefreshShaderParameterHash();
+    RefreshMemoryUse();
+    CheckOcclusion();
+    return true;
+}
+
+bool Material::SaveBinary(Serializer& dest) const
+{
+    dest.WriteFileID("UMAT");
+    dest.WriteUInt(MATERIAL_BINARY_VERSION);
+
+    // Write techniques
+    unsigned numTechniques = 0;
+    for (unsigned i = 0; i < techniques_.Size(); ++i)
+    {
+        if (techniques_[i].technique_)
+            ++numTechniques;
+    }
+    dest.WriteVLE(numTechniques);
+    for (unsigned i = 0; i < techniques_.Size(); ++i)
+    {
+        const TechniqueEntry& entry = techniques_[i];
+        if (!entry.technique_)
+            continue;
+
+        dest.WriteString(entry.technique_->GetName());
+        dest.WriteUByte((unsigned char)entry.qualityLevel_);
+        dest.WriteFloat(entry.lodDistance_);
+    }
+
+    // Write texture units. Store the texture type so that it does not need to be guessed from the file extension
+    unsigned numTextures = 0;
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    {
+        if (GetTexture((TextureUnit)i))
+            ++numTextures;
+    }
+    dest.WriteVLE(numTextures);
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    {
+        Texture* texture = GetTexture((TextureUnit)i);
+        if (texture)
+        {
+            dest.WriteUByte((unsigned char)i);
+            dest.WriteStringHash(texture->GetType());
+            dest.WriteString(texture->GetName());
+        }
+    }
+
+    // Write shader parameters
+    dest.WriteVLE(shaderParameters_.Size());
+    for (HashMap<StringHash, MaterialShaderParameter>::ConstIterator i = shaderParameters_.Begin(); i != shaderParameters_.End();
+         ++i)
+    {
+        dest.WriteString(i->second_.name_);
+        dest.WriteVariant(i->second_.value_);
+    }
+
+    // Write shader parameter animations. The animations themselves are stored in their XML format
+    dest.WriteVLE(shaderParameterAnimationInfos_.Size());
+    for (HashMap<StringHash, SharedPtr<ShaderParameterAnimationInfo> >::ConstIterator i = shaderParameterAnimationInfos_.Begin();
+         i != shaderParameterAnimationInfos_.End(); ++i)
+    {
+        ShaderParameterAnimationInfo* info = i->second_;
+        VectorBuffer animationData;
+        if (!info->GetAnimation()->Save(animationData))
+            return false;
+
+        dest.WriteString(info->GetName());
+        dest.WriteUByte((unsigned char)info->GetWrapMode());
+        dest.WriteFloat(info->GetSpeed());
+        dest.WriteBuffer(animationData.GetBuffer());
+    }
+
+    dest.WriteUByte((unsigned char)cullMode_);
+    dest.WriteUByte((unsigned char)shadowCullMode_);
+    dest.WriteUByte((unsigned char)fillMode_);
+    dest.WriteFloat(depthBias_.constantBias_);
+    return dest.WriteFloat(depthBias_.slopeScaledBias_);
+}
+
 void Material::SetNumTechniques(unsigned num)
 {
     if (!num)
@@ -802,6 +976,51 @@ void Material::ResetToDefaults()
     RefreshMemoryUse();
 }
 
+bool Material::BeginLoadBinary(Deserializer& source)
+{
+    // Store the data to be applied in EndLoad(), as getting the techniques & textures is only possible in the main thread
+    loadBinaryData_.Resize(source.GetSize() - source.GetPosition());
+    if (!loadBinaryData_.Size() || source.Read(&loadBinaryData_[0], loadBinaryData_.Size()) != loadBinaryData_.Size())
+    {
+        loadBinaryData_.Clear();
+        return false;
+    }
+
+    MemoryBuffer buffer(loadBinaryData_);
+    buffer.ReadFileID();
+    unsigned version = buffer.ReadUInt();
+    if (version != MATERIAL_BINARY_VERSION)
+    {
+        LOGERROR("Unsupported cooked material version " + String(version) + " in " + source.GetName());
+        loadBinaryData_.Clear();
+        return false;
+    }
+
+    // If async loading, request the techniques & textures to also be loaded
+    if (GetAsyncLoadState() == ASYNC_LOADING)
+    {
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+        unsigned numTechniques = buffer.ReadVLE();
+        for (unsigned i = 0; i < numTechniques; ++i)
+        {
+            cache->BackgroundLoadResource<Technique>(buffer.ReadString(), true, this);
+            buffer.ReadUByte();
+            buffer.ReadFloat();
+        }
+
+        unsigned numTextures = buffer.ReadVLE();
+        for (unsigned i = 0; i < numTextures; ++i)
+        {
+            buffer.ReadUByte();
+            StringHash type = buffer.ReadStringHash();
+            cache->BackgroundLoadResource(type, buffer.ReadString(), true, this);
+        }
+    }
+
+    return true;
+}
+
 void Material::RefreshShaderParameterHash()
 {
     VectorBuffer temp;
@@ -121,6 +121,10 @@ public:
     bool Load(const XMLElement& source);
     /// Save to an XML element. Return true if successful.
     bool Save(XMLElement& dest) const;
+    /// Load from the cooked binary format synchronously. Return true if successful.
+    bool LoadBinary(Deserializer& source);
+    /// Save in the cooked binary format, which is detected and loaded instead of XML. Return true if successful.
+    bool SaveBinary(Serializer& dest) const;
     /// Set number of techniques.
     void SetNumTechniques(unsigned num);
     /// Set technique.
@@ -228,6 +232,8 @@ private:
     void CheckOcclusion();
     /// Reset to defaults.
     void ResetToDefaults();
+    /// Begin loading from the cooked binary format. Return true if successful.
+    bool BeginLoadBinary(Deserializer& source);
     /// Recalculate shader parameter hash.
     void RefreshShaderParameterHash();
     /// Recalculate the memory used by the material.
@@ -269,6 +275,8 @@ private:
     bool batchedParameterUpdate_;
     /// XML file used while loading.
     SharedPtr<XMLFile> loadXMLFile_;
+    /// Cooked binary data used while loading.
+    PODVector<unsigned char> loadBinaryData_;
     /// Associated scene for shader parameter animation updates.
     WeakPtr<Scene> scene_;
 };
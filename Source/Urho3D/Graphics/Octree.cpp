@@ -395,6 +395,11 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
 
 void Octree::Update(const FrameInfo& frame)
 {
+    // Recalculate the world transforms of nodes moved since the scene update in one batch, before the drawables read them
+    Scene* scene = GetScene();
+    if (scene)
+        scene->UpdateTransforms();
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.Empty())
     {
@@ -402,7 +407,6 @@ void Octree::Update(const FrameInfo& frame)
 
         // Perform updates in worker threads. Notify the scene that a threaded update is going on and components
         // (for example physics objects) should not perform non-threadsafe work when marked dirty
-        Scene* scene = GetScene();
         WorkQueue* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
@@ -434,7 +438,6 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     // Notify drawable update being finished. Custom animation (eg. IK) can be done at this point
-    Scene* scene = GetScene();
     if (scene)
     {
         using namespace SceneDrawableUpdateFinished;
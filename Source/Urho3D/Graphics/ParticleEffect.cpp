@@ -26,6 +26,7 @@
 #include "../Graphics/Material.h"
 #include "../Graphics/ParticleEffect.h"
 #include "../IO/Log.h"
+#include "../IO/Serializer.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLFile.h"
 
@@ -48,6 +49,7 @@ static const float DEFAULT_TIME_TO_LIVE = 1.0f;
 static const float DEFAULT_VELOCITY = 1.0f;
 static const Vector3 DEFAULT_DIRECTION_MIN(-1.0f, -1.0f, -1.0f);
 static const Vector3 DEFAULT_DIRECTION_MAX(1.0f, 1.0f, 1.0f);
+static const unsigned PARTICLEEFFECT_BINARY_VERSION = 1;
 
 ParticleEffect::ParticleEffect(Context* context) :
     Resource(context),
@@ -95,6 +97,12 @@ bool ParticleEffect::BeginLoad(Deserializer& source)
 {
     loadMaterialName_.Clear();
 
+    // Check for the cooked binary format
+    unsigned start = source.GetPosition();
+    if (source.ReadFileID() == "UPEF")
+        return LoadBinary(source);
+    source.Seek(start);
+
     XMLFile file(context_);
     if (!file.Load(source))
     {
@@ -282,6 +290,121 @@ bool ParticleEffect::BeginLoad(Deserializer& source)
     return true;
 }
 
+bool ParticleEffect::LoadBinary(Deserializer& source)
+{
+    unsigned version = source.ReadUInt();
+    if (version != PARTICLEEFFECT_BINARY_VERSION)
+    {
+        LOGERROR("Unsupported cooked particle effect version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    // All values are stored, so no need to reset to defaults first
+    material_.Reset();
+    loadMaterialName_ = source.ReadString();
+    // If async loading, can not GetResource() the material. But can do a background request for it
+    if (!loadMaterialName_.Empty() && GetAsyncLoadState() == ASYNC_LOADING)
+        GetSubsystem<ResourceCache>()->BackgroundLoadResource<Material>(loadMaterialName_, true, this);
+
+    SetNumParticles(source.ReadUInt());
+    updateInvisible_ = source.ReadBool();
+    relative_ = source.ReadBool();
+    scaled_ = source.ReadBool();
+    sorted_ = source.ReadBool();
+    animationLodBias_ = source.ReadFloat();
+    emitterType_ = (EmitterType)source.ReadUByte();
+    emitterSize_ = source.ReadVector3();
+    directionMin_ = source.ReadVector3();
+    directionMax_ = source.ReadVector3();
+    constantForce_ = source.ReadVector3();
+    dampingForce_ = source.ReadFloat();
+    activeTime_ = source.ReadFloat();
+    inactiveTime_ = source.ReadFloat();
+    emissionRateMin_ = source.ReadFloat();
+    emissionRateMax_ = source.ReadFloat();
+    sizeMin_ = source.ReadVector2();
+    sizeMax_ = source.ReadVector2();
+    timeToLiveMin_ = source.ReadFloat();
+    timeToLiveMax_ = source.ReadFloat();
+    velocityMin_ = source.ReadFloat();
+    velocityMax_ = source.ReadFloat();
+    rotationMin_ = source.ReadFloat();
+    rotationMax_ = source.ReadFloat();
+    rotationSpeedMin_ = source.ReadFloat();
+    rotationSpeedMax_ = source.ReadFloat();
+    sizeAdd_ = source.ReadFloat();
+    sizeMul_ = source.ReadFloat();
+
+    colorFrames_.Resize(source.ReadVLE());
+    for (unsigned i = 0; i < colorFrames_.Size(); ++i)
+    {
+        colorFrames_[i].color_ = source.ReadColor();
+        colorFrames_[i].time_ = source.ReadFloat();
+    }
+    if (colorFrames_.Empty())
+        colorFrames_.Push(ColorFrame(Color::WHITE));
+
+    textureFrames_.Resize(source.ReadVLE());
+    for (unsigned i = 0; i < textureFrames_.Size(); ++i)
+    {
+        textureFrames_[i].uv_ = source.ReadRect();
+        textureFrames_[i].time_ = source.ReadFloat();
+    }
+
+    return true;
+}
+
+bool ParticleEffect::SaveBinary(Serializer& dest) const
+{
+    dest.WriteFileID("UPEF");
+    dest.WriteUInt(PARTICLEEFFECT_BINARY_VERSION);
+    dest.WriteString(material_ ? material_->GetName() : loadMaterialName_);
+    dest.WriteUInt(numParticles_);
+    dest.WriteBool(updateInvisible_);
+    dest.WriteBool(relative_);
+    dest.WriteBool(scaled_);
+    dest.WriteBool(sorted_);
+    dest.WriteFloat(animationLodBias_);
+    dest.WriteUByte((unsigned char)emitterType_);
+    dest.WriteVector3(emitterSize_);
+    dest.WriteVector3(directionMin_);
+    dest.WriteVector3(directionMax_);
+    dest.WriteVector3(constantForce_);
+    dest.WriteFloat(dampingForce_);
+    dest.WriteFloat(activeTime_);
+    dest.WriteFloat(inactiveTime_);
+    dest.WriteFloat(emissionRateMin_);
+    dest.WriteFloat(emissionRateMax_);
+    dest.WriteVector2(sizeMin_);
+    dest.WriteVector2(sizeMax_);
+    dest.WriteFloat(timeToLiveMin_);
+    dest.WriteFloat(timeToLiveMax_);
+    dest.WriteFloat(velocityMin_);
+    dest.WriteFloat(velocityMax_);
+    dest.WriteFloat(rotationMin_);
+    dest.WriteFloat(rotationMax_);
+    dest.WriteFloat(rotationSpeedMin_);
+    dest.WriteFloat(rotationSpeedMax_);
+    dest.WriteFloat(sizeAdd_);
+    dest.WriteFloat(sizeMul_);
+
+    dest.WriteVLE(colorFrames_.Size());
+    for (unsigned i = 0; i < colorFrames_.Size(); ++i)
+    {
+        dest.WriteColor(colorFrames_[i].color_);
+        dest.WriteFloat(colorFrames_[i].time_);
+    }
+
+    dest.WriteVLE(textureFrames_.Size());
+    for (unsigned i = 0; i < textureFrames_.Size(); ++i)
+    {
+        dest.WriteRect(textureFrames_[i].uv_);
+        dest.WriteFloat(textureFrames_[i].time_);
+    }
+
+    return true;
+}
+
 bool ParticleEffect::EndLoad()
 {
     // Apply the material now
@@ -122,6 +122,8 @@ public:
     bool Save(XMLElement& dest) const;
     /// Load resource from XMLElement synchronously. Return true if successful.
     bool Load(const XMLElement& source);
+    /// Save in the cooked binary format, which is detected and loaded instead of XML. Return true if successful.
+    bool SaveBinary(Serializer& dest) const;
     /// Set material.
     void SetMaterial(Material* material);
     /// Set maximum number of particles.
@@ -330,6 +332,8 @@ public:
     float GetRandomRotation() const;
 
 private:
+    /// Load from the cooked binary format after the file ID. Return true if successful.
+    bool LoadBinary(Deserializer& source);
     /// Read a float range from an XML element.
     void GetFloatMinMax(const XMLElement& element, float& minValue, float& maxValue);
     /// Read a Vector2 range from an XML element.
@@ -26,6 +26,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Shader.h"
 #include "../Graphics/ShaderVariation.h"
+#include "../IO/AsyncIO.h"
 #include "../IO/Deserializer.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -163,10 +164,11 @@ bool Shader::ProcessSource(String& code, Deserializer& source)
 
     // If the source if a non-packaged file, store the timestamp
     File* file = dynamic_cast<File*>(&source);
-    if (file && !file->IsPackaged())
+    AsyncReadRequest* request = dynamic_cast<AsyncReadRequest*>(&source);
+    if ((file && !file->IsPackaged()) || (request && !request->GetPackage()))
     {
         FileSystem* fileSystem = GetSubsystem<FileSystem>();
-        String fullName = cache->GetResourceFileName(file->GetName());
+        String fullName = cache->GetResourceFileName(source.GetName());
         unsigned fileTimeStamp = fileSystem->GetLastModifiedTime(fullName);
         if (fileTimeStamp > timeStamp_)
             timeStamp_ = fileTimeStamp;
@@ -29,6 +29,7 @@
 #include "../Graphics/Technique.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../IO/Log.h"
+#include "../IO/Serializer.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLFile.h"
 
@@ -71,6 +72,8 @@ static const char* lightingModeNames[] =
     0
 };
 
+static const unsigned TECHNIQUE_BINARY_VERSION = 1;
+
 Pass::Pass(const String& name) :
     blendMode_(BLEND_REPLACE),
     depthTestMode_(CMP_LESSEQUAL),
@@ -196,6 +199,12 @@ bool Technique::BeginLoad(Deserializer& source)
 
     SetMemoryUse(sizeof(Technique));
 
+    // Check for the cooked binary format
+    unsigned start = source.GetPosition();
+    if (source.ReadFileID() == "UTEC")
+        return LoadBinary(source);
+    source.Seek(start);
+
     SharedPtr<XMLFile> xml(new XMLFile(context_));
     if (!xml->Load(source))
         return false;
@@ -288,6 +297,67 @@ bool Technique::BeginLoad(Deserializer& source)
     return true;
 }
 
+bool Technique::SaveBinary(Serializer& dest) const
+{
+    dest.WriteFileID("UTEC");
+    dest.WriteUInt(TECHNIQUE_BINARY_VERSION);
+    dest.WriteBool(isDesktop_);
+
+    // Global shaders & defines have already been merged into the passes during loading
+    dest.WriteVLE(GetNumPasses());
+    for (Vector<SharedPtr<Pass> >::ConstIterator i = passes_.Begin(); i != passes_.End(); ++i)
+    {
+        Pass* pass = i->Get();
+        if (!pass)
+            continue;
+
+        dest.WriteString(pass->GetName());
+        dest.WriteBool(pass->IsDesktop());
+        dest.WriteString(pass->GetVertexShader());
+        dest.WriteString(pass->GetPixelShader());
+        dest.WriteString(pass->GetVertexShaderDefines());
+        dest.WriteString(pass->GetPixelShaderDefines());
+        dest.WriteUByte((unsigned char)pass->GetLightingMode());
+        dest.WriteUByte((unsigned char)pass->GetBlendMode());
+        dest.WriteUByte((unsigned char)pass->GetDepthTestMode());
+        dest.WriteBool(pass->GetDepthWrite());
+        if (!dest.WriteBool(pass->GetAlphaMask()))
+            return false;
+    }
+
+    return true;
+}
+
+bool Technique::LoadBinary(Deserializer& source)
+{
+    unsigned version = source.ReadUInt();
+    if (version != TECHNIQUE_BINARY_VERSION)
+    {
+        LOGERROR("Unsupported cooked technique version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    isDesktop_ = source.ReadBool();
+
+    unsigned numPasses = source.ReadVLE();
+    for (unsigned i = 0; i < numPasses; ++i)
+    {
+        Pass* newPass = CreatePass(source.ReadString());
+        newPass->SetIsDesktop(source.ReadBool());
+        newPass->SetVertexShader(source.ReadString());
+        newPass->SetPixelShader(source.ReadString());
+        newPass->SetVertexShaderDefines(source.ReadString());
+        newPass->SetPixelShaderDefines(source.ReadString());
+        newPass->SetLightingMode((PassLightingMode)source.ReadUByte());
+        newPass->SetBlendMode((BlendMode)source.ReadUByte());
+        newPass->SetDepthTestMode((CompareMode)source.ReadUByte());
+        newPass->SetDepthWrite(source.ReadBool());
+        newPass->SetAlphaMask(source.ReadBool());
+    }
+
+    return true;
+}
+
 void Technique::SetIsDesktop(bool enable)
 {
     isDesktop_ = enable;
@@ -167,6 +167,8 @@ public:
 
     /// Load resource from stream. May be called from a worker thread. Return true if successful.
     virtual bool BeginLoad(Deserializer& source);
+    /// Save in the cooked binary format, which is detected and loaded instead of XML. Return true if successful.
+    bool SaveBinary(Serializer& dest) const;
 
     /// Set whether requires desktop level hardware.
     void SetIsDesktop(bool enable);
@@ -233,6 +235,9 @@ public:
     static unsigned shadowPassIndex;
 
 private:
+    /// Load from the cooked binary format after the file ID. Return true if successful.
+    bool LoadBinary(Deserializer& source);
+
     /// Require desktop GPU flag.
     bool isDesktop_;
     /// Cached desktop GPU support flag.
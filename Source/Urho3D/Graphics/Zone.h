@@ -44,6 +44,8 @@ public:
 
     /// Handle attribute write access.
     virtual void OnSetAttribute(const AttributeInfo& attr, const Variant& src);
+    /// Return false, as attribute changes are handled in OnSetAttribute().
+    virtual bool AllowRawAttributeAccess() const { return false; }
     /// Visualize the component as debug geometry.
     virtual void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
 
@@ -0,0 +1,487 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/CoreEvents.h"
+#include "../IO/AsyncIO.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/IOEvents.h"
+#include "../IO/PackageFile.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+// Gap between package file entries which is read through when merging reads
+static const unsigned MAX_MERGE_GAP = 16384;
+// Maximum size of a merged read
+static const unsigned MAX_MERGE_SIZE = 4 * 1024 * 1024;
+
+AsyncReadRequest::AsyncReadRequest() :
+    owner_(0),
+    data_(0),
+    offset_(0),
+    checksum_(0),
+    priority_(0),
+    sendEvent_(false),
+    inProgress_(false),
+    succeeded_(false),
+    completed_(false)
+{
+}
+
+AsyncReadRequest::~AsyncReadRequest()
+{
+    if (owner_)
+        owner_->CancelRequest(this);
+}
+
+unsigned AsyncReadRequest::Read(void* dest, unsigned size)
+{
+    if (!completed_ || !succeeded_)
+        return 0;
+
+    if (size + position_ > size_)
+        size = size_ - position_;
+    if (!size)
+        return 0;
+
+    memcpy(dest, data_ + position_, size);
+    position_ += size;
+    return size;
+}
+
+unsigned AsyncReadRequest::Seek(unsigned position)
+{
+    if (position > size_)
+        position = size_;
+
+    position_ = position;
+    return position_;
+}
+
+bool AsyncReadRequest::Wait() const
+{
+    while (!completed_)
+        completedCondition_.Wait();
+
+    return succeeded_;
+}
+
+AsyncIOThread::AsyncIOThread(AsyncIO* owner) :
+    owner_(owner)
+{
+}
+
+void AsyncIOThread::ThreadFunction()
+{
+    while (shouldRun_)
+    {
+        if (!owner_->ProcessRequests())
+            owner_->WaitForWork();
+    }
+
+    // Pass the wakeup on to the other threads being stopped
+    owner_->SignalWork();
+}
+
+static bool CompareRequests(AsyncReadRequest* lhs, AsyncReadRequest* rhs)
+{
+    if (lhs->GetPackage() != rhs->GetPackage())
+        return lhs->GetPackage() < rhs->GetPackage();
+    if (lhs->GetOffset() != rhs->GetOffset())
+        return lhs->GetOffset() < rhs->GetOffset();
+    return lhs->GetPath() < rhs->GetPath();
+}
+
+AsyncIO::AsyncIO(Context* context) :
+    Object(context),
+    numThreads_(2),
+    maxBatchSize_(32),
+    numReads_(0),
+    numBytesRead_(0)
+{
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(AsyncIO, HandleBeginFrame));
+}
+
+AsyncIO::~AsyncIO()
+{
+    StopThreads();
+
+    // Fail the requests that were never processed so that nobody waits on them forever
+    MutexLock lock(queueMutex_);
+    for (unsigned i = 0; i < queue_.Size(); ++i)
+    {
+        AsyncReadRequest* request = queue_[i];
+        request->owner_ = 0;
+        request->succeeded_ = false;
+        request->completed_ = true;
+        request->completedCondition_.Set();
+    }
+    for (unsigned i = 0; i < completedRequests_.Size(); ++i)
+        completedRequests_[i]->owner_ = 0;
+    queue_.Clear();
+    completedRequests_.Clear();
+}
+
+void AsyncIO::SetNumThreads(unsigned num)
+{
+    num = (unsigned)Max((int)num, 1);
+    if (num == numThreads_)
+        return;
+
+    // Restart the threads if already running. The requests in progress are finished before stopping
+    bool restart = !threads_.Empty();
+    StopThreads();
+
+    MutexLock lock(queueMutex_);
+    numThreads_ = num;
+    if (restart)
+        StartThreads();
+}
+
+void AsyncIO::SetMaxBatchSize(unsigned num)
+{
+    MutexLock lock(queueMutex_);
+    maxBatchSize_ = (unsigned)Max((int)num, 1);
+}
+
+SharedPtr<AsyncReadRequest> AsyncIO::ReadFile(const String& fileName, int priority, bool sendEvent)
+{
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem || !fileSystem->FileExists(fileName))
+        return SharedPtr<AsyncReadRequest>();
+
+    SharedPtr<AsyncReadRequest> request(new AsyncReadRequest());
+    request->name_ = fileName;
+    request->path_ = fileName;
+    request->priority_ = priority;
+    request->sendEvent_ = sendEvent;
+    QueueRequest(request);
+    return request;
+}
+
+SharedPtr<AsyncReadRequest> AsyncIO::ReadPackageFile(PackageFile* package, const String& fileName, int priority, bool sendEvent)
+{
+    if (!package)
+        return SharedPtr<AsyncReadRequest>();
+
+    const PackageEntry* entry = package->GetEntry(fileName);
+    if (!entry)
+        return SharedPtr<AsyncReadRequest>();
+
+    SharedPtr<AsyncReadRequest> request(new AsyncReadRequest());
+    request->name_ = fileName;
+    request->path_ = fileName;
+    request->package_ = package;
+    request->offset_ = entry->offset_;
+    request->checksum_ = entry->checksum_;
+    request->size_ = entry->size_;
+    request->priority_ = priority;
+    request->sendEvent_ = sendEvent;
+
+    // Uncompressed data in a memory mapped package can be accessed directly
+    if (!package->IsCompressed() && package->GetMappedData())
+    {
+        request->data_ = package->GetMappedData() + entry->offset_;
+        request->succeeded_ = true;
+        request->completed_ = true;
+        if (sendEvent)
+        {
+            MutexLock lock(queueMutex_);
+            request->owner_ = this;
+            completedRequests_.Push(request);
+        }
+    }
+    else
+        QueueRequest(request);
+
+    return request;
+}
+
+bool AsyncIO::ProcessRequests()
+{
+    PODVector<AsyncReadRequest*> batch;
+
+    {
+        MutexLock lock(queueMutex_);
+        if (queue_.Empty())
+            return false;
+
+        // Take the highest priority requests, oldest first within the same priority
+        while (!queue_.Empty() && batch.Size() < maxBatchSize_)
+        {
+            unsigned best = 0;
+            for (unsigned i = 1; i < queue_.Size(); ++i)
+            {
+                if (queue_[i]->priority_ > queue_[best]->priority_)
+                    best = i;
+            }
+            // Mark in progress so that the request is not destroyed before it completes
+            queue_[best]->inProgress_ = true;
+            batch.Push(queue_[best]);
+            queue_.Erase(best);
+        }
+
+        // Let another idle thread take the rest of the queue
+        if (!queue_.Empty())
+            SignalWork();
+    }
+
+    // Sort by package file and offset so that reads progress sequentially through each file
+    Sort(batch.Begin(), batch.End(), CompareRequests);
+
+    unsigned i = 0;
+    while (i < batch.Size())
+    {
+        PackageFile* package = batch[i]->package_;
+        if (package && !package->IsCompressed())
+        {
+            unsigned j = i + 1;
+            while (j < batch.Size() && batch[j]->package_ == package)
+                ++j;
+            ReadPackageRange(batch, i, j);
+            i = j;
+        }
+        else
+        {
+            ReadSingle(batch[i]);
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+unsigned AsyncIO::GetNumQueuedRequests() const
+{
+    MutexLock lock(queueMutex_);
+    return queue_.Size();
+}
+
+void AsyncIO::QueueRequest(AsyncReadRequest* request)
+{
+    MutexLock lock(queueMutex_);
+    request->owner_ = this;
+    queue_.Push(request);
+    StartThreads();
+    SignalWork();
+}
+
+void AsyncIO::CancelRequest(AsyncReadRequest* request)
+{
+    for (;;)
+    {
+        {
+            MutexLock lock(queueMutex_);
+            if (!request->inProgress_)
+            {
+                queue_.Remove(request);
+                completedRequests_.Remove(request);
+                request->owner_ = 0;
+                return;
+            }
+        }
+
+        // An I/O thread is reading into the request; wait for it to finish
+        request->completedCondition_.Wait();
+    }
+}
+
+void AsyncIO::StartThreads()
+{
+    if (threads_.Size())
+        return;
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        SharedPtr<AsyncIOThread> thread(new AsyncIOThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void AsyncIO::StopThreads()
+{
+    if (threads_.Empty())
+        return;
+
+    // Clear the running flags first, then wake up the idle threads. Each exiting thread wakes up the next one
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->RequestStop();
+    SignalWork();
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+    threads_.Clear();
+}
+
+void AsyncIO::CompleteRequest(AsyncReadRequest* request, bool success)
+{
+    if (success)
+    {
+        request->data_ = request->buffer_.Size() ? &request->buffer_[0] : 0;
+        request->size_ = request->buffer_.Size();
+    }
+    else
+    {
+        request->buffer_.Clear();
+        request->data_ = 0;
+        request->size_ = 0;
+    }
+    request->position_ = 0;
+    request->succeeded_ = success;
+
+    // The request may be destroyed by its owner as soon as the mutex is released. A waiter that sees the completed flag and
+    // destroys the request before the owner is cleared blocks on the mutex in CancelRequest(), so set the condition first
+    MutexLock lock(queueMutex_);
+    request->completed_ = true;
+    request->completedCondition_.Set();
+    request->inProgress_ = false;
+    if (request->sendEvent_)
+        completedRequests_.Push(request);
+    else
+        request->owner_ = 0;
+}
+
+void AsyncIO::ReadPackageRange(const PODVector<AsyncReadRequest*>& requests, unsigned start, unsigned end)
+{
+    PackageFile* package = requests[start]->package_;
+    File file(context_, package->GetName());
+    if (!file.IsOpen())
+    {
+        for (unsigned i = start; i < end; ++i)
+            CompleteRequest(requests[i], false);
+        return;
+    }
+
+    unsigned numReads = 0;
+    unsigned numBytes = 0;
+    PODVector<unsigned char> mergeBuffer;
+
+    unsigned i = start;
+    while (i < end)
+    {
+        unsigned rangeStart = requests[i]->offset_;
+        unsigned rangeEnd = rangeStart + requests[i]->size_;
+
+        // Extend the read over following entries which are close enough
+        unsigned j = i + 1;
+        while (j < end)
+        {
+            AsyncReadRequest* next = requests[j];
+            unsigned nextEnd = next->offset_ + next->size_;
+            if (next->offset_ > rangeEnd + MAX_MERGE_GAP || Max((int)nextEnd, (int)rangeEnd) - rangeStart > MAX_MERGE_SIZE)
+                break;
+            rangeEnd = (unsigned)Max((int)nextEnd, (int)rangeEnd);
+            ++j;
+        }
+
+        unsigned rangeSize = rangeEnd - rangeStart;
+        ++numReads;
+        numBytes += rangeSize;
+
+        if (j == i + 1)
+        {
+            AsyncReadRequest* request = requests[i];
+            request->buffer_.Resize(rangeSize);
+            bool success = file.Seek(rangeStart) == rangeStart && (!rangeSize || file.Read(&request->buffer_[0], rangeSize) ==
+                rangeSize);
+            CompleteRequest(request, success);
+        }
+        else
+        {
+            mergeBuffer.Resize(rangeSize);
+            bool success = file.Seek(rangeStart) == rangeStart && file.Read(&mergeBuffer[0], rangeSize) == rangeSize;
+            for (unsigned k = i; k < j; ++k)
+            {
+                AsyncReadRequest* request = requests[k];
+                if (success)
+                {
+                    request->buffer_.Resize(request->size_);
+                    if (request->size_)
+                        memcpy(&request->buffer_[0], &mergeBuffer[request->offset_ - rangeStart], request->size_);
+                }
+                CompleteRequest(request, success);
+            }
+        }
+
+        i = j;
+    }
+
+    MutexLock lock(queueMutex_);
+    numReads_ += numReads;
+    numBytesRead_ += numBytes;
+}
+
+void AsyncIO::ReadSingle(AsyncReadRequest* request)
+{
+    File file(context_);
+    if (request->package_)
+        file.Open(request->package_, request->path_);
+    else
+        file.Open(request->path_);
+
+    bool success = false;
+    if (file.IsOpen())
+    {
+        unsigned size = file.GetSize();
+        request->buffer_.Resize(size);
+        success = !size || file.Read(&request->buffer_[0], size) == size;
+
+        MutexLock lock(queueMutex_);
+        ++numReads_;
+        numBytesRead_ += size;
+    }
+
+    CompleteRequest(request, success);
+}
+
+void AsyncIO::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    using namespace AsyncReadCompleted;
+
+    // Take one request at a time, as an event handler may destroy requests that are still waiting for their event
+    for (;;)
+    {
+        AsyncReadRequest* request;
+        {
+            MutexLock lock(queueMutex_);
+            if (completedRequests_.Empty())
+                break;
+            request = completedRequests_.Front();
+            completedRequests_.Erase(0);
+            request->owner_ = 0;
+        }
+
+        VariantMap& newEventData = GetEventDataMap();
+        newEventData[P_REQUEST] = request;
+        newEventData[P_FILENAME] = request->GetName();
+        newEventData[P_SUCCESS] = request->IsSucceeded();
+        SendEvent(E_ASYNCREADCOMPLETED, newEventData);
+    }
+}
+
+}
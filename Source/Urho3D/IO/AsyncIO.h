@@ -0,0 +1,210 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/Condition.h"
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+#include "../Core/Thread.h"
+#include "../IO/Deserializer.h"
+
+namespace Urho3D
+{
+
+class AsyncIO;
+class PackageFile;
+
+/// Asynchronous file read request. Once completed, the file contents can be read through the Deserializer interface. The I/O threads do not hold references to the request; destroying it cancels the read, or waits for it to finish if already in progress.
+class URHO3D_API AsyncReadRequest : public RefCounted, public Deserializer
+{
+    friend class AsyncIO;
+
+public:
+    /// Construct.
+    AsyncReadRequest();
+    /// Destruct. Cancel the read if still queued.
+    virtual ~AsyncReadRequest();
+
+    /// Read bytes from the file contents. Return number of bytes actually read. Returns zero until the request has completed.
+    virtual unsigned Read(void* dest, unsigned size);
+    /// Set position from the beginning of the file contents.
+    virtual unsigned Seek(unsigned position);
+    /// Return the file name.
+    virtual const String& GetName() const { return name_; }
+    /// Return checksum of the file contents if read from a package file, otherwise zero.
+    virtual unsigned GetChecksum() { return checksum_; }
+    /// Return the file contents for zero-copy access, or null if not completed successfully.
+    virtual const unsigned char* GetDirectData() const { return completed_ && succeeded_ ? data_ : 0; }
+
+    /// Change the file name. Used by the resource system.
+    void SetName(const String& name) { name_ = name; }
+    /// Wait until the request has completed. Return true if the file was read successfully.
+    bool Wait() const;
+
+    /// Return the file system path, or the file name within the package file.
+    const String& GetPath() const { return path_; }
+
+    /// Return the package file, or null if reading from the file system.
+    PackageFile* GetPackage() const { return package_; }
+
+    /// Return start offset within the package file.
+    unsigned GetOffset() const { return offset_; }
+
+    /// Return priority.
+    int GetPriority() const { return priority_; }
+
+    /// Return whether the request has completed, either successfully or not.
+    bool IsCompleted() const { return completed_; }
+
+    /// Return whether the file was read successfully.
+    bool IsSucceeded() const { return completed_ && succeeded_; }
+
+private:
+    /// Owner subsystem while queued, in progress or waiting for the completion event.
+    AsyncIO* owner_;
+    /// File name.
+    String name_;
+    /// File system path or the file name within the package file.
+    String path_;
+    /// Package file.
+    SharedPtr<PackageFile> package_;
+    /// Read buffer.
+    PODVector<unsigned char> buffer_;
+    /// File contents. Points either to the read buffer or the memory mapped package file.
+    const unsigned char* data_;
+    /// Start offset within an uncompressed package file.
+    unsigned offset_;
+    /// Content checksum.
+    unsigned checksum_;
+    /// Priority.
+    int priority_;
+    /// Send event on completion flag.
+    bool sendEvent_;
+    /// In progress flag. Accessed under the owner's queue mutex.
+    bool inProgress_;
+    /// Success flag.
+    bool succeeded_;
+    /// Completed flag.
+    volatile bool completed_;
+    /// Condition set when the request completes.
+    mutable Condition completedCondition_;
+};
+
+/// Asynchronous file I/O worker thread.
+class AsyncIOThread : public RefCounted, public Thread
+{
+public:
+    /// Construct.
+    AsyncIOThread(AsyncIO* owner);
+
+    /// Process read requests until stopped.
+    virtual void ThreadFunction();
+    /// Set the running flag to false without waiting for the thread to finish.
+    void RequestStop() { shouldRun_ = false; }
+
+private:
+    /// Owner.
+    AsyncIO* owner_;
+};
+
+/// %Asynchronous file I/O subsystem. Reads whole files in worker threads, batching the queued requests so that reads within a package file are sorted by offset and adjacent reads are merged.
+class URHO3D_API AsyncIO : public Object
+{
+    OBJECT(AsyncIO);
+
+    friend class AsyncReadRequest;
+
+public:
+    /// Construct.
+    AsyncIO(Context* context);
+    /// Destruct. Finish the requests in progress and fail the rest.
+    virtual ~AsyncIO();
+
+    /// Set number of I/O threads. Default 2.
+    void SetNumThreads(unsigned num);
+    /// Set maximum number of requests to take from the queue at once for sorting and merging. Default 32.
+    void SetMaxBatchSize(unsigned num);
+    /// Queue reading a file from the file system. Return the request, or null if the file does not exist. The request must be kept referenced until completed. If sendEvent is true, the request should only be referenced from the main thread.
+    SharedPtr<AsyncReadRequest> ReadFile(const String& fileName, int priority = 0, bool sendEvent = false);
+    /// Queue reading a file from a package file. Uncompressed files in memory mapped packages complete immediately without copying. Return the request, or null if the file is not in the package.
+    SharedPtr<AsyncReadRequest> ReadPackageFile(PackageFile* package, const String& fileName, int priority = 0, bool sendEvent = false);
+    /// Process a batch of queued requests. Called by the I/O threads. Return false if there was nothing to process.
+    bool ProcessRequests();
+    /// Wait until there may be requests to process. Called by the I/O threads when idle.
+    void WaitForWork() { workCondition_.Wait(); }
+    /// Wake up one idle I/O thread.
+    void SignalWork() { workCondition_.Set(); }
+
+    /// Return number of I/O threads.
+    unsigned GetNumThreads() const { return numThreads_; }
+
+    /// Return maximum number of requests processed as one batch.
+    unsigned GetMaxBatchSize() const { return maxBatchSize_; }
+
+    /// Return number of requests waiting to be processed.
+    unsigned GetNumQueuedRequests() const;
+    /// Return number of file read calls performed. Merged reads count as one.
+    unsigned GetNumReads() const { return numReads_; }
+    /// Return number of bytes read.
+    unsigned long long GetNumBytesRead() const { return numBytesRead_; }
+
+private:
+    /// Queue a request and start the threads if necessary.
+    void QueueRequest(AsyncReadRequest* request);
+    /// Start the I/O threads if not started yet. Called with the queue mutex held.
+    void StartThreads();
+    /// Stop the I/O threads. The threads finish their current batches first.
+    void StopThreads();
+    /// Remove a request that is being destroyed. Wait if it is in progress.
+    void CancelRequest(AsyncReadRequest* request);
+    /// Mark a request completed.
+    void CompleteRequest(AsyncReadRequest* request, bool success);
+    /// Read consecutive requests from the same uncompressed package file, merging adjacent reads.
+    void ReadPackageRange(const PODVector<AsyncReadRequest*>& requests, unsigned start, unsigned end);
+    /// Read a request by opening the file separately.
+    void ReadSingle(AsyncReadRequest* request);
+    /// Handle begin frame event. Send completion events.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+
+    /// Mutex for the request queue and completed requests.
+    mutable Mutex queueMutex_;
+    /// Condition set when requests are queued, and when the I/O threads are stopped.
+    Condition workCondition_;
+    /// Queued requests.
+    PODVector<AsyncReadRequest*> queue_;
+    /// Completed requests waiting for the completion event.
+    PODVector<AsyncReadRequest*> completedRequests_;
+    /// I/O threads.
+    Vector<SharedPtr<AsyncIOThread> > threads_;
+    /// Number of I/O threads to use.
+    unsigned numThreads_;
+    /// Maximum batch size.
+    unsigned maxBatchSize_;
+    /// Number of read calls.
+    unsigned numReads_;
+    /// Number of bytes read.
+    unsigned long long numBytesRead_;
+};
+
+}
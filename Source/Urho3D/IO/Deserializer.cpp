@@ -57,6 +57,11 @@ unsigned Deserializer::GetChecksum()
     return 0;
 }
 
+const unsigned char* Deserializer::GetDirectData() const
+{
+    return 0;
+}
+
 int Deserializer::ReadInt()
 {
     int ret;
@@ -48,6 +48,8 @@ public:
     virtual const String& GetName() const;
     /// Return a checksum if applicable.
     virtual unsigned GetChecksum();
+    /// Return pointer to the whole contents if they are directly accessible in memory without copying, or null if not.
+    virtual const unsigned char* GetDirectData() const;
 
     /// Return current position.
     unsigned GetPosition() const { return position_; }
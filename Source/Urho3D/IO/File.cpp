@@ -23,11 +23,14 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
+#include "../Math/Checksum.h"
 
 #include <cstdio>
 #include <LZ4/lz4.h>
@@ -59,11 +62,54 @@ static const char* openMode[] =
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+static const unsigned MIN_PARALLEL_DECOMPRESS_BLOCKS = 4;
+
+/// Compressed block decompression task.
+struct DecompressBlockTask
+{
+    /// Compressed data.
+    const unsigned char* source_;
+    /// Decompression destination. The dictionary, if any, must immediately precede it.
+    unsigned char* dest_;
+    /// Compressed size.
+    unsigned packedSize_;
+    /// Uncompressed size.
+    unsigned unpackedSize_;
+    /// Whether decompression is against a dictionary.
+    bool dictionary_;
+    /// Success flag.
+    bool success_;
+};
+
+static void DecompressBlock(DecompressBlockTask& task)
+{
+    // Blocks which did not compress are stored as is
+    if (task.packedSize_ == task.unpackedSize_)
+    {
+        memcpy(task.dest_, task.source_, task.unpackedSize_);
+        task.success_ = true;
+        return;
+    }
+
+    int decompressed = task.dictionary_ ?
+        LZ4_decompress_safe_withPrefix64k((const char*)task.source_, (char*)task.dest_, task.packedSize_, task.unpackedSize_) :
+        LZ4_decompress_safe((const char*)task.source_, (char*)task.dest_, task.packedSize_, task.unpackedSize_);
+    task.success_ = decompressed == (int)task.unpackedSize_;
+}
+
+static void DecompressBlockWork(const WorkItem* item, unsigned threadIndex)
+{
+    DecompressBlock(*reinterpret_cast<DecompressBlockTask*>(item->start_));
+}
 
 File::File(Context* context) :
     Object(context),
     mode_(FILE_READ),
     handle_(0),
+    mappedData_(0),
+    mappedPosition_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
 #ifdef ANDROID
     assetHandle_(0),
 #endif
@@ -81,6 +127,10 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     Object(context),
     mode_(FILE_READ),
     handle_(0),
+    mappedData_(0),
+    mappedPosition_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
 #ifdef ANDROID
     assetHandle_(0),
 #endif
@@ -99,6 +149,10 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     Object(context),
     mode_(FILE_READ),
     handle_(0),
+    mappedData_(0),
+    mappedPosition_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
 #ifdef ANDROID
     assetHandle_(0),
 #endif
@@ -222,15 +276,52 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
+    // Read directly from the memory mapping if available
+    package_ = package;
+    if (package->IsMemoryMapped())
+    {
+        mappedData_ = package->GetMappedData() + entry->offset_;
+        mappedPosition_ = 0;
+    }
+    else
+    {
 #ifdef WIN32
-    handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
+        handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
 #else
-    handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
+        handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
 #endif
-    if (!handle_)
+        if (!handle_)
+        {
+            LOGERROR("Could not open package file " + fileName);
+            package_.Reset();
+            return false;
+        }
+
+        fseek((FILE*)handle_, entry->offset_, SEEK_SET);
+    }
+
+    // Read the block offset table from the start of the file data
+    blockSize_ = package->GetBlockSize();
+    currentBlock_ = M_MAX_UNSIGNED;
+    if (blockSize_)
     {
-        LOGERROR("Could not open package file " + fileName);
-        return false;
+        unsigned numBlocks = (entry->size_ + blockSize_ - 1) / blockSize_;
+        blockOffsets_.Resize(numBlocks + 1);
+        unsigned tableSize = blockOffsets_.Size() * sizeof(unsigned);
+        if (mappedData_)
+        {
+            MemoryBuffer table(mappedData_, tableSize);
+            for (unsigned i = 0; i < blockOffsets_.Size(); ++i)
+                blockOffsets_[i] = table.ReadUInt();
+        }
+        else
+        {
+            SharedArrayPtr<unsigned char> tableData(new unsigned char[tableSize]);
+            fread(tableData.Get(), tableSize, 1, (FILE*)handle_);
+            MemoryBuffer table(tableData.Get(), tableSize);
+            for (unsigned i = 0; i < blockOffsets_.Size(); ++i)
+                blockOffsets_[i] = table.ReadUInt();
+        }
     }
 
     fileName_ = fileName;
@@ -242,17 +333,15 @@ bool File::Open(PackageFile* package, const String& fileName)
     compressed_ = package->IsCompressed();
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
-
-    fseek((FILE*)handle_, offset_, SEEK_SET);
     return true;
 }
 
 unsigned File::Read(void* dest, unsigned size)
 {
 #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
+    if (!handle_ && !assetHandle_ && !mappedData_)
 #else
-    if (!handle_)
+    if (!handle_ && !mappedData_)
 #endif
     {
         // Do not log the error further here to prevent spamming the stderr stream
@@ -296,6 +385,9 @@ unsigned File::Read(void* dest, unsigned size)
         return size;
     }
 #endif
+    if (blockSize_)
+        return ReadBlocks(dest, size);
+
     if (compressed_)
     {
         unsigned sizeLeft = size;
@@ -306,7 +398,10 @@ unsigned File::Read(void* dest, unsigned size)
             if (!readBuffer_ || readBufferOffset_ >= readBufferSize_)
             {
                 unsigned char blockHeaderBytes[4];
-                fread(blockHeaderBytes, sizeof blockHeaderBytes, 1, (FILE*)handle_);
+                if (mappedData_)
+                    memcpy(blockHeaderBytes, mappedData_ + mappedPosition_, sizeof blockHeaderBytes);
+                else
+                    fread(blockHeaderBytes, sizeof blockHeaderBytes, 1, (FILE*)handle_);
 
                 MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
                 unsigned unpackedSize = blockHeader.ReadUShort();
@@ -315,12 +410,23 @@ unsigned File::Read(void* dest, unsigned size)
                 if (!readBuffer_)
                 {
                     readBuffer_ = new unsigned char[unpackedSize];
-                    inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
+                    if (!mappedData_)
+                        inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
                 }
 
                 /// \todo Handle errors
-                fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_);
-                LZ4_decompress_fast((const char*)inputBuffer_.Get(), (char*)readBuffer_.Get(), unpackedSize);
+                if (mappedData_)
+                {
+                    // Decompress straight from the mapping
+                    const unsigned char* packedData = mappedData_ + mappedPosition_ + sizeof blockHeaderBytes;
+                    LZ4_decompress_fast((const char*)packedData, (char*)readBuffer_.Get(), unpackedSize);
+                    mappedPosition_ += sizeof blockHeaderBytes + packedSize;
+                }
+                else
+                {
+                    fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_);
+                    LZ4_decompress_fast((const char*)inputBuffer_.Get(), (char*)readBuffer_.Get(), unpackedSize);
+                }
 
                 readBufferSize_ = unpackedSize;
                 readBufferOffset_ = 0;
@@ -337,6 +443,13 @@ unsigned File::Read(void* dest, unsigned size)
         return size;
     }
 
+    if (mappedData_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
     // Need to reassign the position due to internal buffering when transitioning from writing to reading
     if (readSyncNeeded_)
     {
@@ -361,9 +474,9 @@ unsigned File::Read(void* dest, unsigned size)
 unsigned File::Seek(unsigned position)
 {
 #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
+    if (!handle_ && !assetHandle_ && !mappedData_)
 #else
-    if (!handle_)
+    if (!handle_ && !mappedData_)
 #endif
     {
         // Do not log the error further here to prevent spamming the stderr stream
@@ -384,6 +497,13 @@ unsigned File::Seek(unsigned position)
         return position_;
     }
 #endif
+    // Block indexed files decompress the block containing the position on the next read
+    if (blockSize_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
         // Start over from the beginning
@@ -392,7 +512,10 @@ unsigned File::Seek(unsigned position)
             position_ = 0;
             readBufferOffset_ = 0;
             readBufferSize_ = 0;
-            fseek((FILE*)handle_, offset_, SEEK_SET);
+            if (mappedData_)
+                mappedPosition_ = 0;
+            else
+                fseek((FILE*)handle_, offset_, SEEK_SET);
         }
         // Skip bytes
         else if (position >= position_)
@@ -407,6 +530,12 @@ unsigned File::Seek(unsigned position)
         return position_;
     }
 
+    if (mappedData_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     fseek((FILE*)handle_, position + offset_, SEEK_SET);
     position_ = position;
     readSyncNeeded_ = false;
@@ -459,26 +588,28 @@ unsigned File::GetChecksum()
     if (offset_ || checksum_)
         return checksum_;
 #ifdef ANDROID
-    if ((!handle_ && !assetHandle_) || mode_ == FILE_WRITE)
+    if ((!handle_ && !assetHandle_ && !mappedData_) || mode_ == FILE_WRITE)
 #else
-    if (!handle_ || mode_ == FILE_WRITE)
+    if ((!handle_ && !mappedData_) || mode_ == FILE_WRITE)
 #endif
         return 0;
 
     PROFILE(CalculateFileChecksum);
 
     unsigned oldPos = position_;
-    checksum_ = 0;
+    Checksum checksum;
 
     Seek(0);
     while (!IsEof())
     {
-        unsigned char block[1024];
-        unsigned readBytes = Read(block, 1024);
-        for (unsigned i = 0; i < readBytes; ++i)
-            checksum_ = SDBMHash(checksum_, block[i]);
+        unsigned char block[16384];
+        unsigned readBytes = Read(block, sizeof block);
+        if (!readBytes)
+            break;
+        checksum.Update(block, readBytes);
     }
 
+    checksum_ = checksum.GetValue();
     Seek(oldPos);
     return checksum_;
 }
@@ -496,6 +627,22 @@ void File::Close()
     readBuffer_.Reset();
     inputBuffer_.Reset();
 
+    package_.Reset();
+    blockOffsets_.Clear();
+    packedData_.Clear();
+    blockSize_ = 0;
+    currentBlock_ = M_MAX_UNSIGNED;
+
+    if (mappedData_)
+    {
+        mappedData_ = 0;
+        mappedPosition_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
+
     if (handle_)
     {
         fclose((FILE*)handle_);
@@ -507,6 +654,137 @@ void File::Close()
     }
 }
 
+unsigned File::ReadBlocks(void* dest, unsigned size)
+{
+    const PODVector<unsigned char>& dictionary = package_->GetDictionary();
+    unsigned char* destPtr = (unsigned char*)dest;
+    unsigned sizeLeft = size;
+
+    while (sizeLeft)
+    {
+        unsigned block = position_ / blockSize_;
+        unsigned blockStart = block * blockSize_;
+        unsigned blockOffset = position_ - blockStart;
+
+        // Decompress whole blocks straight to the destination. Not possible with a dictionary, as it must precede the output
+        if (!blockOffset && dictionary.Empty())
+        {
+            unsigned numBlocks = 0;
+            unsigned wholeSize = 0;
+            while (block + numBlocks < blockOffsets_.Size() - 1)
+            {
+                unsigned unpackedSize = Min((int)blockSize_, (int)(size_ - blockStart - wholeSize));
+                if (wholeSize + unpackedSize > sizeLeft)
+                    break;
+                wholeSize += unpackedSize;
+                ++numBlocks;
+            }
+
+            if (numBlocks)
+            {
+                if (!DecompressBlocks(destPtr, block, numBlocks))
+                    return size - sizeLeft;
+                destPtr += wholeSize;
+                sizeLeft -= wholeSize;
+                position_ += wholeSize;
+                continue;
+            }
+        }
+
+        // Otherwise decompress into the read buffer, after the dictionary
+        if (!readBuffer_)
+        {
+            readBuffer_ = new unsigned char[dictionary.Size() + blockSize_];
+            if (dictionary.Size())
+                memcpy(readBuffer_.Get(), &dictionary[0], dictionary.Size());
+        }
+        if (block != currentBlock_)
+        {
+            if (!DecompressBlocks(readBuffer_.Get() + dictionary.Size(), block, 1))
+            {
+                currentBlock_ = M_MAX_UNSIGNED;
+                return size - sizeLeft;
+            }
+            currentBlock_ = block;
+        }
+
+        unsigned unpackedSize = Min((int)blockSize_, (int)(size_ - blockStart));
+        unsigned copySize = Min((int)(unpackedSize - blockOffset), (int)sizeLeft);
+        memcpy(destPtr, readBuffer_.Get() + dictionary.Size() + blockOffset, copySize);
+        destPtr += copySize;
+        sizeLeft -= copySize;
+        position_ += copySize;
+    }
+
+    return size;
+}
+
+bool File::DecompressBlocks(unsigned char* dest, unsigned firstBlock, unsigned numBlocks)
+{
+    unsigned packedStart = blockOffsets_[firstBlock];
+    unsigned packedSize = blockOffsets_[firstBlock + numBlocks] - packedStart;
+    const unsigned char* packedData;
+
+    if (mappedData_)
+        packedData = mappedData_ + packedStart;
+    else
+    {
+        // The compressed blocks are consecutive, so read them all at once
+        packedData_.Resize(packedSize);
+        fseek((FILE*)handle_, offset_ + packedStart, SEEK_SET);
+        if (packedSize && fread(&packedData_[0], packedSize, 1, (FILE*)handle_) != 1)
+        {
+            LOGERROR("Error while reading from file " + GetName());
+            return false;
+        }
+        packedData = packedData_.Size() ? &packedData_[0] : 0;
+    }
+
+    PODVector<DecompressBlockTask> tasks(numBlocks);
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned block = firstBlock + i;
+        DecompressBlockTask& task = tasks[i];
+        task.source_ = packedData + blockOffsets_[block] - packedStart;
+        task.dest_ = dest + i * blockSize_;
+        task.packedSize_ = blockOffsets_[block + 1] - blockOffsets_[block];
+        task.unpackedSize_ = Min((int)blockSize_, (int)(size_ - block * blockSize_));
+        task.dictionary_ = !package_->GetDictionary().Empty();
+        task.success_ = false;
+    }
+
+    // Decompress large reads in parallel when on the main thread, as the work queue can not be used from other threads
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (numBlocks >= MIN_PARALLEL_DECOMPRESS_BLOCKS && queue && queue->GetNumThreads() && Thread::IsMainThread())
+    {
+        for (unsigned i = 0; i < numBlocks; ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = DecompressBlockWork;
+            item->start_ = &tasks[i];
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i = 0; i < numBlocks; ++i)
+            DecompressBlock(tasks[i]);
+    }
+
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        if (!tasks[i].success_)
+        {
+            LOGERROR("Error while decompressing file " + GetName());
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void File::Flush()
 {
     if (handle_)
@@ -521,9 +799,9 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
 #ifdef ANDROID
-        return handle_ != 0 || assetHandle_ != 0;
+        return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
 #else
-    return handle_ != 0;
+    return handle_ != 0 || mappedData_ != 0;
 #endif
 }
 
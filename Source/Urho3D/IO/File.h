@@ -69,8 +69,10 @@ public:
     /// Return the file name.
     virtual const String& GetName() const { return fileName_; }
 
-    /// Return a checksum of the file contents using the SDBM hash algorithm.
+    /// Return a checksum of the file contents using the xxHash32 algorithm.
     virtual unsigned GetChecksum();
+    /// Return the file contents within a memory mapped package file for zero-copy access, or null if not mapped or compressed.
+    virtual const unsigned char* GetDirectData() const { return compressed_ ? 0 : mappedData_; }
 
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
@@ -95,13 +97,35 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file is read from a memory mapped package file.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
+
 private:
+    /// Read from a block indexed compressed package file. Return number of bytes actually read.
+    unsigned ReadBlocks(void* dest, unsigned size);
+    /// Decompress consecutive blocks to the destination. Return true if successful.
+    bool DecompressBlocks(unsigned char* dest, unsigned firstBlock, unsigned numBlocks);
+
     /// File name.
     String fileName_;
     /// Open mode.
     FileMode mode_;
     /// File handle.
     void* handle_;
+    /// Package file that the file is read from.
+    SharedPtr<PackageFile> package_;
+    /// File contents within the memory mapped package file.
+    const unsigned char* mappedData_;
+    /// Read position of the compressed data within the memory mapped package file.
+    unsigned mappedPosition_;
+    /// Offsets of the compressed blocks from the file start within a block indexed package, including the end offset.
+    PODVector<unsigned> blockOffsets_;
+    /// Compressed data read buffer for block indexed packages which are not memory mapped.
+    PODVector<unsigned char> packedData_;
+    /// Uncompressed block size, or 0 if not reading from a block indexed package.
+    unsigned blockSize_;
+    /// Index of the decompressed block in the read buffer.
+    unsigned currentBlock_;
 #ifdef ANDROID
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
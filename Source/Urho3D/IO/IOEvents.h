@@ -41,4 +41,12 @@ EVENT(E_ASYNCEXECFINISHED, AsyncExecFinished)
     PARAM(P_EXITCODE, ExitCode);            // int
 }
 
+/// Asynchronous file read request completed.
+EVENT(E_ASYNCREADCOMPLETED, AsyncReadCompleted)
+{
+    PARAM(P_REQUEST, Request);              // AsyncReadRequest pointer
+    PARAM(P_FILENAME, FileName);            // String
+    PARAM(P_SUCCESS, Success);              // bool
+}
+
 }
@@ -47,6 +47,8 @@ public:
     virtual unsigned Seek(unsigned position);
     /// Write bytes to the memory area.
     virtual unsigned Write(const void* data, unsigned size);
+    /// Return the memory area for zero-copy access.
+    virtual const unsigned char* GetDirectData() const { return buffer_; }
 
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
@@ -23,17 +23,32 @@
 #include "../Precompiled.h"
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+// LZ4 back-references reach at most 64 KB before the block
+static const unsigned MAX_DICTIONARY_SIZE = 65536;
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    compressed_(false),
+    blockSize_(0),
+    mappedData_(0),
+    mappingHandle_(0)
 {
 }
 
@@ -41,13 +56,17 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    compressed_(false),
+    blockSize_(0),
+    mappedData_(0),
+    mappingHandle_(0)
 {
     Open(fileName, startOffset);
 }
 
 PackageFile::~PackageFile()
 {
+    UnmapMemory();
 }
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
@@ -60,6 +79,8 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     }
 #endif
 
+    UnmapMemory();
+
     SharedPtr<File> file(new File(context_, fileName));
     if (!file->IsOpen())
         return false;
@@ -67,7 +88,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -84,7 +105,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
         {
             LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -94,11 +115,27 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZB";
+    blockSize_ = 0;
+    dictionary_.Clear();
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
+    // Block indexed compressed packages store the block size and an optional dictionary in the header
+    if (id == "ULZB")
+    {
+        blockSize_ = file->ReadUInt();
+        dictionary_.Resize(file->ReadUInt());
+        if (!blockSize_ || dictionary_.Size() > MAX_DICTIONARY_SIZE)
+        {
+            LOGERROR(fileName + " has an invalid compression block size or dictionary");
+            return false;
+        }
+        if (dictionary_.Size())
+            file->Read(&dictionary_[0], dictionary_.Size());
+    }
+
     for (unsigned i = 0; i < numFiles; ++i)
     {
         String entryName = file->ReadString();
@@ -115,6 +152,70 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     return true;
 }
 
+bool PackageFile::MapMemory()
+{
+    if (mappedData_)
+        return true;
+    if (fileName_.Empty() || !totalSize_)
+    {
+        LOGERROR("Package file not open, can not map into memory");
+        return false;
+    }
+
+#ifdef WIN32
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName_).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+    {
+        mappingHandle_ = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        // The mapping object keeps the file open
+        CloseHandle(fileHandle);
+        if (mappingHandle_)
+        {
+            mappedData_ = (unsigned char*)MapViewOfFile((HANDLE)mappingHandle_, FILE_MAP_READ, 0, 0, totalSize_);
+            if (!mappedData_)
+            {
+                CloseHandle((HANDLE)mappingHandle_);
+                mappingHandle_ = 0;
+            }
+        }
+    }
+#else
+    int fd = open(GetNativePath(fileName_).CString(), O_RDONLY);
+    if (fd != -1)
+    {
+        void* data = mmap(0, totalSize_, PROT_READ, MAP_SHARED, fd, 0);
+        // The mapping stays valid after closing the descriptor
+        close(fd);
+        if (data != MAP_FAILED)
+            mappedData_ = (unsigned char*)data;
+    }
+#endif
+
+    if (!mappedData_)
+    {
+        LOGWARNING("Could not map package file " + fileName_ + " into memory, falling back to file reads");
+        return false;
+    }
+
+    return true;
+}
+
+void PackageFile::UnmapMemory()
+{
+    if (!mappedData_)
+        return;
+
+#ifdef WIN32
+    UnmapViewOfFile(mappedData_);
+    CloseHandle((HANDLE)mappingHandle_);
+    mappingHandle_ = 0;
+#else
+    munmap(mappedData_, totalSize_);
+#endif
+    mappedData_ = 0;
+}
+
 bool PackageFile::Exists(const String& fileName) const
 {
     bool found = entries_.Find(fileName) != entries_.End();
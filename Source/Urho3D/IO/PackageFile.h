@@ -53,6 +53,8 @@ public:
 
     /// Open the package file. Return true if successful.
     bool Open(const String& fileName, unsigned startOffset = 0);
+    /// Map the whole package file into memory, so that files can be read from it without file I/O calls and uncompressed files can be accessed without copying. Return true if successful.
+    bool MapMemory();
     /// Check if a file exists within the package file. This will be case-insensitive on Windows and case-sensitive on other platforms.
     bool Exists(const String& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found. This will be case-insensitive on Windows and case-sensitive on other platforms.
@@ -79,10 +81,25 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return uncompressed size of the independently compressed blocks, or 0 if the package does not have a block index.
+    unsigned GetBlockSize() const { return blockSize_; }
+
+    /// Return the compression dictionary that precedes each compressed block.
+    const PODVector<unsigned char>& GetDictionary() const { return dictionary_; }
+
     /// Return list of file names in the package.
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
 
+    /// Return whether the package file is mapped into memory.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
+
+    /// Return the memory mapped package file contents, or null if not mapped.
+    const unsigned char* GetMappedData() const { return mappedData_; }
+
 private:
+    /// Unmap the package file from memory.
+    void UnmapMemory();
+
     /// File entries.
     HashMap<String, PackageEntry> entries_;
     /// File name.
@@ -95,6 +112,14 @@ private:
     unsigned checksum_;
     /// Compressed flag.
     bool compressed_;
+    /// Compressed block size for block indexed packages.
+    unsigned blockSize_;
+    /// Compression dictionary.
+    PODVector<unsigned char> dictionary_;
+    /// Memory mapped package file contents.
+    unsigned char* mappedData_;
+    /// File mapping object handle. Only used on Windows.
+    void* mappingHandle_;
 };
 
 }
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Math/Checksum.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned PRIME1 = 2654435761U;
+static const unsigned PRIME2 = 2246822519U;
+static const unsigned PRIME3 = 3266489917U;
+static const unsigned PRIME4 = 668265263U;
+static const unsigned PRIME5 = 374761393U;
+
+/// Rotate left.
+static inline unsigned RotateLeft(unsigned value, unsigned bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/// Read a little-endian 32-bit value.
+static inline unsigned ReadLE32(const unsigned char* data)
+{
+    return (unsigned)data[0] | ((unsigned)data[1] << 8) | ((unsigned)data[2] << 16) | ((unsigned)data[3] << 24);
+}
+
+/// Mix 4 bytes into a lane.
+static inline unsigned MixLane(unsigned lane, const unsigned char* data)
+{
+    return RotateLeft(lane + ReadLE32(data) * PRIME2, 13) * PRIME1;
+}
+
+Checksum::Checksum(unsigned seed)
+{
+    Reset(seed);
+}
+
+void Checksum::Reset(unsigned seed)
+{
+    lanes_[0] = seed + PRIME1 + PRIME2;
+    lanes_[1] = seed + PRIME2;
+    lanes_[2] = seed;
+    lanes_[3] = seed - PRIME1;
+    bufferSize_ = 0;
+    totalSize_ = 0;
+    seed_ = seed;
+}
+
+void Checksum::Update(const void* data, unsigned size)
+{
+    const unsigned char* src = (const unsigned char*)data;
+    totalSize_ += size;
+
+    // Complete a stripe from the leftover data first
+    if (bufferSize_)
+    {
+        unsigned copySize = 16 - bufferSize_;
+        if (copySize > size)
+            copySize = size;
+        memcpy(buffer_ + bufferSize_, src, copySize);
+        bufferSize_ += copySize;
+        src += copySize;
+        size -= copySize;
+        if (bufferSize_ < 16)
+            return;
+
+        lanes_[0] = MixLane(lanes_[0], buffer_);
+        lanes_[1] = MixLane(lanes_[1], buffer_ + 4);
+        lanes_[2] = MixLane(lanes_[2], buffer_ + 8);
+        lanes_[3] = MixLane(lanes_[3], buffer_ + 12);
+        bufferSize_ = 0;
+    }
+
+    // Keep the lanes in locals so that the compiler can keep them in registers
+    unsigned v1 = lanes_[0];
+    unsigned v2 = lanes_[1];
+    unsigned v3 = lanes_[2];
+    unsigned v4 = lanes_[3];
+    while (size >= 16)
+    {
+        v1 = MixLane(v1, src);
+        v2 = MixLane(v2, src + 4);
+        v3 = MixLane(v3, src + 8);
+        v4 = MixLane(v4, src + 12);
+        src += 16;
+        size -= 16;
+    }
+    lanes_[0] = v1;
+    lanes_[1] = v2;
+    lanes_[2] = v3;
+    lanes_[3] = v4;
+
+    if (size)
+    {
+        memcpy(buffer_, src, size);
+        bufferSize_ = size;
+    }
+}
+
+unsigned Checksum::GetValue() const
+{
+    unsigned hash;
+    if (totalSize_ >= 16)
+        hash = RotateLeft(lanes_[0], 1) + RotateLeft(lanes_[1], 7) + RotateLeft(lanes_[2], 12) + RotateLeft(lanes_[3], 18);
+    else
+        hash = seed_ + PRIME5;
+
+    hash += totalSize_;
+
+    // Mix in the leftover data
+    unsigned i = 0;
+    for (; i + 4 <= bufferSize_; i += 4)
+        hash = RotateLeft(hash + ReadLE32(buffer_ + i) * PRIME3, 17) * PRIME4;
+    for (; i < bufferSize_; ++i)
+        hash = RotateLeft(hash + buffer_[i] * PRIME5, 11) * PRIME1;
+
+    // Final avalanche
+    hash ^= hash >> 15;
+    hash *= PRIME2;
+    hash ^= hash >> 13;
+    hash *= PRIME3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+unsigned Checksum::Calculate(const void* data, unsigned size, unsigned seed)
+{
+    Checksum checksum(seed);
+    checksum.Update(data, size);
+    return checksum.GetValue();
+}
+
+}
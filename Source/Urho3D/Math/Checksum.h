@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#ifdef URHO3D_IS_BUILDING
+#include "Urho3D.h"
+#else
+#include <Urho3D/Urho3D.h>
+#endif
+
+namespace Urho3D
+{
+
+/// Incremental 32-bit hash of a byte stream, used for file, package and scene checksums. Follows the xxHash32 algorithm: the data is processed 16 bytes at a time in four independent lanes, which is many times faster than hashing one byte at a time. The result does not depend on how the data is split into updates, nor on the byte order of the platform.
+class URHO3D_API Checksum
+{
+public:
+    /// Construct with seed.
+    Checksum(unsigned seed = 0);
+
+    /// Restart with seed.
+    void Reset(unsigned seed = 0);
+    /// Hash more data.
+    void Update(const void* data, unsigned size);
+
+    /// Return the hash of the data so far.
+    unsigned GetValue() const;
+
+    /// Return the hash of a block of data.
+    static unsigned Calculate(const void* data, unsigned size, unsigned seed = 0);
+
+private:
+    /// Lane accumulators.
+    unsigned lanes_[4];
+    /// Data left over from the last update, less than a full stripe.
+    unsigned char buffer_[16];
+    /// Number of bytes in the leftover data.
+    unsigned bufferSize_;
+    /// Total number of bytes hashed.
+    unsigned totalSize_;
+    /// Seed.
+    unsigned seed_;
+};
+
+}
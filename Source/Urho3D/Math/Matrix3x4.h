@@ -24,6 +24,10 @@
 
 #include "../Math/Matrix4.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -292,6 +296,20 @@ public:
     /// Multiply a matrix.
     Matrix3x4 operator *(const Matrix3x4& rhs) const
     {
+#ifdef URHO3D_SSE
+        // Each result row is a combination of the rows of rhs. The additions are in the same order as below
+        Matrix3x4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        _mm_storeu_ps(&ret.m00_, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m00_), r0),
+            _mm_mul_ps(_mm_set1_ps(m01_), r1)), _mm_mul_ps(_mm_set1_ps(m02_), r2)), _mm_set_ps(m03_, 0.0f, 0.0f, 0.0f)));
+        _mm_storeu_ps(&ret.m10_, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m10_), r0),
+            _mm_mul_ps(_mm_set1_ps(m11_), r1)), _mm_mul_ps(_mm_set1_ps(m12_), r2)), _mm_set_ps(m13_, 0.0f, 0.0f, 0.0f)));
+        _mm_storeu_ps(&ret.m20_, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m20_), r0),
+            _mm_mul_ps(_mm_set1_ps(m21_), r1)), _mm_mul_ps(_mm_set1_ps(m22_), r2)), _mm_set_ps(m23_, 0.0f, 0.0f, 0.0f)));
+        return ret;
+#else
         return Matrix3x4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_,
@@ -306,6 +324,7 @@ public:
             m20_ * rhs.m02_ + m21_ * rhs.m12_ + m22_ * rhs.m22_,
             m20_ * rhs.m03_ + m21_ * rhs.m13_ + m22_ * rhs.m23_ + m23_
         );
+#endif
     }
 
     /// Multiply a 4x4 matrix.
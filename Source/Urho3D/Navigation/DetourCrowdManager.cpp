@@ -505,12 +505,12 @@ void DetourCrowdManager::HandleNavMeshFullRebuild(StringHash eventType, VariantM
         SetNavigationMesh(navMesh);
 
         // Scan for existing agents that are potentially important
-        PODVector<Node*> agents;
-        GetScene()->GetChildrenWithComponent<CrowdAgent>(agents, true);
+        // Copy the list, as event handlers could add or remove agents
+        PODVector<CrowdAgent*> agents = GetScene()->GetComponentsByType<CrowdAgent>();
         for (unsigned i = 0; i < agents.Size(); ++i)
         {
-            CrowdAgent* agent = agents[i]->GetComponent<CrowdAgent>();
-            if (agent && agent->IsEnabledEffective())
+            CrowdAgent* agent = agents[i];
+            if (agent->IsEnabledEffective())
                 agent->AddAgentToCrowd();
         }
     }
@@ -384,12 +384,12 @@ bool DynamicNavigationMesh::Build()
         }
 
         // Scan for obstacles to insert into us
-        PODVector<Node*> obstacles;
-        GetScene()->GetChildrenWithComponent<Obstacle>(obstacles, true);
+        // Copy the list, as event handlers could add or remove obstacles
+        PODVector<Obstacle*> obstacles = GetScene()->GetComponentsByType<Obstacle>();
         for (unsigned i = 0; i < obstacles.Size(); ++i)
         {
-            Obstacle* obs = obstacles[i]->GetComponent<Obstacle>();
-            if (obs && obs->IsEnabledEffective())
+            Obstacle* obs = obstacles[i];
+            if (obs->IsEnabledEffective())
                 AddObstacle(obs);
         }
 
@@ -510,12 +510,11 @@ void DynamicNavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTe
         // Draw Obstacle components
         if (drawObstacles_)
         {
-            PODVector<Node*> obstacles;
-            scene->GetChildrenWithComponent<Obstacle>(obstacles, true);
+            const PODVector<Obstacle*>& obstacles = scene->GetComponentsByType<Obstacle>();
             for (unsigned i = 0; i < obstacles.Size(); ++i)
             {
-                Obstacle* obstacle = obstacles[i]->GetComponent<Obstacle>();
-                if (obstacle && obstacle->IsEnabledEffective())
+                Obstacle* obstacle = obstacles[i];
+                if (obstacle->IsEnabledEffective())
                     obstacle->DrawDebugGeometry(debug, depthTest);
             }
         }
@@ -523,12 +522,11 @@ void DynamicNavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTe
         // Draw OffMeshConnection components
         if (drawOffMeshConnections_)
         {
-            PODVector<Node*> connections;
-            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
+            const PODVector<OffMeshConnection*>& connections = scene->GetComponentsByType<OffMeshConnection>();
             for (unsigned i = 0; i < connections.Size(); ++i)
             {
-                OffMeshConnection* connection = connections[i]->GetComponent<OffMeshConnection>();
-                if (connection && connection->IsEnabledEffective())
+                OffMeshConnection* connection = connections[i];
+                if (connection->IsEnabledEffective())
                     connection->DrawDebugGeometry(debug, depthTest);
             }
         }
@@ -536,12 +534,11 @@ void DynamicNavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTe
         // Draw NavArea components
         if (drawNavAreas_)
         {
-            PODVector<Node*> areas;
-            scene->GetChildrenWithComponent<NavArea>(areas, true);
+            const PODVector<NavArea*>& areas = scene->GetComponentsByType<NavArea>();
             for (unsigned i = 0; i < areas.Size(); ++i)
             {
-                NavArea* area = areas[i]->GetComponent<NavArea>();
-                if (area && area->IsEnabledEffective())
+                NavArea* area = areas[i];
+                if (area->IsEnabledEffective())
                     area->DrawDebugGeometry(debug, depthTest);
             }
         }
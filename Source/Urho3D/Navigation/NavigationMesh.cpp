@@ -207,12 +207,11 @@ void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
         // Draw OffMeshConnection components
         if (drawOffMeshConnections_)
         {
-            PODVector<Node*> connections;
-            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
+            const PODVector<OffMeshConnection*>& connections = scene->GetComponentsByType<OffMeshConnection>();
             for (unsigned i = 0; i < connections.Size(); ++i)
             {
-                OffMeshConnection* connection = connections[i]->GetComponent<OffMeshConnection>();
-                if (connection && connection->IsEnabledEffective())
+                OffMeshConnection* connection = connections[i];
+                if (connection->IsEnabledEffective())
                     connection->DrawDebugGeometry(debug, depthTest);
             }
         }
@@ -220,12 +219,11 @@ void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
         // Draw NavArea components
         if (drawNavAreas_)
         {
-            PODVector<Node*> areas;
-            scene->GetChildrenWithComponent<NavArea>(areas, true);
+            const PODVector<NavArea*>& areas = scene->GetComponentsByType<NavArea>();
             for (unsigned i = 0; i < areas.Size(); ++i)
             {
-                NavArea* area = areas[i]->GetComponent<NavArea>();
-                if (area && area->IsEnabledEffective())
+                NavArea* area = areas[i];
+                if (area->IsEnabledEffective())
                     area->DrawDebugGeometry(debug, depthTest);
             }
         }
@@ -785,21 +783,36 @@ void NavigationMesh::CollectGeometries(Vector<NavigationGeometryInfo>& geometryL
     PROFILE(CollectNavigationGeometry);
 
     // Get Navigable components from child nodes, not from whole scene. This makes it possible to partition
-    // the scene into several navigation meshes
+    // the scene into several navigation meshes. When the mesh is in the scene root node, the components can be taken
+    // from the scene's type lists instead of searching the hierarchy
+    Scene* scene = GetScene();
+    bool wholeScene = scene && node_ == scene;
     PODVector<Navigable*> navigables;
-    node_->GetComponents<Navigable>(navigables, true);
+    if (wholeScene)
+        navigables = scene->GetComponentsByType<Navigable>();
+    else
+        node_->GetComponents<Navigable>(navigables, true);
 
+    // Process the recursive navigables first, as the type lists are not in hierarchy order, and a node already processed
+    // by a non-recursive navigable would stop a recursive navigable above it from collecting the nodes below
     HashSet<Node*> processedNodes;
-    for (unsigned i = 0; i < navigables.Size(); ++i)
+    for (unsigned i = 0; i < 2; ++i)
     {
-        if (navigables[i]->IsEnabledEffective())
-            CollectGeometries(geometryList, navigables[i]->GetNode(), processedNodes, navigables[i]->IsRecursive());
+        bool recursive = i == 0;
+        for (unsigned j = 0; j < navigables.Size(); ++j)
+        {
+            if (navigables[j]->IsRecursive() == recursive && navigables[j]->IsEnabledEffective())
+                CollectGeometries(geometryList, navigables[j]->GetNode(), processedNodes, recursive);
+        }
     }
 
     // Get offmesh connections
     Matrix3x4 inverse = node_->GetWorldTransform().Inverse();
     PODVector<OffMeshConnection*> connections;
-    node_->GetComponents<OffMeshConnection>(connections, true);
+    if (wholeScene)
+        connections = scene->GetComponentsByType<OffMeshConnection>();
+    else
+        node_->GetComponents<OffMeshConnection>(connections, true);
 
     for (unsigned i = 0; i < connections.Size(); ++i)
     {
@@ -818,7 +831,10 @@ void NavigationMesh::CollectGeometries(Vector<NavigationGeometryInfo>& geometryL
 
     // Get nav area volumes
     PODVector<NavArea*> navAreas;
-    node_->GetComponents<NavArea>(navAreas, true);
+    if (wholeScene)
+        navAreas = scene->GetComponentsByType<NavArea>();
+    else
+        node_->GetComponents<NavArea>(navAreas, true);
     for (unsigned i = 0; i < navAreas.Size(); ++i)
     {
         NavArea* area = navAreas[i];
@@ -42,6 +42,8 @@ public:
 
     /// Handle attribute write access.
     virtual void OnSetAttribute(const AttributeInfo& attr, const Variant& src);
+    /// Return false, as attribute changes are handled in OnSetAttribute().
+    virtual bool AllowRawAttributeAccess() const { return false; }
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
     virtual void ApplyAttributes();
     /// Visualize the component as debug geometry.
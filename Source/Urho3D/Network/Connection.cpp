@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/Compression.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -34,11 +35,13 @@
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
 #include "../Resource/ResourceCache.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/SmoothedTransform.h"
 
 #include <kNet/kNet.h>
+#include <LZ4/lz4.h>
 
 #include "../DebugNew.h"
 
@@ -46,9 +49,103 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Outbound queue size in fragments, above which no more package data is queued during an update.
+static const unsigned PACKAGE_MAX_PENDING_FRAGMENTS = 1024;
+static const unsigned MAX_CONTROLS_HISTORY = 128;
+
+/// Collects the size and serialization time of a node or component network update for the network statistics, if enabled.
+class NetworkSerializationScope
+{
+public:
+    /// Construct and start measuring. The timer is only read when statistics are enabled.
+    NetworkSerializationScope(Network* network, NetworkStatistics& statistics, HiresTimer& timer, Serializable* object,
+        const Deserializer& buffer, bool outgoing) :
+        network_(network->GetStatisticsEnabled() ? network : 0),
+        statistics_(statistics),
+        timer_(timer),
+        object_(object),
+        buffer_(buffer),
+        startPosition_(buffer.GetPosition()),
+        startTime_(network_ ? timer.GetUSec(false) : 0),
+        outgoing_(outgoing)
+    {
+    }
+
+    /// Destruct and store the measurement.
+    ~NetworkSerializationScope()
+    {
+        if (network_)
+        {
+            unsigned usec = (unsigned)(timer_.GetUSec(false) - startTime_);
+            statistics_.serializationTime_ += usec;
+            network_->AddSerializationStatistics(object_->GetType(), object_->GetTypeName(), buffer_.GetPosition() - startPosition_,
+                usec, outgoing_);
+        }
+    }
+
+private:
+    /// %Network subsystem, null if not collecting statistics.
+    Network* network_;
+    /// Connection statistics to add the serialization time to.
+    NetworkStatistics& statistics_;
+    /// Connection's serialization timer.
+    HiresTimer& timer_;
+    /// Object being serialized.
+    Serializable* object_;
+    /// Message buffer.
+    const Deserializer& buffer_;
+    /// Message buffer position at start.
+    unsigned startPosition_;
+    /// Timer value at start.
+    long long startTime_;
+    /// Outgoing update flag.
+    bool outgoing_;
+};
+
+/// Return the file name used for a package download in progress.
+static String GetPartialPackageFileName(const String& cacheDir, const String& name, unsigned checksum)
+{
+    return cacheDir + ToStringHex(checksum) + "_" + name + ".part";
+}
+
+/// Return the file name used to store the progress of an interrupted package download.
+static String GetPackageProgressFileName(const String& partialFileName)
+{
+    return partialFileName + ".resume";
+}
+
+static void WriteNetworkAttributes(Serializable* object, Serializer& dest)
+{
+    const Vector<AttributeInfo>* attributes = object->GetNetworkAttributes();
+    if (!attributes)
+        return;
+
+    Variant value;
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        object->OnGetAttribute(attributes->At(i), value);
+        dest.WriteVariantData(value);
+    }
+}
+
+static void ReadNetworkAttributes(Serializable* object, Deserializer& source)
+{
+    const Vector<AttributeInfo>* attributes = object->GetNetworkAttributes();
+    if (!attributes)
+        return;
+
+    for (unsigned i = 0; i < attributes->Size() && !source.IsEof(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        object->OnSetAttribute(attr, source.ReadVariant(attr.type_));
+    }
+    object->ApplyAttributes();
+}
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
+    numReceivedFragments_(0),
+    contiguousFragments_(0),
     checksum_(0),
     initiated_(false)
 {
@@ -56,15 +153,21 @@ PackageDownload::PackageDownload() :
 
 PackageUpload::PackageUpload() :
     fragment_(0),
-    totalFragments_(0)
+    totalFragments_(0),
+    compressed_(false)
 {
 }
 
 Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::MessageConnection> connection) :
     Object(context),
     timeStamp_(0),
+    network_(GetSubsystem<Network>()),
     connection_(connection),
     sendMode_(OPSM_NONE),
+    packageChunkFragments_(1),
+    serverTimeStamp_(0),
+    predictionPending_(false),
+    replaying_(false),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
@@ -82,6 +185,9 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
 
 Connection::~Connection()
 {
+    // Store progress of unfinished package downloads so that they can be resumed on the next connection
+    SuspendPackageDownloads();
+
     // Reset scene (remove possible owner references), as this connection is about to be destroyed
     SetScene(0);
 }
@@ -122,16 +228,16 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         memcpy(msg->data, data, numBytes);
 
     connection_->EndAndQueueMessage(msg);
+
+    ++statistics_.messagesOut_;
+    statistics_.bytesOut_ += numBytes;
+    if (network_->GetStatisticsEnabled())
+        network_->AddMessageStatistics(msgID, numBytes, true);
 }
 
 void Connection::SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = 0;
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    remoteEvents_.Push(network_->PrepareRemoteEvent(0, eventType, inOrder, eventData));
 }
 
 void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData)
@@ -152,12 +258,12 @@ void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder,
         return;
     }
 
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = node->GetID();
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    remoteEvents_.Push(network_->PrepareRemoteEvent(node->GetID(), eventType, inOrder, eventData));
+}
+
+void Connection::QueueRemoteEvent(const RemoteEvent& remoteEvent)
+{
+    remoteEvents_.Push(remoteEvent);
 }
 
 void Connection::SetScene(Scene* newScene)
@@ -171,6 +277,7 @@ void Connection::SetScene(Scene* newScene)
     scene_ = newScene;
     sceneLoaded_ = false;
     UnsubscribeFromEvent(E_ASYNCLOADFINISHED);
+    RemoveAllPredictedNodes();
 
     if (!scene_)
         return;
@@ -236,6 +343,50 @@ void Connection::SetLogStatistics(bool enable)
     logStatistics_ = enable;
 }
 
+void Connection::ResetStatistics()
+{
+    statistics_.Reset();
+}
+
+void Connection::AddPredictedNode(Node* node)
+{
+    if (!node)
+    {
+        LOGERROR("Null node for prediction");
+        return;
+    }
+    if (isClient_)
+    {
+        LOGERROR("Predicted nodes are only supported on the client");
+        return;
+    }
+    if (node->GetScene() != scene_ || node->GetID() >= FIRST_LOCAL_ID)
+    {
+        LOGERROR("Predicted node must be a replicated node in the connection's scene");
+        return;
+    }
+
+    PredictedNode& predicted = predictedNodes_[node->GetID()];
+    predicted.node_ = node;
+    predicted.updated_ = false;
+    SavePredictedState(predicted);
+}
+
+void Connection::RemovePredictedNode(Node* node)
+{
+    if (node)
+        predictedNodes_.Erase(node->GetID());
+    if (predictedNodes_.Empty())
+        controlsHistory_.Clear();
+}
+
+void Connection::RemoveAllPredictedNodes()
+{
+    predictedNodes_.Clear();
+    controlsHistory_.Clear();
+    predictionPending_ = false;
+}
+
 void Connection::Disconnect(int waitMSec)
 {
     connection_->Disconnect(waitMSec);
@@ -280,6 +431,18 @@ void Connection::SendClientUpdate()
         msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
 
+    // Keep the sent controls for replaying them on predicted nodes until the server has acknowledged them
+    if (!predictedNodes_.Empty())
+    {
+        if (controlsHistory_.Size() >= MAX_CONTROLS_HISTORY)
+            controlsHistory_.Erase(0);
+        SentControls sent;
+        sent.controls_ = controls_;
+        sent.timeStamp_ = timeStamp_;
+        sent.timeStep_ = 1.0f / (float)network_->GetUpdateFps();
+        controlsHistory_.Push(sent);
+    }
+
     ++timeStamp_;
 }
 
@@ -302,22 +465,31 @@ void Connection::SendRemoteEvents()
 
     PROFILE(SendRemoteEvents);
 
-    for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
+    // Batch the queued events into at most two messages per update: one for in order and one for unordered events
+    for (unsigned ordered = 0; ordered < 2; ++ordered)
     {
-        msg_.Clear();
-        if (!i->senderID_)
+        bool inOrder = ordered != 0;
+        unsigned numEvents = 0;
+        for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
         {
-            msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTEEVENT, true, i->inOrder_, msg_);
+            if (i->inOrder_ == inOrder)
+                ++numEvents;
         }
-        else
+        if (!numEvents)
+            continue;
+
+        msg_.Clear();
+        msg_.WriteVLE(numEvents);
+        for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
         {
-            msg_.WriteNetID(i->senderID_);
+            if (i->inOrder_ != inOrder)
+                continue;
+            msg_.WriteVLE(i->senderID_);
             msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTENODEEVENT, true, i->inOrder_, msg_);
+            msg_.WriteBool(i->compact_);
+            msg_.Write(i->data_.Get(), i->dataSize_);
         }
+        SendMessage(MSG_REMOTEEVENTS, true, inOrder, msg_);
     }
 
     remoteEvents_.Clear();
@@ -325,26 +497,59 @@ void Connection::SendRemoteEvents()
 
 void Connection::SendPackages()
 {
-    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() < 1000)
-    {
-        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+    if (uploads_.Empty())
+        return;
+
+    PROFILE(SendPackages);
+
+    // Adapt the data message size: grow it if the outbound queue drained completely since the last update, shrink it if the
+    // queue is still full
+    unsigned pendingMessages = connection_->NumOutboundMessagesPending();
+    if (!pendingMessages)
+        packageChunkFragments_ = (unsigned)Min((int)packageChunkFragments_ * 2, (int)PACKAGE_MAX_CHUNK_FRAGMENTS);
+    else if (pendingMessages * packageChunkFragments_ >= PACKAGE_MAX_PENDING_FRAGMENTS)
+        packageChunkFragments_ = (unsigned)Max((int)packageChunkFragments_ / 2, 1);
 
+    unsigned maxChunkSize = packageChunkFragments_ * PACKAGE_FRAGMENT_SIZE;
+    packageBuffer_.Resize(maxChunkSize);
+
+    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() * packageChunkFragments_ < PACKAGE_MAX_PENDING_FRAGMENTS)
+    {
         for (HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Begin(); i != uploads_.End();)
         {
             HashMap<StringHash, PackageUpload>::Iterator current = i++;
             PackageUpload& upload = current->second_;
-            unsigned fragmentSize =
-                (unsigned)Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)PACKAGE_FRAGMENT_SIZE);
-            upload.file_->Read(buffer, fragmentSize);
+            unsigned chunkSize = (unsigned)Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)maxChunkSize);
+            upload.file_->Read(&packageBuffer_[0], chunkSize);
 
             msg_.Clear();
             msg_.WriteStringHash(current->first_);
-            msg_.WriteUInt(upload.fragment_++);
-            msg_.Write(buffer, fragmentSize);
+            msg_.WriteUInt(upload.fragment_);
+
+            // Send compressed only if it actually saves space
+            unsigned compressedSize = 0;
+            if (upload.compressed_)
+            {
+                packageCompressBuffer_.Resize(EstimateCompressBound(chunkSize));
+                compressedSize = CompressData(&packageCompressBuffer_[0], &packageBuffer_[0], chunkSize);
+            }
+            if (compressedSize && compressedSize < chunkSize)
+            {
+                msg_.WriteBool(true);
+                msg_.WriteVLE(chunkSize);
+                msg_.Write(&packageCompressBuffer_[0], compressedSize);
+            }
+            else
+            {
+                msg_.WriteBool(false);
+                msg_.Write(&packageBuffer_[0], chunkSize);
+            }
             SendMessage(MSG_PACKAGEDATA, true, false, msg_);
 
+            upload.fragment_ += (chunkSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+
             // Check if upload finished
-            if (upload.fragment_ == upload.totalFragments_)
+            if (upload.fragment_ >= upload.totalFragments_)
                 uploads_.Erase(current);
         }
     }
@@ -364,7 +569,7 @@ void Connection::ProcessPendingLatestData()
         {
             MemoryBuffer msg(current->second_);
             msg.ReadNetID(); // Skip the node ID
-            node->ReadLatestDataUpdate(msg);
+            ReadLatestDataUpdate(node, msg);
             // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
             // Furthermore it would propagate to components and child nodes, which is not desired in this case
             nodeLatestData_.Erase(current);
@@ -380,7 +585,7 @@ void Connection::ProcessPendingLatestData()
         {
             MemoryBuffer msg(current->second_);
             msg.ReadNetID(); // Skip the component ID
-            if (component->ReadLatestDataUpdate(msg))
+            if (ReadLatestDataUpdate(component, msg))
                 component->ApplyAttributes();
             componentLatestData_.Erase(current);
         }
@@ -391,6 +596,11 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
 {
     bool processed = true;
 
+    ++statistics_.messagesIn_;
+    statistics_.bytesIn_ += msg.GetSize();
+    if (network_->GetStatisticsEnabled())
+        network_->AddMessageStatistics(msgID, msg.GetSize(), false);
+
     switch (msgID)
     {
     case MSG_IDENTITY:
@@ -434,6 +644,10 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
         ProcessRemoteEvent(msgID, msg);
         break;
 
+    case MSG_REMOTEEVENTS:
+        ProcessRemoteEvents(msg);
+        break;
+
     case MSG_PACKAGEINFO:
         ProcessPackageInfo(msgID, msg);
         break;
@@ -466,7 +680,7 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Clear previous pending latest data and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
-    downloads_.Clear();
+    SuspendPackageDownloads();
 
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
     // to prevent resource conflicts
@@ -535,7 +749,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
 
             // Read initial attributes, then snap the motion smoothing immediately to the end
-            node->ReadDeltaUpdate(msg);
+            ReadDeltaUpdate(node, msg);
             SmoothedTransform* transform = node->GetComponent<SmoothedTransform>();
             if (transform)
                 transform->Update(1.0f, 0.0f);
@@ -575,7 +789,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 }
 
                 // Read initial attributes and apply
-                component->ReadDeltaUpdate(msg);
+                ReadDeltaUpdate(component, msg);
                 component->ApplyAttributes();
             }
         }
@@ -587,7 +801,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Node* node = scene_->GetNode(nodeID);
             if (node)
             {
-                node->ReadDeltaUpdate(msg);
+                ReadDeltaUpdate(node, msg);
                 // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
                 // Furthermore it would propagate to components and child nodes, which is not desired in this case
                 unsigned changedVars = msg.ReadVLE();
@@ -609,7 +823,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Node* node = scene_->GetNode(nodeID);
             if (node)
             {
-                node->ReadLatestDataUpdate(msg);
+                ReadLatestDataUpdate(node, msg);
                 // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
                 // Furthermore it would propagate to components and child nodes, which is not desired in this case
             }
@@ -659,7 +873,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 }
 
                 // Read initial attributes and apply
-                component->ReadDeltaUpdate(msg);
+                ReadDeltaUpdate(component, msg);
                 component->ApplyAttributes();
             }
             else
@@ -673,7 +887,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
-                component->ReadDeltaUpdate(msg);
+                ReadDeltaUpdate(component, msg);
                 component->ApplyAttributes();
             }
             else
@@ -687,7 +901,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
-                if (component->ReadLatestDataUpdate(msg))
+                if (ReadLatestDataUpdate(component, msg))
                     component->ApplyAttributes();
             }
             else
@@ -727,6 +941,9 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
         else
         {
             String name = msg.ReadString();
+            // Optionally the client can resume from a fragment index and request compressed transfer
+            unsigned startFragment = msg.IsEof() ? 0 : msg.ReadVLE();
+            bool compressed = msg.IsEof() ? false : msg.ReadBool();
 
             if (!scene_)
             {
@@ -760,11 +977,28 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                         return;
                     }
 
-                    LOGINFO("Transmitting package file " + name + " to client " + ToString());
+                    unsigned totalFragments = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    if (startFragment >= totalFragments)
+                    {
+                        LOGERROR("Client requested package file " + name + " from an invalid fragment index");
+                        SendPackageError(name);
+                        return;
+                    }
 
-                    uploads_[nameHash].file_ = file;
-                    uploads_[nameHash].fragment_ = 0;
-                    uploads_[nameHash].totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    if (startFragment)
+                    {
+                        LOGINFO("Resuming transmission of package file " + name + " to client " + ToString() + " from fragment " +
+                            String(startFragment));
+                        file->Seek(startFragment * PACKAGE_FRAGMENT_SIZE);
+                    }
+                    else
+                        LOGINFO("Transmitting package file " + name + " to client " + ToString());
+
+                    PackageUpload& upload = uploads_[nameHash];
+                    upload.file_ = file;
+                    upload.fragment_ = startFragment;
+                    upload.totalFragments_ = totalFragments;
+                    upload.compressed_ = compressed;
                     return;
                 }
             }
@@ -801,52 +1035,45 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 return;
             }
 
-            // If file has not yet been opened, try to open now. Prepend the checksum to the filename to allow multiple versions
+            // Data for a download which has not been requested (or was already finished) is disregarded
             if (!download.file_)
+                return;
+
+            PackageDataResult result = WritePackageData(download, msg);
+            if (result == PACKAGEDATA_ERROR)
+            {
+                // A corrupt chunk can not be recovered by waiting for more data
+                OnPackageDownloadFailed(download.name_);
+                return;
+            }
+            if (result == PACKAGEDATA_COMPLETE)
             {
-                download.file_ = new File(context_,
-                    GetSubsystem<Network>()->GetPackageCacheDir() + ToStringHex(download.checksum_) + "_" + download.name_,
-                    FILE_WRITE);
-                if (!download.file_->IsOpen())
+                LOGINFO("Package " + download.name_ + " downloaded successfully");
+
+                // Move the finished file to its final name. Prepend the checksum to the filename to allow multiple versions
+                FileSystem* fileSystem = GetSubsystem<FileSystem>();
+                const String& packageCacheDir = GetSubsystem<Network>()->GetPackageCacheDir();
+                String packageFileName = packageCacheDir + ToStringHex(download.checksum_) + "_" + download.name_;
+                download.file_->Close();
+                if (fileSystem->FileExists(GetPackageProgressFileName(download.file_->GetName())))
+                    fileSystem->Delete(GetPackageProgressFileName(download.file_->GetName()));
+                if (fileSystem->FileExists(packageFileName))
+                    fileSystem->Delete(packageFileName);
+                if (!fileSystem->Rename(download.file_->GetName(), packageFileName))
                 {
                     OnPackageDownloadFailed(download.name_);
                     return;
                 }
-            }
-
-            // Write the fragment data to the proper index
-            unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
-            unsigned index = msg.ReadUInt();
-            unsigned fragmentSize = msg.GetSize() - msg.GetPosition();
-
-            msg.Read(buffer, fragmentSize);
-            download.file_->Seek(index * PACKAGE_FRAGMENT_SIZE);
-            download.file_->Write(buffer, fragmentSize);
-            download.receivedFragments_.Insert(index);
-
-            // Check if all fragments received
-            if (download.receivedFragments_.Size() == download.totalFragments_)
-            {
-                LOGINFO("Package " + download.name_ + " downloaded successfully");
 
                 // Instantiate the package and add to the resource system, as we will need it to load the scene
-                download.file_->Close();
-                GetSubsystem<ResourceCache>()->AddPackageFile(download.file_->GetName(), 0);
+                GetSubsystem<ResourceCache>()->AddPackageFile(packageFileName, 0);
 
-                // Then start the next download if there are more
+                // Then start the next downloads if there are more
                 downloads_.Erase(i);
                 if (downloads_.Empty())
                     OnPackagesReady();
                 else
-                {
-                    PackageDownload& nextDownload = downloads_.Begin()->second_;
-
-                    LOGINFO("Requesting package " + nextDownload.name_ + " from server");
-                    msg_.Clear();
-                    msg_.WriteString(nextDownload.name_);
-                    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-                    nextDownload.initiated_ = true;
-                }
+                    StartPackageDownloads();
             }
         }
         break;
@@ -938,49 +1165,80 @@ void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
 
 void Connection::ProcessRemoteEvent(int msgID, MemoryBuffer& msg)
 {
-    using namespace RemoteEventData;
+    unsigned senderID = msgID == MSG_REMOTENODEEVENT ? msg.ReadNetID() : 0;
+    StringHash eventType = msg.ReadStringHash();
+    if (!network_->CheckRemoteEvent(eventType))
+    {
+        LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
+        return;
+    }
 
-    if (msgID == MSG_REMOTEEVENT)
+    VariantMap eventData = msg.ReadVariantMap();
+    DispatchRemoteEvent(senderID, eventType, eventData);
+}
+
+void Connection::ProcessRemoteEvents(MemoryBuffer& msg)
+{
+    unsigned numEvents = msg.ReadVLE();
+    for (unsigned i = 0; i < numEvents && !msg.IsEof(); ++i)
     {
+        unsigned senderID = msg.ReadVLE();
         StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
-        {
-            LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
-        }
+        bool compact = msg.ReadBool();
 
-        VariantMap eventData = msg.ReadVariantMap();
-        eventData[P_CONNECTION] = this;
-        SendEvent(eventType, eventData);
-    }
-    else
-    {
-        if (!scene_)
+        // The event data must be read even if the event is not allowed, to stay in sync with the rest of the batch
+        VariantMap eventData;
+        if (compact)
         {
-            LOGERROR("Can not receive remote node event without an assigned scene");
-            return;
+            const RemoteEventSchema* schema = network_->GetRemoteEventSchema(eventType);
+            if (!schema)
+            {
+                LOGERROR("No schema registered for remote event " + eventType.ToString() + ", discarding rest of remote events");
+                return;
+            }
+            for (unsigned j = 0; j < schema->paramNames_.Size(); ++j)
+                eventData[schema->paramNames_[j]] = msg.ReadVariant(schema->paramTypes_[j]);
         }
+        else
+            eventData = msg.ReadVariantMap();
 
-        unsigned nodeID = msg.ReadNetID();
-        StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
+        if (!network_->CheckRemoteEvent(eventType))
         {
             LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
+            continue;
         }
 
-        VariantMap eventData = msg.ReadVariantMap();
-        Node* sender = scene_->GetNode(nodeID);
-        if (!sender)
-        {
-            LOGWARNING("Missing sender for remote node event, discarding");
-            return;
-        }
-        eventData[P_CONNECTION] = this;
-        sender->SendEvent(eventType, eventData);
+        DispatchRemoteEvent(senderID, eventType, eventData);
     }
 }
 
+void Connection::DispatchRemoteEvent(unsigned senderID, StringHash eventType, VariantMap& eventData)
+{
+    using namespace RemoteEventData;
+
+    eventData[P_CONNECTION] = this;
+
+    if (!senderID)
+    {
+        SendEvent(eventType, eventData);
+        return;
+    }
+
+    if (!scene_)
+    {
+        LOGERROR("Can not receive remote node event without an assigned scene");
+        return;
+    }
+
+    Node* sender = scene_->GetNode(senderID);
+    if (!sender)
+    {
+        LOGWARNING("Missing sender for remote node event, discarding");
+        return;
+    }
+    sender->SendEvent(eventType, eventData);
+}
+
 kNet::MessageConnection* Connection::GetMessageConnection() const
 {
     return const_cast<kNet::MessageConnection*>(connection_.ptr());
@@ -991,6 +1249,83 @@ Scene* Connection::GetScene() const
     return scene_;
 }
 
+void Connection::ReconcilePrediction()
+{
+    if (!predictionPending_)
+        return;
+
+    PROFILE(ReconcilePrediction);
+
+    predictionPending_ = false;
+
+    // Drop the controls the server had already received when sending the update
+    unsigned numAcknowledged = 0;
+    while (numAcknowledged < controlsHistory_.Size() &&
+        (unsigned char)(serverTimeStamp_ - controlsHistory_[numAcknowledged].timeStamp_) < 128)
+        ++numAcknowledged;
+    if (numAcknowledged)
+        controlsHistory_.Erase(0, numAcknowledged);
+
+    // The nodes now hold the server state: store it as the new confirmed state, then replay the rest of the controls
+    PODVector<Node*> replayNodes;
+    for (HashMap<unsigned, PredictedNode>::Iterator i = predictedNodes_.Begin(); i != predictedNodes_.End();)
+    {
+        HashMap<unsigned, PredictedNode>::Iterator current = i++;
+        PredictedNode& predicted = current->second_;
+        if (!predicted.node_)
+        {
+            predictedNodes_.Erase(current);
+            continue;
+        }
+        if (predicted.updated_)
+        {
+            SavePredictedState(predicted);
+            predicted.updated_ = false;
+            replayNodes.Push(predicted.node_);
+        }
+    }
+
+    if (replayNodes.Empty() || controlsHistory_.Empty())
+        return;
+
+    using namespace PredictionReplay;
+
+    Controls currentControls = controls_;
+    PODVector<LogicComponent*> components;
+    replaying_ = true;
+
+    for (Vector<SentControls>::ConstIterator i = controlsHistory_.Begin(); i != controlsHistory_.End(); ++i)
+    {
+        controls_ = i->controls_;
+
+        for (unsigned j = 0; j < replayNodes.Size(); ++j)
+        {
+            Node* node = replayNodes[j];
+            node->GetDerivedComponents<LogicComponent>(components);
+            for (unsigned k = 0; k < components.Size(); ++k)
+            {
+                LogicComponent* component = components[k];
+                if (component->IsEnabledEffective() && (component->GetUpdateEventMask() & USE_FIXEDUPDATE))
+                    component->FixedUpdate(i->timeStep_);
+            }
+
+            VariantMap& eventData = GetEventDataMap();
+            eventData[P_CONNECTION] = this;
+            eventData[P_NODE] = node;
+            eventData[P_TIMESTEP] = i->timeStep_;
+            node->SendEvent(E_PREDICTIONREPLAY, eventData);
+        }
+    }
+
+    replaying_ = false;
+    controls_ = currentControls;
+}
+
+bool Connection::IsPredicted(Node* node) const
+{
+    return node && predictedNodes_.Contains(node->GetID());
+}
+
 bool Connection::IsConnected() const
 {
     return connection_->GetConnectionState() == kNet::ConnectionOK;
@@ -1018,12 +1353,15 @@ const String& Connection::GetDownloadName() const
 
 float Connection::GetDownloadProgress() const
 {
+    // Weight the downloads by size, so that concurrent downloads combine to one progress value
+    unsigned numReceivedFragments = 0;
+    unsigned totalFragments = 0;
     for (HashMap<StringHash, PackageDownload>::ConstIterator i = downloads_.Begin(); i != downloads_.End(); ++i)
     {
-        if (i->second_.initiated_)
-            return (float)i->second_.receivedFragments_.Size() / (float)i->second_.totalFragments_;
+        numReceivedFragments += i->second_.numReceivedFragments_;
+        totalFragments += i->second_.totalFragments_;
     }
-    return 1.0f;
+    return totalFragments ? (float)numReceivedFragments / (float)totalFragments : 1.0f;
 }
 
 void Connection::SendPackageToClient(PackageFile* package)
@@ -1132,7 +1470,7 @@ void Connection::ProcessNewNode(Node* node)
     node->AddReplicationState(&nodeState);
 
     // Write node's attributes
-    node->WriteInitialDeltaUpdate(msg_, timeStamp_);
+    WriteInitialDeltaUpdate(node);
 
     // Write node's user variables
     const VariantMap& vars = node->GetVars();
@@ -1161,7 +1499,7 @@ void Connection::ProcessNewNode(Node* node)
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
-        component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        WriteInitialDeltaUpdate(component);
     }
 
     SendMessage(MSG_CREATENODE, true, true, msg_);
@@ -1212,7 +1550,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
+            WriteLatestDataUpdate(node);
 
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
         }
@@ -1222,7 +1560,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_);
+            WriteDeltaUpdate(node, nodeState.dirtyAttributes_);
 
             // Write changed variables
             msg_.WriteVLE(nodeState.dirtyVars_.Size());
@@ -1290,7 +1628,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
+                    WriteLatestDataUpdate(component);
 
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
                 }
@@ -1300,7 +1638,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
+                    WriteDeltaUpdate(component, componentState.dirtyAttributes_);
 
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
 
@@ -1335,7 +1673,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 msg_.WriteNetID(node->GetID());
                 msg_.WriteStringHash(component->GetType());
                 msg_.WriteNetID(component->GetID());
-                component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+                WriteInitialDeltaUpdate(component);
 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
@@ -1428,17 +1766,170 @@ void Connection::RequestPackage(const String& name, unsigned fileSize, unsigned
     download.totalFragments_ = (fileSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
     download.checksum_ = checksum;
 
-    // Start download now only if no existing downloads, else wait for the existing ones to finish
-    if (downloads_.Size() == 1)
+    // Start download now only if the concurrent download limit allows, else wait for the existing ones to finish
+    StartPackageDownloads();
+}
+
+void Connection::StartPackageDownloads()
+{
+    unsigned maxDownloads = GetSubsystem<Network>()->GetMaxPackageDownloads();
+    unsigned numInitiated = 0;
+    for (HashMap<StringHash, PackageDownload>::ConstIterator i = downloads_.Begin(); i != downloads_.End(); ++i)
     {
-        LOGINFO("Requesting package " + name + " from server");
-        msg_.Clear();
-        msg_.WriteString(name);
-        SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-        download.initiated_ = true;
+        if (i->second_.initiated_)
+            ++numInitiated;
+    }
+
+    for (HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Begin(); i != downloads_.End() && numInitiated <
+        maxDownloads; ++i)
+    {
+        if (i->second_.initiated_)
+            continue;
+
+        if (!StartPackageDownload(i->second_))
+        {
+            OnPackageDownloadFailed(i->second_.name_);
+            return;
+        }
+        ++numInitiated;
     }
 }
 
+bool Connection::StartPackageDownload(PackageDownload& download)
+{
+    Network* network = GetSubsystem<Network>();
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    const String& packageCacheDir = network->GetPackageCacheDir();
+    String partialFileName = GetPartialPackageFileName(packageCacheDir, download.name_, download.checksum_);
+    String progressFileName = GetPackageProgressFileName(partialFileName);
+
+    download.receivedFragments_.Resize(download.totalFragments_);
+    if (download.totalFragments_)
+        memset(&download.receivedFragments_[0], 0, download.totalFragments_);
+    download.numReceivedFragments_ = 0;
+    download.contiguousFragments_ = 0;
+
+    // Check for an interrupted earlier download of the same package version
+    unsigned startFragment = 0;
+    if (fileSystem->FileExists(partialFileName) && fileSystem->FileExists(progressFileName))
+    {
+        File progressFile(context_, progressFileName);
+        startFragment = (unsigned)Min((int)progressFile.ReadUInt(), Max((int)download.totalFragments_ - 1, 0));
+    }
+
+    download.file_ = new File(context_, partialFileName, startFragment ? FILE_READWRITE : FILE_WRITE);
+    if (!download.file_->IsOpen())
+    {
+        download.file_.Reset();
+        return false;
+    }
+
+    for (unsigned i = 0; i < startFragment; ++i)
+        download.receivedFragments_[i] = 1;
+    download.numReceivedFragments_ = startFragment;
+    download.contiguousFragments_ = startFragment;
+
+    if (startFragment)
+        LOGINFO("Resuming download of package " + download.name_ + " from fragment " + String(startFragment));
+    else
+        LOGINFO("Requesting package " + download.name_ + " from server");
+
+    msg_.Clear();
+    msg_.WriteString(download.name_);
+    msg_.WriteVLE(startFragment);
+    msg_.WriteBool(network->GetPackageCompression());
+    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
+    download.initiated_ = true;
+    return true;
+}
+
+PackageDataResult Connection::WritePackageData(PackageDownload& download, MemoryBuffer& msg)
+{
+    unsigned index = msg.ReadUInt();
+    bool compressed = msg.ReadBool();
+    unsigned maxChunkSize = PACKAGE_MAX_CHUNK_FRAGMENTS * PACKAGE_FRAGMENT_SIZE;
+    unsigned chunkSize;
+
+    if (compressed)
+    {
+        chunkSize = msg.ReadVLE();
+        if (chunkSize > maxChunkSize)
+        {
+            LOGERROR("Invalid package data chunk size");
+            return PACKAGEDATA_ERROR;
+        }
+        packageBuffer_.Resize(chunkSize);
+        // Decompress with bounds checking, as the data comes from the network
+        int compressedSize = (int)(msg.GetSize() - msg.GetPosition());
+        if (chunkSize && LZ4_decompress_safe((const char*)msg.GetData() + msg.GetPosition(), (char*)&packageBuffer_[0],
+            compressedSize, (int)chunkSize) != (int)chunkSize)
+        {
+            LOGERROR("Could not decompress package data chunk");
+            return PACKAGEDATA_ERROR;
+        }
+    }
+    else
+    {
+        chunkSize = (unsigned)Min((int)(msg.GetSize() - msg.GetPosition()), (int)maxChunkSize);
+        packageBuffer_.Resize(chunkSize);
+        if (chunkSize)
+            msg.Read(&packageBuffer_[0], chunkSize);
+    }
+
+    unsigned numFragments = (chunkSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+    if (!numFragments || index + numFragments > download.totalFragments_)
+    {
+        LOGERROR("Invalid package data fragment index");
+        return PACKAGEDATA_ERROR;
+    }
+
+    // Write the chunk data to the proper index
+    download.file_->Seek(index * PACKAGE_FRAGMENT_SIZE);
+    download.file_->Write(&packageBuffer_[0], chunkSize);
+    for (unsigned i = index; i < index + numFragments; ++i)
+    {
+        if (!download.receivedFragments_[i])
+        {
+            download.receivedFragments_[i] = 1;
+            ++download.numReceivedFragments_;
+        }
+    }
+    while (download.contiguousFragments_ < download.totalFragments_ &&
+        download.receivedFragments_[download.contiguousFragments_])
+        ++download.contiguousFragments_;
+
+    // Check if all fragments received
+    return download.numReceivedFragments_ == download.totalFragments_ ? PACKAGEDATA_COMPLETE : PACKAGEDATA_INCOMPLETE;
+}
+
+void Connection::SuspendPackageDownloads()
+{
+    for (HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Begin(); i != downloads_.End(); ++i)
+    {
+        PackageDownload& download = i->second_;
+        if (!download.file_)
+            continue;
+
+        download.file_->Close();
+        // Nothing to resume from, so do not leave an empty or partly written file in the cache
+        if (!download.contiguousFragments_)
+        {
+            FileSystem* fileSystem = GetSubsystem<FileSystem>();
+            String progressFileName = GetPackageProgressFileName(download.file_->GetName());
+            if (fileSystem->FileExists(progressFileName))
+                fileSystem->Delete(progressFileName);
+            fileSystem->Delete(download.file_->GetName());
+            continue;
+        }
+
+        File progressFile(context_, GetPackageProgressFileName(download.file_->GetName()), FILE_WRITE);
+        if (progressFile.IsOpen())
+            progressFile.WriteUInt(download.contiguousFragments_);
+    }
+
+    downloads_.Clear();
+}
+
 void Connection::SendPackageError(const String& name)
 {
     msg_.Clear();
@@ -1460,8 +1951,8 @@ void Connection::OnSceneLoadFailed()
 void Connection::OnPackageDownloadFailed(const String& name)
 {
     LOGERROR("Download of package " + name + " failed");
-    // As one package failed, we can not join the scene in any case. Clear the downloads
-    downloads_.Clear();
+    // As one package failed, we can not join the scene in any case. Clear the downloads, but keep what has been received so far
+    SuspendPackageDownloads();
     OnSceneLoadFailed();
 }
 
@@ -1516,4 +2007,120 @@ void Connection::ProcessPackageInfo(int msgID, MemoryBuffer& msg)
     RequestNeededPackages(1, msg);
 }
 
+void Connection::WriteInitialDeltaUpdate(Serializable* object)
+{
+    NetworkSerializationScope scope(network_, statistics_, serializationTimer_, object, msg_, true);
+    object->WriteInitialDeltaUpdate(msg_, timeStamp_);
+}
+
+void Connection::WriteDeltaUpdate(Serializable* object, const DirtyBits& attributeBits)
+{
+    NetworkSerializationScope scope(network_, statistics_, serializationTimer_, object, msg_, true);
+    object->WriteDeltaUpdate(msg_, attributeBits, timeStamp_);
+}
+
+void Connection::WriteLatestDataUpdate(Serializable* object)
+{
+    NetworkSerializationScope scope(network_, statistics_, serializationTimer_, object, msg_, true);
+    object->WriteLatestDataUpdate(msg_, timeStamp_);
+}
+
+bool Connection::ReadDeltaUpdate(Serializable* object, MemoryBuffer& msg)
+{
+    PrepareUpdate(object, msg);
+    NetworkSerializationScope scope(network_, statistics_, serializationTimer_, object, msg, false);
+    return object->ReadDeltaUpdate(msg);
+}
+
+bool Connection::ReadLatestDataUpdate(Serializable* object, MemoryBuffer& msg)
+{
+    PrepareUpdate(object, msg);
+    NetworkSerializationScope scope(network_, statistics_, serializationTimer_, object, msg, false);
+    return object->ReadLatestDataUpdate(msg);
+}
+
+void Connection::PrepareUpdate(Serializable* object, MemoryBuffer& msg)
+{
+    // The update begins with the timestamp of the latest controls the server had received
+    if (msg.GetPosition() < msg.GetSize())
+        serverTimeStamp_ = msg.GetData()[msg.GetPosition()];
+
+    if (predictedNodes_.Empty())
+        return;
+
+    Node* node = dynamic_cast<Node*>(object);
+    if (!node)
+    {
+        Component* component = dynamic_cast<Component*>(object);
+        node = component ? component->GetNode() : 0;
+    }
+    if (!node)
+        return;
+
+    HashMap<unsigned, PredictedNode>::Iterator i = predictedNodes_.Find(node->GetID());
+    if (i == predictedNodes_.End() || !i->second_.node_)
+        return;
+
+    // Server updates are deltas against the previous server state, so return to it before applying the first one
+    if (!i->second_.updated_)
+    {
+        RestorePredictedState(i->second_);
+        i->second_.updated_ = true;
+    }
+    predictionPending_ = true;
+}
+
+void Connection::SavePredictedState(PredictedNode& predicted)
+{
+    Node* node = predicted.node_;
+    VectorBuffer& dest = predicted.confirmedState_;
+    dest.Clear();
+    WriteNetworkAttributes(node, dest);
+
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    unsigned numReplicated = 0;
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        if (components[i]->GetID() < FIRST_LOCAL_ID)
+            ++numReplicated;
+    }
+
+    dest.WriteVLE(numReplicated);
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->GetID() >= FIRST_LOCAL_ID)
+            continue;
+
+        // Write each component with its size so that it can be skipped if it has been removed when restoring
+        predictedComponentState_.Clear();
+        WriteNetworkAttributes(component, predictedComponentState_);
+        dest.WriteNetID(component->GetID());
+        dest.WriteVLE(predictedComponentState_.GetSize());
+        dest.Write(predictedComponentState_.GetData(), predictedComponentState_.GetSize());
+    }
+}
+
+void Connection::RestorePredictedState(PredictedNode& predicted)
+{
+    Node* node = predicted.node_;
+    if (!scene_ || !predicted.confirmedState_.GetSize())
+        return;
+
+    MemoryBuffer source(predicted.confirmedState_.GetData(), predicted.confirmedState_.GetSize());
+    ReadNetworkAttributes(node, source);
+
+    unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents && !source.IsEof(); ++i)
+    {
+        unsigned componentID = source.ReadNetID();
+        unsigned size = source.ReadVLE();
+        unsigned end = source.GetPosition() + size;
+        Component* component = scene_->GetComponent(componentID);
+        if (component && component->GetNode() == node)
+            ReadNetworkAttributes(component, source);
+        source.Seek(end);
+    }
+}
+
 }
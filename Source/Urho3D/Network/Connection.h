@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/ArrayPtr.h"
 #include "../Container/HashSet.h"
 #include "../Core/Object.h"
 #include "../Core/Timer.h"
@@ -41,6 +42,7 @@ namespace Urho3D
 
 class File;
 class MemoryBuffer;
+class Network;
 class Node;
 class Scene;
 class Serializable;
@@ -53,26 +55,92 @@ struct RemoteEvent
     unsigned senderID_;
     /// Event type.
     StringHash eventType_;
-    /// Event data.
-    VariantMap eventData_;
+    /// Serialized event data. Shared between all connections the event is broadcast to.
+    SharedArrayPtr<unsigned char> data_;
+    /// Serialized event data size in bytes.
+    unsigned dataSize_;
+    /// Event data is serialized in the compact form defined by a remote event schema.
+    bool compact_;
     /// In order flag.
     bool inOrder_;
 };
 
+/// Controls sent by the client, kept for replaying client-side predicted nodes.
+struct SentControls
+{
+    /// Controls.
+    Controls controls_;
+    /// Timestamp the controls were sent with.
+    unsigned char timeStamp_;
+    /// Time in seconds the controls were in effect.
+    float timeStep_;
+};
+
+/// Client-side predicted node.
+struct PredictedNode
+{
+    /// Node.
+    WeakPtr<Node> node_;
+    /// Network attributes of the node and its replicated components as last confirmed by the server.
+    VectorBuffer confirmedState_;
+    /// Server update received during this frame flag.
+    bool updated_;
+};
+
+/// %Network traffic statistics counters.
+struct URHO3D_API NetworkStatistics
+{
+    /// Construct with zero counters.
+    NetworkStatistics() :
+        messagesIn_(0),
+        messagesOut_(0),
+        bytesIn_(0),
+        bytesOut_(0),
+        serializationTime_(0)
+    {
+    }
+
+    /// Reset counters.
+    void Reset() { *this = NetworkStatistics(); }
+
+    /// Received messages or updates.
+    unsigned messagesIn_;
+    /// Sent messages or updates.
+    unsigned messagesOut_;
+    /// Received bytes.
+    unsigned bytesIn_;
+    /// Sent bytes.
+    unsigned bytesOut_;
+    /// Time spent serializing and deserializing in microseconds. Only measured when network statistics are enabled.
+    unsigned serializationTime_;
+};
+
+/// Result of writing a received package data chunk.
+enum PackageDataResult
+{
+    PACKAGEDATA_INCOMPLETE = 0,
+    PACKAGEDATA_COMPLETE,
+    PACKAGEDATA_ERROR
+};
+
 /// Package file receive transfer.
 struct PackageDownload
 {
     /// Construct with defaults.
     PackageDownload();
 
-    /// Destination file.
+    /// Destination file. Data is written to a partial file in the package cache directory until the download finishes.
     SharedPtr<File> file_;
-    /// Already received fragments.
-    HashSet<unsigned> receivedFragments_;
+    /// Received flag for each fragment.
+    PODVector<unsigned char> receivedFragments_;
     /// Package name.
     String name_;
     /// Total number of fragments.
     unsigned totalFragments_;
+    /// Number of received fragments.
+    unsigned numReceivedFragments_;
+    /// Number of fragments received contiguously from the beginning of the file. Used to resume an interrupted download.
+    unsigned contiguousFragments_;
     /// Checksum.
     unsigned checksum_;
     /// Download initiated flag.
@@ -91,6 +159,8 @@ struct PackageUpload
     unsigned fragment_;
     /// Total number of fragments
     unsigned totalFragments_;
+    /// Compress the transferred data flag.
+    bool compressed_;
 };
 
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
@@ -120,6 +190,8 @@ public:
     void SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Send a remote event with the specified node as sender.
     void SendRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
+    /// Queue an already serialized remote event. Called by Network when broadcasting, so that the event data is serialized only once.
+    void QueueRemoteEvent(const RemoteEvent& remoteEvent);
     /// Assign scene. On the server, this will cause the client to load it.
     void SetScene(Scene* newScene);
     /// Assign identity. Called by Network.
@@ -134,6 +206,14 @@ public:
     void SetConnectPending(bool connectPending);
     /// Set whether to log data in/out statistics.
     void SetLogStatistics(bool enable);
+    /// Reset the traffic statistics counters.
+    void ResetStatistics();
+    /// Set a node to be predicted on the client. When server updates for it arrive, the controls the server has not yet received are replayed through its LogicComponents' FixedUpdate().
+    void AddPredictedNode(Node* node);
+    /// Stop predicting a node.
+    void RemovePredictedNode(Node* node);
+    /// Stop predicting all nodes.
+    void RemoveAllPredictedNodes();
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
@@ -146,6 +226,8 @@ public:
     void SendPackages();
     /// Process pending latest data for nodes and components.
     void ProcessPendingLatestData();
+    /// Reconcile predicted nodes that received server updates by replaying unacknowledged controls. Called by Network.
+    void ReconcilePrediction();
     /// Process a message from the server or client. Called by Network.
     bool ProcessMessage(int msgID, MemoryBuffer& msg);
 
@@ -164,6 +246,18 @@ public:
     /// Return the controls timestamp, sent from client to server along each control update.
     unsigned char GetTimeStamp() const { return timeStamp_; }
 
+    /// Return the timestamp of the latest controls the server had received, as echoed back in scene updates.
+    unsigned char GetServerTimeStamp() const { return serverTimeStamp_; }
+
+    /// Return sent controls not yet acknowledged by the server. Only recorded while there are predicted nodes.
+    const Vector<SentControls>& GetControlsHistory() const { return controlsHistory_; }
+
+    /// Return whether a node is predicted.
+    bool IsPredicted(Node* node) const;
+
+    /// Return whether unacknowledged controls are being replayed. Can be used to skip side effects such as sounds during the replay.
+    bool IsReplaying() const { return replaying_; }
+
     /// Return the observer position sent by the client for interest management.
     const Vector3& GetPosition() const { return position_; }
 
@@ -185,6 +279,9 @@ public:
     /// Return whether to log data in/out statistics.
     bool GetLogStatistics() const { return logStatistics_; }
 
+    /// Return traffic statistics counters of this connection.
+    const NetworkStatistics& GetStatistics() const { return statistics_; }
+
     /// Return remote address.
     String GetAddress() const { return address_; }
 
@@ -197,8 +294,10 @@ public:
     unsigned GetNumDownloads() const;
     /// Return name of current package download, or empty if no downloads.
     const String& GetDownloadName() const;
-    /// Return progress of current package download, or 1.0 if no downloads.
+    /// Return combined progress of the remaining package downloads weighted by size, or 1.0 if no downloads.
     float GetDownloadProgress() const;
+    /// Return current package data message size in fragments on the server. Adapted each update according to how fast the outbound queue drains.
+    unsigned GetPackageChunkFragments() const { return packageChunkFragments_; }
     /// Trigger client connection to download a package file from the server. Can be used to download additional resource packages when client is already joined in a scene. The package must have been added as a requirement to the scene the client is joined in, or else the eventual download will fail.
     void SendPackageToClient(PackageFile* package);
 
@@ -231,6 +330,10 @@ private:
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Process a batch of remote events.
+    void ProcessRemoteEvents(MemoryBuffer& msg);
+    /// Send a received remote event, either globally or from the sender node if sender ID is nonzero.
+    void DispatchRemoteEvent(unsigned senderID, StringHash eventType, VariantMap& eventData);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
@@ -241,10 +344,34 @@ private:
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
     bool RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg);
-    /// Initiate a package download.
+    /// Queue a package download.
     void RequestPackage(const String& name, unsigned fileSize, unsigned checksum);
+    /// Initiate queued package downloads up to the allowed number of concurrent downloads.
+    void StartPackageDownloads();
+    /// Open the partial file for a package download, resuming from an earlier interrupted download if possible, and request the data from the server. Return true on success.
+    bool StartPackageDownload(PackageDownload& download);
+    /// Write a package data chunk received from the server. Return whether the download is complete, or an error if the chunk is invalid.
+    PackageDataResult WritePackageData(PackageDownload& download, MemoryBuffer& msg);
+    /// Store the progress of unfinished package downloads so that they can be resumed later, then clear them.
+    void SuspendPackageDownloads();
     /// Send an error reply for a package download.
     void SendPackageError(const String& name);
+    /// Write initial attributes of a node or component to the message buffer.
+    void WriteInitialDeltaUpdate(Serializable* object);
+    /// Write changed attributes of a node or component to the message buffer.
+    void WriteDeltaUpdate(Serializable* object, const DirtyBits& attributeBits);
+    /// Write latest data attributes of a node or component to the message buffer.
+    void WriteLatestDataUpdate(Serializable* object);
+    /// Read a delta update for a node or component. Return true if attributes changed.
+    bool ReadDeltaUpdate(Serializable* object, MemoryBuffer& msg);
+    /// Read a latest data update for a node or component. Return true if attributes changed.
+    bool ReadLatestDataUpdate(Serializable* object, MemoryBuffer& msg);
+    /// Store the server timestamp of an update about to be read, and restore the confirmed state if the object belongs to a predicted node.
+    void PrepareUpdate(Serializable* object, MemoryBuffer& msg);
+    /// Store the network attributes of a predicted node and its replicated components as the confirmed state.
+    void SavePredictedState(PredictedNode& predicted);
+    /// Restore the confirmed state of a predicted node.
+    void RestorePredictedState(PredictedNode& predicted);
     /// Handle scene load failure on the server or client.
     void OnSceneLoadFailed();
     /// Handle a package download failure on the client.
@@ -252,6 +379,8 @@ private:
     /// Handle all packages loaded successfully. Also called directly on MSG_LOADSCENE if there are none.
     void OnPackagesReady();
 
+    /// %Network subsystem. Owns the connection, so it is always valid.
+    Network* network_;
     /// kNet message connection.
     kNet::SharedPtr<kNet::MessageConnection> connection_;
     /// Scene.
@@ -270,12 +399,26 @@ private:
     HashSet<unsigned> nodesToProcess_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Reusable buffer for package data.
+    PODVector<unsigned char> packageBuffer_;
+    /// Reusable buffer for compressed package data.
+    PODVector<unsigned char> packageCompressBuffer_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
+    /// Sent controls not yet acknowledged by the server.
+    Vector<SentControls> controlsHistory_;
+    /// Client-side predicted nodes by ID.
+    HashMap<unsigned, PredictedNode> predictedNodes_;
+    /// Reusable buffer for predicted component state.
+    VectorBuffer predictedComponentState_;
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
     /// Statistics timer.
     Timer statsTimer_;
+    /// Timer for measuring serialization time when network statistics are enabled.
+    HiresTimer serializationTimer_;
+    /// Traffic statistics counters.
+    NetworkStatistics statistics_;
     /// Remote endpoint address.
     String address_;
     /// Remote endpoint port.
@@ -286,6 +429,14 @@ private:
     Quaternion rotation_;
     /// Send mode for the observer position & rotation.
     ObserverPositionSendMode sendMode_;
+    /// Package data message size in fragments.
+    unsigned packageChunkFragments_;
+    /// Latest controls timestamp echoed back by the server.
+    unsigned char serverTimeStamp_;
+    /// Predicted nodes have received server updates flag.
+    bool predictionPending_;
+    /// Replaying unacknowledged controls flag.
+    bool replaying_;
     /// Client connection flag.
     bool isClient_;
     /// Connection pending flag.
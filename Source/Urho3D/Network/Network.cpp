@@ -25,7 +25,9 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
 #include "../Engine/EngineEvents.h"
+#include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
 #include "../IO/IOEvents.h"
@@ -46,6 +48,25 @@ namespace Urho3D
 {
 
 static const int DEFAULT_UPDATE_FPS = 30;
+static const unsigned DEFAULT_MAX_PACKAGE_DOWNLOADS = 4;
+static const int DEFAULT_STATISTICS_INTERVAL = 2000;
+static const unsigned STATISTICS_LINE_MAX_LENGTH = 256;
+
+/// Return the default value of a remote event schema parameter type.
+static Variant GetDefaultRemoteEventParameter(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_VARIANTVECTOR:
+        return Variant(VariantVector());
+
+    case VAR_VARIANTMAP:
+        return Variant(VariantMap());
+
+    default:
+        return Variant(type, String::EMPTY);
+    }
+}
 
 Network::Network(Context* context) :
     Object(context),
@@ -53,7 +74,11 @@ Network::Network(Context* context) :
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
-    updateAcc_(0.0f)
+    updateAcc_(0.0f),
+    maxPackageDownloads_(DEFAULT_MAX_PACKAGE_DOWNLOADS),
+    packageCompression_(false),
+    statisticsInterval_(DEFAULT_STATISTICS_INTERVAL),
+    statisticsEnabled_(false)
 {
     network_ = new kNet::Network();
 
@@ -298,18 +323,33 @@ void Network::BroadcastMessage(int msgID, bool reliable, bool inOrder, const uns
 
 void Network::BroadcastRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
+    if (clientConnections_.Empty())
+        return;
+
+    // Serialize the event data only once for all connections
+    RemoteEvent remoteEvent = PrepareRemoteEvent(0, eventType, inOrder, eventData);
     for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
          i != clientConnections_.End(); ++i)
-        i->second_->SendRemoteEvent(eventType, inOrder, eventData);
+        i->second_->QueueRemoteEvent(remoteEvent);
 }
 
 void Network::BroadcastRemoteEvent(Scene* scene, StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
+    RemoteEvent remoteEvent;
+    bool prepared = false;
+
     for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
          i != clientConnections_.End(); ++i)
     {
         if (i->second_->GetScene() == scene)
-            i->second_->SendRemoteEvent(eventType, inOrder, eventData);
+        {
+            if (!prepared)
+            {
+                remoteEvent = PrepareRemoteEvent(0, eventType, inOrder, eventData);
+                prepared = true;
+            }
+            i->second_->QueueRemoteEvent(remoteEvent);
+        }
     }
 }
 
@@ -327,11 +367,21 @@ void Network::BroadcastRemoteEvent(Node* node, StringHash eventType, bool inOrde
     }
 
     Scene* scene = node->GetScene();
+    RemoteEvent remoteEvent;
+    bool prepared = false;
+
     for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
          i != clientConnections_.End(); ++i)
     {
         if (i->second_->GetScene() == scene)
-            i->second_->SendRemoteEvent(node, eventType, inOrder, eventData);
+        {
+            if (!prepared)
+            {
+                remoteEvent = PrepareRemoteEvent(node->GetID(), eventType, inOrder, eventData);
+                prepared = true;
+            }
+            i->second_->QueueRemoteEvent(remoteEvent);
+        }
     }
 }
 
@@ -375,11 +425,156 @@ void Network::UnregisterAllRemoteEvents()
     allowedRemoteEvents_.Clear();
 }
 
+bool Network::RegisterRemoteEventSchema(StringHash eventType, const Vector<StringHash>& paramNames,
+    const PODVector<VariantType>& paramTypes)
+{
+    if (paramNames.Size() != paramTypes.Size())
+    {
+        LOGERROR("Remote event schema parameter name and type counts do not match");
+        return false;
+    }
+    for (unsigned i = 0; i < paramTypes.Size(); ++i)
+    {
+        if (paramTypes[i] == VAR_NONE || paramTypes[i] == VAR_VOIDPTR || paramTypes[i] == VAR_PTR ||
+            paramTypes[i] >= MAX_VAR_TYPES)
+        {
+            LOGERROR("Unsupported parameter type in remote event schema");
+            return false;
+        }
+    }
+
+    RemoteEventSchema& schema = remoteEventSchemas_[eventType];
+    schema.paramNames_ = paramNames;
+    schema.paramTypes_ = paramTypes;
+    return true;
+}
+
+void Network::UnregisterRemoteEventSchema(StringHash eventType)
+{
+    remoteEventSchemas_.Erase(eventType);
+}
+
+RemoteEvent Network::PrepareRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData)
+{
+    RemoteEvent remoteEvent;
+    remoteEvent.senderID_ = senderID;
+    remoteEvent.eventType_ = eventType;
+    remoteEvent.inOrder_ = inOrder;
+
+    remoteEventBuffer_.Clear();
+    HashMap<StringHash, RemoteEventSchema>::ConstIterator i = remoteEventSchemas_.Find(eventType);
+    if (i != remoteEventSchemas_.End())
+    {
+        const RemoteEventSchema& schema = i->second_;
+        for (unsigned j = 0; j < schema.paramNames_.Size(); ++j)
+        {
+            VariantMap::ConstIterator k = eventData.Find(schema.paramNames_[j]);
+            if (k != eventData.End() && k->second_.GetType() == schema.paramTypes_[j])
+                remoteEventBuffer_.WriteVariantData(k->second_);
+            else
+            {
+                // Missing or mismatching parameters are sent as default values to keep the data readable
+                if (k != eventData.End())
+                    LOGWARNING("Mismatching parameter type in remote event " + eventType.ToString() + ", sending default value");
+                remoteEventBuffer_.WriteVariantData(GetDefaultRemoteEventParameter(schema.paramTypes_[j]));
+            }
+        }
+        remoteEvent.compact_ = true;
+    }
+    else
+    {
+        remoteEventBuffer_.WriteVariantMap(eventData);
+        remoteEvent.compact_ = false;
+    }
+
+    remoteEvent.dataSize_ = remoteEventBuffer_.GetSize();
+    remoteEvent.data_ = new unsigned char[remoteEvent.dataSize_];
+    memcpy(remoteEvent.data_.Get(), remoteEventBuffer_.GetData(), remoteEvent.dataSize_);
+    return remoteEvent;
+}
+
 void Network::SetPackageCacheDir(const String& path)
 {
     packageCacheDir_ = AddTrailingSlash(path);
 }
 
+void Network::SetMaxPackageDownloads(unsigned num)
+{
+    maxPackageDownloads_ = (unsigned)Max((int)num, 1);
+}
+
+void Network::SetPackageCompression(bool enable)
+{
+    packageCompression_ = enable;
+}
+
+void Network::SetStatisticsEnabled(bool enable)
+{
+    statisticsEnabled_ = enable;
+    statisticsTimer_.Reset();
+}
+
+void Network::SetStatisticsInterval(int msec)
+{
+    statisticsInterval_ = Max(msec, 1);
+}
+
+void Network::SetStatisticsFileName(const String& fileName)
+{
+    statisticsFileName_ = fileName;
+    statisticsTimer_.Reset();
+}
+
+void Network::ResetStatistics()
+{
+    messageStatistics_.Clear();
+    serializationStatistics_.Clear();
+
+    if (serverConnection_)
+        serverConnection_->ResetStatistics();
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+         i != clientConnections_.End(); ++i)
+        i->second_->ResetStatistics();
+}
+
+void Network::AddMessageStatistics(int msgID, unsigned bytes, bool outgoing)
+{
+    NetworkStatistics& stats = messageStatistics_[msgID];
+    if (outgoing)
+    {
+        ++stats.messagesOut_;
+        stats.bytesOut_ += bytes;
+    }
+    else
+    {
+        ++stats.messagesIn_;
+        stats.bytesIn_ += bytes;
+    }
+}
+
+void Network::AddSerializationStatistics(StringHash type, const String& typeName, unsigned bytes, unsigned usec, bool outgoing)
+{
+    HashMap<StringHash, NetworkStatistics>::Iterator i = serializationStatistics_.Find(type);
+    if (i == serializationStatistics_.End())
+    {
+        i = serializationStatistics_.Insert(MakePair(type, NetworkStatistics()));
+        serializationTypeNames_[type] = typeName;
+    }
+
+    NetworkStatistics& stats = i->second_;
+    if (outgoing)
+    {
+        ++stats.messagesOut_;
+        stats.bytesOut_ += bytes;
+    }
+    else
+    {
+        ++stats.messagesIn_;
+        stats.bytesIn_ += bytes;
+    }
+    stats.serializationTime_ += usec;
+}
+
 void Network::SendPackageToClients(Scene* scene, PackageFile* package)
 {
     if (!scene)
@@ -450,6 +645,65 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Contains(eventType);
 }
 
+const RemoteEventSchema* Network::GetRemoteEventSchema(StringHash eventType) const
+{
+    HashMap<StringHash, RemoteEventSchema>::ConstIterator i = remoteEventSchemas_.Find(eventType);
+    return i != remoteEventSchemas_.End() ? &i->second_ : 0;
+}
+
+NetworkStatistics Network::GetMessageStatistics(int msgID) const
+{
+    HashMap<int, NetworkStatistics>::ConstIterator i = messageStatistics_.Find(msgID);
+    return i != messageStatistics_.End() ? i->second_ : NetworkStatistics();
+}
+
+NetworkStatistics Network::GetSerializationStatistics(StringHash type) const
+{
+    HashMap<StringHash, NetworkStatistics>::ConstIterator i = serializationStatistics_.Find(type);
+    return i != serializationStatistics_.End() ? i->second_ : NetworkStatistics();
+}
+
+String Network::PrintStatistics() const
+{
+    char line[STATISTICS_LINE_MAX_LENGTH];
+    String output;
+
+    output += "Connection                  Msg in  Msg out    KB in   KB out\n\n";
+    Vector<SharedPtr<Connection> > connections = GetClientConnections();
+    if (serverConnection_)
+        connections.Push(serverConnection_);
+    for (Vector<SharedPtr<Connection> >::ConstIterator i = connections.Begin(); i != connections.End(); ++i)
+    {
+        const NetworkStatistics& stats = (*i)->GetStatistics();
+        sprintf(line, "%-24s %9u %8u %8.1f %8.1f\n", (*i)->ToString().CString(), stats.messagesIn_, stats.messagesOut_,
+            stats.bytesIn_ / 1024.0f, stats.bytesOut_ / 1024.0f);
+        output += String(line);
+    }
+
+    output += "\nMessage ID                  Msg in  Msg out    KB in   KB out\n\n";
+    for (HashMap<int, NetworkStatistics>::ConstIterator i = messageStatistics_.Begin(); i != messageStatistics_.End(); ++i)
+    {
+        const NetworkStatistics& stats = i->second_;
+        sprintf(line, "0x%-22x %9u %8u %8.1f %8.1f\n", i->first_, stats.messagesIn_, stats.messagesOut_, stats.bytesIn_ / 1024.0f,
+            stats.bytesOut_ / 1024.0f);
+        output += String(line);
+    }
+
+    output += "\nType                         Upd in  Upd out    KB in   KB out  Time ms\n\n";
+    for (HashMap<StringHash, NetworkStatistics>::ConstIterator i = serializationStatistics_.Begin();
+         i != serializationStatistics_.End(); ++i)
+    {
+        const NetworkStatistics& stats = i->second_;
+        HashMap<StringHash, String>::ConstIterator j = serializationTypeNames_.Find(i->first_);
+        String typeName = j != serializationTypeNames_.End() ? j->second_ : i->first_.ToString();
+        sprintf(line, "%-24s %9u %8u %8.1f %8.1f %8.3f\n", typeName.CString(), stats.messagesIn_, stats.messagesOut_,
+            stats.bytesIn_ / 1024.0f, stats.bytesOut_ / 1024.0f, stats.serializationTime_ / 1000.0f);
+        output += String(line);
+    }
+
+    return output;
+}
+
 void Network::Update(float timeStep)
 {
     PROFILE(UpdateNetwork);
@@ -465,6 +719,9 @@ void Network::Update(float timeStep)
         // Process latest data messages waiting for the correct nodes or components to be created
         serverConnection_->ProcessPendingLatestData();
 
+        // Replay controls not yet processed by the server on predicted nodes that received updates
+        serverConnection_->ReconcilePrediction();
+
         // Check for state transitions
         kNet::ConnectionState state = connection->GetConnectionState();
         if (serverConnection_->IsConnectPending() && state == kNet::ConnectionOK)
@@ -538,6 +795,12 @@ void Network::PostUpdate(float timeStep)
         // Notify that the update was sent
         SendEvent(E_NETWORKUPDATESENT);
     }
+
+    if (statisticsEnabled_ && !statisticsFileName_.Empty() && statisticsTimer_.GetMSec(false) >= (unsigned)statisticsInterval_)
+    {
+        statisticsTimer_.Reset();
+        WriteStatistics();
+    }
 }
 
 void Network::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
@@ -596,6 +859,25 @@ void Network::ConfigureNetworkSimulator()
         i->second_->ConfigureNetworkSimulator(simulatedLatency_, simulatedPacketLoss_);
 }
 
+void Network::WriteStatistics()
+{
+    PROFILE(WriteNetworkStatistics);
+
+    File file(context_, statisticsFileName_, FILE_READWRITE);
+    if (!file.IsOpen())
+    {
+        LOGERROR("Could not open network statistics file " + statisticsFileName_);
+        statisticsFileName_.Clear();
+        return;
+    }
+
+    file.Seek(file.GetSize());
+    String output = Time::GetTimeStamp() + "\n\n" + PrintStatistics() + "\n";
+    file.Write(output.CString(), output.Length());
+
+    ResetStatistics();
+}
+
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
@@ -43,6 +43,15 @@ template <class T> unsigned MakeHash(kNet::MessageConnection* value)
     return ((unsigned)(size_t)value) >> 9;
 }
 
+/// Remote event schema. Defines the parameters of a remote event, which are then sent in order without names or type information.
+struct RemoteEventSchema
+{
+    /// Parameter names.
+    Vector<StringHash> paramNames_;
+    /// Parameter types.
+    PODVector<VariantType> paramTypes_;
+};
+
 /// %Network subsystem. Manages client-server communications using the UDP protocol.
 class URHO3D_API Network : public Object, public kNet::IMessageHandler, public kNet::INetworkServerListener
 {
@@ -97,8 +106,30 @@ public:
     void UnregisterRemoteEvent(StringHash eventType);
     /// Unregister all remote events.
     void UnregisterAllRemoteEvents();
+    /// Register a schema for a remote event. The listed parameters are sent in order without names or type information; parameters not in the schema are not sent. Both ends must register the same schema. Return true if successful.
+    bool RegisterRemoteEventSchema(StringHash eventType, const Vector<StringHash>& paramNames, const PODVector<VariantType>& paramTypes);
+    /// Unregister a remote event schema.
+    void UnregisterRemoteEventSchema(StringHash eventType);
+    /// Serialize a remote event for queuing to connections. Called by Connection and when broadcasting.
+    RemoteEvent PrepareRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData);
     /// Set the package download cache directory.
     void SetPackageCacheDir(const String& path);
+    /// Set maximum number of package files downloaded concurrently from the server.
+    void SetMaxPackageDownloads(unsigned num);
+    /// Set whether to request LZ4-compressed package file transfer from the server.
+    void SetPackageCompression(bool enable);
+    /// Set whether to collect per-message type and per-component type traffic statistics.
+    void SetStatisticsEnabled(bool enable);
+    /// Set the interval in milliseconds for writing traffic statistics to the statistics file.
+    void SetStatisticsInterval(int msec);
+    /// Set the file to append traffic statistics to at each statistics interval. The statistics are reset after each write. Empty disables.
+    void SetStatisticsFileName(const String& fileName);
+    /// Reset all traffic statistics, including the per-connection counters.
+    void ResetStatistics();
+    /// Add a sent or received message to the traffic statistics. Called by Connection.
+    void AddMessageStatistics(int msgID, unsigned bytes, bool outgoing);
+    /// Add a written or read node or component update to the traffic statistics. Called by Connection.
+    void AddSerializationStatistics(StringHash type, const String& typeName, unsigned bytes, unsigned usec, bool outgoing);
     /// Trigger all client connections in the specified scene to download a package file from the server. Can be used to download additional resource packages when clients are already joined in the scene. The package must have been added as a requirement to the scene, or else the eventual download will fail.
     void SendPackageToClients(Scene* scene, PackageFile* package);
     /// Perform an HTTP request to the specified URL. Empty verb defaults to a GET request. Return a request object which can be used to read the response data.
@@ -125,10 +156,40 @@ public:
     bool IsServerRunning() const;
     /// Return whether a remote event is allowed to be received.
     bool CheckRemoteEvent(StringHash eventType) const;
+    /// Return the schema of a remote event, or null if none registered.
+    const RemoteEventSchema* GetRemoteEventSchema(StringHash eventType) const;
 
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
 
+    /// Return maximum number of concurrent package downloads.
+    unsigned GetMaxPackageDownloads() const { return maxPackageDownloads_; }
+
+    /// Return whether compressed package file transfer is requested.
+    bool GetPackageCompression() const { return packageCompression_; }
+
+    /// Return whether traffic statistics are collected.
+    bool GetStatisticsEnabled() const { return statisticsEnabled_; }
+
+    /// Return the statistics file interval in milliseconds.
+    int GetStatisticsInterval() const { return statisticsInterval_; }
+
+    /// Return the statistics file name.
+    const String& GetStatisticsFileName() const { return statisticsFileName_; }
+
+    /// Return traffic statistics for all message ID's.
+    const HashMap<int, NetworkStatistics>& GetMessageStatistics() const { return messageStatistics_; }
+
+    /// Return traffic statistics for all node and component types.
+    const HashMap<StringHash, NetworkStatistics>& GetSerializationStatistics() const { return serializationStatistics_; }
+
+    /// Return traffic statistics for a message ID.
+    NetworkStatistics GetMessageStatistics(int msgID) const;
+    /// Return traffic statistics for a node or component type.
+    NetworkStatistics GetSerializationStatistics(StringHash type) const;
+    /// Return traffic statistics of all connections, message ID's and node and component types as a text table.
+    String PrintStatistics() const;
+
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
     /// Send outgoing messages after frame logic. Called by HandleRenderUpdate.
@@ -145,6 +206,8 @@ private:
     void OnServerDisconnected();
     /// Reconfigure network simulator parameters on all existing connections.
     void ConfigureNetworkSimulator();
+    /// Append traffic statistics to the statistics file, then reset them.
+    void WriteStatistics();
 
     /// kNet instance.
     kNet::Network* network_;
@@ -156,6 +219,10 @@ private:
     HashSet<StringHash> allowedRemoteEvents_;
     /// Remote event fixed blacklist.
     HashSet<StringHash> blacklistedRemoteEvents_;
+    /// Remote event schemas.
+    HashMap<StringHash, RemoteEventSchema> remoteEventSchemas_;
+    /// Remote event serialization buffer.
+    VectorBuffer remoteEventBuffer_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
     /// Update FPS.
@@ -170,6 +237,24 @@ private:
     float updateAcc_;
     /// Package cache directory.
     String packageCacheDir_;
+    /// Maximum number of concurrent package downloads.
+    unsigned maxPackageDownloads_;
+    /// Compressed package transfer flag.
+    bool packageCompression_;
+    /// Traffic statistics per message ID.
+    HashMap<int, NetworkStatistics> messageStatistics_;
+    /// Traffic statistics per node and component type.
+    HashMap<StringHash, NetworkStatistics> serializationStatistics_;
+    /// Node and component type names for printing the statistics.
+    HashMap<StringHash, String> serializationTypeNames_;
+    /// Statistics file name.
+    String statisticsFileName_;
+    /// Statistics file timer.
+    Timer statisticsTimer_;
+    /// Statistics file interval in milliseconds.
+    int statisticsInterval_;
+    /// Statistics collection flag.
+    bool statisticsEnabled_;
 };
 
 /// Register Network library objects.
@@ -91,6 +91,14 @@ EVENT(E_NETWORKSCENELOADFAILED, NetworkSceneLoadFailed)
     PARAM(P_CONNECTION, Connection);      // Connection pointer
 }
 
+/// Client-side predicted node is replaying controls not yet processed by the server, after its LogicComponents have been updated. Sent from the node.
+EVENT(E_PREDICTIONREPLAY, PredictionReplay)
+{
+    PARAM(P_CONNECTION, Connection);      // Connection pointer
+    PARAM(P_NODE, Node);                  // Node pointer
+    PARAM(P_TIMESTEP, TimeStep);          // float
+}
+
 /// Remote event: adds Connection parameter to the event data
 EVENT(E_REMOTEEVENTDATA, RemoteEventData)
 {
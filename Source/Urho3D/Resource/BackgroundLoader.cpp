@@ -23,7 +23,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
+#include "../IO/AsyncIO.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
@@ -34,73 +36,177 @@
 namespace Urho3D
 {
 
-BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+BackgroundLoaderThread::BackgroundLoaderThread(BackgroundLoader* owner, unsigned index) :
+    owner_(owner),
+    index_(index)
 {
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoaderThread::ThreadFunction()
 {
     while (shouldRun_)
     {
-        backgroundLoadMutex_.Acquire();
+        if (!owner_->LoadNextResource(index_))
+            owner_->WaitForWork();
+    }
+
+    // Pass the wakeup on to the other threads being stopped
+    owner_->SignalWork();
+}
+
+BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+    owner_(owner),
+    numThreads_((unsigned)Max((int)GetNumPhysicalCPUs() - 1, 1))
+{
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+    // Stop the threads before the queue is destroyed
+    StopThreads();
+}
+
+void BackgroundLoader::SetNumThreads(unsigned num)
+{
+    num = (unsigned)Max((int)num, 1);
+    if (num == numThreads_)
+        return;
+
+    // Stopping a thread waits for its current resource to finish loading, so the queue stays consistent
+    StopThreads();
+
+    MutexLock lock(backgroundLoadMutex_);
+    numThreads_ = num;
+    if (backgroundLoadQueue_.Size())
+        StartThreads();
+}
+
+void BackgroundLoader::SetMaxConcurrentLoads(StringHash type, unsigned num)
+{
+    MutexLock lock(backgroundLoadMutex_);
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
+    if (num)
+        maxConcurrentLoads_[type] = num;
+    else
+        maxConcurrentLoads_.Erase(type);
+}
+
+bool BackgroundLoader::LoadNextResource(unsigned threadIndex)
+{
+    backgroundLoadMutex_.Acquire();
+
+    // Search for the highest priority queued resource whose type is not already at its concurrent load limit. Prefer
+    // resources whose file has already been read, so that the worker threads do not stall on I/O
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator best = backgroundLoadQueue_.End();
+    bool bestReady = false;
+    unsigned numLoadable = 0;
+    for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
+         i != backgroundLoadQueue_.End(); ++i)
+    {
+        if (i->second_.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+            continue;
+        if (!maxConcurrentLoads_.Empty())
         {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+            HashMap<StringHash, unsigned>::ConstIterator j = maxConcurrentLoads_.Find(i->first_.first_);
+            if (j != maxConcurrentLoads_.End() && concurrentLoads_[i->first_.first_] >= j->second_)
+                continue;
         }
+        ++numLoadable;
+        bool ready = !i->second_.fileRequest_ || i->second_.fileRequest_->IsCompleted();
+        if (best != backgroundLoadQueue_.End() && ((bestReady && !ready) || (bestReady == ready &&
+            i->second_.priority_ <= best->second_.priority_)))
+            continue;
+        best = i;
+        bestReady = ready;
+    }
+
+    if (best == backgroundLoadQueue_.End())
+    {
+        // No resources to load found
+        backgroundLoadMutex_.Release();
+        return false;
+    }
 
-        if (i == backgroundLoadQueue_.End())
+    BackgroundLoadItem& item = best->second_;
+    Resource* resource = item.resource_;
+    StringHash type = best->first_.first_;
+    // Mark as loading before releasing the mutex so that other threads will not pick the same resource. We can be sure
+    // that the item is not removed from the queue as long as it is in the "queued" or "loading" state
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    ++concurrentLoads_[type];
+    SharedPtr<AsyncReadRequest> request = item.fileRequest_;
+    item.fileRequest_.Reset();
+    bool traced = item.traced_;
+    backgroundLoadMutex_.Release();
+
+    // Wake up another idle thread if there is more to load
+    if (numLoadable > 1)
+        SignalWork();
+
+    // The record is only accessed by this thread until the load state changes
+    ResourceLoadRecord& record = item.record_;
+    long long ioStartTime = traced ? owner_->GetLoadTraceTime() : 0;
+
+    bool success = false;
+    if (request && request->Wait())
+    {
+        if (traced)
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            record.fileSize_ = request->GetSize();
+            record.beginLoadTime_ = owner_->GetLoadTraceTime();
         }
-        else
+        success = resource->BeginLoad(*request);
+    }
+    else
+    {
+        // If the asynchronous read was not issued or failed, read the file now. This also logs the failure
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (traced)
         {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
-
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+            record.fileSize_ = file ? file->GetSize() : 0;
+            record.beginLoadTime_ = owner_->GetLoadTraceTime();
+        }
+        if (file)
+            success = resource->BeginLoad(*file);
+    }
 
-                item.dependents_.Clear();
-            }
+    if (traced)
+    {
+        record.ioWaitTime_ = record.beginLoadTime_ - ioStartTime;
+        record.beginLoadDuration_ = owner_->GetLoadTraceTime() - record.beginLoadTime_;
+        record.thread_ = threadIndex;
+    }
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
+             i != item.dependents_.End(); ++i)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
+
+        item.dependents_.Clear();
     }
+
+    --concurrentLoads_[type];
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    // Resources held back by the concurrent load limit may be loadable now
+    bool limited = !maxConcurrentLoads_.Empty();
+    backgroundLoadMutex_.Release();
+
+    if (limited)
+        SignalWork();
+
+    return true;
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, int priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
@@ -113,6 +219,16 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
+    item.traced_ = owner_->IsLoadTraceEnabled();
+    if (item.traced_)
+    {
+        item.record_.type_ = type;
+        item.record_.name_ = name;
+        item.record_.requester_ = caller ? caller->GetName() : owner_->GetLoadRequesterName();
+        item.record_.requestTime_ = owner_->GetLoadTraceTime();
+        item.record_.background_ = true;
+    }
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -148,15 +264,21 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
             callerItem.dependencies_.Insert(key);
+            // The caller can not finish before its dependencies, so load them at least with the same priority
+            item.priority_ = Max(item.priority_, callerItem.priority_);
         }
         else
             LOGWARNING("Resource " + caller->GetName() +
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Start reading the file now so that the I/O overlaps with loading other resources
+    if (owner_->GetAsyncFileReads())
+        item.fileRequest_ = owner_->ReadFileAsync(name, item.priority_);
+
+    // Start the background loader threads now, and wake up an idle one
+    StartThreads();
+    SignalWork();
 
     return true;
 }
@@ -170,6 +292,8 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        // Make sure the resource is picked next if it is still waiting in the queue
+        i->second_.priority_ = M_MAX_INT;
         backgroundLoadMutex_.Release();
 
         {
@@ -208,7 +332,7 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (threads_.Size())
     {
         HiresTimer timer;
 
@@ -247,9 +371,45 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.Size();
 }
 
+unsigned BackgroundLoader::GetMaxConcurrentLoads(StringHash type) const
+{
+    MutexLock lock(backgroundLoadMutex_);
+    HashMap<StringHash, unsigned>::ConstIterator i = maxConcurrentLoads_.Find(type);
+    return i != maxConcurrentLoads_.End() ? i->second_ : 0;
+}
+
+void BackgroundLoader::StartThreads()
+{
+    if (threads_.Size())
+        return;
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this, i + 1));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    if (threads_.Empty())
+        return;
+
+    // Clear the running flags first, then wake up the idle threads. Each exiting thread wakes up the next one
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->RequestStop();
+    SignalWork();
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+    threads_.Clear();
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
+    if (item.traced_)
+        item.record_.endLoadTime_ = owner_->GetLoadTraceTime();
 
     bool success = resource->GetAsyncLoadState() == ASYNC_SUCCESS;
     // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
@@ -263,7 +423,10 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
             profiler->BeginBlock(profileBlockName.CString());
 #endif
         LOGDEBUG("Finishing background loaded resource " + resource->GetName());
+        // Resources requested during EndLoad() are its dependencies
+        owner_->loadingResources_.Push(resource);
         success = resource->EndLoad();
+        owner_->loadingResources_.Pop();
 
 #ifdef URHO3D_PROFILING
         if (profiler)
@@ -272,6 +435,13 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
 
+    if (item.traced_)
+    {
+        item.record_.endLoadDuration_ = owner_->GetLoadTraceTime() - item.record_.endLoadTime_;
+        item.record_.success_ = success;
+        owner_->AddLoadRecord(item.record_);
+    }
+
     if (!success && item.sendEventOnFailure_)
     {
         using namespace LoadFailed;
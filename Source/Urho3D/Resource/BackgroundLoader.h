@@ -24,17 +24,20 @@
 
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
+#include "../Core/Condition.h"
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
 #include "../Core/Thread.h"
 #include "../Math/StringHash.h"
+#include "../Resource/ResourceCache.h"
 
 namespace Urho3D
 {
 
+class AsyncReadRequest;
+class BackgroundLoader;
 class Resource;
-class ResourceCache;
 
 /// Queue item for background loading of a resource.
 struct BackgroundLoadItem
@@ -45,31 +48,75 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Asynchronous read of the resource file, issued when queued.
+    SharedPtr<AsyncReadRequest> fileRequest_;
+    /// Load priority. Queued resources with higher priority are loaded first.
+    int priority_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Whether the load is being traced.
+    bool traced_;
+    /// Load timing record if traced.
+    ResourceLoadRecord record_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+/// Worker thread of the background loader.
+class BackgroundLoaderThread : public RefCounted, public Thread
 {
 public:
     /// Construct.
-    BackgroundLoader(ResourceCache* owner);
+    BackgroundLoaderThread(BackgroundLoader* owner, unsigned index);
 
     /// Resource background loading loop.
     virtual void ThreadFunction();
+    /// Set the running flag to false without waiting for the thread to finish.
+    void RequestStop() { shouldRun_ = false; }
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+    /// Thread index, starting from 1.
+    unsigned index_;
+};
+
+/// Background loader of resources. Owned by the ResourceCache. Loads resources in a pool of worker threads.
+class BackgroundLoader : public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoader(ResourceCache* owner);
+    /// Destruct. Stop the worker threads.
+    ~BackgroundLoader();
 
+    /// Set number of worker threads. The threads are started on the first background load request.
+    void SetNumThreads(unsigned num);
+    /// Set maximum number of resources of a type that are loaded concurrently. 0 is unlimited (default.)
+    void SetMaxConcurrentLoads(StringHash type, unsigned num);
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, int priority = 0);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
+    /// Load the highest priority queued resource. Called by the worker threads. Return false if there was nothing to load.
+    bool LoadNextResource(unsigned threadIndex);
+    /// Wait until there may be resources to load. Called by the worker threads when idle.
+    void WaitForWork() { workCondition_.Wait(); }
+    /// Wake up one idle worker thread.
+    void SignalWork() { workCondition_.Set(); }
 
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of worker threads.
+    unsigned GetNumThreads() const { return numThreads_; }
+    /// Return maximum number of concurrently loaded resources of a type, 0 if unlimited.
+    unsigned GetMaxConcurrentLoads(StringHash type) const;
 
 private:
+    /// Start the worker threads if not started yet. Called with the queue mutex held.
+    void StartThreads();
+    /// Stop the worker threads. The threads finish their current resources first.
+    void StopThreads();
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -77,8 +124,18 @@ private:
     ResourceCache* owner_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
+    /// Condition set when resources are queued or loads finish, and when the worker threads are stopped.
+    Condition workCondition_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Worker threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Maximum concurrent loads per resource type.
+    HashMap<StringHash, unsigned> maxConcurrentLoads_;
+    /// Current concurrent loads per resource type.
+    HashMap<StringHash, unsigned> concurrentLoads_;
+    /// Number of worker threads.
+    unsigned numThreads_;
 };
 
 }
@@ -22,13 +22,98 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Resource/Decompress.h"
 
+#include <cstring>
+
 // DXT decompression based on the Squish library, modified for Urho3D
 
 namespace Urho3D
 {
 
+/// Minimum number of pixels to split the decompression or compression of an image into several work items.
+static const int MIN_PARALLEL_PIXELS = 128 * 128;
+
+struct BlockWork;
+
+/// Function to process a range of rows of an image.
+typedef void (*BlockWorkFunction)(const BlockWork& work);
+
+/// Image decompression or compression work. The rows are rows of 4x4 blocks, except for PVRTC which uses pixel rows.
+struct BlockWork
+{
+    /// Function to call.
+    BlockWorkFunction function_;
+    /// Destination data.
+    unsigned char* dest_;
+    /// Source data.
+    const unsigned char* src_;
+    /// Image width.
+    int width_;
+    /// Image height.
+    int height_;
+    /// Image depth.
+    int depth_;
+    /// Compressed format.
+    CompressedFormat format_;
+    /// First row to process.
+    int start_;
+    /// End row, exclusive.
+    int end_;
+};
+
+/// Process a range of image rows in a worker thread.
+static void ProcessBlockWork(const WorkItem* item, unsigned threadIndex)
+{
+    const BlockWork* work = reinterpret_cast<const BlockWork*>(item->start_);
+    work->function_(*work);
+}
+
+/// Process the rows of an image. When a work queue is given and called from the main thread, split a large image into bands
+/// for the worker threads.
+static void ProcessBlockRows(BlockWork& work, int numRows, WorkQueue* queue)
+{
+    int numBands = 1;
+    if (queue && queue->GetNumThreads() && Thread::IsMainThread() && work.width_ * work.height_ * work.depth_ >= MIN_PARALLEL_PIXELS)
+        numBands = Min((int)queue->GetNumThreads() + 1, numRows);
+
+    if (numBands <= 1)
+    {
+        work.start_ = 0;
+        work.end_ = numRows;
+        work.function_(work);
+        return;
+    }
+
+    PODVector<BlockWork> bands(numBands);
+    int bandSize = (numRows + numBands - 1) / numBands;
+    for (int i = 0; i < numBands; ++i)
+    {
+        bands[i] = work;
+        bands[i].start_ = Min(i * bandSize, numRows);
+        bands[i].end_ = Min(bands[i].start_ + bandSize, numRows);
+
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = ProcessBlockWork;
+        item->start_ = &bands[i];
+        queue->AddWorkItem(item);
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+/// Copy a decompressed 4x4 block to an RGBA image, clipping it to the image size.
+static void WriteBlock(unsigned char* rgba, const unsigned* block, int x, int y, int width, int height)
+{
+    int blockWidth = Min(width - x, 4);
+    int blockHeight = Min(height - y, 4);
+    for (int py = 0; py < blockHeight; ++py)
+        memcpy(rgba + 4 * (width * (y + py) + x), block + 4 * py, (size_t)blockWidth * 4);
+}
+
 /* -----------------------------------------------------------------------------
 
     Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
@@ -74,13 +159,14 @@ static int Unpack565(unsigned char const* packed, unsigned char* colour)
     return value;
 }
 
-static void DecompressColourDXT(unsigned char* rgba, void const* block, bool isDxt1)
+static void DecompressColourDXT(unsigned* rgba, void const* block, bool isDxt1)
 {
     // get the block bytes
     unsigned char const* bytes = reinterpret_cast< unsigned char const* >( block );
 
-    // unpack the endpoints
-    unsigned char codes[16];
+    // unpack the endpoints. Build the codebook as whole pixels so that they can be written at once
+    unsigned codeWords[4];
+    unsigned char* codes = reinterpret_cast<unsigned char*>(codeWords);
     int a = Unpack565(bytes, codes);
     int b = Unpack565(bytes + 2, codes + 4);
 
@@ -106,26 +192,10 @@ static void DecompressColourDXT(unsigned char* rgba, void const* block, bool isD
     codes[8 + 3] = 255;
     codes[12 + 3] = (unsigned char)((isDxt1 && a <= b) ? 0 : 255);
 
-    // unpack the indices
-    unsigned char indices[16];
-    for (int i = 0; i < 4; ++i)
-    {
-        unsigned char* ind = indices + 4 * i;
-        unsigned char packed = bytes[4 + i];
-
-        ind[0] = (unsigned char)(packed & 0x3);
-        ind[1] = (unsigned char)((packed >> 2) & 0x3);
-        ind[2] = (unsigned char)((packed >> 4) & 0x3);
-        ind[3] = (unsigned char)((packed >> 6) & 0x3);
-    }
-
-    // store out the colours
+    // store out the colours, 2 bits of index per pixel
+    unsigned indices = (unsigned)bytes[4] | ((unsigned)bytes[5] << 8) | ((unsigned)bytes[6] << 16) | ((unsigned)bytes[7] << 24);
     for (int i = 0; i < 16; ++i)
-    {
-        unsigned char offset = (unsigned char)(4 * indices[i]);
-        for (int j = 0; j < 4; ++j)
-            rgba[4 * i + j] = codes[offset + j];
-    }
+        rgba[i] = codeWords[(indices >> (2 * i)) & 0x3];
 }
 
 static void DecompressAlphaDXT3(unsigned char* rgba, void const* block)
@@ -174,34 +244,21 @@ static void DecompressAlphaDXT5(unsigned char* rgba, void const* block)
             codes[1 + i] = (unsigned char)(((7 - i) * alpha0 + i * alpha1) / 7);
     }
 
-    // decode the indices
-    unsigned char indices[16];
+    // decode the indices and write out the indexed codebook values
     unsigned char const* src = bytes + 2;
-    unsigned char* dest = indices;
     for (int i = 0; i < 2; ++i)
     {
         // grab 3 bytes
-        int value = 0;
-        for (int j = 0; j < 3; ++j)
-        {
-            int byte = *src++;
-            value |= (byte << 8 * j);
-        }
+        int value = (int)src[0] | ((int)src[1] << 8) | ((int)src[2] << 16);
+        src += 3;
 
         // unpack 8 3-bit values from it
         for (int j = 0; j < 8; ++j)
-        {
-            int index = (value >> 3 * j) & 0x7;
-            *dest++ = (unsigned char)index;
-        }
+            rgba[4 * (8 * i + j) + 3] = codes[(value >> 3 * j) & 0x7];
     }
-
-    // write out the indexed codebook values
-    for (int i = 0; i < 16; ++i)
-        rgba[4 * i + 3] = codes[indices[i]];
 }
 
-static void DecompressDXT(unsigned char* rgba, const void* block, CompressedFormat format)
+static void DecompressDXT(unsigned* rgba, const void* block, CompressedFormat format)
 {
     // get the block locations
     void const* colourBlock = block;
@@ -214,61 +271,49 @@ static void DecompressDXT(unsigned char* rgba, const void* block, CompressedForm
 
     // decompress alpha separately if necessary
     if (format == CF_DXT3)
-        DecompressAlphaDXT3(rgba, alphaBock);
+        DecompressAlphaDXT3(reinterpret_cast<unsigned char*>(rgba), alphaBock);
     else if (format == CF_DXT5)
-        DecompressAlphaDXT5(rgba, alphaBock);
+        DecompressAlphaDXT5(reinterpret_cast<unsigned char*>(rgba), alphaBock);
 }
 
-void DecompressImageDXT(unsigned char* rgba, const void* blocks, int width, int height, int depth, CompressedFormat format)
+static void DecompressRowsDXT(const BlockWork& work)
 {
-    // initialise the block input
-    unsigned char const* sourceBlock = reinterpret_cast< unsigned char const* >( blocks );
-    int bytesPerBlock = format == CF_DXT1 ? 8 : 16;
+    int bytesPerBlock = work.format_ == CF_DXT1 ? 8 : 16;
+    int blocksX = (work.width_ + 3) / 4;
+    int blocksY = (work.height_ + 3) / 4;
 
-    // loop over blocks
-    for (int z = 0; z < depth; ++z)
+    for (int row = work.start_; row < work.end_; ++row)
     {
-        int sz = width * height * 4 * z;
-        for (int y = 0; y < height; y += 4)
-        {
-            for (int x = 0; x < width; x += 4)
-            {
-                // decompress the block
-                unsigned char targetRgba[4 * 16];
-                DecompressDXT(targetRgba, sourceBlock, format);
+        int z = row / blocksY;
+        int y = (row - z * blocksY) * 4;
+        unsigned char* slice = work.dest_ + work.width_ * work.height_ * 4 * z;
+        unsigned char const* sourceBlock = work.src_ + row * blocksX * bytesPerBlock;
 
-                // write the decompressed pixels to the correct image locations
-                unsigned char const* sourcePixel = targetRgba;
-                for (int py = 0; py < 4; ++py)
-                {
-                    for (int px = 0; px < 4; ++px)
-                    {
-                        // get the target location
-                        int sx = x + px;
-                        int sy = y + py;
-                        if (sx < width && sy < height)
-                        {
-                            unsigned char* targetPixel = rgba + sz + 4 * (width * sy + sx);
-
-                            // copy the rgba value
-                            for (int i = 0; i < 4; ++i)
-                                *targetPixel++ = *sourcePixel++;
-                        }
-                        else
-                        {
-                            // skip this pixel as its outside the image
-                            sourcePixel += 4;
-                        }
-                    }
-                }
-
-                // advance
-                sourceBlock += bytesPerBlock;
-            }
+        for (int x = 0; x < work.width_; x += 4)
+        {
+            // decompress the block and write the pixels to the image
+            unsigned targetRgba[16];
+            DecompressDXT(targetRgba, sourceBlock, work.format_);
+            WriteBlock(slice, targetRgba, x, y, work.width_, work.height_);
+            sourceBlock += bytesPerBlock;
         }
     }
 }
 
+void DecompressImageDXT(unsigned char* rgba, const void* blocks, int width, int height, int depth, CompressedFormat format,
+    WorkQueue* queue)
+{
+    BlockWork work;
+    work.function_ = DecompressRowsDXT;
+    work.dest_ = rgba;
+    work.src_ = reinterpret_cast<const unsigned char*>(blocks);
+    work.width_ = width;
+    work.height_ = height;
+    work.depth_ = depth;
+    work.format_ = format;
+    ProcessBlockRows(work, depth * ((height + 3) / 4), queue);
+}
+
 // ETC and PVRTC decompression based on the Oolong Engine, modified for Urho3D
 
 /*
@@ -304,10 +349,10 @@ const int mod[8][4] = {{2,  8,   -2,  -8},
                        {47, 183, -47, -183}};
 
 // lsb: hgfedcba ponmlkji msb: hgfedcba ponmlkji due to endianness
-static unsigned long ModifyPixel(int red, int green, int blue, int x, int y, unsigned long modBlock, int modTable)
+static unsigned ModifyPixel(int red, int green, int blue, int x, int y, unsigned modBlock, int modTable)
 {
     int index = x * 4 + y, pixelMod;
-    unsigned long mostSig = modBlock << 1;
+    unsigned mostSig = modBlock << 1;
     if (index < 8)    //hgfedcba
         pixelMod = mod[modTable][((modBlock >> (index + 24)) & 0x1) + ((mostSig >> (index + 8)) & 0x2)];
     else    // ponmlkj
@@ -320,9 +365,10 @@ static unsigned long ModifyPixel(int red, int green, int blue, int x, int y, uns
     return ((blue << 16) + (green << 8) + red) | 0xff000000;
 }
 
-static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
+static void DecompressETC(unsigned* pDestData, const void* pSrcData)
 {
-    unsigned long blockTop, blockBot, * input = (unsigned long*)pSrcData, * output;
+    // The block is two 32-bit words. Do not use unsigned long, as it is 64 bits on LP64 platforms
+    unsigned blockTop, blockBot, * input = (unsigned*)pSrcData, * output;
     unsigned char red1, green1, blue1, red2, green2, blue2;
     bool bFlip, bDiff;
     int modtable1, modtable2;
@@ -330,7 +376,7 @@ static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
     blockTop = *(input++);
     blockBot = *(input++);
 
-    output = (unsigned long*)pDestData;
+    output = pDestData;
     // check flipbit
     bFlip = (blockTop & ETC_FLIP) != 0;
     bDiff = (blockTop & ETC_DIFF) != 0;
@@ -405,52 +451,39 @@ static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
     }
 }
 
-void DecompressImageETC(unsigned char* rgba, const void* blocks, int width, int height)
+static void DecompressRowsETC(const BlockWork& work)
 {
-    // initialise the block input
-    unsigned char const* sourceBlock = reinterpret_cast< unsigned char const* >( blocks );
-    int bytesPerBlock = 8;
+    int blocksX = (work.width_ + 3) / 4;
 
-    // loop over blocks
-    for (int y = 0; y < height; y += 4)
+    for (int row = work.start_; row < work.end_; ++row)
     {
-        for (int x = 0; x < width; x += 4)
+        int y = row * 4;
+        unsigned char const* sourceBlock = work.src_ + row * blocksX * 8;
+
+        for (int x = 0; x < work.width_; x += 4)
         {
-            // decompress the block
-            unsigned char targetRgba[4 * 16];
+            // decompress the block and write the pixels to the image
+            unsigned targetRgba[16];
             DecompressETC(targetRgba, sourceBlock);
-
-            // write the decompressed pixels to the correct image locations
-            unsigned char const* sourcePixel = targetRgba;
-            for (int py = 0; py < 4; ++py)
-            {
-                for (int px = 0; px < 4; ++px)
-                {
-                    // get the target location
-                    int sx = x + px;
-                    int sy = y + py;
-                    if (sx < width && sy < height)
-                    {
-                        unsigned char* targetPixel = rgba + 4 * (width * sy + sx);
-
-                        // copy the rgba value
-                        for (int i = 0; i < 4; ++i)
-                            *targetPixel++ = *sourcePixel++;
-                    }
-                    else
-                    {
-                        // skip this pixel as its outside the image
-                        sourcePixel += 4;
-                    }
-                }
-            }
-
-            // advance
-            sourceBlock += bytesPerBlock;
+            WriteBlock(work.dest_, targetRgba, x, y, work.width_, work.height_);
+            sourceBlock += 8;
         }
     }
 }
 
+void DecompressImageETC(unsigned char* rgba, const void* blocks, int width, int height, WorkQueue* queue)
+{
+    BlockWork work;
+    work.function_ = DecompressRowsETC;
+    work.dest_ = rgba;
+    work.src_ = reinterpret_cast<const unsigned char*>(blocks);
+    work.width_ = width;
+    work.height_ = height;
+    work.depth_ = 1;
+    work.format_ = CF_ETC1;
+    ProcessBlockRows(work, (height + 3) / 4, queue);
+}
+
 #define PT_INDEX    (2) /*The Punch-through index*/
 #define BLK_Y_SIZE  (4) /*always 4 for all 2D block types*/
 #define BLK_X_MAX   (8) /*Max X dimension for blocks*/
@@ -802,9 +835,13 @@ static unsigned TwiddleUV(unsigned YSize, unsigned XSize, unsigned YPos, unsigne
     return Twiddled;
 }
 
-void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format)
+static void DecompressRowsPVRTC(const BlockWork& work)
 {
-    AMTC_BLOCK_STRUCT* pCompressedData = (AMTC_BLOCK_STRUCT*)blocks;
+    unsigned char* dest = work.dest_;
+    int width = work.width_;
+    int height = work.height_;
+    CompressedFormat format = work.format_;
+    AMTC_BLOCK_STRUCT* pCompressedData = (AMTC_BLOCK_STRUCT*)work.src_;
     int AssumeImageTiles = 1;
     int Do2bitMode = format == CF_PVRTC_RGB_2BPP || format == CF_PVRTC_RGBA_2BPP;
 
@@ -857,7 +894,7 @@ void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, in
     // Step through the pixels of the image decompressing each one in turn
     //
     // Note that this is a hideously inefficient way to do this!
-    for (y = 0; y < height; y++)
+    for (y = work.start_; y < work.end_; y++)
     {
         for (x = 0; x < width; x++)
         {
@@ -948,6 +985,20 @@ void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, in
     }
 }
 
+void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format, WorkQueue* queue)
+{
+    // Each pixel is decoded from its neighbourhood of blocks, so the work can be split by pixel rows
+    BlockWork work;
+    work.function_ = DecompressRowsPVRTC;
+    work.dest_ = dest;
+    work.src_ = reinterpret_cast<const unsigned char*>(blocks);
+    work.width_ = width;
+    work.height_ = height;
+    work.depth_ = 1;
+    work.format_ = format;
+    ProcessBlockRows(work, height, queue);
+}
+
 void FlipBlockVertical(unsigned char* dest, unsigned char* src, CompressedFormat format)
 {
     switch (format)
@@ -1071,4 +1122,213 @@ void FlipBlockHorizontal(unsigned char* dest, unsigned char* src, CompressedForm
     }
 }
 
+
+/// Quantize a color to the 565 format.
+static unsigned short Pack565(int red, int green, int blue)
+{
+    return (unsigned short)((((red * 31 + 127) / 255) << 11) | (((green * 63 + 127) / 255) << 5) | ((blue * 31 + 127) / 255));
+}
+
+static void CompressColourDXT(unsigned char* dest, const unsigned char* rgba)
+{
+    // Find the bounding box of the colors
+    int minColor[3] = { 255, 255, 255 };
+    int maxColor[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            int value = rgba[4 * i + j];
+            if (value < minColor[j])
+                minColor[j] = value;
+            if (value > maxColor[j])
+                maxColor[j] = value;
+        }
+    }
+
+    // Inset the bounding box to reduce the error of the interpolated colors
+    for (int j = 0; j < 3; ++j)
+    {
+        int inset = (maxColor[j] - minColor[j]) >> 4;
+        minColor[j] += inset;
+        maxColor[j] -= inset;
+    }
+
+    // Use the diagonal of the bounding box that follows the correlation of the colors
+    int center[3];
+    for (int j = 0; j < 3; ++j)
+        center[j] = (minColor[j] + maxColor[j]) >> 1;
+    int covRedBlue = 0;
+    int covGreenBlue = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int blue = rgba[4 * i + 2] - center[2];
+        covRedBlue += (rgba[4 * i] - center[0]) * blue;
+        covGreenBlue += (rgba[4 * i + 1] - center[1]) * blue;
+    }
+    if (covRedBlue < 0)
+        Swap(minColor[0], maxColor[0]);
+    if (covGreenBlue < 0)
+        Swap(minColor[1], maxColor[1]);
+
+    // The first endpoint must be larger to select the four color mode
+    unsigned short color0 = Pack565(maxColor[0], maxColor[1], maxColor[2]);
+    unsigned short color1 = Pack565(minColor[0], minColor[1], minColor[2]);
+    if (color0 < color1)
+        Swap(color0, color1);
+
+    unsigned indices = 0;
+    if (color0 != color1)
+    {
+        // Build the codebook the same way as the decompressor and select the closest color for each pixel
+        unsigned char packed[4] = { (unsigned char)(color0 & 0xff), (unsigned char)(color0 >> 8), (unsigned char)(color1 & 0xff),
+            (unsigned char)(color1 >> 8) };
+        unsigned char codes[16];
+        Unpack565(packed, codes);
+        Unpack565(packed + 2, codes + 4);
+        for (int j = 0; j < 3; ++j)
+        {
+            codes[8 + j] = (unsigned char)((2 * codes[j] + codes[4 + j]) / 3);
+            codes[12 + j] = (unsigned char)((codes[j] + 2 * codes[4 + j]) / 3);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            int bestError = M_MAX_INT;
+            for (int k = 0; k < 4; ++k)
+            {
+                int dr = rgba[4 * i] - codes[4 * k];
+                int dg = rgba[4 * i + 1] - codes[4 * k + 1];
+                int db = rgba[4 * i + 2] - codes[4 * k + 2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = k;
+                }
+            }
+            indices |= (unsigned)bestIndex << (2 * i);
+        }
+    }
+
+    dest[0] = (unsigned char)(color0 & 0xff);
+    dest[1] = (unsigned char)(color0 >> 8);
+    dest[2] = (unsigned char)(color1 & 0xff);
+    dest[3] = (unsigned char)(color1 >> 8);
+    dest[4] = (unsigned char)(indices & 0xff);
+    dest[5] = (unsigned char)((indices >> 8) & 0xff);
+    dest[6] = (unsigned char)((indices >> 16) & 0xff);
+    dest[7] = (unsigned char)(indices >> 24);
+}
+
+static void CompressAlphaDXT3(unsigned char* dest, const unsigned char* rgba)
+{
+    // Quantize to 4 bits with rounding, two pixels per byte
+    for (int i = 0; i < 8; ++i)
+    {
+        int lo = (rgba[8 * i + 3] * 15 + 127) / 255;
+        int hi = (rgba[8 * i + 7] * 15 + 127) / 255;
+        dest[i] = (unsigned char)(lo | (hi << 4));
+    }
+}
+
+static void CompressAlphaDXT5(unsigned char* dest, const unsigned char* rgba)
+{
+    int minAlpha = 255;
+    int maxAlpha = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int alpha = rgba[4 * i + 3];
+        if (alpha < minAlpha)
+            minAlpha = alpha;
+        if (alpha > maxAlpha)
+            maxAlpha = alpha;
+    }
+
+    // Use the 8-alpha codebook, which requires the first value to be larger
+    dest[0] = (unsigned char)maxAlpha;
+    dest[1] = (unsigned char)minAlpha;
+
+    // The codebook values are evenly spaced from the maximum (index 0) through the interpolated values (indices 2-7) to the
+    // minimum (index 1), so the closest value can be calculated directly
+    int range = maxAlpha - minAlpha;
+    for (int i = 0; i < 2; ++i)
+    {
+        int value = 0;
+        if (range)
+        {
+            for (int j = 0; j < 8; ++j)
+            {
+                int step = ((maxAlpha - rgba[4 * (8 * i + j) + 3]) * 7 + range / 2) / range;
+                int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+                value |= index << (3 * j);
+            }
+        }
+
+        dest[2 + 3 * i] = (unsigned char)(value & 0xff);
+        dest[3 + 3 * i] = (unsigned char)((value >> 8) & 0xff);
+        dest[4 + 3 * i] = (unsigned char)((value >> 16) & 0xff);
+    }
+}
+
+static void CompressRowsDXT(const BlockWork& work)
+{
+    int bytesPerBlock = work.format_ == CF_DXT1 ? 8 : 16;
+    int blocksX = (work.width_ + 3) / 4;
+
+    for (int row = work.start_; row < work.end_; ++row)
+    {
+        int y = row * 4;
+        unsigned char* destBlock = work.dest_ + row * blocksX * bytesPerBlock;
+
+        for (int x = 0; x < work.width_; x += 4)
+        {
+            // Gather the block, repeating the edge pixels if it extends outside the image
+            unsigned block[16];
+            for (int py = 0; py < 4; ++py)
+            {
+                int sy = Min(y + py, work.height_ - 1);
+                for (int px = 0; px < 4; ++px)
+                {
+                    int sx = Min(x + px, work.width_ - 1);
+                    memcpy(&block[py * 4 + px], work.src_ + 4 * (work.width_ * sy + sx), 4);
+                }
+            }
+
+            const unsigned char* blockRgba = reinterpret_cast<const unsigned char*>(block);
+            if (work.format_ == CF_DXT1)
+                CompressColourDXT(destBlock, blockRgba);
+            else
+            {
+                if (work.format_ == CF_DXT3)
+                    CompressAlphaDXT3(destBlock, blockRgba);
+                else
+                    CompressAlphaDXT5(destBlock, blockRgba);
+                CompressColourDXT(destBlock + 8, blockRgba);
+            }
+
+            destBlock += bytesPerBlock;
+        }
+    }
+}
+
+bool CompressImageDXT(unsigned char* dest, const unsigned char* rgba, int width, int height, CompressedFormat format,
+    WorkQueue* queue)
+{
+    if (format != CF_DXT1 && format != CF_DXT3 && format != CF_DXT5)
+        return false;
+
+    BlockWork work;
+    work.function_ = CompressRowsDXT;
+    work.dest_ = dest;
+    work.src_ = rgba;
+    work.width_ = width;
+    work.height_ = height;
+    work.depth_ = 1;
+    work.format_ = format;
+    ProcessBlockRows(work, (height + 3) / 4, queue);
+    return true;
+}
+
 }
@@ -27,13 +27,19 @@
 namespace Urho3D
 {
 
-/// Decompress a DXT compressed image to RGBA.
-URHO3D_API void
-    DecompressImageDXT(unsigned char* dest, const void* blocks, int width, int height, int depth, CompressedFormat format);
-/// Decompress an ETC1 compressed image to RGBA.
-URHO3D_API void DecompressImageETC(unsigned char* dest, const void* blocks, int width, int height);
-/// Decompress a PVRTC compressed image to RGBA.
-URHO3D_API void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format);
+class WorkQueue;
+
+/// Decompress a DXT compressed image to RGBA. If a work queue is given, a large image is split for the worker threads when called from the main thread.
+URHO3D_API void DecompressImageDXT
+    (unsigned char* dest, const void* blocks, int width, int height, int depth, CompressedFormat format, WorkQueue* queue = 0);
+/// Decompress an ETC1 compressed image to RGBA, optionally using the work queue.
+URHO3D_API void DecompressImageETC(unsigned char* dest, const void* blocks, int width, int height, WorkQueue* queue = 0);
+/// Decompress a PVRTC compressed image to RGBA, optionally using the work queue.
+URHO3D_API void DecompressImagePVRTC
+    (unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format, WorkQueue* queue = 0);
+/// Compress an RGBA image to DXT1, DXT3 or DXT5, optionally using the work queue. Return false if the format is not supported.
+URHO3D_API bool CompressImageDXT
+    (unsigned char* dest, const unsigned char* rgba, int width, int height, CompressedFormat format, WorkQueue* queue = 0);
 /// Flip a compressed block vertically.
 URHO3D_API void FlipBlockVertical(unsigned char* dest, unsigned char* src, CompressedFormat format);
 /// Flip a compressed block horizontally.
@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -34,6 +35,10 @@
 #include <STB/stb_image.h>
 #include <STB/stb_image_write.h>
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 extern "C" unsigned char* stbi_write_png_to_mem(unsigned char* pixels, int stride_bytes, int x, int y, int n, int* out_len);
@@ -51,6 +56,34 @@ extern "C" unsigned char* stbi_write_png_to_mem(unsigned char* pixels, int strid
 namespace Urho3D
 {
 
+/// Minimum number of mip level pixels to split the calculation into several work items.
+static const unsigned MIN_PARALLEL_MIP_PIXELS = 128 * 128;
+
+/// Mip level calculation work item.
+struct MipLevelWork
+{
+    /// Source image data.
+    const unsigned char* pixelDataIn_;
+    /// Destination mip level data.
+    unsigned char* pixelDataOut_;
+    /// Source image width.
+    int width_;
+    /// Source image height.
+    int height_;
+    /// Source image depth.
+    int depth_;
+    /// Mip level width.
+    int widthOut_;
+    /// Mip level height.
+    int heightOut_;
+    /// Number of color components.
+    unsigned components_;
+    /// First row or slice to calculate.
+    int start_;
+    /// End row or slice, exclusive.
+    int end_;
+};
+
 /// DirectDraw color key definition.
 struct DDColorKey
 {
@@ -168,7 +201,7 @@ struct DDSurfaceDesc2
     unsigned dwTextureStage_;
 };
 
-bool CompressedLevel::Decompress(unsigned char* dest)
+bool CompressedLevel::Decompress(unsigned char* dest, WorkQueue* queue)
 {
     if (!data_)
         return false;
@@ -178,18 +211,18 @@ bool CompressedLevel::Decompress(unsigned char* dest)
     case CF_DXT1:
     case CF_DXT3:
     case CF_DXT5:
-        DecompressImageDXT(dest, data_, width_, height_, depth_, format_);
+        DecompressImageDXT(dest, data_, width_, height_, depth_, format_, queue);
         return true;
 
     case CF_ETC1:
-        DecompressImageETC(dest, data_, width_, height_);
+        DecompressImageETC(dest, data_, width_, height_, queue);
         return true;
 
     case CF_PVRTC_RGB_2BPP:
     case CF_PVRTC_RGBA_2BPP:
     case CF_PVRTC_RGB_4BPP:
     case CF_PVRTC_RGBA_4BPP:
-        DecompressImagePVRTC(dest, data_, width_, height_, format_);
+        DecompressImagePVRTC(dest, data_, width_, height_, format_, queue);
         return true;
 
     default:
@@ -198,6 +231,296 @@ bool CompressedLevel::Decompress(unsigned char* dest)
     }
 }
 
+#ifdef URHO3D_SSE
+/// Sum horizontally adjacent RGBA pixels widened to 16 bits. Each input holds two pixels, the result holds the two sums.
+static inline __m128i SumPixelPairs(__m128i pixels01, __m128i pixels23)
+{
+    return _mm_unpacklo_epi64(_mm_add_epi16(pixels01, _mm_srli_si128(pixels01, 8)),
+        _mm_add_epi16(pixels23, _mm_srli_si128(pixels23, 8)));
+}
+#endif
+
+/// Calculate a range of rows of a 2D mip level.
+static void CalculateMipRows(const unsigned char* pixelDataIn, unsigned char* pixelDataOut, int width, int widthOut,
+    unsigned components, int startY, int endY)
+{
+    switch (components)
+    {
+    case 1:
+        for (int y = startY; y < endY; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * width];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width];
+            unsigned char* out = &pixelDataOut[y * widthOut];
+
+            for (int x = 0; x < widthOut; ++x)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 1] +
+                                          inLower[x * 2] + inLower[x * 2 + 1]) >> 2);
+            }
+        }
+        break;
+
+    case 2:
+        for (int y = startY; y < endY; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * width * 2];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width * 2];
+            unsigned char* out = &pixelDataOut[y * widthOut * 2];
+
+            for (int x = 0; x < widthOut * 2; x += 2)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 2] +
+                                          inLower[x * 2] + inLower[x * 2 + 2]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 3] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 3]) >> 2);
+            }
+        }
+        break;
+
+    case 3:
+        for (int y = startY; y < endY; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * width * 3];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width * 3];
+            unsigned char* out = &pixelDataOut[y * widthOut * 3];
+
+            for (int x = 0; x < widthOut * 3; x += 3)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 3] +
+                                          inLower[x * 2] + inLower[x * 2 + 3]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 4] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 4]) >> 2);
+                out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 5] +
+                                              inLower[x * 2 + 2] + inLower[x * 2 + 5]) >> 2);
+            }
+        }
+        break;
+
+    case 4:
+        for (int y = startY; y < endY; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * width * 4];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width * 4];
+            unsigned char* out = &pixelDataOut[y * widthOut * 4];
+            int x = 0;
+
+#ifdef URHO3D_SSE
+            // Calculate four output pixels at a time. The sums are 16-bit so the result is identical to the scalar loop
+            __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= widthOut * 4; x += 16)
+            {
+                __m128i upper0 = _mm_loadu_si128((const __m128i*)&inUpper[x * 2]);
+                __m128i upper1 = _mm_loadu_si128((const __m128i*)&inUpper[x * 2 + 16]);
+                __m128i lower0 = _mm_loadu_si128((const __m128i*)&inLower[x * 2]);
+                __m128i lower1 = _mm_loadu_si128((const __m128i*)&inLower[x * 2 + 16]);
+                __m128i sum01 = SumPixelPairs(_mm_add_epi16(_mm_unpacklo_epi8(upper0, zero), _mm_unpacklo_epi8(lower0, zero)),
+                    _mm_add_epi16(_mm_unpackhi_epi8(upper0, zero), _mm_unpackhi_epi8(lower0, zero)));
+                __m128i sum23 = SumPixelPairs(_mm_add_epi16(_mm_unpacklo_epi8(upper1, zero), _mm_unpacklo_epi8(lower1, zero)),
+                    _mm_add_epi16(_mm_unpackhi_epi8(upper1, zero), _mm_unpackhi_epi8(lower1, zero)));
+                _mm_storeu_si128((__m128i*)&out[x], _mm_packus_epi16(_mm_srli_epi16(sum01, 2), _mm_srli_epi16(sum23, 2)));
+            }
+#endif
+
+            for (; x < widthOut * 4; x += 4)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 4] +
+                                          inLower[x * 2] + inLower[x * 2 + 4]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 5] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 5]) >> 2);
+                out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 6] +
+                                              inLower[x * 2 + 2] + inLower[x * 2 + 6]) >> 2);
+                out[x + 3] = (unsigned char)(((unsigned)inUpper[x * 2 + 3] + inUpper[x * 2 + 7] +
+                                              inLower[x * 2 + 3] + inLower[x * 2 + 7]) >> 2);
+            }
+        }
+        break;
+
+    default:
+        assert(false);  // Should never reach here
+        break;
+    }
+}
+
+/// Calculate a range of slices of a 3D mip level.
+static void CalculateMipSlices(const unsigned char* pixelDataIn, unsigned char* pixelDataOut, int width, int height, int widthOut,
+    int heightOut, unsigned components, int startZ, int endZ)
+{
+    switch (components)
+    {
+    case 1:
+        for (int z = startZ; z < endZ; ++z)
+        {
+            const unsigned char* inOuter = &pixelDataIn[(z * 2) * width * height];
+            const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width * height];
+
+            for (int y = 0; y < heightOut; ++y)
+            {
+                const unsigned char* inOuterUpper = &inOuter[(y * 2) * width];
+                const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width];
+                const unsigned char* inInnerUpper = &inInner[(y * 2) * width];
+                const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width];
+                unsigned char* out = &pixelDataOut[z * widthOut * heightOut + y * widthOut];
+
+                for (int x = 0; x < widthOut; ++x)
+                {
+                    out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 1] +
+                                              inOuterLower[x * 2] + inOuterLower[x * 2 + 1] +
+                                              inInnerUpper[x * 2] + inInnerUpper[x * 2 + 1] +
+                                              inInnerLower[x * 2] + inInnerLower[x * 2 + 1]) >> 3);
+                }
+            }
+        }
+        break;
+
+    case 2:
+        for (int z = startZ; z < endZ; ++z)
+        {
+            const unsigned char* inOuter = &pixelDataIn[(z * 2) * width * height * 2];
+            const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width * height * 2];
+
+            for (int y = 0; y < heightOut; ++y)
+            {
+                const unsigned char* inOuterUpper = &inOuter[(y * 2) * width * 2];
+                const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width * 2];
+                const unsigned char* inInnerUpper = &inInner[(y * 2) * width * 2];
+                const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width * 2];
+                unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 2 + y * widthOut * 2];
+
+                for (int x = 0; x < widthOut * 2; x += 2)
+                {
+                    out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 2] +
+                                              inOuterLower[x * 2] + inOuterLower[x * 2 + 2] +
+                                              inInnerUpper[x * 2] + inInnerUpper[x * 2 + 2] +
+                                              inInnerLower[x * 2] + inInnerLower[x * 2 + 2]) >> 3);
+                    out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 3] +
+                                                  inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 3] +
+                                                  inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 3] +
+                                                  inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 3]) >> 3);
+                }
+            }
+        }
+        break;
+
+    case 3:
+        for (int z = startZ; z < endZ; ++z)
+        {
+            const unsigned char* inOuter = &pixelDataIn[(z * 2) * width * height * 3];
+            const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width * height * 3];
+
+            for (int y = 0; y < heightOut; ++y)
+            {
+                const unsigned char* inOuterUpper = &inOuter[(y * 2) * width * 3];
+                const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width * 3];
+                const unsigned char* inInnerUpper = &inInner[(y * 2) * width * 3];
+                const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width * 3];
+                unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 3 + y * widthOut * 3];
+
+                for (int x = 0; x < widthOut * 3; x += 3)
+                {
+                    out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 3] +
+                                              inOuterLower[x * 2] + inOuterLower[x * 2 + 3] +
+                                              inInnerUpper[x * 2] + inInnerUpper[x * 2 + 3] +
+                                              inInnerLower[x * 2] + inInnerLower[x * 2 + 3]) >> 3);
+                    out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 4] +
+                                                  inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 4] +
+                                                  inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 4] +
+                                                  inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 4]) >> 3);
+                    out[x + 2] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 2] + inOuterUpper[x * 2 + 5] +
+                                                  inOuterLower[x * 2 + 2] + inOuterLower[x * 2 + 5] +
+                                                  inInnerUpper[x * 2 + 2] + inInnerUpper[x * 2 + 5] +
+                                                  inInnerLower[x * 2 + 2] + inInnerLower[x * 2 + 5]) >> 3);
+                }
+            }
+        }
+        break;
+
+    case 4:
+        for (int z = startZ; z < endZ; ++z)
+        {
+            const unsigned char* inOuter = &pixelDataIn[(z * 2) * width * height * 4];
+            const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width * height * 4];
+
+            for (int y = 0; y < heightOut; ++y)
+            {
+                const unsigned char* inOuterUpper = &inOuter[(y * 2) * width * 4];
+                const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width * 4];
+                const unsigned char* inInnerUpper = &inInner[(y * 2) * width * 4];
+                const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width * 4];
+                unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 4 + y * widthOut * 4];
+                int x = 0;
+
+#ifdef URHO3D_SSE
+                __m128i zero = _mm_setzero_si128();
+                const unsigned char* rows[4] = { inOuterUpper, inOuterLower, inInnerUpper, inInnerLower };
+                for (; x + 16 <= widthOut * 4; x += 16)
+                {
+                    __m128i sumLow0 = zero;
+                    __m128i sumHigh0 = zero;
+                    __m128i sumLow1 = zero;
+                    __m128i sumHigh1 = zero;
+                    for (unsigned i = 0; i < 4; ++i)
+                    {
+                        __m128i in0 = _mm_loadu_si128((const __m128i*)&rows[i][x * 2]);
+                        __m128i in1 = _mm_loadu_si128((const __m128i*)&rows[i][x * 2 + 16]);
+                        sumLow0 = _mm_add_epi16(sumLow0, _mm_unpacklo_epi8(in0, zero));
+                        sumHigh0 = _mm_add_epi16(sumHigh0, _mm_unpackhi_epi8(in0, zero));
+                        sumLow1 = _mm_add_epi16(sumLow1, _mm_unpacklo_epi8(in1, zero));
+                        sumHigh1 = _mm_add_epi16(sumHigh1, _mm_unpackhi_epi8(in1, zero));
+                    }
+                    __m128i sum01 = SumPixelPairs(sumLow0, sumHigh0);
+                    __m128i sum23 = SumPixelPairs(sumLow1, sumHigh1);
+                    _mm_storeu_si128((__m128i*)&out[x], _mm_packus_epi16(_mm_srli_epi16(sum01, 3), _mm_srli_epi16(sum23, 3)));
+                }
+#endif
+
+                for (; x < widthOut * 4; x += 4)
+                {
+                    out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 4] +
+                                              inOuterLower[x * 2] + inOuterLower[x * 2 + 4] +
+                                              inInnerUpper[x * 2] + inInnerUpper[x * 2 + 4] +
+                                              inInnerLower[x * 2] + inInnerLower[x * 2 + 4]) >> 3);
+                    out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 5] +
+                                                  inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 5] +
+                                                  inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 5] +
+                                                  inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 5]) >> 3);
+                    out[x + 2] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 2] + inOuterUpper[x * 2 + 6] +
+                                                  inOuterLower[x * 2 + 2] + inOuterLower[x * 2 + 6] +
+                                                  inInnerUpper[x * 2 + 2] + inInnerUpper[x * 2 + 6] +
+                                                  inInnerLower[x * 2 + 2] + inInnerLower[x * 2 + 6]) >> 3);
+                    out[x + 3] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 3] + inOuterUpper[x * 2 + 7] +
+                                                  inOuterLower[x * 2 + 3] + inOuterLower[x * 2 + 7] +
+                                                  inInnerUpper[x * 2 + 3] + inInnerUpper[x * 2 + 7] +
+                                                  inInnerLower[x * 2 + 3] + inInnerLower[x * 2 + 7]) >> 3);
+                }
+            }
+        }
+        break;
+
+    default:
+        assert(false);  // Should never reach here
+        break;
+    }
+}
+
+/// Calculate a range of rows (2D) or slices (3D) of a mip level.
+static void CalculateMipRange(const MipLevelWork& work)
+{
+    if (work.depth_ > 1)
+    {
+        CalculateMipSlices(work.pixelDataIn_, work.pixelDataOut_, work.width_, work.height_, work.widthOut_, work.heightOut_,
+            work.components_, work.start_, work.end_);
+    }
+    else
+        CalculateMipRows(work.pixelDataIn_, work.pixelDataOut_, work.width_, work.widthOut_, work.components_, work.start_, work.end_);
+}
+
+/// Calculate a mip level range in a worker thread.
+static void CalculateMipRangeWork(const WorkItem* item, unsigned threadIndex)
+{
+    CalculateMipRange(*reinterpret_cast<const MipLevelWork*>(item->start_));
+}
+
 Image::Image(Context* context) :
     Resource(context),
     width_(0),
@@ -1054,6 +1377,131 @@ bool Image::SaveJPG(const String& fileName, int quality) const
         return false;
 }
 
+bool Image::SaveDDS(const String& fileName) const
+{
+    PROFILE(SaveImageDDS);
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem && !fileSystem->CheckAccess(GetPath(fileName)))
+    {
+        LOGERROR("Access denied to " + fileName);
+        return false;
+    }
+
+    if (compressedFormat_ != CF_DXT1 && compressedFormat_ != CF_DXT3 && compressedFormat_ != CF_DXT5)
+    {
+        LOGERROR("Can only save DXT compressed image to DDS");
+        return false;
+    }
+
+    // The compressed levels are stored consecutively, so the data size is the end of the last level
+    CompressedLevel lastLevel = GetCompressedLevel(numCompressedLevels_ - 1);
+    if (!lastLevel.data_)
+        return false;
+    unsigned dataSize = (unsigned)(lastLevel.data_ + lastLevel.dataSize_ - data_.Get());
+    // Further cube map faces or array slices loaded from a DDS file follow the first surface, but are not described by the image
+    if (dataSize < GetMemoryUse())
+    {
+        LOGERROR("Can not save cube map or array image to DDS");
+        return false;
+    }
+
+    File outFile(context_, fileName, FILE_WRITE);
+    if (!outFile.IsOpen())
+        return false;
+
+    DDSurfaceDesc2 ddsd;
+    memset(&ddsd, 0, sizeof ddsd);
+    ddsd.dwSize_ = sizeof ddsd;
+    // Caps, height, width, pixel format, mip map count and linear size
+    ddsd.dwFlags_ = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    ddsd.dwHeight_ = (unsigned)height_;
+    ddsd.dwWidth_ = (unsigned)width_;
+    ddsd.dwLinearSize_ = GetCompressedLevel(0).dataSize_;
+    ddsd.dwMipMapCount_ = numCompressedLevels_;
+    ddsd.ddpfPixelFormat_.dwSize_ = sizeof ddsd.ddpfPixelFormat_;
+    ddsd.ddpfPixelFormat_.dwFlags_ = 0x4;
+    if (compressedFormat_ == CF_DXT1)
+        ddsd.ddpfPixelFormat_.dwFourCC_ = FOURCC_DXT1;
+    else if (compressedFormat_ == CF_DXT3)
+        ddsd.ddpfPixelFormat_.dwFourCC_ = FOURCC_DXT3;
+    else
+        ddsd.ddpfPixelFormat_.dwFourCC_ = FOURCC_DXT5;
+    // Texture, and complex + mip map if has several levels
+    ddsd.ddsCaps_.dwCaps_ = 0x1000;
+    if (numCompressedLevels_ > 1)
+        ddsd.ddsCaps_.dwCaps_ |= 0x8 | 0x400000;
+    // Volume texture: depth flag, complex and volume caps. The slices of each level are stored consecutively
+    if (depth_ > 1)
+    {
+        ddsd.dwFlags_ |= 0x800000;
+        ddsd.dwDepth_ = (unsigned)depth_;
+        ddsd.ddsCaps_.dwCaps_ |= 0x8;
+        ddsd.ddsCaps_.dwCaps2_ = 0x200000;
+    }
+
+    outFile.WriteFileID("DDS ");
+    outFile.Write(&ddsd, sizeof ddsd);
+    return outFile.Write(data_.Get(), dataSize) == dataSize;
+}
+
+bool Image::Compress(CompressedFormat format)
+{
+    PROFILE(CompressImage);
+
+    if (format != CF_DXT1 && format != CF_DXT3 && format != CF_DXT5)
+    {
+        LOGERROR("Unsupported image compression format");
+        return false;
+    }
+    if (IsCompressed())
+    {
+        LOGERROR("Image is already compressed");
+        return false;
+    }
+    if (depth_ > 1)
+    {
+        LOGERROR("Can not compress 3D image");
+        return false;
+    }
+
+    SharedPtr<Image> level = ConvertToRGBA();
+    if (!level)
+        return false;
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned blockSize = format == CF_DXT1 ? 8 : 16;
+    PODVector<unsigned char> compressedData;
+    unsigned numLevels = 0;
+
+    for (;;)
+    {
+        int levelWidth = level->GetWidth();
+        int levelHeight = level->GetHeight();
+        unsigned offset = compressedData.Size();
+        compressedData.Resize(offset + ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize);
+        CompressImageDXT(&compressedData[offset], level->GetData(), levelWidth, levelHeight, format, queue);
+        ++numLevels;
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+        level = level->GetNextLevel();
+        if (!level)
+            return false;
+    }
+
+    data_ = new unsigned char[compressedData.Size()];
+    memcpy(data_.Get(), &compressedData[0], compressedData.Size());
+    depth_ = 1;
+    components_ = format == CF_DXT1 ? 3 : 4;
+    compressedFormat_ = format;
+    numCompressedLevels_ = numLevels;
+    nextLevel_.Reset();
+    SetMemoryUse(compressedData.Size());
+
+    return true;
+}
+
 Color Image::GetPixel(int x, int y) const
 {
     return GetPixel(x, y, 0);
@@ -1255,217 +1703,50 @@ SharedPtr<Image> Image::GetNextLevel() const
             break;
         }
     }
-    // 2D case
-    else if (depth_ == 1)
-    {
-        switch (components_)
-        {
-        case 1:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_];
-                unsigned char* out = &pixelDataOut[y * widthOut];
-
-                for (int x = 0; x < widthOut; ++x)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 1] +
-                                              inLower[x * 2] + inLower[x * 2 + 1]) >> 2);
-                }
-            }
-            break;
-
-        case 2:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 2];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 2];
-                unsigned char* out = &pixelDataOut[y * widthOut * 2];
-
-                for (int x = 0; x < widthOut * 2; x += 2)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 2] +
-                                              inLower[x * 2] + inLower[x * 2 + 2]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 3] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 3]) >> 2);
-                }
-            }
-            break;
-
-        case 3:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 3];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 3];
-                unsigned char* out = &pixelDataOut[y * widthOut * 3];
-
-                for (int x = 0; x < widthOut * 3; x += 3)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 3] +
-                                              inLower[x * 2] + inLower[x * 2 + 3]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 4] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 5]) >> 2);
-                }
-            }
-            break;
-
-        case 4:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 4];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 4];
-                unsigned char* out = &pixelDataOut[y * widthOut * 4];
-
-                for (int x = 0; x < widthOut * 4; x += 4)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 4] +
-                                              inLower[x * 2] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 5]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 6] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 6]) >> 2);
-                    out[x + 3] = (unsigned char)(((unsigned)inUpper[x * 2 + 3] + inUpper[x * 2 + 7] +
-                                                  inLower[x * 2 + 3] + inLower[x * 2 + 7]) >> 2);
-                }
-            }
-            break;
-
-        default:
-            assert(false);  // Should never reach here
-            break;
-        }
-    }
-    // 3D case
+    // 2D and 3D cases
     else
     {
-        switch (components_)
+        MipLevelWork work;
+        work.pixelDataIn_ = pixelDataIn;
+        work.pixelDataOut_ = pixelDataOut;
+        work.width_ = width_;
+        work.height_ = height_;
+        work.depth_ = depth_;
+        work.widthOut_ = widthOut;
+        work.heightOut_ = heightOut;
+        work.components_ = components_;
+        work.start_ = 0;
+        work.end_ = depth_ > 1 ? depthOut : heightOut;
+
+        // When in the main thread, split a large level into bands of rows or slices for the worker threads. The background
+        // loading threads can not use the work queue, but they already process several images in parallel
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        int numBands = 1;
+        if (queue && queue->GetNumThreads() && Thread::IsMainThread() &&
+            (unsigned)(widthOut * heightOut * depthOut) >= MIN_PARALLEL_MIP_PIXELS)
+            numBands = Min((int)queue->GetNumThreads() + 1, work.end_);
+
+        if (numBands > 1)
         {
-        case 1:
-            for (int z = 0; z < depthOut; ++z)
-            {
-                const unsigned char* inOuter = &pixelDataIn[(z * 2) * width_ * height_];
-                const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width_ * height_];
-
-                for (int y = 0; y < heightOut; ++y)
-                {
-                    const unsigned char* inOuterUpper = &inOuter[(y * 2) * width_];
-                    const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width_];
-                    const unsigned char* inInnerUpper = &inInner[(y * 2) * width_];
-                    const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width_];
-                    unsigned char* out = &pixelDataOut[z * widthOut * heightOut + y * widthOut];
-
-                    for (int x = 0; x < widthOut; ++x)
-                    {
-                        out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 1] +
-                                                  inOuterLower[x * 2] + inOuterLower[x * 2 + 1] +
-                                                  inInnerUpper[x * 2] + inInnerUpper[x * 2 + 1] +
-                                                  inInnerLower[x * 2] + inInnerLower[x * 2 + 1]) >> 3);
-                    }
-                }
-            }
-            break;
-
-        case 2:
-            for (int z = 0; z < depthOut; ++z)
-            {
-                const unsigned char* inOuter = &pixelDataIn[(z * 2) * width_ * height_ * 2];
-                const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width_ * height_ * 2];
-
-                for (int y = 0; y < heightOut; ++y)
-                {
-                    const unsigned char* inOuterUpper = &inOuter[(y * 2) * width_ * 2];
-                    const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width_ * 2];
-                    const unsigned char* inInnerUpper = &inInner[(y * 2) * width_ * 2];
-                    const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width_ * 2];
-                    unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 2 + y * widthOut * 2];
-
-                    for (int x = 0; x < widthOut * 2; x += 2)
-                    {
-                        out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 2] +
-                                                  inOuterLower[x * 2] + inOuterLower[x * 2 + 2] +
-                                                  inInnerUpper[x * 2] + inInnerUpper[x * 2 + 2] +
-                                                  inInnerLower[x * 2] + inInnerLower[x * 2 + 2]) >> 3);
-                        out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 3] +
-                                                      inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 3] +
-                                                      inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 3] +
-                                                      inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 3]) >> 3);
-                    }
-                }
-            }
-            break;
-
-        case 3:
-            for (int z = 0; z < depthOut; ++z)
-            {
-                const unsigned char* inOuter = &pixelDataIn[(z * 2) * width_ * height_ * 3];
-                const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width_ * height_ * 3];
-
-                for (int y = 0; y < heightOut; ++y)
-                {
-                    const unsigned char* inOuterUpper = &inOuter[(y * 2) * width_ * 3];
-                    const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width_ * 3];
-                    const unsigned char* inInnerUpper = &inInner[(y * 2) * width_ * 3];
-                    const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width_ * 3];
-                    unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 3 + y * widthOut * 3];
-
-                    for (int x = 0; x < widthOut * 3; x += 3)
-                    {
-                        out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 3] +
-                                                  inOuterLower[x * 2] + inOuterLower[x * 2 + 3] +
-                                                  inInnerUpper[x * 2] + inInnerUpper[x * 2 + 3] +
-                                                  inInnerLower[x * 2] + inInnerLower[x * 2 + 3]) >> 3);
-                        out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 4] +
-                                                      inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 4] +
-                                                      inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 4] +
-                                                      inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 4]) >> 3);
-                        out[x + 2] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 2] + inOuterUpper[x * 2 + 5] +
-                                                      inOuterLower[x * 2 + 2] + inOuterLower[x * 2 + 5] +
-                                                      inInnerUpper[x * 2 + 2] + inInnerUpper[x * 2 + 5] +
-                                                      inInnerLower[x * 2 + 2] + inInnerLower[x * 2 + 5]) >> 3);
-                    }
-                }
-            }
-            break;
-
-        case 4:
-            for (int z = 0; z < depthOut; ++z)
+            PODVector<MipLevelWork> bands(numBands);
+            int bandSize = (work.end_ + numBands - 1) / numBands;
+            for (int i = 0; i < numBands; ++i)
             {
-                const unsigned char* inOuter = &pixelDataIn[(z * 2) * width_ * height_ * 4];
-                const unsigned char* inInner = &pixelDataIn[(z * 2 + 1) * width_ * height_ * 4];
-
-                for (int y = 0; y < heightOut; ++y)
-                {
-                    const unsigned char* inOuterUpper = &inOuter[(y * 2) * width_ * 4];
-                    const unsigned char* inOuterLower = &inOuter[(y * 2 + 1) * width_ * 4];
-                    const unsigned char* inInnerUpper = &inInner[(y * 2) * width_ * 4];
-                    const unsigned char* inInnerLower = &inInner[(y * 2 + 1) * width_ * 4];
-                    unsigned char* out = &pixelDataOut[z * widthOut * heightOut * 4 + y * widthOut * 4];
-
-                    for (int x = 0; x < widthOut * 4; x += 4)
-                    {
-                        out[x] = (unsigned char)(((unsigned)inOuterUpper[x * 2] + inOuterUpper[x * 2 + 4] +
-                                                  inOuterLower[x * 2] + inOuterLower[x * 2 + 4] +
-                                                  inInnerUpper[x * 2] + inInnerUpper[x * 2 + 4] +
-                                                  inInnerLower[x * 2] + inInnerLower[x * 2 + 4]) >> 3);
-                        out[x + 1] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 1] + inOuterUpper[x * 2 + 5] +
-                                                      inOuterLower[x * 2 + 1] + inOuterLower[x * 2 + 5] +
-                                                      inInnerUpper[x * 2 + 1] + inInnerUpper[x * 2 + 5] +
-                                                      inInnerLower[x * 2 + 1] + inInnerLower[x * 2 + 5]) >> 3);
-                        out[x + 2] = (unsigned char)(((unsigned)inOuterUpper[x * 2 + 2] + inOuterUpper[x * 2 + 6] +
-                                                      inOuterLower[x * 2 + 2] + inOuterLower[x * 2 + 6] +
-                                                      inInnerUpper[x * 2 + 2] + inInnerUpper[x * 2 + 6] +
-                                                      inInnerLower[x * 2 + 2] + inInnerLower[x * 2 + 6]) >> 3);
-                    }
-                }
+                bands[i] = work;
+                bands[i].start_ = Min(i * bandSize, work.end_);
+                bands[i].end_ = Min(bands[i].start_ + bandSize, work.end_);
+
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = M_MAX_UNSIGNED;
+                item->workFunction_ = CalculateMipRangeWork;
+                item->start_ = &bands[i];
+                queue->AddWorkItem(item);
             }
-            break;
 
-        default:
-            assert(false);  // Should never reach here
-            break;
+            queue->Complete(M_MAX_UNSIGNED);
         }
+        else
+            CalculateMipRange(work);
     }
 
     return mipImage;
@@ -1541,6 +1822,32 @@ SharedPtr<Image> Image::ConvertToRGBA() const
     return ret;
 }
 
+SharedPtr<Image> Image::GetDecompressedImage() const
+{
+    if (!IsCompressed())
+    {
+        LOGERROR("Image is not compressed");
+        return SharedPtr<Image>();
+    }
+
+    CompressedLevel level = GetCompressedLevel(0);
+    if (!level.data_)
+        return SharedPtr<Image>();
+
+    SharedPtr<Image> ret(new Image(context_));
+    ret->SetSize(level.width_, level.height_, level.depth_, 4);
+
+    if (compressedFormat_ == CF_RGBA)
+        memcpy(ret->GetData(), level.data_, level.dataSize_);
+    else if (!level.Decompress(ret->GetData(), GetSubsystem<WorkQueue>()))
+    {
+        LOGERROR("Failed to decompress image");
+        return SharedPtr<Image>();
+    }
+
+    return ret;
+}
+
 CompressedLevel Image::GetCompressedLevel(unsigned index) const
 {
     CompressedLevel level;
@@ -1875,6 +2182,14 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode directly from memory if possible
+    const unsigned char* data = source.GetDirectData();
+    if (data)
+    {
+        source.Seek(dataSize);
+        return stbi_load_from_memory(data, dataSize, &width, &height, (int*)&components, 0);
+    }
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int*)&components, 0);
@@ -30,6 +30,8 @@ struct SDL_Surface;
 namespace Urho3D
 {
 
+class WorkQueue;
+
 static const int COLOR_LUT_SIZE = 16;
 
 /// Supported compressed image formats.
@@ -63,8 +65,8 @@ struct CompressedLevel
     {
     }
 
-    /// Decompress to RGBA. The destination buffer required is width * height * 4 bytes. Return true if successful.
-    bool Decompress(unsigned char* dest);
+    /// Decompress to RGBA. The destination buffer required is width * height * depth * 4 bytes. If a work queue is given, a large level is decompressed in parallel when called from the main thread. Return true if successful.
+    bool Decompress(unsigned char* dest, WorkQueue* queue = 0);
 
     /// Compressed image data.
     unsigned char* data_;
@@ -138,6 +140,10 @@ public:
     bool SaveTGA(const String& fileName) const;
     /// Save in JPG format with compression quality. Return true if successful.
     bool SaveJPG(const String& fileName, int quality) const;
+    /// Save in DDS format. The image must be DXT compressed and can be a volume, but not a cube map or array. Return true if successful.
+    bool SaveDDS(const String& fileName) const;
+    /// Compress a 2D image to DXT1, DXT3 or DXT5 including the full mip chain. Return true if successful.
+    bool Compress(CompressedFormat format);
 
     /// Return a 2D pixel color.
     Color GetPixel(int x, int y) const;
@@ -182,6 +188,8 @@ public:
     SharedPtr<Image> ConvertToRGBA() const;
     /// Return a compressed mip level.
     CompressedLevel GetCompressedLevel(unsigned index) const;
+    /// Return the first mip level of a compressed image decompressed to RGBA, or null if failed.
+    SharedPtr<Image> GetDecompressedImage() const;
     /// Return subimage from the image by the defined rect or null if failed. 3D images are not supported. You must free the subimage yourself.
     Image* GetSubimage(const IntRect& rect) const;
     /// Return an SDL surface from the image, or null if failed. Only RGB images are supported. Specify rect to only return partial image. You must free the surface yourself.
@@ -32,6 +32,7 @@ namespace Urho3D
 Resource::Resource(Context* context) :
     Object(context),
     memoryUse_(0),
+    useCount_(0),
     asyncLoadState_(ASYNC_DONE)
 {
 }
@@ -71,6 +71,8 @@ public:
     void SetMemoryUse(unsigned size);
     /// Reset last used timer.
     void ResetUseTimer();
+    /// Increment the number of times the resource has been requested from the resource cache.
+    void IncrementUseCount() { ++useCount_; }
     /// Set the asynchronous loading state. Called by ResourceCache. Resources in the middle of asynchronous loading are not normally returned to user.
     void SetAsyncLoadState(AsyncLoadState newState);
 
@@ -86,6 +88,9 @@ public:
     /// Return time since last use in milliseconds. If referred to elsewhere than in the resource cache, returns always zero.
     unsigned GetUseTimer();
 
+    /// Return number of times the resource has been requested from the resource cache.
+    unsigned GetUseCount() const { return useCount_; }
+
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
 
@@ -98,6 +103,8 @@ private:
     Timer useTimer_;
     /// Memory use in bytes.
     unsigned memoryUse_;
+    /// Number of requests from the resource cache.
+    unsigned useCount_;
     /// Asynchronous loading state.
     AsyncLoadState asyncLoadState_;
 };
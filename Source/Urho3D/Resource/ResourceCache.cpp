@@ -26,6 +26,7 @@
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
 #include "../Core/WorkQueue.h"
+#include "../IO/AsyncIO.h"
 #include "../IO/FileSystem.h"
 #include "../IO/FileWatcher.h"
 #include "../IO/Log.h"
@@ -70,7 +71,12 @@ ResourceCache::ResourceCache(Context* context) :
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
-    finishBackgroundResourcesMs_(5)
+    memoryMapPackages_(false),
+    asyncFileReads_(true),
+    finishBackgroundResourcesMs_(5),
+    totalMemoryBudget_(0),
+    evictionPolicy_(EVICT_LRU),
+    loadTraceEnabled_(false)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
@@ -78,6 +84,11 @@ ResourceCache::ResourceCache(Context* context) :
     // Create resource background loader. Its thread will start on the first background request
     backgroundLoader_ = new BackgroundLoader(this);
 
+    // Use the asynchronous I/O subsystem if registered, otherwise create a private instance
+    asyncIO_ = GetSubsystem<AsyncIO>();
+    if (!asyncIO_)
+        asyncIO_ = new AsyncIO(context_);
+
     // Subscribe BeginFrame for handling directory watchers and background loaded resource finalization
     SubscribeToEvent(E_BEGINFRAME, HANDLER(ResourceCache, HandleBeginFrame));
 }
@@ -134,6 +145,10 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
     if (!package || !package->GetNumFiles())
         return false;
 
+    // If mapping fails, the package is still usable through regular file reads
+    if (memoryMapPackages_)
+        package->MapMemory();
+
     if (priority < packages_.Size())
         packages_.Insert(priority, SharedPtr<PackageFile>(package));
     else
@@ -428,6 +443,84 @@ void ResourceCache::SetMemoryBudget(StringHash type, unsigned budget)
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
+void ResourceCache::SetTotalMemoryBudget(unsigned budget)
+{
+    totalMemoryBudget_ = budget;
+    UpdateTotalMemoryBudget();
+}
+
+void ResourceCache::SetEvictionPolicy(ResourceEvictionPolicy policy)
+{
+    evictionPolicy_ = policy;
+}
+
+void ResourceCache::SetEvictionPriority(StringHash type, int priority)
+{
+    resourceGroups_[type].evictionPriority_ = priority;
+}
+
+void ResourceCache::SetResourcePinned(StringHash type, const String& name, bool enable)
+{
+    StringHash nameHash(SanitateResourceName(name));
+    if (enable)
+        resourceGroups_[type].pinnedResources_.Insert(nameHash);
+    else
+    {
+        HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
+        if (i != resourceGroups_.End())
+        {
+            i->second_.pinnedResources_.Erase(nameHash);
+            // The resource may have been kept over budget only due to being pinned
+            UpdateResourceGroup(type);
+        }
+    }
+}
+
+void ResourceCache::PrefetchResources(const ResourceRefList& resources, int priority)
+{
+    for (unsigned i = 0; i < resources.names_.Size(); ++i)
+    {
+        if (!resources.names_[i].Empty())
+            BackgroundLoadResource(resources.type_, resources.names_[i], true, 0, priority);
+    }
+}
+
+unsigned ResourceCache::EvictResources(const ResourceRefList& resources)
+{
+    HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(resources.type_);
+    if (i == resourceGroups_.End())
+        return 0;
+
+    unsigned released = 0;
+    for (unsigned j = 0; j < resources.names_.Size(); ++j)
+    {
+        StringHash nameHash(SanitateResourceName(resources.names_[j]));
+        HashMap<StringHash, SharedPtr<Resource> >::Iterator k = i->second_.resources_.Find(nameHash);
+        if (k == i->second_.resources_.End() || i->second_.pinnedResources_.Contains(nameHash))
+            continue;
+
+        if (k->second_.Refs() == 1 && k->second_.WeakRefs() == 0)
+        {
+            EvictResource(i->second_, k);
+            ++released;
+        }
+    }
+
+    if (released)
+        UpdateResourceGroup(resources.type_);
+    return released;
+}
+
+void ResourceCache::ResetStatistics()
+{
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        i->second_.hits_ = 0;
+        i->second_.misses_ = 0;
+        i->second_.evictions_ = 0;
+    }
+}
+
 void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
@@ -453,6 +546,129 @@ void ResourceCache::SetReturnFailedResources(bool enable)
     returnFailedResources_ = enable;
 }
 
+void ResourceCache::SetLoadTraceEnabled(bool enable)
+{
+    MutexLock lock(loadTraceMutex_);
+
+    if (enable && !loadTraceEnabled_)
+    {
+        loadRecords_.Clear();
+        loadTraceTimer_.Reset();
+    }
+
+    loadTraceEnabled_ = enable;
+}
+
+void ResourceCache::ClearLoadRecords()
+{
+    MutexLock lock(loadTraceMutex_);
+    loadRecords_.Clear();
+}
+
+void ResourceCache::AddLoadRecord(const ResourceLoadRecord& record)
+{
+    MutexLock lock(loadTraceMutex_);
+    if (loadTraceEnabled_)
+        loadRecords_.Push(record);
+}
+
+bool ResourceCache::SaveLoadRecordsCSV(Serializer& dest) const
+{
+    Vector<ResourceLoadRecord> records = GetLoadRecords();
+
+    bool success = dest.WriteLine("Type,Name,Requester,Thread,Background,Success,FileSize,RequestTime,IOWait,BeginLoadTime,"
+        "BeginLoadDuration,EndLoadTime,EndLoadDuration,TotalTime");
+
+    for (unsigned i = 0; i < records.Size() && success; ++i)
+    {
+        const ResourceLoadRecord& record = records[i];
+        String line = context_->GetTypeName(record.type_) + ",\"" + record.name_ + "\",\"" + record.requester_ + "\"," +
+            String(record.thread_) + "," + String((int)record.background_) + "," + String((int)record.success_) + "," +
+            String(record.fileSize_) + "," + String(record.requestTime_) + "," + String(record.ioWaitTime_) + "," +
+            String(record.beginLoadTime_) + "," + String(record.beginLoadDuration_) + "," + String(record.endLoadTime_) + "," +
+            String(record.endLoadDuration_) + "," + String(record.GetTotalTime());
+        success = dest.WriteLine(line);
+    }
+
+    return success;
+}
+
+/// Add a complete event to a Chrome trace event array.
+static void AddTraceEvent(JSONValue& events, const String& name, const String& category, unsigned thread, long long start,
+    long long duration, const ResourceLoadRecord& record)
+{
+    JSONValue event = events.CreateChild(JSON_OBJECT);
+    event.SetString("name", name);
+    event.SetString("cat", category);
+    event.SetString("ph", "X");
+    event.SetDouble("ts", (double)start);
+    event.SetDouble("dur", (double)duration);
+    event.SetInt("pid", 0);
+    event.SetInt("tid", thread);
+
+    JSONValue args = event.CreateChild("args", JSON_OBJECT);
+    args.SetString("requester", record.requester_);
+    args.SetInt("fileSize", record.fileSize_);
+    args.SetBool("success", record.success_);
+}
+
+bool ResourceCache::SaveLoadTrace(Serializer& dest) const
+{
+    Vector<ResourceLoadRecord> records = GetLoadRecords();
+
+    SharedPtr<JSONFile> file(new JSONFile(context_));
+    JSONValue root = file->CreateRoot();
+    JSONValue events = root.CreateChild("traceEvents", JSON_ARRAY);
+
+    unsigned numThreads = 1;
+    for (unsigned i = 0; i < records.Size(); ++i)
+    {
+        const ResourceLoadRecord& record = records[i];
+        const String& category = context_->GetTypeName(record.type_);
+
+        // I/O happens in the thread that executes BeginLoad()
+        if (record.ioWaitTime_ > 0)
+        {
+            AddTraceEvent(events, "Read " + record.name_, category, record.thread_, record.beginLoadTime_ - record.ioWaitTime_,
+                record.ioWaitTime_, record);
+        }
+        AddTraceEvent(events, (record.background_ ? "BeginLoad " : "Load ") + record.name_, category, record.thread_,
+            record.beginLoadTime_, record.beginLoadDuration_, record);
+        if (record.background_)
+        {
+            AddTraceEvent(events, "EndLoad " + record.name_, category, 0, record.endLoadTime_, record.endLoadDuration_,
+                record);
+        }
+
+        if (record.thread_ + 1 > numThreads)
+            numThreads = record.thread_ + 1;
+    }
+
+    // Name the threads
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        JSONValue event = events.CreateChild(JSON_OBJECT);
+        event.SetString("name", "thread_name");
+        event.SetString("ph", "M");
+        event.SetInt("pid", 0);
+        event.SetInt("tid", i);
+        JSONValue args = event.CreateChild("args", JSON_OBJECT);
+        args.SetString("name", i ? "Background loader " + String(i) : String("Main thread"));
+    }
+
+    return file->Save(dest);
+}
+
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+    backgroundLoader_->SetNumThreads(num);
+}
+
+void ResourceCache::SetMaxConcurrentBackgroundLoads(StringHash type, unsigned num)
+{
+    backgroundLoader_->SetMaxConcurrentLoads(type, num);
+}
+
 SharedPtr<File> ResourceCache::GetFile(const String& nameIn, bool sendEventOnFailure)
 {
     MutexLock lock(resourceMutex_);
@@ -502,6 +718,34 @@ SharedPtr<File> ResourceCache::GetFile(const String& nameIn, bool sendEventOnFai
     return SharedPtr<File>();
 }
 
+SharedPtr<AsyncReadRequest> ResourceCache::ReadFileAsync(const String& nameIn, int priority)
+{
+    MutexLock lock(resourceMutex_);
+
+    String name = SanitateResourceName(nameIn);
+    if (resourceRouter_)
+        resourceRouter_->Route(name, RESOURCE_GETFILE);
+
+    SharedPtr<AsyncReadRequest> request;
+    if (name.Length())
+    {
+        if (searchPackagesFirst_)
+        {
+            request = SearchPackagesAsync(name, priority);
+            if (!request)
+                request = SearchResourceDirsAsync(name, priority);
+        }
+        else
+        {
+            request = SearchResourceDirsAsync(name, priority);
+            if (!request)
+                request = SearchPackagesAsync(name, priority);
+        }
+    }
+
+    return request;
+}
+
 Resource* ResourceCache::GetExistingResource(StringHash type, const String& nameIn)
 {
     String name = SanitateResourceName(nameIn);
@@ -519,6 +763,11 @@ Resource* ResourceCache::GetExistingResource(StringHash type, const String& name
     StringHash nameHash(name);
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
+    if (existing)
+    {
+        existing->IncrementUseCount();
+        ++resourceGroups_[type].hits_;
+    }
     return existing;
 }
 
@@ -543,7 +792,11 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        existing->IncrementUseCount();
+        ++resourceGroups_[type].hits_;
         return existing;
+    }
 
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
@@ -565,14 +818,46 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     }
 
     // Attempt to load the resource
+    ++resourceGroups_[type].misses_;
+    bool traced = loadTraceEnabled_;
+    ResourceLoadRecord record;
+    if (traced)
+    {
+        record.type_ = type;
+        record.name_ = name;
+        record.requester_ = GetLoadRequesterName();
+        record.requestTime_ = GetLoadTraceTime();
+    }
+
     SharedPtr<File> file = GetFile(name, sendEventOnFailure);
     if (!file)
         return 0;   // Error is already logged
 
     LOGDEBUG("Loading resource " + name);
     resource->SetName(name);
+    resource->IncrementUseCount();
 
-    if (!resource->Load(*(file.Get())))
+    bool success;
+    if (traced)
+    {
+        record.beginLoadTime_ = GetLoadTraceTime();
+        record.ioWaitTime_ = record.beginLoadTime_ - record.requestTime_;
+        record.fileSize_ = file->GetSize();
+
+        // Resources requested during the load are its dependencies
+        loadingResources_.Push(resource);
+        success = resource->Load(*(file.Get()));
+        loadingResources_.Pop();
+
+        record.endLoadTime_ = GetLoadTraceTime();
+        record.beginLoadDuration_ = record.endLoadTime_ - record.beginLoadTime_;
+        record.success_ = success;
+        AddLoadRecord(record);
+    }
+    else
+        success = resource->Load(*(file.Get()));
+
+    if (!success)
     {
         // Error should already been logged by corresponding resource descendant class
         if (sendEventOnFailure)
@@ -596,7 +881,8 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller,
+    int priority)
 {
     // If empty name, fail immediately
     String name = SanitateResourceName(nameIn);
@@ -608,7 +894,13 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
+    if (!backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller, priority))
+        return false;
+
+    // Statistics are only updated from the main thread. Background loads queued from BeginLoad() are not counted
+    if (Thread::IsMainThread())
+        ++resourceGroups_[type].misses_;
+    return true;
 }
 
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
@@ -669,6 +961,16 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
     return backgroundLoader_->GetNumQueuedResources();
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+    return backgroundLoader_->GetNumThreads();
+}
+
+unsigned ResourceCache::GetMaxConcurrentBackgroundLoads(StringHash type) const
+{
+    return backgroundLoader_->GetMaxConcurrentLoads(type);
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
@@ -729,6 +1031,72 @@ unsigned ResourceCache::GetTotalMemoryUse() const
     return total;
 }
 
+int ResourceCache::GetEvictionPriority(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.evictionPriority_ : 0;
+}
+
+Vector<ResourceLoadRecord> ResourceCache::GetLoadRecords() const
+{
+    MutexLock lock(loadTraceMutex_);
+    return loadRecords_;
+}
+
+unsigned ResourceCache::GetNumLoadRecords() const
+{
+    MutexLock lock(loadTraceMutex_);
+    return loadRecords_.Size();
+}
+
+bool ResourceCache::IsResourcePinned(StringHash type, const String& name) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.pinnedResources_.Contains(StringHash(SanitateResourceName(name))) : false;
+}
+
+unsigned ResourceCache::GetNumHits(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.hits_ : 0;
+}
+
+unsigned ResourceCache::GetNumMisses(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.misses_ : 0;
+}
+
+unsigned ResourceCache::GetNumEvictions(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.evictions_ : 0;
+}
+
+unsigned ResourceCache::GetTotalNumHits() const
+{
+    unsigned total = 0;
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        total += i->second_.hits_;
+    return total;
+}
+
+unsigned ResourceCache::GetTotalNumMisses() const
+{
+    unsigned total = 0;
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        total += i->second_.misses_;
+    return total;
+}
+
+unsigned ResourceCache::GetTotalNumEvictions() const
+{
+    unsigned total = 0;
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        total += i->second_.evictions_;
+    return total;
+}
+
 String ResourceCache::GetResourceFileName(const String& name) const
 {
     MutexLock lock(resourceMutex_);
@@ -919,40 +1287,98 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     if (i == resourceGroups_.End())
         return;
 
-    for (;;)
+    unsigned totalSize = 0;
+    for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+         j != i->second_.resources_.End(); ++j)
+        totalSize += j->second_->GetMemoryUse();
+    i->second_.memoryUse_ = totalSize;
+
+    // If memory budget defined and is exceeded, release resources according to the eviction policy
+    while (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_)
     {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
+        HashMap<StringHash, SharedPtr<Resource> >::Iterator candidate = FindEvictionCandidate(i->second_);
+        if (candidate == i->second_.resources_.End())
+            break;
 
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
-             j != i->second_.resources_.End(); ++j)
+        LOGDEBUG("Resource group " + candidate->second_->GetTypeName() + " over memory budget, releasing resource " +
+                 candidate->second_->GetName());
+        EvictResource(i->second_, candidate);
+    }
+
+    UpdateTotalMemoryBudget();
+}
+
+void ResourceCache::UpdateTotalMemoryBudget()
+{
+    if (!totalMemoryBudget_)
+        return;
+
+    unsigned totalMemoryUse = GetTotalMemoryUse();
+    while (totalMemoryUse > totalMemoryBudget_)
+    {
+        // Release from the lowest priority group first, then choose the best candidate among groups of equal priority
+        ResourceGroup* bestGroup = 0;
+        HashMap<StringHash, SharedPtr<Resource> >::Iterator bestCandidate;
+
+        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
         {
-            totalSize += j->second_->GetMemoryUse();
-            unsigned useTimer = j->second_->GetUseTimer();
-            if (useTimer > oldestTimer)
+            if (bestGroup && i->second_.evictionPriority_ > bestGroup->evictionPriority_)
+                continue;
+
+            HashMap<StringHash, SharedPtr<Resource> >::Iterator candidate = FindEvictionCandidate(i->second_);
+            if (candidate == i->second_.resources_.End())
+                continue;
+
+            if (!bestGroup || i->second_.evictionPriority_ < bestGroup->evictionPriority_ ||
+                IsBetterEvictionCandidate(candidate->second_, bestCandidate->second_))
             {
-                oldestTimer = useTimer;
-                oldestResource = j;
+                bestGroup = &i->second_;
+                bestCandidate = candidate;
             }
         }
 
-        i->second_.memoryUse_ = totalSize;
-
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_ &&
-            oldestResource != i->second_.resources_.End())
-        {
-            LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
-                     oldestResource->second_->GetName());
-            i->second_.resources_.Erase(oldestResource);
-        }
-        else
+        // Resources in use or pinned can not be released
+        if (!bestGroup)
             break;
+
+        LOGDEBUG("Resource cache over total memory budget, releasing resource " + bestCandidate->second_->GetName());
+        totalMemoryUse -= bestCandidate->second_->GetMemoryUse();
+        EvictResource(*bestGroup, bestCandidate);
     }
 }
 
+HashMap<StringHash, SharedPtr<Resource> >::Iterator ResourceCache::FindEvictionCandidate(ResourceGroup& group)
+{
+    HashMap<StringHash, SharedPtr<Resource> >::Iterator best = group.resources_.End();
+
+    for (HashMap<StringHash, SharedPtr<Resource> >::Iterator i = group.resources_.Begin(); i != group.resources_.End(); ++i)
+    {
+        // Resources in use always return a zero timer and can not be released
+        if (!i->second_->GetUseTimer() || group.pinnedResources_.Contains(i->first_))
+            continue;
+
+        if (best == group.resources_.End() || IsBetterEvictionCandidate(i->second_, best->second_))
+            best = i;
+    }
+
+    return best;
+}
+
+bool ResourceCache::IsBetterEvictionCandidate(Resource* first, Resource* second)
+{
+    if (evictionPolicy_ == EVICT_LFU && first->GetUseCount() != second->GetUseCount())
+        return first->GetUseCount() < second->GetUseCount();
+    else
+        return first->GetUseTimer() > second->GetUseTimer();
+}
+
+void ResourceCache::EvictResource(ResourceGroup& group, HashMap<StringHash, SharedPtr<Resource> >::Iterator resource)
+{
+    group.memoryUse_ -= resource->second_->GetMemoryUse();
+    ++group.evictions_;
+    group.resources_.Erase(resource);
+}
+
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     for (unsigned i = 0; i < fileWatchers_.Size(); ++i)
@@ -1012,6 +1438,44 @@ File* ResourceCache::SearchPackages(const String& nameIn)
     return 0;
 }
 
+SharedPtr<AsyncReadRequest> ResourceCache::SearchResourceDirsAsync(const String& nameIn, int priority)
+{
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    {
+        if (fileSystem->FileExists(resourceDirs_[i] + nameIn))
+        {
+            // Rename the request similarly to SearchResourceDirs()
+            SharedPtr<AsyncReadRequest> request = asyncIO_->ReadFile(resourceDirs_[i] + nameIn, priority);
+            if (request)
+                request->SetName(nameIn);
+            return request;
+        }
+    }
+
+    // Fallback using absolute path
+    return asyncIO_->ReadFile(nameIn, priority);
+}
+
+SharedPtr<AsyncReadRequest> ResourceCache::SearchPackagesAsync(const String& nameIn, int priority)
+{
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+    {
+        if (packages_[i]->Exists(nameIn))
+            return asyncIO_->ReadPackageFile(packages_[i], nameIn, priority);
+    }
+
+    return SharedPtr<AsyncReadRequest>();
+}
+
+String ResourceCache::GetLoadRequesterName() const
+{
+    if (loadingResources_.Empty() || !Thread::IsMainThread())
+        return String::EMPTY;
+    else
+        return loadingResources_.Back()->GetName();
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
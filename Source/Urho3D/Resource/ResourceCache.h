@@ -25,12 +25,15 @@
 #include "../Container/HashSet.h"
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
+#include "../Core/Timer.h"
 #include "../IO/File.h"
 #include "../Resource/Resource.h"
 
 namespace Urho3D
 {
 
+class AsyncIO;
+class AsyncReadRequest;
 class BackgroundLoader;
 class FileWatcher;
 class PackageFile;
@@ -38,13 +41,26 @@ class PackageFile;
 /// Sets to priority so that a package or file is pushed to the end of the vector.
 static const unsigned PRIORITY_LAST = 0xffffffff;
 
+/// Policy for choosing which unused resource to release when over a memory budget.
+enum ResourceEvictionPolicy
+{
+    /// Release the least recently used resource.
+    EVICT_LRU = 0,
+    /// Release the least frequently requested resource. Ties are broken by least recent use.
+    EVICT_LFU
+};
+
 /// Container of resources with specific type.
 struct ResourceGroup
 {
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        evictionPriority_(0),
+        hits_(0),
+        misses_(0),
+        evictions_(0)
     {
     }
 
@@ -52,8 +68,67 @@ struct ResourceGroup
     unsigned memoryBudget_;
     /// Current memory use.
     unsigned memoryUse_;
+    /// Eviction priority when over the total memory budget. Groups with lower priority are released from first.
+    int evictionPriority_;
+    /// Number of requests for already loaded resources.
+    unsigned hits_;
+    /// Number of requests which required loading the resource.
+    unsigned misses_;
+    /// Number of resources released due to memory budgets.
+    unsigned evictions_;
     /// Resources.
     HashMap<StringHash, SharedPtr<Resource> > resources_;
+    /// Resources which are never released due to memory budgets.
+    HashSet<StringHash> pinnedResources_;
+};
+
+/// Timing record of a resource load, collected when load tracing is enabled. Times are in microseconds since the trace was enabled.
+struct ResourceLoadRecord
+{
+    /// Construct with defaults.
+    ResourceLoadRecord() :
+        fileSize_(0),
+        requestTime_(0),
+        ioWaitTime_(0),
+        beginLoadTime_(0),
+        beginLoadDuration_(0),
+        endLoadTime_(0),
+        endLoadDuration_(0),
+        thread_(0),
+        background_(false),
+        success_(false)
+    {
+    }
+
+    /// Return time from the request until the resource was finished.
+    long long GetTotalTime() const { return endLoadTime_ + endLoadDuration_ - requestTime_; }
+
+    /// Resource type.
+    StringHash type_;
+    /// Resource name.
+    String name_;
+    /// Name of the resource that requested this resource as a dependency, empty if requested directly.
+    String requester_;
+    /// Size of the resource file in bytes.
+    unsigned fileSize_;
+    /// Time the resource was requested or queued for background loading.
+    long long requestTime_;
+    /// Time spent opening the resource file, or waiting for its asynchronous read to complete.
+    long long ioWaitTime_;
+    /// Time BeginLoad() started.
+    long long beginLoadTime_;
+    /// Duration of BeginLoad(). For a synchronous load, includes EndLoad() and loading of dependencies.
+    long long beginLoadDuration_;
+    /// Time EndLoad() started in the main thread. For a synchronous load, the time the load finished.
+    long long endLoadTime_;
+    /// Duration of EndLoad() in the main thread. Zero for a synchronous load.
+    long long endLoadDuration_;
+    /// Thread that executed BeginLoad(): 0 is the main thread and 1 onwards the background loader threads.
+    unsigned thread_;
+    /// Whether was background loaded.
+    bool background_;
+    /// Whether loaded successfully.
+    bool success_;
 };
 
 /// Resource request types.
@@ -82,6 +157,8 @@ class URHO3D_API ResourceCache : public Object
 {
     OBJECT(ResourceCache);
 
+    friend class BackgroundLoader;
+
 public:
     /// Construct.
     ResourceCache(Context* context);
@@ -118,30 +195,68 @@ public:
     void ReloadResourceWithDependencies(const String& fileName);
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     void SetMemoryBudget(StringHash type, unsigned budget);
+    /// Set memory budget for all resources, default 0 is unlimited.
+    void SetTotalMemoryBudget(unsigned budget);
+    /// Set policy for choosing the resource to release when over a memory budget. Default LRU.
+    void SetEvictionPolicy(ResourceEvictionPolicy policy);
+    /// Set eviction priority of a resource type for the total memory budget. Resources of lower priority types are released first. Default 0.
+    void SetEvictionPriority(StringHash type, int priority);
+    /// Pin or unpin a resource, which may also be done before it is loaded. Pinned resources are not released due to memory budgets.
+    void SetResourcePinned(StringHash type, const String& name, bool enable);
+    /// Queue background loading of the resources which are not yet loaded. For example a streaming system can call this ahead of needing a level region.
+    void PrefetchResources(const ResourceRefList& resources, int priority = 0);
+    /// Release resources which are not in use and not pinned. Return number of resources released.
+    unsigned EvictResources(const ResourceRefList& resources);
+    /// Reset hit, miss and eviction statistics.
+    void ResetStatistics();
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
     void SetReturnFailedResources(bool enable);
+    /// Enable or disable collecting timing records of resource loads. Enabling clears the previous records and restarts the trace clock. Default false.
+    void SetLoadTraceEnabled(bool enable);
+    /// Clear the collected load records.
+    void ClearLoadRecords();
+    /// Add a load record. Called by the cache and the background loader, or by custom loading code. Ignored if load tracing is disabled. Can be called from outside the main thread.
+    void AddLoadRecord(const ResourceLoadRecord& record);
+    /// Save the collected load records as comma-separated values. Return true if successful.
+    bool SaveLoadRecordsCSV(Serializer& dest) const;
+    /// Save the collected load records in the Chrome trace event JSON format, which can be viewed in chrome://tracing. Return true if successful.
+    bool SaveLoadTrace(Serializer& dest) const;
 
     /// Define whether when getting resources should check package files or directories first. True for packages, false for directories.
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
+    /// Enable or disable mapping package files into memory when they are added, so that files are read from them without copying where possible. Default false.
+    void SetMemoryMapPackages(bool enable) { memoryMapPackages_ = enable; }
+    /// Enable or disable reading resource files asynchronously when they are queued for background loading. Default true.
+    void SetAsyncFileReads(bool enable) { asyncFileReads_ = enable; }
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of background loading threads. Default is the number of physical CPU cores minus one, but at least one.
+    void SetNumBackgroundLoadThreads(unsigned num);
+    /// Set maximum number of resources of a type that are background loaded concurrently. 0 is unlimited (default.)
+    void SetMaxConcurrentBackgroundLoads(StringHash type, unsigned num);
 
     /// Set the resource router object. By default there is none, so the routing process is skipped.
     void SetResourceRouter(ResourceRouter* router) { resourceRouter_ = router; }
 
     /// Open and return a file from the resource load paths or from inside a package file. If not found, use a fallback search with absolute path. Return null if fails. Can be called from outside the main thread.
     SharedPtr<File> GetFile(const String& name, bool sendEventOnFailure = true);
+    /// Queue an asynchronous read of a file from the resource load paths or from inside a package file, using the same search order as GetFile(). Return null if not found. Can be called from outside the main thread.
+    SharedPtr<AsyncReadRequest> ReadFileAsync(const String& name, int priority = 0);
     /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread.
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    /// Background load a resource. Resources with higher priority are loaded first. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0, int priority = 0);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Return number of background loading threads.
+    unsigned GetNumBackgroundLoadThreads() const;
+    /// Return maximum number of concurrently background loaded resources of a type, 0 if unlimited.
+    unsigned GetMaxConcurrentBackgroundLoads(StringHash type) const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist.
@@ -163,7 +278,7 @@ public:
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const String& name, bool sendEventOnFailure = true);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0, int priority = 0);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
     /// Return whether a file exists by name.
@@ -174,6 +289,26 @@ public:
     unsigned GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
     unsigned GetTotalMemoryUse() const;
+    /// Return memory budget for all resources.
+    unsigned GetTotalMemoryBudget() const { return totalMemoryBudget_; }
+    /// Return eviction policy.
+    ResourceEvictionPolicy GetEvictionPolicy() const { return evictionPolicy_; }
+    /// Return eviction priority of a resource type.
+    int GetEvictionPriority(StringHash type) const;
+    /// Return whether a resource is pinned.
+    bool IsResourcePinned(StringHash type, const String& name) const;
+    /// Return number of requests for already loaded resources of a type.
+    unsigned GetNumHits(StringHash type) const;
+    /// Return number of requests which required loading a resource of a type.
+    unsigned GetNumMisses(StringHash type) const;
+    /// Return number of resources of a type released due to memory budgets or by EvictResources().
+    unsigned GetNumEvictions(StringHash type) const;
+    /// Return number of requests for already loaded resources of all types.
+    unsigned GetTotalNumHits() const;
+    /// Return number of requests which required loading a resource, for all types.
+    unsigned GetTotalNumMisses() const;
+    /// Return number of resources of all types released due to memory budgets or by EvictResources().
+    unsigned GetTotalNumEvictions() const;
     /// Return full absolute file name of resource if possible.
     String GetResourceFileName(const String& name) const;
 
@@ -186,12 +321,28 @@ public:
     /// Return whether when getting resources should check package files or directories first.
     bool GetSearchPackagesFirst() const { return searchPackagesFirst_; }
 
+    /// Return whether package files are mapped into memory when added.
+    bool GetMemoryMapPackages() const { return memoryMapPackages_; }
+
+    /// Return whether resource files are read asynchronously when queued for background loading.
+    bool GetAsyncFileReads() const { return asyncFileReads_; }
+
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
 
     /// Return the resource router.
     ResourceRouter* GetResourceRouter() const { return resourceRouter_; }
 
+    /// Return whether load tracing is enabled.
+    bool IsLoadTraceEnabled() const { return loadTraceEnabled_; }
+
+    /// Return a copy of the collected load records. Can be called from outside the main thread.
+    Vector<ResourceLoadRecord> GetLoadRecords() const;
+    /// Return number of collected load records.
+    unsigned GetNumLoadRecords() const;
+    /// Return microseconds since load tracing was enabled. Can be called from outside the main thread.
+    long long GetLoadTraceTime() const { return loadTraceTimer_.GetUSec(false); }
+
     /// Return either the path itself or its parent, based on which of them has recognized resource subdirectories.
     String GetPreferredResourceDir(const String& path) const;
     /// Remove unsupported constructs from the resource name to prevent ambiguity, and normalize absolute filename to resource path relative if possible.
@@ -212,12 +363,26 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Release resources of any type while over the total memory budget.
+    void UpdateTotalMemoryBudget();
+    /// Return the best resource to release from a group according to the eviction policy, or end iterator if none can be released.
+    HashMap<StringHash, SharedPtr<Resource> >::Iterator FindEvictionCandidate(ResourceGroup& group);
+    /// Return whether the first resource should be released before the second according to the eviction policy.
+    bool IsBetterEvictionCandidate(Resource* first, Resource* second);
+    /// Release a resource due to a memory budget.
+    void EvictResource(ResourceGroup& group, HashMap<StringHash, SharedPtr<Resource> >::Iterator resource);
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const String& nameIn);
     /// Search resource packages for file.
     File* SearchPackages(const String& nameIn);
+    /// Search FileSystem for file and queue an asynchronous read.
+    SharedPtr<AsyncReadRequest> SearchResourceDirsAsync(const String& nameIn, int priority);
+    /// Search resource packages for file and queue an asynchronous read.
+    SharedPtr<AsyncReadRequest> SearchPackagesAsync(const String& nameIn, int priority);
+    /// Return name of the resource being loaded or finished in the main thread, which is the requester of any resources it loads. Empty if none or not called from the main thread.
+    String GetLoadRequesterName() const;
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -235,14 +400,34 @@ private:
     SharedPtr<BackgroundLoader> backgroundLoader_;
     /// Resource router.
     SharedPtr<ResourceRouter> resourceRouter_;
+    /// Asynchronous file I/O subsystem.
+    SharedPtr<AsyncIO> asyncIO_;
     /// Automatic resource reloading flag.
     bool autoReloadResources_;
     /// Return failed resources flag.
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Memory map package files flag.
+    bool memoryMapPackages_;
+    /// Asynchronous file reads flag.
+    bool asyncFileReads_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Memory budget for all resources.
+    unsigned totalMemoryBudget_;
+    /// Eviction policy.
+    ResourceEvictionPolicy evictionPolicy_;
+    /// Mutex for thread-safe access to the load records.
+    mutable Mutex loadTraceMutex_;
+    /// Collected load records.
+    Vector<ResourceLoadRecord> loadRecords_;
+    /// Load trace clock.
+    mutable HiresTimer loadTraceTimer_;
+    /// Resources being loaded or finished in the main thread, innermost last.
+    PODVector<Resource*> loadingResources_;
+    /// Load tracing flag.
+    bool loadTraceEnabled_;
 };
 
 template <class T> T* ResourceCache::GetExistingResource(const String& name)
@@ -263,10 +448,10 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& nam
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller, int priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
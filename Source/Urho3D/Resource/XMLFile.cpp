@@ -89,11 +89,20 @@ bool XMLFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
-        return false;
+    // Parse directly from memory if possible, otherwise read into a temporary buffer first
+    SharedArrayPtr<char> buffer;
+    const char* data = (const char*)source.GetDirectData();
+    if (data && !source.GetPosition())
+        source.Seek(dataSize);
+    else
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.Get(), dataSize) != dataSize)
+            return false;
+        data = buffer.Get();
+    }
 
-    if (!document_->load_buffer(buffer.Get(), dataSize))
+    if (!document_->load_buffer(data, dataSize))
     {
         LOGERROR("Could not parse XML data from " + source.GetName());
         document_->reset();
@@ -67,7 +67,8 @@ void AttributeAnimationInfo::ApplyValue(const Variant& newValue)
 
 Animatable::Animatable(Context* context) :
     Serializable(context),
-    animationEnabled_(true)
+    animationEnabled_(true),
+    animatedIndex_(M_MAX_UNSIGNED)
 {
 }
 
@@ -87,7 +88,13 @@ bool Animatable::LoadXML(const XMLElement& source, bool setInstanceDefault)
         return false;
 
     SetObjectAnimation(0);
-    attributeAnimationInfos_.Clear();
+    if (!attributeAnimationInfos_.Empty())
+    {
+        attributeAnimationInfos_.Clear();
+        animatedNetworkAttributes_.Clear();
+        // Let the scene drop its references to the destroyed animation instances
+        OnAttributeAnimationRemoved();
+    }
 
     XMLElement elem = source.GetChild("objectanimation");
     if (elem)
@@ -237,8 +244,8 @@ void Animatable::SetAttributeAnimation(const String& name, ValueAnimation* attri
 
         attributeAnimationInfos_[name] = new AttributeAnimationInfo(this, *attributeInfo, attributeAnimation, wrapMode, speed);
 
-        if (!info)
-            OnAttributeAnimationAdded();
+        // Notify also when replacing, as the previous animation instance was destroyed
+        OnAttributeAnimationAdded();
     }
     else
     {
@@ -64,6 +64,8 @@ class URHO3D_API Animatable : public Serializable
 {
     OBJECT(Animatable);
 
+    friend class Scene;
+
 public:
     /// Construct.
     Animatable(Context* context);
@@ -101,6 +103,8 @@ public:
     WrapMode GetAttributeAnimationWrapMode(const String& name) const;
     /// Return attribute animation speed.
     float GetAttributeAnimationSpeed(const String& name) const;
+    /// Return number of attribute animations.
+    unsigned GetNumAttributeAnimations() const { return attributeAnimationInfos_.Size(); }
 
     /// Set object animation attribute.
     void SetObjectAnimationAttr(const ResourceRef& value);
@@ -138,6 +142,8 @@ protected:
     HashSet<const AttributeInfo*> animatedNetworkAttributes_;
     /// Attribute animation infos.
     HashMap<String, SharedPtr<AttributeAnimationInfo> > attributeAnimationInfos_;
+    /// Index in the scene's list of objects with attribute animations, or M_MAX_UNSIGNED if not listed.
+    unsigned animatedIndex_;
 };
 
 }
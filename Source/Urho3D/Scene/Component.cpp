@@ -37,6 +37,8 @@ Component::Component(Context* context) :
     Animatable(context),
     node_(0),
     id_(0),
+    sceneTypeIndex_(M_MAX_UNSIGNED),
+    contentHash_(0),
     networkUpdate_(false),
     enabled_(true)
 {
@@ -204,14 +206,16 @@ void Component::CleanupConnection(Connection* connection)
 
 void Component::OnAttributeAnimationAdded()
 {
-    if (attributeAnimationInfos_.Size() == 1)
-        SubscribeToEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE, HANDLER(Component, HandleAttributeAnimationUpdate));
+    Scene* scene = GetScene();
+    if (scene)
+        scene->AttributeAnimationsChanged(this);
 }
 
 void Component::OnAttributeAnimationRemoved()
 {
-    if (attributeAnimationInfos_.Empty())
-        UnsubscribeFromEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE);
+    Scene* scene = GetScene();
+    if (scene)
+        scene->AttributeAnimationsChanged(this);
 }
 
 void Component::OnNodeSet(Node* node)
@@ -258,11 +262,4 @@ void Component::GetComponents(PODVector<Component*>& dest, StringHash type) cons
     else
         dest.Clear();
 }
-
-void Component::HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace AttributeAnimationUpdate;
-
-    UpdateAttributeAnimations(eventData[P_TIMESTEP].GetFloat());
-}
 }
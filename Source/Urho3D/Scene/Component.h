@@ -40,6 +40,7 @@ class URHO3D_API Component : public Animatable
     BASEOBJECT(Component);
 
     friend class Node;
+    friend class Prefab;
     friend class Scene;
 
 public:
@@ -114,13 +115,15 @@ protected:
     void SetID(unsigned id);
     /// Set scene node. Called by Node when creating the component.
     void SetNode(Node* node);
-    /// Handle scene attribute animation update event.
-    void HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData);
 
     /// Scene node.
     Node* node_;
     /// Unique ID within the scene.
     unsigned id_;
+    /// Index in the scene's list of components of the same type, or M_MAX_UNSIGNED if not listed.
+    unsigned sceneTypeIndex_;
+    /// Hash of the network attributes included in the scene content hash.
+    unsigned contentHash_;
     /// Network update queued flag.
     bool networkUpdate_;
     /// Enabled flag.
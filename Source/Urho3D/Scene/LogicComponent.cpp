@@ -38,6 +38,8 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
+    currentSceneMask_(0),
+    threadSafeUpdate_(false),
     delayedStartCalled_(false)
 {
 }
@@ -76,6 +78,15 @@ void LogicComponent::SetUpdateEventMask(unsigned char mask)
     }
 }
 
+void LogicComponent::SetThreadSafeUpdate(bool enable)
+{
+    if (threadSafeUpdate_ != enable)
+    {
+        threadSafeUpdate_ = enable;
+        UpdateEventSubscription();
+    }
+}
+
 void LogicComponent::OnNodeSet(Node* node)
 {
     if (node)
@@ -103,6 +114,7 @@ void LogicComponent::OnSceneSet(Scene* scene)
         UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
 #endif
         currentEventMask_ = 0;
+        SetSceneUpdate(updateScene_, USE_UPDATE | USE_POSTUPDATE, false);
     }
 }
 
@@ -114,7 +126,11 @@ void LogicComponent::UpdateEventSubscription()
 
     bool enabled = IsEnabledEffective();
 
+    // Thread-safe updates are performed by the scene, but the delayed start is always called from the update event
     bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
+    bool sceneUpdate = needUpdate && threadSafeUpdate_ && delayedStartCalled_;
+    needUpdate = needUpdate && !sceneUpdate;
+    SetSceneUpdate(scene, USE_UPDATE, sceneUpdate);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
     {
         SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(LogicComponent, HandleSceneUpdate));
@@ -127,12 +143,15 @@ void LogicComponent::UpdateEventSubscription()
     }
 
     bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
+    bool scenePostUpdate = needPostUpdate && threadSafeUpdate_;
+    needPostUpdate = needPostUpdate && !scenePostUpdate;
+    SetSceneUpdate(scene, USE_POSTUPDATE, scenePostUpdate);
     if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
     {
         SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(LogicComponent, HandleScenePostUpdate));
         currentEventMask_ |= USE_POSTUPDATE;
     }
-    else if (!needUpdate && (currentEventMask_ & USE_POSTUPDATE))
+    else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
     {
         UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
         currentEventMask_ &= ~USE_POSTUPDATE;
@@ -169,6 +188,26 @@ void LogicComponent::UpdateEventSubscription()
 #endif
 }
 
+void LogicComponent::SetSceneUpdate(Scene* scene, unsigned char mask, bool enable)
+{
+    unsigned char addMask = enable ? mask & ~currentSceneMask_ : 0;
+    unsigned char removeMask = enable ? 0 : mask & currentSceneMask_;
+
+    // The scene may already be under destruction, in which case there is nothing to remove from
+    if (removeMask)
+    {
+        if (scene)
+            scene->RemoveThreadSafeLogic(this, removeMask);
+        currentSceneMask_ &= ~removeMask;
+    }
+    if (addMask && scene)
+    {
+        scene->AddThreadSafeLogic(this, addMask);
+        currentSceneMask_ |= addMask;
+        updateScene_ = scene;
+    }
+}
+
 void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
 {
     using namespace SceneUpdate;
@@ -186,6 +225,12 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
             currentEventMask_ &= ~USE_UPDATE;
             return;
         }
+        // If thread-safe, the scene calls Update() from now on, starting right after this event
+        if (threadSafeUpdate_)
+        {
+            UpdateEventSubscription();
+            return;
+        }
     }
 
     // Then execute user-defined update function
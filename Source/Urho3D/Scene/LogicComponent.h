@@ -69,10 +69,14 @@ class URHO3D_API LogicComponent : public Component
 
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(unsigned char mask);
+    /// Declare that Update() and PostUpdate() are thread-safe. The scene then calls them itself after sending the update events, grouped by component type and in parallel on the worker threads. They may only modify the component's own node and components, and must request other scene changes and event sends through the scene's delayed functions. Moving a node also marks its child nodes dirty, so components updated in parallel must not move nodes of the same hierarchy. DelayedStart() and the physics updates are still called from events in the main thread. Like the update event mask, this should be called in the subclass constructor.
+    void SetThreadSafeUpdate(bool enable);
 
     /// Return what update events are subscribed to.
     unsigned char GetUpdateEventMask() const { return updateEventMask_; }
 
+    /// Return whether Update() and PostUpdate() are thread-safe.
+    bool IsThreadSafeUpdate() const { return threadSafeUpdate_; }
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
 
@@ -85,6 +89,8 @@ protected:
 private:
     /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
     void UpdateEventSubscription();
+    /// Add to or remove from the scene's thread-safe updates.
+    void SetSceneUpdate(Scene* scene, unsigned char mask, bool enable);
     /// Handle scene update event.
     void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle scene post-update event.
@@ -99,6 +105,12 @@ private:
     unsigned char updateEventMask_;
     /// Current event subscription mask.
     unsigned char currentEventMask_;
+    /// Current thread-safe scene update mask.
+    unsigned char currentSceneMask_;
+    /// Scene performing the thread-safe updates.
+    WeakPtr<Scene> updateScene_;
+    /// Thread-safe update flag.
+    bool threadSafeUpdate_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
 };
@@ -50,6 +50,7 @@ Node::Node(Context* context) :
     parent_(0),
     scene_(0),
     id_(0),
+    contentHash_(0),
     position_(Vector3::ZERO),
     rotation_(Quaternion::IDENTITY),
     scale_(Vector3::ONE),
@@ -546,23 +547,16 @@ void Node::SetOwner(Connection* owner)
 
 void Node::MarkDirty()
 {
-    dirty_ = true;
+    // A world transform is only recalculated after the parent's, so the children of an already dirty node are dirty as
+    // well. Nodes without a parent are the exception, as their children do not recalculate them
+    if (dirty_ && parent_)
+        return;
 
-    // Notify listener components first, then mark child nodes
-    for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
-    {
-        if (*i)
-        {
-            (*i)->OnMarkedDirty(this);
-            ++i;
-        }
-        // If listener has expired, erase from list
-        else
-            i = listeners_.Erase(i);
-    }
+    // Queue the topmost changed node for the scene's batched world transform update
+    if (!dirty_ && scene_ && scene_ != this)
+        scene_->MarkTransformDirty(this);
 
-    for (Vector<SharedPtr<Node> >::Iterator i = children_.Begin(); i != children_.End(); ++i)
-        (*i)->MarkDirty();
+    SetDirtyRecursive();
 }
 
 Node* Node::CreateChild(const String& name, CreateMode mode, unsigned id)
@@ -975,7 +969,7 @@ void Node::GetChildrenWithComponent(PODVector<Node*>& dest, StringHash type, boo
                 dest.Push(*i);
         }
     }
-    else
+    else if (!scene_ || scene_->GetNumComponentsByType(type))
         GetChildrenWithComponentRecursive(dest, type);
 }
 
@@ -1036,7 +1030,7 @@ void Node::GetComponents(PODVector<Component*>& dest, StringHash type, bool recu
                 dest.Push(*i);
         }
     }
-    else
+    else if (!scene_ || scene_->GetNumComponentsByType(type))
         GetComponentsRecursive(dest, type);
 }
 
@@ -1495,14 +1489,14 @@ void Node::SetTransformSilent(const Vector3& position, const Quaternion& rotatio
 
 void Node::OnAttributeAnimationAdded()
 {
-    if (attributeAnimationInfos_.Size() == 1)
-        SubscribeToEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE, HANDLER(Node, HandleAttributeAnimationUpdate));
+    if (scene_)
+        scene_->AttributeAnimationsChanged(this);
 }
 
 void Node::OnAttributeAnimationRemoved()
 {
-    if (attributeAnimationInfos_.Empty())
-        UnsubscribeFromEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE);
+    if (scene_)
+        scene_->AttributeAnimationsChanged(this);
 }
 
 void Node::SetObjectAttributeAnimation(const String& name, ValueAnimation* attributeAnimation, WrapMode wrapMode, float speed)
@@ -1683,6 +1677,30 @@ void Node::UpdateWorldTransform() const
     dirty_ = false;
 }
 
+void Node::SetDirtyRecursive()
+{
+    dirty_ = true;
+
+    // Notify listener components first, then mark child nodes
+    for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
+    {
+        if (*i)
+        {
+            (*i)->OnMarkedDirty(this);
+            ++i;
+        }
+        // If listener has expired, erase from list
+        else
+            i = listeners_.Erase(i);
+    }
+
+    for (Vector<SharedPtr<Node> >::Iterator i = children_.Begin(); i != children_.End(); ++i)
+    {
+        if (!(*i)->dirty_)
+            (*i)->SetDirtyRecursive();
+    }
+}
+
 void Node::RemoveChild(Vector<SharedPtr<Node> >::Iterator i)
 {
     // Send change event. Do not send when already being destroyed
@@ -1811,11 +1829,4 @@ void Node::RemoveComponent(Vector<SharedPtr<Component> >::Iterator i)
     components_.Erase(i);
 }
 
-void Node::HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace AttributeAnimationUpdate;
-
-    UpdateAttributeAnimations(eventData[P_TIMESTEP].GetFloat());
-}
-
 }
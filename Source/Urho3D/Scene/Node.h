@@ -58,6 +58,7 @@ class URHO3D_API Node : public Animatable
     BASEOBJECT(Node);
 
     friend class Connection;
+    friend class Scene;
 
 public:
     /// Construct.
@@ -240,7 +241,7 @@ public:
     void SetEnabledRecursive(bool enable);
     /// Set owner connection for networking.
     void SetOwner(Connection* owner);
-    /// Mark node and child nodes to need world transform recalculation. Notify listener components.
+    /// Mark node and child nodes to need world transform recalculation. Notify listener components. Child nodes that are already dirty are not visited again.
     void MarkDirty();
     /// Create a child scene node (with specified ID if provided).
     Node* CreateChild(const String& name = String::EMPTY, CreateMode mode = REPLICATED, unsigned id = 0);
@@ -448,7 +449,7 @@ public:
 
     /// Return child scene nodes, optionally recursive.
     void GetChildren(PODVector<Node*>& dest, bool recursive = false) const;
-    /// Return child scene nodes with a specific component.
+    /// Return child scene nodes with a specific component. The recursive search is skipped if the scene has no components of the type.
     void GetChildrenWithComponent(PODVector<Node*>& dest, StringHash type, bool recursive = false) const;
     /// Return child scene node by index.
     Node* GetChild(unsigned index) const;
@@ -468,7 +469,7 @@ public:
     /// Return all components.
     const Vector<SharedPtr<Component> >& GetComponents() const { return components_; }
 
-    /// Return all components of type. Optionally recursive.
+    /// Return all components of type. Optionally recursive. The recursive search is skipped if the scene has no components of the type. To get all components of a type in the whole scene faster, use Scene::GetComponentsByType().
     void GetComponents(PODVector<Component*>& dest, StringHash type, bool recursive = false) const;
     /// Return component by type. If there are several, returns the first.
     Component* GetComponent(StringHash type) const;
@@ -573,6 +574,8 @@ private:
     Component* SafeCreateComponent(const String& typeName, StringHash type, CreateMode mode, unsigned id);
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Set dirty flag on self and child nodes that are not dirty yet, and notify listener components.
+    void SetDirtyRecursive();
     /// Remove child node by iterator.
     void RemoveChild(Vector<SharedPtr<Node> >::Iterator i);
     /// Return child nodes recursively.
@@ -585,8 +588,6 @@ private:
     Node* CloneRecursive(Node* parent, SceneResolver& resolver, CreateMode mode);
     /// Remove a component from this node with the specified iterator.
     void RemoveComponent(Vector<SharedPtr<Component> >::Iterator i);
-    /// Handle attribute animation update event.
-    void HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData);
 
     /// World-space transform matrix.
     mutable Matrix3x4 worldTransform_;
@@ -602,6 +603,8 @@ private:
     Scene* scene_;
     /// Unique ID within the scene.
     unsigned id_;
+    /// Hash of the network attributes included in the scene content hash.
+    unsigned contentHash_;
     /// Position.
     Vector3 position_;
     /// Rotation.
@@ -0,0 +1,586 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../Resource/XMLFile.h"
+#include "../Scene/Component.h"
+#include "../Scene/Prefab.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Scene/SceneSnapshot.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Return whether an XML node or component element or any of its children define attribute animations.
+static bool HasAttributeAnimations(const XMLElement& element)
+{
+    if (element.GetChild("attributeanimation"))
+        return true;
+
+    for (XMLElement childElem = element.GetChild(); childElem; childElem = childElem.GetNext())
+    {
+        if ((childElem.GetName() == "node" || childElem.GetName() == "component") && HasAttributeAnimations(childElem))
+            return true;
+    }
+
+    return false;
+}
+
+Prefab::Prefab(Context* context) :
+    Resource(context),
+    maxPoolSize_(0)
+{
+}
+
+Prefab::~Prefab()
+{
+}
+
+void Prefab::RegisterObject(Context* context)
+{
+    context->RegisterFactory<Prefab>();
+}
+
+bool Prefab::BeginLoad(Deserializer& source)
+{
+    // Only read the data here, as the template is captured from a loaded node hierarchy, which must be created in the main thread
+    if (GetExtension(GetName()) == ".xml" || GetExtension(source.GetName()) == ".xml")
+    {
+        loadXMLFile_ = new XMLFile(context_);
+        return loadXMLFile_->Load(source);
+    }
+
+    loadData_.Resize(source.GetSize() - source.GetPosition());
+    if (!loadData_.Size() || source.Read(&loadData_[0], loadData_.Size()) != loadData_.Size())
+    {
+        loadData_.Clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Prefab::EndLoad()
+{
+    // Load the hierarchy the same way as when instantiating from the source, but keep the IDs for resolving references
+    SharedPtr<Node> node(new Node(context_));
+    bool success = false;
+    if (loadXMLFile_)
+    {
+        XMLElement rootElem = loadXMLFile_->GetRoot();
+        node->SetID(rootElem.GetUInt("id"));
+        success = node->LoadXML(rootElem);
+        if (success && HasAttributeAnimations(rootElem))
+            LOGWARNING("Attribute animations are not stored in prefab " + GetName());
+    }
+    else if (loadData_.Size())
+    {
+        MemoryBuffer buffer(loadData_);
+        node->SetID(buffer.ReadUInt());
+        buffer.Seek(0);
+        success = node->Load(buffer);
+    }
+
+    loadXMLFile_.Reset();
+    loadData_.Clear();
+    return success && Define(node);
+}
+
+bool Prefab::Define(Node* node)
+{
+    if (!node)
+    {
+        LOGERROR("Null node given for prefab");
+        return false;
+    }
+
+    PROFILE(DefinePrefab);
+
+    ClearPool();
+    nodes_.Clear();
+    components_.Clear();
+    layouts_.Clear();
+    rawData_.Clear();
+
+    // Collect the persistent nodes so that parents come before their children
+    PODVector<Node*> sourceNodes;
+    PrefabNode rootRecord;
+    rootRecord.id_ = node->GetID();
+    rootRecord.parentIndex_ = 0;
+    sourceNodes.Push(node);
+    nodes_.Push(rootRecord);
+    for (unsigned i = 0; i < sourceNodes.Size(); ++i)
+    {
+        const Vector<SharedPtr<Node> >& children = sourceNodes[i]->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+        {
+            if (!(*j)->IsTemporary())
+            {
+                PrefabNode record;
+                record.id_ = (*j)->GetID();
+                record.parentIndex_ = i;
+                sourceNodes.Push(*j);
+                nodes_.Push(record);
+            }
+        }
+    }
+
+    BuildLayout(nodeLayout_, Node::GetTypeStatic(), context_->GetAttributes(Node::GetTypeStatic()), false);
+
+    const HashMap<StringHash, SharedPtr<ObjectFactory> >& factories = context_->GetObjectFactories();
+    HashMap<StringHash, unsigned> layoutIndices;
+    VectorBuffer data;
+
+    for (unsigned i = 0; i < sourceNodes.Size(); ++i)
+    {
+        PrefabNode& nodeRecord = nodes_[i];
+        nodeRecord.dataOffset_ = data.GetPosition();
+        if (!WriteAttributes(sourceNodes[i], nodeLayout_, data))
+            return false;
+        nodeRecord.dataSize_ = data.GetPosition() - nodeRecord.dataOffset_;
+        nodeRecord.numComponents_ = 0;
+
+        const Vector<SharedPtr<Component> >& components = sourceNodes[i]->GetComponents();
+        for (Vector<SharedPtr<Component> >::ConstIterator j = components.Begin(); j != components.End(); ++j)
+        {
+            Component* component = *j;
+            if (component->IsTemporary())
+                continue;
+
+            StringHash type = component->GetType();
+            if (!factories.Contains(type))
+            {
+                LOGWARNING("Skipping unknown component type " + type.ToString() + " in prefab " + GetName());
+                continue;
+            }
+
+            unsigned layoutIndex;
+            HashMap<StringHash, unsigned>::Iterator k = layoutIndices.Find(type);
+            if (k != layoutIndices.End())
+                layoutIndex = k->second_;
+            else
+            {
+                layoutIndex = layouts_.Size();
+                layoutIndices[type] = layoutIndex;
+                layouts_.Resize(layouts_.Size() + 1);
+
+                // Types with per-instance attributes are loaded one object at a time, as in the binary format
+                const Vector<AttributeInfo>* attributes = component->GetAttributes();
+                if (attributes != context_->GetAttributes(type) || !component->AllowRawAttributeAccess())
+                {
+                    layouts_.Back().type_ = type;
+                    layouts_.Back().perObject_ = true;
+                }
+                else
+                    BuildLayout(layouts_.Back(), type, attributes, true);
+            }
+
+            const PrefabLayout& layout = layouts_[layoutIndex];
+            PrefabComponent record;
+            record.id_ = component->GetID();
+            record.layoutIndex_ = layoutIndex;
+            record.rawOffset_ = rawData_.Size();
+            record.dataOffset_ = data.GetPosition();
+
+            if (layout.rawSize_)
+            {
+                rawData_.Resize(rawData_.Size() + layout.rawSize_);
+                unsigned char* raw = &rawData_[record.rawOffset_];
+                const unsigned char* src = reinterpret_cast<const unsigned char*>(component);
+                for (unsigned l = 0; l < layout.attributes_.Size(); ++l)
+                {
+                    const PrefabAttribute& attr = layout.attributes_[l];
+                    if (attr.size_)
+                    {
+                        memcpy(raw, src + attr.offset_, attr.size_);
+                        raw += attr.size_;
+                    }
+                }
+            }
+
+            if (!(layout.perObject_ ? component->Save(data) : WriteAttributes(component, layout, data)))
+                return false;
+            record.dataSize_ = data.GetPosition() - record.dataOffset_;
+
+            components_.Push(record);
+            ++nodeRecord.numComponents_;
+        }
+    }
+
+    data_ = data.GetBuffer();
+
+    SetMemoryUse(sizeof(Prefab) + nodes_.Size() * sizeof(PrefabNode) + components_.Size() * sizeof(PrefabComponent) +
+        data_.Size() + rawData_.Size());
+    return true;
+}
+
+Node* Prefab::Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    Scene* scene = parent ? parent->GetScene() : 0;
+    if (!scene)
+    {
+        LOGERROR("Can not instantiate prefab " + GetName() + " without a parent node in a scene");
+        return 0;
+    }
+    if (nodes_.Empty())
+    {
+        LOGERROR("Can not instantiate empty prefab " + GetName());
+        return 0;
+    }
+
+    PROFILE(InstantiatePrefab);
+
+    PrefabInstance instance;
+    if (!pool_.Empty())
+    {
+        instance = pool_.Back();
+        pool_.Pop();
+    }
+    else
+    {
+        BuildNodes(instance);
+        if (!BuildComponents(instance))
+            return 0;
+    }
+
+    // Assign all IDs first, so that the whole hierarchy is added to the scene at once. Do not create replicated components
+    // to local nodes, as when creating them one by one
+    unsigned componentIndex = 0;
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        CreateMode nodeMode = (mode == REPLICATED && nodes_[i].id_ < FIRST_LOCAL_ID) ? REPLICATED : LOCAL;
+        instance.nodes_[i]->SetID(scene->GetFreeNodeID(nodeMode));
+        for (unsigned j = 0; j < nodes_[i].numComponents_; ++j, ++componentIndex)
+        {
+            CreateMode componentMode = (nodeMode == REPLICATED && components_[componentIndex].id_ < FIRST_LOCAL_ID) ?
+                REPLICATED : LOCAL;
+            instance.components_[componentIndex]->SetID(scene->GetFreeComponentID(componentMode));
+        }
+    }
+
+    Node* node = instance.node_;
+    parent->AddChild(node);
+
+    // Read the remaining component attributes now that the resources can be accessed, then resolve the ID references
+    SceneResolver resolver;
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        resolver.AddNode(nodes_[i].id_, instance.nodes_[i]);
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        const PrefabComponent& record = components_[i];
+        const PrefabLayout& layout = layouts_[record.layoutIndex_];
+        Component* component = instance.components_[i];
+        resolver.AddComponent(record.id_, component);
+
+        if (layout.perObject_)
+        {
+            // Components save their type and ID first
+            MemoryBuffer buffer(&data_[record.dataOffset_], record.dataSize_);
+            buffer.ReadStringHash();
+            buffer.ReadUInt();
+            component->Load(buffer);
+        }
+        else
+            ReadAttributes(component, layout, record.dataOffset_, record.dataSize_);
+
+        // As in Node::AddComponent(), mark every new component: its network attribute values are only gathered for the initial
+        // replication once it has been marked, whether or not any network attributes were copied directly
+        component->MarkNetworkUpdate();
+    }
+
+    resolver.Resolve();
+    node->ApplyAttributes();
+    node->SetTransform(position, rotation);
+    return node;
+}
+
+bool Prefab::Release(Node* node)
+{
+    if (!node || node == node->GetScene())
+        return false;
+
+    // A detached instance may already be in the pool
+    if (!node->GetParent())
+    {
+        for (unsigned i = 0; i < pool_.Size(); ++i)
+        {
+            if (pool_[i].node_ == node)
+                return false;
+        }
+    }
+
+    // Hold a reference while removing, so that the node survives if it is pooled
+    SharedPtr<Node> nodeShared(node);
+    node->Remove();
+    if (pool_.Size() >= maxPoolSize_)
+        return false;
+
+    PrefabInstance instance;
+    instance.node_ = node;
+    if (!CollectInstance(instance))
+    {
+        LOGDEBUG("Node " + node->GetName() + " no longer matches prefab " + GetName() + ", not pooling");
+        return false;
+    }
+
+    ResetInstance(instance);
+    pool_.Push(instance);
+    return true;
+}
+
+void Prefab::Prepare(unsigned count)
+{
+    if (nodes_.Empty() || !count)
+        return;
+
+    PROFILE(PreparePrefab);
+
+    unsigned start = pool_.Size();
+    pool_.Resize(start + count);
+
+    // Create the nodes in worker threads if available. The components are created in the main thread, as their constructors
+    // and OnNodeSet() may subscribe to events or access other subsystems
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    int numWorkItems = queue ? Min((int)queue->GetNumThreads() + 1, (int)count) : 1;
+    if (numWorkItems > 1)
+    {
+        unsigned instancesPerItem = (count + numWorkItems - 1) / numWorkItems;
+        for (unsigned i = start; i < pool_.Size(); i += instancesPerItem)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = BuildNodesWork;
+            item->start_ = &pool_[i];
+            item->end_ = &pool_[0] + Min((int)(i + instancesPerItem), (int)pool_.Size());
+            item->aux_ = this;
+            queue->AddWorkItem(item);
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i = start; i < pool_.Size(); ++i)
+            BuildNodes(pool_[i]);
+    }
+
+    for (unsigned i = pool_.Size() - 1; i >= start && i < pool_.Size(); --i)
+    {
+        if (!BuildComponents(pool_[i]))
+            pool_.Erase(i);
+    }
+}
+
+void Prefab::SetMaxPoolSize(unsigned size)
+{
+    maxPoolSize_ = size;
+    if (pool_.Size() > maxPoolSize_)
+        pool_.Resize(maxPoolSize_);
+}
+
+void Prefab::ClearPool()
+{
+    pool_.Clear();
+}
+
+void Prefab::BuildLayout(PrefabLayout& layout, StringHash type, const Vector<AttributeInfo>* attributes, bool allowRaw)
+{
+    layout.type_ = type;
+    layout.attributes_.Clear();
+    layout.rawSize_ = 0;
+    layout.perObject_ = false;
+    if (!attributes)
+        return;
+
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+
+        PrefabAttribute prefabAttr;
+        prefabAttr.index_ = i;
+        prefabAttr.offset_ = attr.offset_;
+        prefabAttr.size_ = allowRaw ? GetRawAttributeSize(attr) : 0;
+        layout.rawSize_ += prefabAttr.size_;
+        layout.attributes_.Push(prefabAttr);
+    }
+}
+
+bool Prefab::WriteAttributes(Serializable* object, const PrefabLayout& layout, Serializer& dest)
+{
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    for (unsigned i = 0; i < layout.attributes_.Size(); ++i)
+    {
+        const PrefabAttribute& attr = layout.attributes_[i];
+        if (!attr.size_ && !object->WriteAttributeData(attributes->At(attr.index_), dest))
+        {
+            LOGERROR("Could not store " + object->GetTypeName() + " attributes in prefab " + GetName());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Prefab::ReadAttributes(Serializable* object, const PrefabLayout& layout, unsigned dataOffset, unsigned dataSize) const
+{
+    if (!dataSize)
+        return;
+
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    MemoryBuffer buffer(&data_[dataOffset], dataSize);
+    for (unsigned i = 0; i < layout.attributes_.Size(); ++i)
+    {
+        const PrefabAttribute& attr = layout.attributes_[i];
+        if (!attr.size_)
+            object->ReadAttributeData(attributes->At(attr.index_), buffer);
+    }
+}
+
+void Prefab::CopyRawAttributes(Component* component, const PrefabComponent& record) const
+{
+    const PrefabLayout& layout = layouts_[record.layoutIndex_];
+    if (!layout.rawSize_)
+        return;
+
+    const unsigned char* raw = &rawData_[record.rawOffset_];
+    unsigned char* dest = reinterpret_cast<unsigned char*>(component);
+    for (unsigned i = 0; i < layout.attributes_.Size(); ++i)
+    {
+        const PrefabAttribute& attr = layout.attributes_[i];
+        if (attr.size_)
+        {
+            memcpy(dest + attr.offset_, raw, attr.size_);
+            raw += attr.size_;
+        }
+    }
+}
+
+void Prefab::BuildNodes(PrefabInstance& instance) const
+{
+    instance.nodes_.Resize(nodes_.Size());
+    instance.components_.Clear();
+
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        Node* node = new Node(context_);
+        if (i)
+            instance.nodes_[nodes_[i].parentIndex_]->AddChild(node);
+        else
+            instance.node_ = node;
+
+        instance.nodes_[i] = node;
+        ReadAttributes(node, nodeLayout_, nodes_[i].dataOffset_, nodes_[i].dataSize_);
+    }
+}
+
+bool Prefab::BuildComponents(PrefabInstance& instance) const
+{
+    instance.components_.Resize(components_.Size());
+
+    unsigned componentIndex = 0;
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        Node* node = instance.nodes_[i];
+        for (unsigned j = 0; j < nodes_[i].numComponents_; ++j, ++componentIndex)
+        {
+            const PrefabComponent& record = components_[componentIndex];
+            StringHash type = layouts_[record.layoutIndex_].type_;
+            SharedPtr<Component> component = DynamicCast<Component>(context_->CreateObject(type));
+            if (!component)
+            {
+                LOGERROR("Could not create component type " + type.ToString() + " of prefab " + GetName());
+                return false;
+            }
+
+            node->AddComponent(component, 0, REPLICATED);
+            instance.components_[componentIndex] = component;
+            CopyRawAttributes(component, record);
+        }
+    }
+
+    return true;
+}
+
+bool Prefab::CollectInstance(PrefabInstance& instance) const
+{
+    instance.nodes_.Clear();
+    instance.components_.Clear();
+    instance.nodes_.Push(instance.node_);
+
+    for (unsigned i = 0; i < instance.nodes_.Size(); ++i)
+    {
+        Node* node = instance.nodes_[i];
+        const Vector<SharedPtr<Component> >& components = node->GetComponents();
+        if (components.Size() != nodes_[i].numComponents_)
+            return false;
+        for (Vector<SharedPtr<Component> >::ConstIterator j = components.Begin(); j != components.End(); ++j)
+        {
+            if ((*j)->GetType() != layouts_[components_[instance.components_.Size()].layoutIndex_].type_)
+                return false;
+            instance.components_.Push(*j);
+        }
+
+        const Vector<SharedPtr<Node> >& children = node->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+        {
+            unsigned index = instance.nodes_.Size();
+            if (index >= nodes_.Size() || nodes_[index].parentIndex_ != i)
+                return false;
+            instance.nodes_.Push(*j);
+        }
+    }
+
+    return instance.nodes_.Size() == nodes_.Size();
+}
+
+void Prefab::ResetInstance(PrefabInstance& instance) const
+{
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        ReadAttributes(instance.nodes_[i], nodeLayout_, nodes_[i].dataOffset_, nodes_[i].dataSize_);
+    for (unsigned i = 0; i < components_.Size(); ++i)
+        CopyRawAttributes(instance.components_[i], components_[i]);
+}
+
+void Prefab::BuildNodesWork(const WorkItem* item, unsigned threadIndex)
+{
+    const Prefab* prefab = reinterpret_cast<const Prefab*>(item->aux_);
+    PrefabInstance* start = reinterpret_cast<PrefabInstance*>(item->start_);
+    PrefabInstance* end = reinterpret_cast<PrefabInstance*>(item->end_);
+
+    while (start != end)
+        prefab->BuildNodes(*start++);
+}
+
+}
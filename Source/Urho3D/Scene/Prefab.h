@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Resource/Resource.h"
+#include "../Scene/Node.h"
+
+namespace Urho3D
+{
+
+class XMLFile;
+struct WorkItem;
+
+/// Node in a prefab template.
+struct PrefabNode
+{
+    /// Node ID in the prefab source, used to resolve references.
+    unsigned id_;
+    /// Index of the parent node.
+    unsigned parentIndex_;
+    /// Number of components.
+    unsigned numComponents_;
+    /// Offset of the attribute data.
+    unsigned dataOffset_;
+    /// Size of the attribute data.
+    unsigned dataSize_;
+};
+
+/// Component in a prefab template.
+struct PrefabComponent
+{
+    /// Component ID in the prefab source, used to resolve references.
+    unsigned id_;
+    /// Index of the component type layout.
+    unsigned layoutIndex_;
+    /// Offset of the raw attribute data.
+    unsigned rawOffset_;
+    /// Offset of the attribute data.
+    unsigned dataOffset_;
+    /// Size of the attribute data.
+    unsigned dataSize_;
+};
+
+/// Attribute of an object type in a prefab template.
+struct PrefabAttribute
+{
+    /// Attribute index.
+    unsigned index_;
+    /// Byte offset of the attribute in the object.
+    unsigned offset_;
+    /// Size when copied as raw memory, or zero when read through the attribute.
+    unsigned size_;
+};
+
+/// Attribute layout of an object type in a prefab template.
+struct PrefabLayout
+{
+    /// Construct.
+    PrefabLayout() :
+        rawSize_(0),
+        perObject_(false)
+    {
+    }
+
+    /// Object type.
+    StringHash type_;
+    /// File attributes.
+    PODVector<PrefabAttribute> attributes_;
+    /// Size of the raw data per object.
+    unsigned rawSize_;
+    /// Whether the objects are loaded through Load() instead of by attribute.
+    bool perObject_;
+};
+
+/// Detached instance of a prefab.
+struct PrefabInstance
+{
+    /// Root node.
+    SharedPtr<Node> node_;
+    /// Nodes in template order.
+    PODVector<Node*> nodes_;
+    /// Components in template order.
+    PODVector<Component*> components_;
+};
+
+/// %Node hierarchy template for fast repeated instantiation. The hierarchy is loaded once from an XML or binary object prefab, and stored as the attribute data of its nodes and components, with the plain data attributes of each component as raw memory. Instances are cloned from the template and their IDs are assigned before the whole hierarchy is added to the scene at once. Released instances can be pooled for reuse, and detached instances can be prepared ahead of time, creating the nodes in worker threads.
+class URHO3D_API Prefab : public Resource
+{
+    OBJECT(Prefab);
+
+public:
+    /// Construct.
+    Prefab(Context* context);
+    /// Destruct.
+    virtual ~Prefab();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    virtual bool EndLoad();
+
+    /// Define the template from a node hierarchy. Temporary nodes and components are skipped. Clears the pool. Return true if successful.
+    bool Define(Node* node);
+    /// Instantiate under a parent node in a scene, reusing a pooled instance if available. Return the root node, or null if failed.
+    Node* Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Remove an instance from its parent and pool it for reuse, if the pool is not full and the hierarchy still matches the template. An instance that is already pooled is ignored. Return true if pooled.
+    bool Release(Node* node);
+    /// Build detached instances into the pool ahead of time, regardless of the maximum pool size. The nodes are created in worker threads if available.
+    void Prepare(unsigned count);
+    /// Set maximum number of released instances to pool. Zero (default) disables pooling.
+    void SetMaxPoolSize(unsigned size);
+    /// Destroy the pooled instances.
+    void ClearPool();
+
+    /// Return maximum number of released instances to pool.
+    unsigned GetMaxPoolSize() const { return maxPoolSize_; }
+    /// Return number of pooled instances.
+    unsigned GetPoolSize() const { return pool_.Size(); }
+    /// Return number of nodes in the template.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of components in the template.
+    unsigned GetNumComponents() const { return components_.Size(); }
+
+private:
+    /// Build the layout of an object type.
+    void BuildLayout(PrefabLayout& layout, StringHash type, const Vector<AttributeInfo>* attributes, bool allowRaw);
+    /// Write the attributes of an object that are not copied as raw memory.
+    bool WriteAttributes(Serializable* object, const PrefabLayout& layout, Serializer& dest);
+    /// Read the attributes of an object that are not copied as raw memory.
+    void ReadAttributes(Serializable* object, const PrefabLayout& layout, unsigned dataOffset, unsigned dataSize) const;
+    /// Copy the raw attribute data of a component.
+    void CopyRawAttributes(Component* component, const PrefabComponent& record) const;
+    /// Create the nodes of an instance and read their attributes. May be called from a worker thread.
+    void BuildNodes(PrefabInstance& instance) const;
+    /// Create the components of an instance and copy their raw attribute data. Return true if successful.
+    bool BuildComponents(PrefabInstance& instance) const;
+    /// Collect the nodes and components of a released instance. Return true if they match the template.
+    bool CollectInstance(PrefabInstance& instance) const;
+    /// Restore the node attributes and raw component attribute data of a released instance.
+    void ResetInstance(PrefabInstance& instance) const;
+    /// Build the nodes of a range of instances in a worker thread.
+    static void BuildNodesWork(const WorkItem* item, unsigned threadIndex);
+
+    /// Nodes in breadth-first order.
+    PODVector<PrefabNode> nodes_;
+    /// Components in the order of their nodes.
+    PODVector<PrefabComponent> components_;
+    /// Node attribute layout.
+    PrefabLayout nodeLayout_;
+    /// Component type layouts.
+    Vector<PrefabLayout> layouts_;
+    /// Attribute data of the nodes and components.
+    PODVector<unsigned char> data_;
+    /// Raw attribute data of the components.
+    PODVector<unsigned char> rawData_;
+    /// Pooled detached instances.
+    Vector<PrefabInstance> pool_;
+    /// Maximum number of released instances to pool.
+    unsigned maxPoolSize_;
+    /// XML file used while loading.
+    SharedPtr<XMLFile> loadXMLFile_;
+    /// Binary data used while loading.
+    PODVector<unsigned char> loadData_;
+};
+
+}
@@ -28,15 +28,21 @@
 #include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
+#include "../Math/Checksum.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 #include "../Resource/XMLFile.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
+#include "../Scene/Prefab.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneSnapshot.h"
+#include "../Scene/SceneStreamer.h"
 #include "../Scene/SmoothedTransform.h"
 #include "../Scene/SplinePath.h"
 #include "../Scene/UnknownComponent.h"
@@ -53,14 +59,91 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned MIN_TRANSFORMS_PER_WORK_ITEM = 256;
+static const unsigned MIN_LOGIC_COMPONENTS_PER_WORK_ITEM = 32;
+static const unsigned MIN_ATTRIBUTE_ANIMATIONS_PER_WORK_ITEM = 1024;
+
+/// Empty component list returned for types without components in the scene.
+static const PODVector<Component*> noComponents;
+
+/// Remove a logic component from its type group. The update order within the group is not preserved.
+static void RemoveLogicComponent(HashMap<StringHash, PODVector<LogicComponent*> >& components, StringHash type,
+    LogicComponent* component)
+{
+    HashMap<StringHash, PODVector<LogicComponent*> >::Iterator i = components.Find(type);
+    if (i == components.End())
+        return;
+
+    PODVector<LogicComponent*>& group = i->second_;
+    PODVector<LogicComponent*>::Iterator j = group.Find(component);
+    if (j != group.End())
+    {
+        *j = group.Back();
+        group.Pop();
+    }
+    if (group.Empty())
+        components.Erase(i);
+}
+
+/// %Serializer that hashes the written data instead of storing it.
+class ChecksumSerializer : public Serializer
+{
+public:
+    /// Construct.
+    ChecksumSerializer(Checksum& checksum) :
+        checksum_(checksum)
+    {
+    }
+
+    /// Hash bytes.
+    virtual unsigned Write(const void* data, unsigned size)
+    {
+        checksum_.Update(data, size);
+        return size;
+    }
+
+private:
+    /// Checksum to update.
+    Checksum& checksum_;
+};
+
+/// Return the content hash of a node or component from its ID, type, parent or owner node ID and network attributes.
+static unsigned HashNetworkAttributes(Serializable* object, unsigned id, unsigned parentID, bool isNode)
+{
+    Checksum checksum(id);
+    ChecksumSerializer dest(checksum);
+    dest.WriteStringHash(object->GetType());
+    dest.WriteUInt(parentID);
+
+    const Vector<AttributeInfo>* attributes = object->GetNetworkAttributes();
+    if (attributes)
+    {
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            // The network parent attribute of a node under a local parent refers to the local parent's name and ancestors,
+            // which can change without the node being marked for network update. The parent ID is hashed instead
+            if (isNode && attr.type_ == VAR_BUFFER && attr.name_ == "Network Parent Node")
+                continue;
+            object->WriteAttributeData(attr, dest);
+        }
+    }
+
+    return checksum.GetValue();
+}
 
 Scene::Scene(Context* context) :
     Node(context),
+    replicatedNodes_(FIRST_REPLICATED_ID),
+    localNodes_(FIRST_LOCAL_ID),
+    replicatedComponents_(FIRST_REPLICATED_ID),
+    localComponents_(FIRST_LOCAL_ID),
     replicatedNodeID_(FIRST_REPLICATED_ID),
     replicatedComponentID_(FIRST_REPLICATED_ID),
     localNodeID_(FIRST_LOCAL_ID),
     localComponentID_(FIRST_LOCAL_ID),
     checksum_(0),
+    totalContentHash_(0),
     asyncLoadingMs_(5),
     timeScale_(1.0f),
     elapsedTime_(0),
@@ -68,7 +151,10 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    transformBatching_(false),
+    animatedAttributesDirty_(false),
+    contentHashValid_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
@@ -86,10 +172,11 @@ Scene::~Scene()
     RemoveAllChildren();
 
     // Remove scene reference and owner from all nodes that still exist
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
-        i->second_->ResetScene();
-    for (HashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
-        i->second_->ResetScene();
+    PODVector<Node*> nodes;
+    replicatedNodes_.GetObjects(nodes);
+    localNodes_.GetObjects(nodes);
+    for (PODVector<Node*>::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+        (*i)->ResetScene();
 }
 
 void Scene::RegisterObject(Context* context)
@@ -192,14 +279,28 @@ void Scene::AddReplicationState(NodeReplicationState* state)
     Node::AddReplicationState(state);
 
     // This is the first update for a new connection. Mark all replicated nodes dirty
-    for (HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
-        state->sceneState_->dirtyNodes_.Insert(i->first_);
+    PODVector<Node*> nodes;
+    replicatedNodes_.GetObjects(nodes);
+    for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+        state->sceneState_->dirtyNodes_.Insert((*i)->GetID());
+
+    // While replicated, hold back freed replicated IDs until the next network update has sent the removals, so that the
+    // clients never see an ID change owner within one update
+    replicatedNodes_.SetDeferReuse(true);
+    replicatedComponents_.SetDeferReuse(true);
 }
 
 bool Scene::LoadXML(Deserializer& source)
 {
     PROFILE(LoadSceneXML);
 
+    // If the file has been cooked to the binary format, load it as such
+    unsigned start = source.GetPosition();
+    bool isBinary = source.ReadFileID() == "USCN";
+    source.Seek(start);
+    if (isBinary)
+        return Load(source);
+
     StopAsyncLoading();
 
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -241,6 +342,24 @@ bool Scene::SaveXML(Serializer& dest, const String& indentation) const
         return false;
 }
 
+bool Scene::SaveSnapshot(Serializer& dest)
+{
+    PROFILE(SaveSceneSnapshot);
+
+    SceneSnapshot snapshot;
+    return snapshot.Save(this, dest);
+}
+
+bool Scene::LoadSnapshot(Deserializer& source)
+{
+    PROFILE(LoadSceneSnapshot);
+
+    StopAsyncLoading();
+
+    SceneSnapshot snapshot;
+    return snapshot.Load(this, source);
+}
+
 bool Scene::LoadAsync(File* file, LoadMode mode)
 {
     if (!file)
@@ -322,6 +441,13 @@ bool Scene::LoadAsyncXML(File* file, LoadMode mode)
         return false;
     }
 
+    // If the file has been cooked to the binary format, load it as such
+    unsigned start = file->GetPosition();
+    bool isBinary = file->ReadFileID() == "USCN";
+    file->Seek(start);
+    if (isBinary)
+        return LoadAsync(file, mode);
+
     StopAsyncLoading();
 
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -469,11 +595,15 @@ void Scene::Clear(bool clearReplicated, bool clearLocal)
     {
         replicatedNodeID_ = FIRST_REPLICATED_ID;
         replicatedComponentID_ = FIRST_REPLICATED_ID;
+        replicatedNodes_.ClearFreeIDs();
+        replicatedComponents_.ClearFreeIDs();
     }
     if (clearLocal)
     {
         localNodeID_ = FIRST_LOCAL_ID;
         localComponentID_ = FIRST_LOCAL_ID;
+        localNodes_.ClearFreeIDs();
+        localComponents_.ClearFreeIDs();
     }
 }
 
@@ -541,30 +671,61 @@ void Scene::UnregisterAllVars()
 
 Node* Scene::GetNode(unsigned id) const
 {
+    return id < FIRST_LOCAL_ID ? replicatedNodes_.Find(id) : localNodes_.Find(id);
+}
+
+Component* Scene::GetComponent(unsigned id) const
+{
+    return id < FIRST_LOCAL_ID ? replicatedComponents_.Find(id) : localComponents_.Find(id);
+}
+
+const PODVector<Component*>& Scene::GetComponentsByType(StringHash type) const
+{
+    HashMap<StringHash, PODVector<Component*> >::ConstIterator i = componentsByType_.Find(type);
+    return i != componentsByType_.End() ? i->second_ : noComponents;
+}
+
+unsigned Scene::GetNumComponentsByType(StringHash type) const
+{
+    HashMap<StringHash, PODVector<Component*> >::ConstIterator i = componentsByType_.Find(type);
+    return i != componentsByType_.End() ? i->second_.Size() : 0;
+}
+
+SceneHandle Scene::GetHandle(Node* node) const
+{
+    if (!node || node->GetScene() != this)
+        return SceneHandle();
+
+    unsigned id = node->GetID();
+    return SceneHandle(id, id < FIRST_LOCAL_ID ? replicatedNodes_.GetGeneration(id) : localNodes_.GetGeneration(id));
+}
+
+SceneHandle Scene::GetHandle(Component* component) const
+{
+    if (!component || component->GetScene() != this)
+        return SceneHandle();
+
+    unsigned id = component->GetID();
+    return SceneHandle(id, id < FIRST_LOCAL_ID ? replicatedComponents_.GetGeneration(id) :
+        localComponents_.GetGeneration(id));
+}
+
+Node* Scene::GetNode(const SceneHandle& handle) const
+{
+    unsigned id = handle.id_;
     if (id < FIRST_LOCAL_ID)
-    {
-        HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Find(id);
-        return i != replicatedNodes_.End() ? i->second_ : 0;
-    }
+        return replicatedNodes_.GetGeneration(id) == handle.generation_ ? replicatedNodes_.Find(id) : 0;
     else
-    {
-        HashMap<unsigned, Node*>::ConstIterator i = localNodes_.Find(id);
-        return i != localNodes_.End() ? i->second_ : 0;
-    }
+        return localNodes_.GetGeneration(id) == handle.generation_ ? localNodes_.Find(id) : 0;
 }
 
-Component* Scene::GetComponent(unsigned id) const
+Component* Scene::GetComponent(const SceneHandle& handle) const
 {
+    unsigned id = handle.id_;
     if (id < FIRST_LOCAL_ID)
-    {
-        HashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Find(id);
-        return i != replicatedComponents_.End() ? i->second_ : 0;
-    }
+        return replicatedComponents_.GetGeneration(id) == handle.generation_ ? replicatedComponents_.Find(id) : 0;
     else
-    {
-        HashMap<unsigned, Component*>::ConstIterator i = localComponents_.Find(id);
-        return i != localComponents_.End() ? i->second_ : 0;
-    }
+        return localComponents_.GetGeneration(id) == handle.generation_ ? localComponents_.Find(id) : 0;
 }
 
 float Scene::GetAsyncProgress() const
@@ -574,6 +735,68 @@ float Scene::GetAsyncProgress() const
         (float)(asyncProgress_.totalNodes_ + asyncProgress_.totalResources_);
 }
 
+unsigned Scene::GetContentHash()
+{
+    PROFILE(GetContentHash);
+
+    // The per-object hashes are summed, so that an object can be rehashed or removed without touching the others
+    if (!contentHashValid_)
+    {
+        totalContentHash_ = 0;
+
+        PODVector<Node*> nodes;
+        replicatedNodes_.GetObjects(nodes);
+        for (PODVector<Node*>::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+        {
+            (*i)->contentHash_ = 0;
+            UpdateContentHash(*i);
+        }
+
+        PODVector<Component*> components;
+        replicatedComponents_.GetObjects(components);
+        for (PODVector<Component*>::Iterator i = components.Begin(); i != components.End(); ++i)
+        {
+            (*i)->contentHash_ = 0;
+            UpdateContentHash(*i);
+        }
+
+        contentHashValid_ = true;
+    }
+    else
+    {
+        // Objects already queued for network update are not marked again until the network update, so rehash them as well
+        for (HashSet<unsigned>::Iterator i = contentDirtyNodes_.Begin(); i != contentDirtyNodes_.End(); ++i)
+        {
+            Node* node = replicatedNodes_.Find(*i);
+            if (node)
+                UpdateContentHash(node);
+        }
+        for (HashSet<unsigned>::Iterator i = networkUpdateNodes_.Begin(); i != networkUpdateNodes_.End(); ++i)
+        {
+            Node* node = replicatedNodes_.Find(*i);
+            if (node && !contentDirtyNodes_.Contains(*i))
+                UpdateContentHash(node);
+        }
+
+        for (HashSet<unsigned>::Iterator i = contentDirtyComponents_.Begin(); i != contentDirtyComponents_.End(); ++i)
+        {
+            Component* component = replicatedComponents_.Find(*i);
+            if (component)
+                UpdateContentHash(component);
+        }
+        for (HashSet<unsigned>::Iterator i = networkUpdateComponents_.Begin(); i != networkUpdateComponents_.End(); ++i)
+        {
+            Component* component = replicatedComponents_.Find(*i);
+            if (component && !contentDirtyComponents_.Contains(*i))
+                UpdateContentHash(component);
+        }
+    }
+
+    contentDirtyNodes_.Clear();
+    contentDirtyComponents_.Clear();
+    return totalContentHash_;
+}
+
 const String& Scene::GetVarName(StringHash hash) const
 {
     HashMap<StringHash, String>::ConstIterator i = varNames_.Find(hash);
@@ -602,8 +825,10 @@ void Scene::Update(float timeStep)
 
     // Update variable timestep logic
     SendEvent(E_SCENEUPDATE, eventData);
+    UpdateThreadSafeLogic(threadSafeUpdateLogic_, false, timeStep);
 
-    // Update scene attribute animation.
+    // Update attribute animations of the nodes and components in one batch, then those of other objects such as materials
+    UpdateAttributeAnimations(timeStep);
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
 
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
@@ -625,6 +850,9 @@ void Scene::Update(float timeStep)
 
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
+    UpdateThreadSafeLogic(threadSafePostUpdateLogic_, true, timeStep);
+
+    UpdateTransforms();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -654,6 +882,40 @@ void Scene::EndThreadedUpdate()
             (*i)->OnMarkedDirty((*i)->GetNode());
         delayedDirtyComponents_.Clear();
     }
+
+    if (!delayedChanges_.Empty())
+    {
+        PROFILE(ApplyDelayedChanges);
+
+        // Apply in the order requested. Changes requested from now on are applied immediately
+        for (unsigned i = 0; i < delayedChanges_.Size(); ++i)
+        {
+            DelayedChange& change = delayedChanges_[i];
+            switch (change.type_)
+            {
+            case DELAYED_CREATE_CHILD:
+                if (change.node_)
+                    change.node_->CreateChild(change.name_, change.mode_);
+                break;
+
+            case DELAYED_REMOVE_NODE:
+                if (change.node_)
+                    change.node_->Remove();
+                break;
+
+            case DELAYED_REMOVE_COMPONENT:
+                if (change.component_)
+                    change.component_->Remove();
+                break;
+
+            case DELAYED_SEND_EVENT:
+                if (change.sender_)
+                    change.sender_->SendEvent(change.eventType_, change.eventData_);
+                break;
+            }
+        }
+        delayedChanges_.Clear();
+    }
 }
 
 void Scene::DelayedMarkedDirty(Component* component)
@@ -662,8 +924,199 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::DelayedCreateChild(Node* parent, const String& name, CreateMode mode)
+{
+    if (!parent)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        parent->CreateChild(name, mode);
+        return;
+    }
+
+    // Weak references are not thread-safe, so also fill the queued change while holding the lock
+    MutexLock lock(sceneMutex_);
+    delayedChanges_.Resize(delayedChanges_.Size() + 1);
+    DelayedChange& change = delayedChanges_.Back();
+    change.type_ = DELAYED_CREATE_CHILD;
+    change.node_ = parent;
+    change.name_ = name;
+    change.mode_ = mode;
+}
+
+void Scene::DelayedRemove(Node* node)
+{
+    if (!node)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        node->Remove();
+        return;
+    }
+
+    MutexLock lock(sceneMutex_);
+    delayedChanges_.Resize(delayedChanges_.Size() + 1);
+    DelayedChange& change = delayedChanges_.Back();
+    change.type_ = DELAYED_REMOVE_NODE;
+    change.node_ = node;
+}
+
+void Scene::DelayedRemove(Component* component)
+{
+    if (!component)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        component->Remove();
+        return;
+    }
+
+    MutexLock lock(sceneMutex_);
+    delayedChanges_.Resize(delayedChanges_.Size() + 1);
+    DelayedChange& change = delayedChanges_.Back();
+    change.type_ = DELAYED_REMOVE_COMPONENT;
+    change.component_ = component;
+}
+
+void Scene::DelayedSendEvent(Object* sender, StringHash eventType, VariantMap& eventData)
+{
+    if (!sender)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        sender->SendEvent(eventType, eventData);
+        return;
+    }
+
+    MutexLock lock(sceneMutex_);
+    delayedChanges_.Resize(delayedChanges_.Size() + 1);
+    DelayedChange& change = delayedChanges_.Back();
+    change.type_ = DELAYED_SEND_EVENT;
+    change.sender_ = sender;
+    change.eventType_ = eventType;
+    change.eventData_ = eventData;
+}
+
+void Scene::AddThreadSafeLogic(LogicComponent* component, unsigned char mask)
+{
+    if (!component)
+        return;
+
+    StringHash type = component->GetType();
+    if (mask & USE_UPDATE)
+        threadSafeUpdateLogic_[type].Push(component);
+    if (mask & USE_POSTUPDATE)
+        threadSafePostUpdateLogic_[type].Push(component);
+}
+
+void Scene::RemoveThreadSafeLogic(LogicComponent* component, unsigned char mask)
+{
+    if (!component)
+        return;
+
+    StringHash type = component->GetType();
+    if (mask & USE_UPDATE)
+        RemoveLogicComponent(threadSafeUpdateLogic_, type, component);
+    if (mask & USE_POSTUPDATE)
+        RemoveLogicComponent(threadSafePostUpdateLogic_, type, component);
+}
+
+void Scene::SetTransformBatching(bool enable)
+{
+    transformBatching_ = enable;
+    if (!enable)
+        dirtyTransformNodes_.Clear();
+}
+
+void Scene::UpdateTransforms()
+{
+    if (dirtyTransformNodes_.Empty())
+        return;
+
+    PROFILE(UpdateTransforms);
+
+    // Without worker threads, recalculate each subtree depth first. Otherwise collect the nodes by depth, and recalculate one
+    // level at a time so that the parents are always up to date, splitting large levels into work items
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    bool threaded = queue && queue->GetNumThreads() && Thread::IsMainThread();
+
+    for (Vector<WeakPtr<Node> >::ConstIterator i = dirtyTransformNodes_.Begin(); i != dirtyTransformNodes_.End(); ++i)
+    {
+        Node* node = *i;
+        // Skip nodes that have been destroyed or removed from the scene
+        if (!node || node->scene_ != this || !node->parent_)
+            continue;
+        // Skip nodes whose parent is dirty, as they will be reached from the parent
+        if (node->parent_ != this && node->parent_->dirty_)
+            continue;
+
+        if (threaded)
+        {
+            unsigned depth = 0;
+            for (Node* parent = node->parent_; parent && parent != this; parent = parent->parent_)
+                ++depth;
+            CollectDirtyTransforms(node, depth);
+        }
+        else
+            UpdateDirtyTransforms(node);
+    }
+    dirtyTransformNodes_.Clear();
+
+    for (unsigned i = 0; i < transformLevels_.Size(); ++i)
+    {
+        PODVector<Node*>& level = transformLevels_[i];
+        if (level.Empty())
+            continue;
+
+        int numWorkItems = Min((int)queue->GetNumThreads() + 1, (int)(level.Size() / MIN_TRANSFORMS_PER_WORK_ITEM));
+        if (numWorkItems > 1)
+        {
+            unsigned nodesPerItem = (level.Size() + numWorkItems - 1) / numWorkItems;
+            for (unsigned start = 0; start < level.Size(); start += nodesPerItem)
+            {
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = M_MAX_UNSIGNED;
+                item->workFunction_ = UpdateWorldTransformsWork;
+                item->start_ = &level[start];
+                item->end_ = &level[0] + Min((int)(start + nodesPerItem), (int)level.Size());
+                queue->AddWorkItem(item);
+            }
+
+            queue->Complete(M_MAX_UNSIGNED);
+        }
+        else
+            UpdateWorldTransforms(&level[0], &level[0] + level.Size());
+
+        level.Clear();
+    }
+}
+
+void Scene::MarkTransformDirty(Node* node)
+{
+    if (!transformBatching_)
+        return;
+
+    // Nodes may be marked dirty from worker threads during a threaded update
+    if (!threadedUpdate_)
+        dirtyTransformNodes_.Push(WeakPtr<Node>(node));
+    else
+    {
+        MutexLock lock(sceneMutex_);
+        dirtyTransformNodes_.Push(WeakPtr<Node>(node));
+    }
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
+    // Reuse freed IDs first to keep the ID tables dense
+    unsigned freeID = mode == REPLICATED ? replicatedNodes_.PopFreeID() : localNodes_.PopFreeID();
+    if (freeID)
+        return freeID;
+
     if (mode == REPLICATED)
     {
         for (;;)
@@ -674,7 +1127,7 @@ unsigned Scene::GetFreeNodeID(CreateMode mode)
             else
                 replicatedNodeID_ = FIRST_REPLICATED_ID;
 
-            if (!replicatedNodes_.Contains(ret))
+            if (!replicatedNodes_.Find(ret))
                 return ret;
         }
     }
@@ -688,7 +1141,7 @@ unsigned Scene::GetFreeNodeID(CreateMode mode)
             else
                 localNodeID_ = FIRST_LOCAL_ID;
 
-            if (!localNodes_.Contains(ret))
+            if (!localNodes_.Find(ret))
                 return ret;
         }
     }
@@ -696,6 +1149,10 @@ unsigned Scene::GetFreeNodeID(CreateMode mode)
 
 unsigned Scene::GetFreeComponentID(CreateMode mode)
 {
+    unsigned freeID = mode == REPLICATED ? replicatedComponents_.PopFreeID() : localComponents_.PopFreeID();
+    if (freeID)
+        return freeID;
+
     if (mode == REPLICATED)
     {
         for (;;)
@@ -706,7 +1163,7 @@ unsigned Scene::GetFreeComponentID(CreateMode mode)
             else
                 replicatedComponentID_ = FIRST_REPLICATED_ID;
 
-            if (!replicatedComponents_.Contains(ret))
+            if (!replicatedComponents_.Find(ret))
                 return ret;
         }
     }
@@ -720,7 +1177,7 @@ unsigned Scene::GetFreeComponentID(CreateMode mode)
             else
                 localComponentID_ = FIRST_LOCAL_ID;
 
-            if (!localComponents_.Contains(ret))
+            if (!localComponents_.Find(ret))
                 return ret;
         }
     }
@@ -749,29 +1206,32 @@ void Scene::NodeAdded(Node* node)
     // If node with same ID exists, remove the scene reference from it and overwrite with the new node
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Find(id);
-        if (i != replicatedNodes_.End() && i->second_ != node)
+        Node* oldNode = replicatedNodes_.Find(id);
+        if (oldNode && oldNode != node)
         {
             LOGWARNING("Overwriting node with ID " + String(id));
-            NodeRemoved(i->second_);
+            NodeRemoved(oldNode);
         }
 
-        replicatedNodes_[id] = node;
+        replicatedNodes_.Insert(id, node);
 
         MarkNetworkUpdate(node);
         MarkReplicationDirty(node);
     }
     else
     {
-        HashMap<unsigned, Node*>::Iterator i = localNodes_.Find(id);
-        if (i != localNodes_.End() && i->second_ != node)
+        Node* oldNode = localNodes_.Find(id);
+        if (oldNode && oldNode != node)
         {
             LOGWARNING("Overwriting node with ID " + String(id));
-            NodeRemoved(i->second_);
+            NodeRemoved(oldNode);
         }
-        localNodes_[id] = node;
+        localNodes_.Insert(id, node);
     }
 
+    if (node->GetNumAttributeAnimations())
+        AddAnimatedObject(node);
+
     // Add already created components and child nodes now
     const Vector<SharedPtr<Component> >& components = node->GetComponents();
     for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
@@ -791,10 +1251,17 @@ void Scene::NodeRemoved(Node* node)
     {
         replicatedNodes_.Erase(id);
         MarkReplicationDirty(node);
+        if (contentHashValid_)
+        {
+            totalContentHash_ -= node->contentHash_;
+            contentDirtyNodes_.Erase(id);
+        }
+        node->contentHash_ = 0;
     }
     else
         localNodes_.Erase(id);
 
+    RemoveAnimatedObject(node);
     node->ResetScene();
 
     // Remove components and child nodes as well
@@ -822,27 +1289,40 @@ void Scene::ComponentAdded(Component* component)
 
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
-        if (i != replicatedComponents_.End() && i->second_ != component)
+        Component* oldComponent = replicatedComponents_.Find(id);
+        if (oldComponent && oldComponent != component)
         {
             LOGWARNING("Overwriting component with ID " + String(id));
-            ComponentRemoved(i->second_);
+            ComponentRemoved(oldComponent);
         }
 
-        replicatedComponents_[id] = component;
+        replicatedComponents_.Insert(id, component);
+        // The component may still be flagged for network update from a previous scene, so mark it dirty directly
+        if (contentHashValid_)
+            contentDirtyComponents_.Insert(id);
     }
     else
     {
-        HashMap<unsigned, Component*>::Iterator i = localComponents_.Find(id);
-        if (i != localComponents_.End() && i->second_ != component)
+        Component* oldComponent = localComponents_.Find(id);
+        if (oldComponent && oldComponent != component)
         {
             LOGWARNING("Overwriting component with ID " + String(id));
-            ComponentRemoved(i->second_);
+            ComponentRemoved(oldComponent);
         }
 
-        localComponents_[id] = component;
+        localComponents_.Insert(id, component);
     }
 
+    if (component->sceneTypeIndex_ == M_MAX_UNSIGNED)
+    {
+        PODVector<Component*>& group = componentsByType_[component->GetType()];
+        component->sceneTypeIndex_ = group.Size();
+        group.Push(component);
+    }
+
+    if (component->GetNumAttributeAnimations())
+        AddAnimatedObject(component);
+
     component->OnSceneSet(this);
 }
 
@@ -853,10 +1333,30 @@ void Scene::ComponentRemoved(Component* component)
 
     unsigned id = component->GetID();
     if (id < FIRST_LOCAL_ID)
+    {
         replicatedComponents_.Erase(id);
+        if (contentHashValid_)
+        {
+            totalContentHash_ -= component->contentHash_;
+            contentDirtyComponents_.Erase(id);
+        }
+        component->contentHash_ = 0;
+    }
     else
         localComponents_.Erase(id);
 
+    // Fill the hole in the type group with its last component, so that removal takes constant time
+    if (component->sceneTypeIndex_ != M_MAX_UNSIGNED)
+    {
+        PODVector<Component*>& group = componentsByType_[component->GetType()];
+        Component* last = group.Back();
+        group[component->sceneTypeIndex_] = last;
+        last->sceneTypeIndex_ = component->sceneTypeIndex_;
+        group.Pop();
+        component->sceneTypeIndex_ = M_MAX_UNSIGNED;
+    }
+
+    RemoveAnimatedObject(component);
     component->SetID(0);
     component->OnSceneSet(0);
 }
@@ -887,6 +1387,10 @@ String Scene::GetVarNamesAttr() const
 
 void Scene::PrepareNetworkUpdate()
 {
+    // The removals of the replicated IDs freed since the last network update are sent in this update
+    replicatedNodes_.ReleaseDeferredIDs();
+    replicatedComponents_.ReleaseDeferredIDs();
+
     for (HashSet<unsigned>::Iterator i = networkUpdateNodes_.Begin(); i != networkUpdateNodes_.End(); ++i)
     {
         Node* node = GetNode(*i);
@@ -909,11 +1413,22 @@ void Scene::CleanupConnection(Connection* connection)
 {
     Node::CleanupConnection(connection);
 
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
-        i->second_->CleanupConnection(connection);
+    PODVector<Node*> nodes;
+    replicatedNodes_.GetObjects(nodes);
+    for (PODVector<Node*>::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+        (*i)->CleanupConnection(connection);
+
+    PODVector<Component*> components;
+    replicatedComponents_.GetObjects(components);
+    for (PODVector<Component*>::Iterator i = components.Begin(); i != components.End(); ++i)
+        (*i)->CleanupConnection(connection);
 
-    for (HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
-        i->second_->CleanupConnection(connection);
+    // Reuse freed replicated IDs immediately again when no longer replicated
+    if (!networkState_ || networkState_->replicationStates_.Empty())
+    {
+        replicatedNodes_.SetDeferReuse(false);
+        replicatedComponents_.SetDeferReuse(false);
+    }
 }
 
 void Scene::MarkNetworkUpdate(Node* node)
@@ -921,11 +1436,17 @@ void Scene::MarkNetworkUpdate(Node* node)
     if (node)
     {
         if (!threadedUpdate_)
+        {
             networkUpdateNodes_.Insert(node->GetID());
+            if (contentHashValid_)
+                contentDirtyNodes_.Insert(node->GetID());
+        }
         else
         {
             MutexLock lock(sceneMutex_);
             networkUpdateNodes_.Insert(node->GetID());
+            if (contentHashValid_)
+                contentDirtyNodes_.Insert(node->GetID());
         }
     }
 }
@@ -935,11 +1456,17 @@ void Scene::MarkNetworkUpdate(Component* component)
     if (component)
     {
         if (!threadedUpdate_)
+        {
             networkUpdateComponents_.Insert(component->GetID());
+            if (contentHashValid_)
+                contentDirtyComponents_.Insert(component->GetID());
+        }
         else
         {
             MutexLock lock(sceneMutex_);
             networkUpdateComponents_.Insert(component->GetID());
+            if (contentHashValid_)
+                contentDirtyComponents_.Insert(component->GetID());
         }
     }
 }
@@ -959,6 +1486,43 @@ void Scene::MarkReplicationDirty(Node* node)
     }
 }
 
+void Scene::AttributeAnimationsChanged(Animatable* object)
+{
+    if (!object)
+        return;
+
+    if (object->GetNumAttributeAnimations())
+        AddAnimatedObject(object);
+    else
+        RemoveAnimatedObject(object);
+
+    animatedAttributesDirty_ = true;
+}
+
+void Scene::AddAnimatedObject(Animatable* object)
+{
+    if (object->animatedIndex_ != M_MAX_UNSIGNED)
+        return;
+
+    object->animatedIndex_ = animatedObjects_.Size();
+    animatedObjects_.Push(object);
+    animatedAttributesDirty_ = true;
+}
+
+void Scene::RemoveAnimatedObject(Animatable* object)
+{
+    if (object->animatedIndex_ == M_MAX_UNSIGNED)
+        return;
+
+    // Fill the hole with the last object, so that removal takes constant time
+    Animatable* last = animatedObjects_.Back();
+    animatedObjects_[object->animatedIndex_] = last;
+    last->animatedIndex_ = object->animatedIndex_;
+    animatedObjects_.Pop();
+    object->animatedIndex_ = M_MAX_UNSIGNED;
+    animatedAttributesDirty_ = true;
+}
+
 void Scene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 {
     using namespace Update;
@@ -1224,6 +1788,294 @@ void Scene::PreloadResourcesXML(const XMLElement& element)
     }
 }
 
+void Scene::UpdateThreadSafeLogic(HashMap<StringHash, PODVector<LogicComponent*> >& components, bool postUpdate, float timeStep)
+{
+    if (components.Empty())
+        return;
+
+    PROFILE(UpdateThreadSafeLogic);
+
+    // Delay the scene changes also when updating in the main thread, so that the component lists stay unchanged
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    threadedUpdate_ = true;
+
+    if (queue && queue->GetNumThreads())
+    {
+        // Keep the components of one type in the same work items, and split large groups among the threads
+        for (HashMap<StringHash, PODVector<LogicComponent*> >::Iterator i = components.Begin(); i != components.End(); ++i)
+        {
+            PODVector<LogicComponent*>& group = i->second_;
+            if (group.Empty())
+                continue;
+
+            int numWorkItems = Clamp((int)(group.Size() / MIN_LOGIC_COMPONENTS_PER_WORK_ITEM), 1, (int)queue->GetNumThreads() + 1);
+            unsigned componentsPerItem = (group.Size() + numWorkItems - 1) / numWorkItems;
+            for (unsigned start = 0; start < group.Size(); start += componentsPerItem)
+            {
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = M_MAX_UNSIGNED;
+                item->workFunction_ = postUpdate ? PostUpdateLogicWork : UpdateLogicWork;
+                item->start_ = &group[start];
+                item->end_ = &group[0] + Min((int)(start + componentsPerItem), (int)group.Size());
+                item->aux_ = &timeStep;
+                queue->AddWorkItem(item);
+            }
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (HashMap<StringHash, PODVector<LogicComponent*> >::Iterator i = components.Begin(); i != components.End(); ++i)
+        {
+            PODVector<LogicComponent*>& group = i->second_;
+            for (PODVector<LogicComponent*>::Iterator j = group.Begin(); j != group.End(); ++j)
+            {
+                if (postUpdate)
+                    (*j)->PostUpdate(timeStep);
+                else
+                    (*j)->Update(timeStep);
+            }
+        }
+    }
+
+    EndThreadedUpdate();
+}
+
+void Scene::UpdateLogicWork(const WorkItem* item, unsigned threadIndex)
+{
+    float timeStep = *reinterpret_cast<float*>(item->aux_);
+    for (LogicComponent** i = reinterpret_cast<LogicComponent**>(item->start_); i != item->end_; ++i)
+        (*i)->Update(timeStep);
+}
+
+void Scene::PostUpdateLogicWork(const WorkItem* item, unsigned threadIndex)
+{
+    float timeStep = *reinterpret_cast<float*>(item->aux_);
+    for (LogicComponent** i = reinterpret_cast<LogicComponent**>(item->start_); i != item->end_; ++i)
+        (*i)->PostUpdate(timeStep);
+}
+
+void Scene::CollectDirtyTransforms(Node* node, unsigned depth)
+{
+    if (node->dirty_)
+    {
+        // Clear the dirty flag already so that the node is collected only once. The world transform is recalculated
+        // before anything else can read it
+        node->dirty_ = false;
+        if (transformLevels_.Size() <= depth)
+            transformLevels_.Resize(depth + 1);
+        transformLevels_[depth].Push(node);
+    }
+
+    // Also visit the children of a node that has been recalculated on demand since it was queued, as they may still be dirty
+    const Vector<SharedPtr<Node> >& children = node->children_;
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        CollectDirtyTransforms(*i, depth + 1);
+}
+
+void Scene::UpdateDirtyTransforms(Node* node)
+{
+    if (node->dirty_)
+        node->UpdateWorldTransform();
+
+    const Vector<SharedPtr<Node> >& children = node->children_;
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        UpdateDirtyTransforms(*i);
+}
+
+void Scene::UpdateWorldTransforms(Node** start, Node** end)
+{
+    while (start != end)
+        (*start++)->UpdateWorldTransform();
+}
+
+void Scene::UpdateWorldTransformsWork(const WorkItem* item, unsigned threadIndex)
+{
+    UpdateWorldTransforms(reinterpret_cast<Node**>(item->start_), reinterpret_cast<Node**>(item->end_));
+}
+
+void Scene::UpdateAttributeAnimations(float timeStep)
+{
+    if (animatedObjects_.Empty())
+        return;
+
+    PROFILE(UpdateAttributeAnimations);
+
+    // Rebuild the attribute list only when attribute animations have been added, replaced or removed
+    if (animatedAttributesDirty_)
+    {
+        unsigned dataSize = 0;
+        animatedAttributes_.Clear();
+        for (PODVector<Animatable*>::ConstIterator i = animatedObjects_.Begin(); i != animatedObjects_.End(); ++i)
+        {
+            const HashMap<String, SharedPtr<AttributeAnimationInfo> >& infos = (*i)->attributeAnimationInfos_;
+            for (HashMap<String, SharedPtr<AttributeAnimationInfo> >::ConstIterator j = infos.Begin(); j != infos.End(); ++j)
+            {
+                AnimatedAttribute attr;
+                attr.object_ = *i;
+                attr.info_ = j->second_;
+                attr.attributeInfo_ = &attr.info_->GetAttributeInfo();
+                attr.animation_ = attr.info_->GetAnimation();
+                attr.scaledTime_ = 0.0f;
+                attr.dataOffset_ = dataSize;
+                attr.numComponents_ = attr.animation_ ? attr.animation_->PrepareAnimationData() : 0;
+                attr.enabled_ = false;
+                attr.batched_ = false;
+                attr.finished_ = false;
+                animatedAttributes_.Push(attr);
+                dataSize += attr.numComponents_;
+            }
+        }
+
+        animationData_.Resize(dataSize);
+        animatedAttributesDirty_ = false;
+    }
+
+    // Advance the animation times. Animations that can not be evaluated as floats, for example due to their value type, are
+    // updated one at a time afterward
+    unsigned numBatched = 0;
+    bool rebuild = false;
+    for (PODVector<AnimatedAttribute>::Iterator i = animatedAttributes_.Begin(); i != animatedAttributes_.End(); ++i)
+    {
+        i->enabled_ = i->object_->animationEnabled_;
+        i->batched_ = false;
+        i->finished_ = false;
+        if (!i->enabled_ || !i->numComponents_)
+            continue;
+
+        // If the key frames were changed so that the value size differs, fall back until the list is rebuilt
+        if (i->animation_->PrepareAnimationData() != i->numComponents_)
+        {
+            rebuild = true;
+            continue;
+        }
+
+        i->info_->AdvanceTime(timeStep, i->scaledTime_, i->finished_);
+        i->batched_ = true;
+        ++numBatched;
+    }
+
+    // Evaluate the values, splitting large batches into work items
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    int numWorkItems = queue ? Min((int)queue->GetNumThreads() + 1, (int)(numBatched / MIN_ATTRIBUTE_ANIMATIONS_PER_WORK_ITEM)) :
+        1;
+    if (numWorkItems > 1)
+    {
+        unsigned attrsPerItem = (animatedAttributes_.Size() + numWorkItems - 1) / numWorkItems;
+        for (unsigned start = 0; start < animatedAttributes_.Size(); start += attrsPerItem)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = EvaluateAttributeAnimationsWork;
+            item->start_ = &animatedAttributes_[start];
+            item->end_ = &animatedAttributes_[0] + Min((int)(start + attrsPerItem), (int)animatedAttributes_.Size());
+            item->aux_ = &animationData_[0];
+            queue->AddWorkItem(item);
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else if (numBatched)
+        EvaluateAttributeAnimations(&animatedAttributes_[0], &animatedAttributes_[0] + animatedAttributes_.Size(), &animationData_[0]);
+
+    // Apply the values through the typed attribute accessors, calling ApplyAttributes() once per object. Keep the animations
+    // that still have to be updated, send events or be removed, as event handlers may change or destroy the objects
+    Vector<SharedPtr<AttributeAnimationInfo> > pendingInfos;
+    PODVector<AnimatedAttribute> pendingAttributes;
+    MemoryBuffer buffer(animationData_.Size() ? &animationData_[0] : 0, animationData_.Size() * sizeof(float));
+    for (unsigned i = 0; i < animatedAttributes_.Size(); ++i)
+    {
+        AnimatedAttribute& attr = animatedAttributes_[i];
+        if (!attr.enabled_)
+            continue;
+
+        if (attr.batched_)
+        {
+            buffer.Seek(attr.dataOffset_ * sizeof(float));
+            attr.object_->ReadAttributeData(*attr.attributeInfo_, buffer);
+            if (i + 1 == animatedAttributes_.Size() || animatedAttributes_[i + 1].object_ != attr.object_)
+                attr.object_->ApplyAttributes();
+
+            // A setter removed or replaced animations, or removed an animated object. The rest of the list may refer to
+            // destroyed objects, so stop applying until it has been rebuilt on the next update
+            if (animatedAttributesDirty_)
+                break;
+
+            if (!attr.finished_ && !attr.animation_->HasEventFrames())
+            {
+                attr.info_->SendEventFrames(attr.scaledTime_);
+                continue;
+            }
+        }
+
+        pendingInfos.Push(SharedPtr<AttributeAnimationInfo>(attr.info_));
+        pendingAttributes.Push(attr);
+    }
+
+    if (rebuild)
+        animatedAttributesDirty_ = true;
+
+    for (unsigned i = 0; i < pendingInfos.Size(); ++i)
+    {
+        AttributeAnimationInfo* info = pendingInfos[i];
+        AnimatedAttribute& attr = pendingAttributes[i];
+        if (!info->GetTarget())
+            continue;
+
+        if (attr.batched_)
+            info->SendEventFrames(attr.scaledTime_);
+        else
+            attr.finished_ = info->Update(timeStep);
+    }
+
+    // Remove finished animations, unless they were already replaced
+    for (unsigned i = 0; i < pendingInfos.Size(); ++i)
+    {
+        AttributeAnimationInfo* info = pendingInfos[i];
+        Animatable* object = static_cast<Animatable*>(info->GetTarget());
+        if (pendingAttributes[i].finished_ && object)
+        {
+            const String& name = info->GetAttributeInfo().name_;
+            if (object->GetAttributeAnimationInfo(name) == info)
+                object->SetAttributeAnimation(name, 0);
+        }
+    }
+}
+
+void Scene::EvaluateAttributeAnimations(AnimatedAttribute* start, AnimatedAttribute* end, float* data)
+{
+    for (AnimatedAttribute* i = start; i != end; ++i)
+    {
+        if (i->batched_)
+            i->animation_->GetAnimationData(i->scaledTime_, data + i->dataOffset_);
+    }
+}
+
+void Scene::EvaluateAttributeAnimationsWork(const WorkItem* item, unsigned threadIndex)
+{
+    EvaluateAttributeAnimations(reinterpret_cast<AnimatedAttribute*>(item->start_), reinterpret_cast<AnimatedAttribute*>(item->end_),
+        reinterpret_cast<float*>(item->aux_));
+}
+
+void Scene::UpdateContentHash(Node* node)
+{
+    totalContentHash_ -= node->contentHash_;
+    Node* parent = node->GetParent();
+    node->contentHash_ = HashNetworkAttributes(node, node->GetID(), parent && parent->GetID() < FIRST_LOCAL_ID ? parent->GetID() : 0,
+        true);
+    totalContentHash_ += node->contentHash_;
+}
+
+void Scene::UpdateContentHash(Component* component)
+{
+    Node* node = component->GetNode();
+    totalContentHash_ -= component->contentHash_;
+    component->contentHash_ = HashNetworkAttributes(component, component->GetID(), node ? node->GetID() : 0,
+        false);
+    totalContentHash_ += component->contentHash_;
+}
+
 void RegisterSceneLibrary(Context* context)
 {
     ValueAnimation::RegisterObject(context);
@@ -1233,6 +2085,8 @@ void RegisterSceneLibrary(Context* context)
     SmoothedTransform::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
+    Prefab::RegisterObject(context);
+    SceneStreamer::RegisterObject(context);
 }
 
 }
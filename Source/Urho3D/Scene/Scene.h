@@ -26,13 +26,16 @@
 #include "../Core/Mutex.h"
 #include "../Resource/XMLElement.h"
 #include "../Scene/Node.h"
+#include "../Scene/SceneIDTable.h"
 #include "../Scene/SceneResolver.h"
 
 namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
+struct WorkItem;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -73,6 +76,61 @@ struct AsyncProgress
     unsigned totalNodes_;
 };
 
+/// %Scene change requested during a threaded update.
+enum DelayedChangeType
+{
+    DELAYED_CREATE_CHILD = 0,
+    DELAYED_REMOVE_NODE,
+    DELAYED_REMOVE_COMPONENT,
+    DELAYED_SEND_EVENT
+};
+
+/// %Scene change requested during a threaded update, applied in the main thread when the update ends.
+struct DelayedChange
+{
+    /// Change type.
+    DelayedChangeType type_;
+    /// Node to remove, or parent node of the child to create.
+    WeakPtr<Node> node_;
+    /// Component to remove.
+    WeakPtr<Component> component_;
+    /// Event sender.
+    WeakPtr<Object> sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Event parameters.
+    VariantMap eventData_;
+    /// Name of the child node to create.
+    String name_;
+    /// Create mode of the child node to create.
+    CreateMode mode_;
+};
+
+/// Attribute animation in the batched attribute animation update.
+struct AnimatedAttribute
+{
+    /// Animated object.
+    Animatable* object_;
+    /// Attribute animation instance.
+    AttributeAnimationInfo* info_;
+    /// Animated attribute.
+    const AttributeInfo* attributeInfo_;
+    /// Animation.
+    ValueAnimation* animation_;
+    /// Time to evaluate the animation at.
+    float scaledTime_;
+    /// Offset of the value in the evaluated data.
+    unsigned dataOffset_;
+    /// Number of floats in the value, or zero if the animation is updated through Update() instead.
+    unsigned numComponents_;
+    /// Whether the object's animation is enabled on this frame.
+    bool enabled_;
+    /// Whether the value is evaluated as floats on this frame.
+    bool batched_;
+    /// Whether the animation finished.
+    bool finished_;
+};
+
 /// Root scene node, represents the whole scene.
 class URHO3D_API Scene : public Node
 {
@@ -100,13 +158,17 @@ public:
     /// Add a replication state that is tracking this scene.
     virtual void AddReplicationState(NodeReplicationState* state);
 
-    /// Load from an XML file. Return true if successful.
+    /// Load from an XML file, or from the binary format if the file has been cooked. Return true if successful.
     bool LoadXML(Deserializer& source);
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
+    /// Save a snapshot of the whole scene in a compact binary format that is faster to save and restore than the regular binary format, but is not meant for long-term storage. Return true if successful.
+    bool SaveSnapshot(Serializer& dest);
+    /// Restore a snapshot saved with SaveSnapshot(). Removes all existing child nodes and components first, unless the snapshot is invalid. Return true if successful.
+    bool LoadSnapshot(Deserializer& source);
     /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsync(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
-    /// Load from an XML file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
+    /// Load from an XML file asynchronously, or from the binary format if the file has been cooked. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsyncXML(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
     /// Stop asynchronous loading.
     void StopAsyncLoading();
@@ -146,6 +208,20 @@ public:
     Node* GetNode(unsigned id) const;
     /// Return component from the whole scene by ID, or null if not found.
     Component* GetComponent(unsigned id) const;
+    /// Return a generation-checked handle to a node, or a null handle if the node is not in this scene.
+    SceneHandle GetHandle(Node* node) const;
+    /// Return a generation-checked handle to a component, or a null handle if the component is not in this scene.
+    SceneHandle GetHandle(Component* component) const;
+    /// Return node by handle, or null if it has been removed, even if its ID has been given to another node.
+    Node* GetNode(const SceneHandle& handle) const;
+    /// Return component by handle, or null if it has been removed, even if its ID has been given to another component.
+    Component* GetComponent(const SceneHandle& handle) const;
+    /// Return all components of a type in the scene, in no particular order. Components of derived types are not included. The vector changes when components of the type are added or removed, so copy it if doing either while iterating.
+    const PODVector<Component*>& GetComponentsByType(StringHash type) const;
+    /// Return number of components of a type in the scene. Components of derived types are not included.
+    unsigned GetNumComponentsByType(StringHash type) const;
+    /// Template version of returning all components of a type in the scene.
+    template <class T> const PODVector<T*>& GetComponentsByType() const;
 
     /// Return whether updates are enabled.
     bool IsUpdateEnabled() const { return updateEnabled_; }
@@ -165,6 +241,9 @@ public:
     /// Return source file checksum.
     unsigned GetChecksum() const { return checksum_; }
 
+    /// Return hash of the network attributes of all replicated nodes and components. The first call hashes the whole scene, after which only the objects marked for network update are rehashed. Should not be called during threaded update.
+    unsigned GetContentHash();
+
     /// Return update time scale.
     float GetTimeScale() const { return timeScale_; }
 
@@ -194,10 +273,32 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Create a child node when the threaded update ends, or immediately if not in threaded update. Is thread-safe.
+    void DelayedCreateChild(Node* parent, const String& name = String::EMPTY, CreateMode mode = REPLICATED);
+    /// Remove a node when the threaded update ends, or immediately if not in threaded update. Is thread-safe.
+    void DelayedRemove(Node* node);
+    /// Remove a component when the threaded update ends, or immediately if not in threaded update. Is thread-safe.
+    void DelayedRemove(Component* component);
+    /// Send an event when the threaded update ends, or immediately if not in threaded update. Is thread-safe.
+    void DelayedSendEvent(Object* sender, StringHash eventType, VariantMap& eventData);
+    /// Add a thread-safe logic component to be updated by the scene. Called by LogicComponent.
+    void AddThreadSafeLogic(LogicComponent* component, unsigned char mask);
+    /// Remove a thread-safe logic component from the scene updates. Called by LogicComponent.
+    void RemoveThreadSafeLogic(LogicComponent* component, unsigned char mask);
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
 
+    /// Enable or disable batched world transform updates. When enabled, the topmost nodes whose transform changed are queued, and the world transforms below them are recalculated in one pass ordered by hierarchy depth, using the worker threads for large levels. Default false.
+    void SetTransformBatching(bool enable);
+    /// Recalculate the world transforms of the queued dirty nodes. Called at the end of the scene update, and by the octree before updating drawables.
+    void UpdateTransforms();
+    /// Queue a node for the batched world transform update. Called by Node when its transform becomes dirty.
+    void MarkTransformDirty(Node* node);
+
+    /// Return whether batched world transform updates are enabled.
+    bool GetTransformBatching() const { return transformBatching_; }
+
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
     /// Get free component ID, either non-local or local.
@@ -224,6 +325,10 @@ public:
     void MarkNetworkUpdate(Component* component);
     /// Mark a node dirty in scene replication states. The node does not need to have own replication state yet.
     void MarkReplicationDirty(Node* node);
+    /// Add, refresh or remove a node or component in the batched attribute animation update after its attribute animations were added, replaced or removed.
+    void AttributeAnimationsChanged(Animatable* object);
+    /// Return number of nodes and components with attribute animations.
+    unsigned GetNumAnimatedObjects() const { return animatedObjects_.Size(); }
 
 private:
     /// Handle the logic update event to update the scene, if active.
@@ -242,15 +347,45 @@ private:
     void PreloadResources(File* file, bool isSceneFile);
     /// Preload resources from an XML scene or object prefab file.
     void PreloadResourcesXML(const XMLElement& element);
+    /// Update thread-safe logic components grouped by type, in worker threads if available.
+    void UpdateThreadSafeLogic(HashMap<StringHash, PODVector<LogicComponent*> >& components, bool postUpdate, float timeStep);
+    /// Call Update() of a range of logic components in a worker thread.
+    static void UpdateLogicWork(const WorkItem* item, unsigned threadIndex);
+    /// Call PostUpdate() of a range of logic components in a worker thread.
+    static void PostUpdateLogicWork(const WorkItem* item, unsigned threadIndex);
+    /// Collect the dirty nodes of a subtree by hierarchy depth for the batched world transform update.
+    void CollectDirtyTransforms(Node* node, unsigned depth);
+    /// Recalculate the dirty world transforms of a subtree depth first.
+    static void UpdateDirtyTransforms(Node* node);
+    /// Recalculate world transforms of a range of nodes whose parents are up to date.
+    static void UpdateWorldTransforms(Node** start, Node** end);
+    /// Recalculate world transforms of a range of nodes in a worker thread.
+    static void UpdateWorldTransformsWork(const WorkItem* item, unsigned threadIndex);
+    /// Add a node or component with attribute animations to the batched attribute animation update.
+    void AddAnimatedObject(Animatable* object);
+    /// Remove a node or component from the batched attribute animation update.
+    void RemoveAnimatedObject(Animatable* object);
+    /// Update the attribute animations of the nodes and components, evaluating the values in worker threads if available.
+    void UpdateAttributeAnimations(float timeStep);
+    /// Evaluate a range of attribute animations.
+    static void EvaluateAttributeAnimations(AnimatedAttribute* start, AnimatedAttribute* end, float* data);
+    /// Evaluate a range of attribute animations in a worker thread.
+    static void EvaluateAttributeAnimationsWork(const WorkItem* item, unsigned threadIndex);
+    /// Rehash a replicated node for the content hash.
+    void UpdateContentHash(Node* node);
+    /// Rehash a replicated component for the content hash.
+    void UpdateContentHash(Component* component);
 
     /// Replicated scene nodes by ID.
-    HashMap<unsigned, Node*> replicatedNodes_;
+    SceneIDTable<Node> replicatedNodes_;
     /// Local scene nodes by ID.
-    HashMap<unsigned, Node*> localNodes_;
+    SceneIDTable<Node> localNodes_;
     /// Replicated components by ID.
-    HashMap<unsigned, Component*> replicatedComponents_;
+    SceneIDTable<Component> replicatedComponents_;
     /// Local components by ID.
-    HashMap<unsigned, Component*> localComponents_;
+    SceneIDTable<Component> localComponents_;
+    /// Components by type.
+    HashMap<StringHash, PODVector<Component*> > componentsByType_;
     /// Asynchronous loading progress.
     AsyncProgress asyncProgress_;
     /// Node and component ID resolver for asynchronous loading.
@@ -265,9 +400,29 @@ private:
     HashSet<unsigned> networkUpdateNodes_;
     /// Components to check for attribute changes on the next network update.
     HashSet<unsigned> networkUpdateComponents_;
+    /// Nodes to rehash on the next content hash query.
+    HashSet<unsigned> contentDirtyNodes_;
+    /// Components to rehash on the next content hash query.
+    HashSet<unsigned> contentDirtyComponents_;
     /// Delayed dirty notification queue for components.
     PODVector<Component*> delayedDirtyComponents_;
-    /// Mutex for the delayed dirty notification queue.
+    /// Topmost nodes whose transform became dirty, queued for the batched world transform update.
+    Vector<WeakPtr<Node> > dirtyTransformNodes_;
+    /// Dirty nodes collected for the batched world transform update, by hierarchy depth.
+    Vector<PODVector<Node*> > transformLevels_;
+    /// Scene changes requested during threaded update.
+    Vector<DelayedChange> delayedChanges_;
+    /// Thread-safe logic components using the update by type.
+    HashMap<StringHash, PODVector<LogicComponent*> > threadSafeUpdateLogic_;
+    /// Thread-safe logic components using the post-update by type.
+    HashMap<StringHash, PODVector<LogicComponent*> > threadSafePostUpdateLogic_;
+    /// Nodes and components with attribute animations.
+    PODVector<Animatable*> animatedObjects_;
+    /// Attribute animations collected for the batched update.
+    PODVector<AnimatedAttribute> animatedAttributes_;
+    /// Evaluated attribute animation values.
+    PODVector<float> animationData_;
+    /// Mutex for the delayed dirty notification and scene change queues.
     Mutex sceneMutex_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
@@ -281,6 +436,8 @@ private:
     unsigned localComponentID_;
     /// Scene source file checksum.
     mutable unsigned checksum_;
+    /// Sum of the content hashes of the replicated nodes and components.
+    unsigned totalContentHash_;
     /// Maximum milliseconds per frame to spend on async scene loading.
     int asyncLoadingMs_;
     /// Scene update time scale.
@@ -297,8 +454,19 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched world transform update flag.
+    bool transformBatching_;
+    /// Attribute animation list dirty flag.
+    bool animatedAttributesDirty_;
+    /// Content hash valid flag. Changes are tracked only after the first full hash.
+    bool contentHashValid_;
 };
 
+template <class T> const PODVector<T*>& Scene::GetComponentsByType() const
+{
+    return reinterpret_cast<const PODVector<T*>&>(GetComponentsByType(T::GetTypeStatic()));
+}
+
 /// Register Scene library objects.
 void URHO3D_API RegisterSceneLibrary(Context* context);
 
@@ -110,6 +110,29 @@ EVENT(E_ASYNCLOADFINISHED, AsyncLoadFinished)
     PARAM(P_SCENE, Scene);                  // Scene pointer
 };
 
+/// Streamed scene cell finished loading.
+EVENT(E_STREAMINGCELLLOADED, StreamingCellLoaded)
+{
+    PARAM(P_SCENE, Scene);                  // Scene pointer
+    PARAM(P_NODE, Node);                    // Node pointer
+    PARAM(P_CELL, Cell);                    // IntVector2
+    PARAM(P_NUMNODES, NumNodes);            // int
+    PARAM(P_DATASIZE, DataSize);            // int
+    PARAM(P_RESOURCEMEMORY, ResourceMemory); // int
+    PARAM(P_PRELOADTIME, PreloadTime);      // float
+    PARAM(P_LOADTIME, LoadTime);            // float
+    PARAM(P_LOADFRAMES, LoadFrames);        // int
+};
+
+/// Streamed scene cell unloaded.
+EVENT(E_STREAMINGCELLUNLOADED, StreamingCellUnloaded)
+{
+    PARAM(P_SCENE, Scene);                  // Scene pointer
+    PARAM(P_NODE, Node);                    // Node pointer
+    PARAM(P_CELL, Cell);                    // IntVector2
+    PARAM(P_UNLOADTIME, UnloadTime);        // float
+};
+
 /// A child node has been added to a parent node.
 EVENT(E_NODEADDED, NodeAdded)
 {
@@ -0,0 +1,306 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+
+namespace Urho3D
+{
+
+/// Minimum number of freed IDs before they are reused, so that the ID of a removed object is not immediately given to a new one.
+static const unsigned MIN_FREE_SCENE_IDS = 1024;
+/// Number of IDs beyond twice the slot count that are still stored in the slots. IDs further away are stored in a hash map.
+static const unsigned SCENE_ID_SLOT_SLACK = 4096;
+
+/// Generation-checked reference to a scene node or component. Unlike a plain ID, it no longer resolves once the object is removed, even if the ID is later given to another object.
+struct URHO3D_API SceneHandle
+{
+    /// Construct null.
+    SceneHandle() :
+        id_(0),
+        generation_(0)
+    {
+    }
+
+    /// Construct with ID and generation.
+    SceneHandle(unsigned id, unsigned generation) :
+        id_(id),
+        generation_(generation)
+    {
+    }
+
+    /// Test for equality with another handle.
+    bool operator ==(const SceneHandle& rhs) const { return id_ == rhs.id_ && generation_ == rhs.generation_; }
+    /// Test for inequality with another handle.
+    bool operator !=(const SceneHandle& rhs) const { return id_ != rhs.id_ || generation_ != rhs.generation_; }
+
+    /// Return whether is null.
+    bool IsNull() const { return id_ == 0; }
+
+    /// Object ID.
+    unsigned id_;
+    /// Number of times the ID had been freed when the handle was taken.
+    unsigned generation_;
+};
+
+/// Slot in a scene ID table.
+template <class T> struct SceneIDSlot
+{
+    /// Object, or null if the ID is free.
+    T* object_;
+    /// Number of times the ID has been freed.
+    unsigned generation_;
+    /// Whether the ID is queued for reuse.
+    bool queued_;
+};
+
+/// Table of scene nodes or components by ID within one ID range. IDs from the start of the range are indexed directly in an array of slots, which stays dense as freed IDs are reused in first-in first-out order. IDs too far beyond the slots, such as those loaded from a sparse scene, are stored in a hash map instead, which keeps freed entries to remember their generation.
+template <class T> class SceneIDTable
+{
+public:
+    /// Construct with the first ID of the range.
+    SceneIDTable(unsigned firstID) :
+        firstID_(firstID),
+        numObjects_(0),
+        freeHead_(0),
+        deferReuse_(false)
+    {
+    }
+
+    /// Add or replace an object.
+    void Insert(unsigned id, T* object)
+    {
+        unsigned index = id - firstID_;
+        if (index >= slots_.Size() && index < slots_.Size() * 2 + SCENE_ID_SLOT_SLACK)
+        {
+            // Grow geometrically, as IDs are usually allocated one past the last slot
+            unsigned newSize = slots_.Size() + (slots_.Size() >> 1) + 64;
+            Grow(index < newSize ? newSize : index + 1);
+        }
+
+        if (index < slots_.Size())
+        {
+            SceneIDSlot<T>& slot = slots_[index];
+            if (!slot.object_)
+                ++numObjects_;
+            slot.object_ = object;
+        }
+        else
+        {
+            typename HashMap<unsigned, SceneIDSlot<T> >::Iterator i = overflow_.Find(id);
+            if (i == overflow_.End())
+            {
+                SceneIDSlot<T> slot;
+                slot.object_ = object;
+                slot.generation_ = 0;
+                slot.queued_ = false;
+                overflow_[id] = slot;
+                ++numObjects_;
+            }
+            else
+            {
+                if (!i->second_.object_)
+                    ++numObjects_;
+                i->second_.object_ = object;
+            }
+        }
+    }
+
+    /// Remove an object. Its ID is queued for reuse.
+    void Erase(unsigned id)
+    {
+        unsigned index = id - firstID_;
+        if (index < slots_.Size())
+        {
+            SceneIDSlot<T>& slot = slots_[index];
+            if (!slot.object_)
+                return;
+
+            slot.object_ = 0;
+            ++slot.generation_;
+            --numObjects_;
+
+            // The ID may still be queued if it was taken again by an object added with an explicit ID
+            if (slot.queued_)
+                return;
+            slot.queued_ = true;
+            if (deferReuse_)
+                deferredIDs_.Push(id);
+            else
+                freeIDs_.Push(id);
+        }
+        else
+        {
+            // Keep the entry so that handles taken before the removal stay invalid if the ID is used again
+            typename HashMap<unsigned, SceneIDSlot<T> >::Iterator i = overflow_.Find(id);
+            if (i != overflow_.End() && i->second_.object_)
+            {
+                i->second_.object_ = 0;
+                ++i->second_.generation_;
+                --numObjects_;
+            }
+        }
+    }
+
+    /// Return a freed ID for reuse, or zero if not enough IDs have been freed.
+    unsigned PopFreeID()
+    {
+        while (freeIDs_.Size() - freeHead_ > MIN_FREE_SCENE_IDS)
+        {
+            unsigned id = freeIDs_[freeHead_++];
+            slots_[id - firstID_].queued_ = false;
+            if (freeHead_ >= MIN_FREE_SCENE_IDS && freeHead_ * 2 >= freeIDs_.Size())
+            {
+                freeIDs_.Erase(0, freeHead_);
+                freeHead_ = 0;
+            }
+
+            // The ID may have been taken again by an object added with an explicit ID
+            if (!Find(id))
+                return id;
+        }
+
+        return 0;
+    }
+
+    /// Set whether freed IDs are held back until ReleaseDeferredIDs() is called.
+    void SetDeferReuse(bool enable)
+    {
+        deferReuse_ = enable;
+        if (!enable)
+            ReleaseDeferredIDs();
+    }
+
+    /// Make the held back freed IDs available for reuse.
+    void ReleaseDeferredIDs()
+    {
+        freeIDs_.Push(deferredIDs_);
+        deferredIDs_.Clear();
+    }
+
+    /// Forget the freed IDs. Called when the ID counters are reset.
+    void ClearFreeIDs()
+    {
+        for (unsigned i = freeHead_; i < freeIDs_.Size(); ++i)
+            slots_[freeIDs_[i] - firstID_].queued_ = false;
+        for (unsigned i = 0; i < deferredIDs_.Size(); ++i)
+            slots_[deferredIDs_[i] - firstID_].queued_ = false;
+        freeIDs_.Clear();
+        deferredIDs_.Clear();
+        freeHead_ = 0;
+    }
+
+    /// Return object by ID, or null if not found.
+    T* Find(unsigned id) const
+    {
+        unsigned index = id - firstID_;
+        if (index < slots_.Size())
+            return slots_[index].object_;
+        if (overflow_.Empty())
+            return 0;
+
+        typename HashMap<unsigned, SceneIDSlot<T> >::ConstIterator i = overflow_.Find(id);
+        return i != overflow_.End() ? i->second_.object_ : 0;
+    }
+
+    /// Return the number of times an ID has been freed.
+    unsigned GetGeneration(unsigned id) const
+    {
+        unsigned index = id - firstID_;
+        if (index < slots_.Size())
+            return slots_[index].generation_;
+        if (overflow_.Empty())
+            return 0;
+
+        typename HashMap<unsigned, SceneIDSlot<T> >::ConstIterator i = overflow_.Find(id);
+        return i != overflow_.End() ? i->second_.generation_ : 0;
+    }
+
+    /// Append all objects to a vector.
+    void GetObjects(PODVector<T*>& dest) const
+    {
+        for (unsigned i = 0; i < slots_.Size(); ++i)
+        {
+            if (slots_[i].object_)
+                dest.Push(slots_[i].object_);
+        }
+        for (typename HashMap<unsigned, SceneIDSlot<T> >::ConstIterator i = overflow_.Begin(); i != overflow_.End(); ++i)
+        {
+            if (i->second_.object_)
+                dest.Push(i->second_.object_);
+        }
+    }
+
+    /// Return number of objects.
+    unsigned Size() const { return numObjects_; }
+    /// Return number of slots.
+    unsigned GetNumSlots() const { return slots_.Size(); }
+    /// Return whether freed IDs are held back.
+    bool GetDeferReuse() const { return deferReuse_; }
+
+private:
+    /// Add slots and move the entries of the overflow map that now fit in them, keeping their generations.
+    void Grow(unsigned newSize)
+    {
+        unsigned oldSize = slots_.Size();
+        slots_.Resize(newSize);
+        for (unsigned i = oldSize; i < newSize; ++i)
+        {
+            slots_[i].object_ = 0;
+            slots_[i].generation_ = 0;
+            slots_[i].queued_ = false;
+        }
+
+        for (typename HashMap<unsigned, SceneIDSlot<T> >::Iterator i = overflow_.Begin(); i != overflow_.End();)
+        {
+            unsigned index = i->first_ - firstID_;
+            if (index < newSize)
+            {
+                slots_[index].object_ = i->second_.object_;
+                slots_[index].generation_ = i->second_.generation_;
+                i = overflow_.Erase(i);
+            }
+            else
+                ++i;
+        }
+    }
+
+    /// Slots indexed by ID from the start of the range.
+    PODVector<SceneIDSlot<T> > slots_;
+    /// Objects and freed entries whose IDs are beyond the slots.
+    HashMap<unsigned, SceneIDSlot<T> > overflow_;
+    /// Freed IDs in the order they were freed.
+    PODVector<unsigned> freeIDs_;
+    /// Freed IDs held back from reuse.
+    PODVector<unsigned> deferredIDs_;
+    /// First ID of the range.
+    unsigned firstID_;
+    /// Number of objects.
+    unsigned numObjects_;
+    /// Index of the next freed ID to reuse.
+    unsigned freeHead_;
+    /// Whether freed IDs are held back.
+    bool deferReuse_;
+};
+
+}
@@ -0,0 +1,895 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../IO/Log.h"
+#include "../IO/VectorBuffer.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneSnapshot.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Node hierarchy record in a scene snapshot.
+struct SnapshotNodeRecord
+{
+    /// Node ID.
+    unsigned id_;
+    /// Index of the parent node.
+    unsigned parentIndex_;
+    /// Number of components.
+    unsigned numComponents_;
+};
+
+/// Component record in a scene snapshot.
+struct SnapshotComponentRecord
+{
+    /// Index of the component type layout.
+    unsigned typeIndex_;
+    /// Component ID.
+    unsigned id_;
+};
+
+/// Size of the node state data: position, rotation, scale and the enabled flag.
+static const unsigned NODE_STATE_SIZE = sizeof(Vector3) + sizeof(Quaternion) + sizeof(Vector3) + sizeof(unsigned char);
+
+/// Return the size of a variant type when stored as raw memory, or zero if it can not be.
+static unsigned GetRawTypeSize(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_INT:
+        return sizeof(int);
+
+    case VAR_BOOL:
+        return sizeof(bool);
+
+    case VAR_FLOAT:
+        return sizeof(float);
+
+    case VAR_VECTOR2:
+        return sizeof(Vector2);
+
+    case VAR_VECTOR3:
+        return sizeof(Vector3);
+
+    case VAR_VECTOR4:
+        return sizeof(Vector4);
+
+    case VAR_QUATERNION:
+        return sizeof(Quaternion);
+
+    case VAR_COLOR:
+        return sizeof(Color);
+
+    case VAR_INTRECT:
+        return sizeof(IntRect);
+
+    case VAR_INTVECTOR2:
+        return sizeof(IntVector2);
+
+    case VAR_DOUBLE:
+        return sizeof(double);
+
+    default:
+        return 0;
+    }
+}
+
+unsigned GetRawAttributeSize(const AttributeInfo& attr)
+{
+    if (attr.accessor_ || attr.ptr_)
+        return 0;
+
+    // Enums use the low 8 bits only
+    if (attr.type_ == VAR_INT && attr.enumNames_)
+        return sizeof(unsigned char);
+    return GetRawTypeSize(attr.type_);
+}
+
+/// Return whether a stored raw attribute size is valid for its type. Zero means the attribute is stored as a variant.
+static bool IsValidRawSize(VariantType type, unsigned size)
+{
+    return !size || size == GetRawTypeSize(type) || (type == VAR_INT && size == sizeof(unsigned char));
+}
+
+/// Return whether the rest of a stream can hold a number of records of a given size.
+static bool HasRoomFor(const Deserializer& source, unsigned count, unsigned recordSize)
+{
+    return source.GetPosition() <= source.GetSize() && count <= (source.GetSize() - source.GetPosition()) / recordSize;
+}
+
+/// Return whether a node attribute is stored with the node hierarchy and state instead of the node attributes.
+static bool IsNodeStateAttribute(const String& name)
+{
+    return name == "Is Enabled" || name == "Name" || name == "Position" || name == "Rotation" || name == "Scale";
+}
+
+/// Fill an object list with null objects, for reading through data without applying it.
+static void SetNullObjects(PODVector<Serializable*>& objects, unsigned count)
+{
+    objects.Resize(count);
+    for (unsigned i = 0; i < count; ++i)
+        objects[i] = 0;
+}
+
+/// Convert raw attribute memory to a variant.
+static Variant RawToVariant(VariantType type, unsigned size, const unsigned char* data)
+{
+    switch (type)
+    {
+    case VAR_INT:
+        return size == sizeof(unsigned char) ? Variant((int)*data) : Variant(*reinterpret_cast<const int*>(data));
+
+    case VAR_BOOL:
+        return Variant(*reinterpret_cast<const bool*>(data));
+
+    case VAR_FLOAT:
+        return Variant(*reinterpret_cast<const float*>(data));
+
+    case VAR_VECTOR2:
+        return Variant(*reinterpret_cast<const Vector2*>(data));
+
+    case VAR_VECTOR3:
+        return Variant(*reinterpret_cast<const Vector3*>(data));
+
+    case VAR_VECTOR4:
+        return Variant(*reinterpret_cast<const Vector4*>(data));
+
+    case VAR_QUATERNION:
+        return Variant(*reinterpret_cast<const Quaternion*>(data));
+
+    case VAR_COLOR:
+        return Variant(*reinterpret_cast<const Color*>(data));
+
+    case VAR_INTRECT:
+        return Variant(*reinterpret_cast<const IntRect*>(data));
+
+    case VAR_INTVECTOR2:
+        return Variant(*reinterpret_cast<const IntVector2*>(data));
+
+    case VAR_DOUBLE:
+        return Variant(*reinterpret_cast<const double*>(data));
+
+    default:
+        return Variant::EMPTY;
+    }
+}
+
+SceneSnapshot::SceneSnapshot()
+{
+}
+
+SceneSnapshot::~SceneSnapshot()
+{
+}
+
+bool SceneSnapshot::Save(Scene* scene, Serializer& dest)
+{
+    if (!scene)
+        return false;
+
+    Context* context = scene->GetContext();
+
+    // Collect the persistent nodes so that parents come before their children. The scene itself is the first node
+    PODVector<Node*> nodes;
+    PODVector<SnapshotNodeRecord> nodeRecords;
+    PODVector<SnapshotComponentRecord> componentRecords;
+    SnapshotNodeRecord sceneRecord;
+    sceneRecord.id_ = scene->GetID();
+    sceneRecord.parentIndex_ = 0;
+    nodes.Push(scene);
+    nodeRecords.Push(sceneRecord);
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        const Vector<SharedPtr<Node> >& children = nodes[i]->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+        {
+            if (!(*j)->IsTemporary())
+            {
+                SnapshotNodeRecord record;
+                record.id_ = (*j)->GetID();
+                record.parentIndex_ = i;
+                nodes.Push(*j);
+                nodeRecords.Push(record);
+            }
+        }
+    }
+
+    // Group the persistent components by type
+    HashMap<StringHash, unsigned> typeIndices;
+    Vector<SnapshotLayout> layouts;
+    Vector<PODVector<Serializable*> > typeComponents;
+    StringHash lastType;
+    unsigned lastTypeIndex = M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        const Vector<SharedPtr<Component> >& components = nodes[i]->GetComponents();
+        nodeRecords[i].numComponents_ = 0;
+        for (Vector<SharedPtr<Component> >::ConstIterator j = components.Begin(); j != components.End(); ++j)
+        {
+            Component* component = *j;
+            if (component->IsTemporary())
+                continue;
+
+            // Nodes often have similar components, so check the previous type before the lookup
+            StringHash type = component->GetType();
+            if (type != lastType || lastTypeIndex == M_MAX_UNSIGNED)
+            {
+                HashMap<StringHash, unsigned>::Iterator k = typeIndices.Find(type);
+                if (k != typeIndices.End())
+                    lastTypeIndex = k->second_;
+                else
+                {
+                    lastTypeIndex = layouts.Size();
+                    typeIndices[type] = lastTypeIndex;
+                    layouts.Resize(layouts.Size() + 1);
+                    typeComponents.Resize(typeComponents.Size() + 1);
+
+                    // Types with per-instance attributes can not share a layout
+                    const Vector<AttributeInfo>* attributes = component->GetAttributes();
+                    if (attributes != context->GetAttributes(type) || !component->AllowRawAttributeAccess())
+                    {
+                        layouts.Back().type_ = type;
+                        layouts.Back().perObject_ = true;
+                    }
+                    else
+                        BuildLayout(layouts.Back(), type, attributes, true);
+                }
+                lastType = type;
+            }
+
+            SnapshotComponentRecord record;
+            record.typeIndex_ = lastTypeIndex;
+            record.id_ = component->GetID();
+            componentRecords.Push(record);
+            ++nodeRecords[i].numComponents_;
+            typeComponents[lastTypeIndex].Push(component);
+        }
+    }
+
+    SnapshotLayout sceneLayout;
+    SnapshotLayout nodeLayout;
+    BuildLayout(sceneLayout, scene->GetType(), scene->GetAttributes(), scene->AllowRawAttributeAccess());
+    BuildLayout(nodeLayout, Node::GetTypeStatic(), context->GetAttributes(Node::GetTypeStatic()), true);
+
+    // Write ID, version and layouts
+    if (!dest.WriteFileID("USNP") || !dest.WriteUInt(SCENE_SNAPSHOT_VERSION))
+    {
+        LOGERROR("Could not save scene snapshot, writing to stream failed");
+        return false;
+    }
+
+    if (!WriteLayout(dest, sceneLayout) || !WriteLayout(dest, nodeLayout) || !dest.WriteVLE(layouts.Size()))
+        return false;
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        if (!WriteLayout(dest, layouts[i]))
+            return false;
+    }
+
+    // Write the hierarchy as blocks of node and component records, then the node names
+    unsigned nodeRecordsSize = nodeRecords.Size() * sizeof(SnapshotNodeRecord);
+    unsigned componentRecordsSize = componentRecords.Size() * sizeof(SnapshotComponentRecord);
+    if (!dest.WriteVLE(nodeRecords.Size()) || !dest.WriteVLE(componentRecords.Size()) ||
+        dest.Write(&nodeRecords[0], nodeRecordsSize) != nodeRecordsSize || (componentRecordsSize &&
+        dest.Write(&componentRecords[0], componentRecordsSize) != componentRecordsSize))
+    {
+        LOGERROR("Could not save scene snapshot, writing to stream failed");
+        return false;
+    }
+    for (unsigned i = 1; i < nodes.Size(); ++i)
+    {
+        if (!dest.WriteString(nodes[i]->GetName()))
+        {
+            LOGERROR("Could not save scene snapshot, writing to stream failed");
+            return false;
+        }
+    }
+
+    // Write the scene attributes
+    PODVector<Serializable*> objects;
+    objects.Push(scene);
+    if (!WriteAttributes(dest, sceneLayout, objects))
+        return false;
+
+    // Write the node transforms and enabled flags as one block, bypassing the attribute accessors
+    if (nodes.Size() > 1)
+    {
+        rawData_.Resize((nodes.Size() - 1) * NODE_STATE_SIZE);
+        unsigned char* raw = &rawData_[0];
+        for (unsigned i = 1; i < nodes.Size(); ++i, raw += NODE_STATE_SIZE)
+        {
+            Node* node = nodes[i];
+            memcpy(raw, &node->GetPosition(), sizeof(Vector3));
+            memcpy(raw + sizeof(Vector3), &node->GetRotation(), sizeof(Quaternion));
+            memcpy(raw + sizeof(Vector3) + sizeof(Quaternion), &node->GetScale(), sizeof(Vector3));
+            raw[NODE_STATE_SIZE - 1] = node->IsEnabled() ? 1 : 0;
+        }
+
+        if (dest.Write(&rawData_[0], rawData_.Size()) != rawData_.Size())
+        {
+            LOGERROR("Could not save scene snapshot, writing to stream failed");
+            return false;
+        }
+    }
+
+    // Write the other node attributes, then the components by type
+    objects.Clear();
+    for (unsigned i = 1; i < nodes.Size(); ++i)
+        objects.Push(nodes[i]);
+    if (!WriteAttributes(dest, nodeLayout, objects))
+        return false;
+
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        if (!(layouts[i].perObject_ ? WriteObjects(dest, typeComponents[i]) : WriteAttributes(dest, layouts[i], typeComponents[i])))
+            return false;
+    }
+
+    return true;
+}
+
+bool SceneSnapshot::Load(Scene* scene, Deserializer& source)
+{
+    if (!scene)
+        return false;
+
+    Context* context = scene->GetContext();
+
+    if (source.ReadFileID() != "USNP")
+    {
+        LOGERROR(source.GetName() + " is not a valid scene snapshot");
+        return false;
+    }
+    unsigned version = source.ReadUInt();
+    if (version != SCENE_SNAPSHOT_VERSION)
+    {
+        LOGERROR("Unsupported scene snapshot version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    SnapshotLayout sceneLayout;
+    SnapshotLayout nodeLayout;
+    if (!ReadLayout(source, sceneLayout) || !ReadLayout(source, nodeLayout))
+        return false;
+    // Check the counts against the data left before allocating, as a corrupt file could ask for anything. A layout takes
+    // at least its type and per-object flag
+    unsigned numLayouts = source.ReadVLE();
+    if (!HasRoomFor(source, numLayouts, sizeof(unsigned) + sizeof(bool)))
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+        return false;
+    }
+    Vector<SnapshotLayout> layouts(numLayouts);
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        if (!ReadLayout(source, layouts[i]))
+            return false;
+    }
+
+    // Read and check the hierarchy before modifying the scene
+    unsigned numNodes = source.ReadVLE();
+    unsigned numComponents = source.ReadVLE();
+    if (!numNodes)
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " has no scene node");
+        return false;
+    }
+    if (!HasRoomFor(source, numNodes, sizeof(SnapshotNodeRecord)))
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+        return false;
+    }
+    unsigned nodeRecordsSize = numNodes * sizeof(SnapshotNodeRecord);
+    if (numComponents > (source.GetSize() - source.GetPosition() - nodeRecordsSize) / sizeof(SnapshotComponentRecord))
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+        return false;
+    }
+    unsigned componentRecordsSize = numComponents * sizeof(SnapshotComponentRecord);
+
+    PODVector<SnapshotNodeRecord> nodeRecords(numNodes);
+    PODVector<SnapshotComponentRecord> componentRecords(numComponents);
+    if (source.Read(&nodeRecords[0], nodeRecordsSize) != nodeRecordsSize || (componentRecordsSize &&
+        source.Read(&componentRecords[0], componentRecordsSize) != componentRecordsSize))
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+        return false;
+    }
+
+    unsigned totalComponents = 0;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        // Check against the components left, so that the sum can not wrap around
+        if ((i && nodeRecords[i].parentIndex_ >= i) || nodeRecords[i].numComponents_ > numComponents - totalComponents)
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " has an invalid node hierarchy");
+            return false;
+        }
+        totalComponents += nodeRecords[i].numComponents_;
+    }
+    if (totalComponents != numComponents)
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " has an invalid node hierarchy");
+        return false;
+    }
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        if (componentRecords[i].typeIndex_ >= layouts.Size())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " has an invalid component type");
+            return false;
+        }
+    }
+
+    Vector<String> names(numNodes);
+    for (unsigned i = 1; i < numNodes; ++i)
+        names[i] = source.ReadString();
+
+    // Check that the attribute data is complete, then return to it. Only then clear the scene
+    unsigned dataStart = source.GetPosition();
+    if (!CheckData(source, sceneLayout, nodeLayout, layouts, componentRecords, numNodes))
+        return false;
+    if (source.Seek(dataStart) != dataStart)
+    {
+        LOGERROR("Could not seek back to the attribute data in scene snapshot " + source.GetName());
+        return false;
+    }
+
+    scene->Clear();
+
+    // Create the nodes, and the components after the node attributes have been loaded
+    PODVector<Node*> nodes(numNodes);
+    nodes[0] = scene;
+    for (unsigned i = 1; i < numNodes; ++i)
+    {
+        unsigned id = nodeRecords[i].id_;
+        nodes[i] = nodes[nodeRecords[i].parentIndex_]->CreateChild(names[i], id < FIRST_LOCAL_ID ? REPLICATED : LOCAL, id);
+    }
+
+    PODVector<Serializable*> objects;
+    objects.Push(scene);
+    MatchLayout(sceneLayout, scene->GetAttributes(), scene->AllowRawAttributeAccess());
+    if (!ReadAttributes(source, sceneLayout, objects))
+        return false;
+
+    if (numNodes > 1)
+    {
+        if (!HasRoomFor(source, numNodes - 1, NODE_STATE_SIZE))
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+        rawData_.Resize((numNodes - 1) * NODE_STATE_SIZE);
+        if (source.Read(&rawData_[0], rawData_.Size()) != rawData_.Size())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+
+        // The node records are not aligned, so copy the floats out before constructing the transform
+        const unsigned char* raw = &rawData_[0];
+        float transform[10];
+        for (unsigned i = 1; i < numNodes; ++i, raw += NODE_STATE_SIZE)
+        {
+            memcpy(transform, raw, sizeof transform);
+            nodes[i]->SetTransform(Vector3(&transform[0]), Quaternion(&transform[3]), Vector3(&transform[7]));
+            if (!raw[NODE_STATE_SIZE - 1])
+                nodes[i]->SetEnabled(false);
+        }
+    }
+
+    objects.Clear();
+    for (unsigned i = 1; i < numNodes; ++i)
+        objects.Push(nodes[i]);
+    MatchLayout(nodeLayout, context->GetAttributes(Node::GetTypeStatic()), true);
+    if (!ReadAttributes(source, nodeLayout, objects))
+        return false;
+
+    // Create the components in their original order within each node. Skip types that can not be created
+    const HashMap<StringHash, SharedPtr<ObjectFactory> >& factories = context->GetObjectFactories();
+    Vector<PODVector<Serializable*> > typeComponents(layouts.Size());
+    PODVector<bool> knownTypes(layouts.Size());
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        knownTypes[i] = factories.Contains(layouts[i].type_);
+        if (!knownTypes[i])
+            LOGWARNING("Unknown component type " + layouts[i].type_.ToString() + " in scene snapshot, skipping components");
+    }
+
+    unsigned componentIndex = 0;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        for (unsigned j = 0; j < nodeRecords[i].numComponents_; ++j, ++componentIndex)
+        {
+            unsigned typeIndex = componentRecords[componentIndex].typeIndex_;
+            unsigned id = componentRecords[componentIndex].id_;
+            Component* component = 0;
+            if (knownTypes[typeIndex])
+                component = nodes[i]->CreateComponent(layouts[typeIndex].type_, id < FIRST_LOCAL_ID ? REPLICATED : LOCAL, id);
+            typeComponents[typeIndex].Push(component);
+        }
+    }
+
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        SnapshotLayout& layout = layouts[i];
+        const PODVector<Serializable*>& components = typeComponents[i];
+        if (layout.perObject_)
+        {
+            if (!ReadObjects(source, components))
+                return false;
+        }
+        else
+        {
+            // Match the layout using the first created component, as raw access is decided per object
+            Serializable* first = 0;
+            for (unsigned j = 0; j < components.Size() && !first; ++j)
+                first = components[j];
+            if (first)
+                MatchLayout(layout, first->GetAttributes(), first->AllowRawAttributeAccess());
+            if (!ReadAttributes(source, layout, components))
+                return false;
+        }
+    }
+
+    scene->ApplyAttributes();
+    return true;
+}
+
+void SceneSnapshot::BuildLayout(SnapshotLayout& layout, StringHash type, const Vector<AttributeInfo>* attributes, bool allowRaw)
+{
+    layout.type_ = type;
+    layout.attributes_.Clear();
+    layout.rawSize_ = 0;
+    layout.perObject_ = false;
+    layout.directNetworkAttributes_ = false;
+    if (!attributes)
+        return;
+
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!(attr.mode_ & AM_FILE) || (type == Node::GetTypeStatic() && IsNodeStateAttribute(attr.name_)))
+            continue;
+
+        SnapshotAttribute snapshotAttr;
+        snapshotAttr.name_ = attr.name_;
+        snapshotAttr.type_ = attr.type_;
+        snapshotAttr.size_ = allowRaw ? GetRawAttributeSize(attr) : 0;
+        snapshotAttr.rawOffset_ = layout.rawSize_;
+        snapshotAttr.index_ = i;
+        snapshotAttr.offset_ = attr.offset_;
+        snapshotAttr.direct_ = snapshotAttr.size_ != 0;
+        layout.rawSize_ += snapshotAttr.size_;
+        layout.attributes_.Push(snapshotAttr);
+    }
+}
+
+bool SceneSnapshot::WriteLayout(Serializer& dest, const SnapshotLayout& layout)
+{
+    bool success = dest.WriteStringHash(layout.type_) && dest.WriteBool(layout.perObject_);
+    if (success && !layout.perObject_)
+    {
+        success = dest.WriteVLE(layout.attributes_.Size());
+        for (unsigned i = 0; i < layout.attributes_.Size() && success; ++i)
+        {
+            const SnapshotAttribute& attr = layout.attributes_[i];
+            success = dest.WriteString(attr.name_) && dest.WriteUByte((unsigned char)attr.type_) &&
+                dest.WriteUByte((unsigned char)attr.size_);
+        }
+    }
+
+    if (!success)
+        LOGERROR("Could not save scene snapshot, writing to stream failed");
+    return success;
+}
+
+bool SceneSnapshot::ReadLayout(Deserializer& source, SnapshotLayout& layout)
+{
+    layout.type_ = source.ReadStringHash();
+    layout.attributes_.Clear();
+    layout.rawSize_ = 0;
+    layout.perObject_ = source.ReadBool();
+    layout.directNetworkAttributes_ = false;
+    if (layout.perObject_)
+        return true;
+
+    // An attribute takes at least an empty name, the type and the size
+    unsigned numAttributes = source.ReadVLE();
+    if (!HasRoomFor(source, numAttributes, 3))
+    {
+        LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+        return false;
+    }
+
+    layout.attributes_.Reserve(numAttributes);
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (source.IsEof())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+
+        SnapshotAttribute attr;
+        attr.name_ = source.ReadString();
+        attr.type_ = (VariantType)source.ReadUByte();
+        attr.size_ = source.ReadUByte();
+        // The raw data is converted according to the type, so the size must match it
+        if (!IsValidRawSize(attr.type_, attr.size_) || attr.size_ > M_MAX_UNSIGNED - layout.rawSize_)
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " has an invalid attribute " + attr.name_);
+            return false;
+        }
+        attr.rawOffset_ = layout.rawSize_;
+        layout.rawSize_ += attr.size_;
+        layout.attributes_.Push(attr);
+    }
+
+    return true;
+}
+
+void SceneSnapshot::MatchLayout(SnapshotLayout& layout, const Vector<AttributeInfo>* attributes, bool allowRaw)
+{
+    layout.directNetworkAttributes_ = false;
+
+    for (unsigned i = 0; i < layout.attributes_.Size(); ++i)
+    {
+        SnapshotAttribute& snapshotAttr = layout.attributes_[i];
+        snapshotAttr.index_ = M_MAX_UNSIGNED;
+        snapshotAttr.direct_ = false;
+        if (!attributes)
+            continue;
+
+        // Usually the attributes are in the same order, so check the same index first
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            unsigned index = (i + j) % attributes->Size();
+            const AttributeInfo& attr = attributes->At(index);
+            if ((attr.mode_ & AM_FILE) && attr.type_ == snapshotAttr.type_ && attr.name_ == snapshotAttr.name_)
+            {
+                snapshotAttr.index_ = index;
+                snapshotAttr.offset_ = attr.offset_;
+                snapshotAttr.direct_ = allowRaw && snapshotAttr.size_ && GetRawAttributeSize(attr) == snapshotAttr.size_;
+                if (snapshotAttr.direct_ && (attr.mode_ & AM_NET))
+                    layout.directNetworkAttributes_ = true;
+                break;
+            }
+        }
+    }
+}
+
+bool SceneSnapshot::WriteAttributes(Serializer& dest, const SnapshotLayout& layout, const PODVector<Serializable*>& objects)
+{
+    const Vector<SnapshotAttribute>& snapshotAttrs = layout.attributes_;
+
+    // Gather the plain data attributes of all objects into one block
+    if (layout.rawSize_)
+    {
+        rawData_.Resize(objects.Size() * layout.rawSize_);
+        unsigned char* raw = &rawData_[0];
+        for (unsigned i = 0; i < objects.Size(); ++i)
+        {
+            const unsigned char* object = reinterpret_cast<const unsigned char*>(objects[i]);
+            for (unsigned j = 0; j < snapshotAttrs.Size(); ++j)
+            {
+                if (snapshotAttrs[j].size_)
+                    memcpy(raw + snapshotAttrs[j].rawOffset_, object + snapshotAttrs[j].offset_, snapshotAttrs[j].size_);
+            }
+            raw += layout.rawSize_;
+        }
+
+        if (dest.Write(&rawData_[0], rawData_.Size()) != rawData_.Size())
+        {
+            LOGERROR("Could not save scene snapshot, writing to stream failed");
+            return false;
+        }
+    }
+
+    // Then the remaining attributes one at a time
+    for (unsigned i = 0; i < objects.Size(); ++i)
+    {
+        const Vector<AttributeInfo>* attributes = objects[i]->GetAttributes();
+        for (unsigned j = 0; j < snapshotAttrs.Size(); ++j)
+        {
+            const SnapshotAttribute& attr = snapshotAttrs[j];
+            if (attr.size_)
+                continue;
+
+            if (!objects[i]->WriteAttributeData(attributes->At(attr.index_), dest))
+            {
+                LOGERROR("Could not save scene snapshot, writing to stream failed");
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SceneSnapshot::ReadAttributes(Deserializer& source, const SnapshotLayout& layout, const PODVector<Serializable*>& objects)
+{
+    const Vector<SnapshotAttribute>& snapshotAttrs = layout.attributes_;
+
+    if (layout.rawSize_)
+    {
+        if (!HasRoomFor(source, objects.Size(), layout.rawSize_))
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+        rawData_.Resize(objects.Size() * layout.rawSize_);
+        if (source.Read(&rawData_[0], rawData_.Size()) != rawData_.Size())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+
+        const unsigned char* raw = &rawData_[0];
+        for (unsigned i = 0; i < objects.Size(); ++i, raw += layout.rawSize_)
+        {
+            Serializable* object = objects[i];
+            if (!object)
+                continue;
+
+            const Vector<AttributeInfo>* attributes = object->GetAttributes();
+            unsigned char* dest = reinterpret_cast<unsigned char*>(object);
+            for (unsigned j = 0; j < snapshotAttrs.Size(); ++j)
+            {
+                const SnapshotAttribute& attr = snapshotAttrs[j];
+                if (attr.direct_)
+                    memcpy(dest + attr.offset_, raw + attr.rawOffset_, attr.size_);
+                else if (attr.size_ && attr.index_ != M_MAX_UNSIGNED)
+                    object->OnSetAttribute(attributes->At(attr.index_), RawToVariant(attr.type_, attr.size_, raw + attr.rawOffset_));
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < objects.Size(); ++i)
+    {
+        Serializable* object = objects[i];
+        const Vector<AttributeInfo>* attributes = object ? object->GetAttributes() : 0;
+        for (unsigned j = 0; j < snapshotAttrs.Size(); ++j)
+        {
+            const SnapshotAttribute& attr = snapshotAttrs[j];
+            if (attr.size_)
+                continue;
+
+            if (source.IsEof())
+            {
+                LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+                return false;
+            }
+
+            if (object && attr.index_ != M_MAX_UNSIGNED)
+                object->ReadAttributeData(attributes->At(attr.index_), source);
+            else
+                source.ReadVariant(attr.type_);
+        }
+
+        if (object && layout.directNetworkAttributes_)
+            object->MarkNetworkUpdate();
+    }
+
+    return true;
+}
+
+bool SceneSnapshot::CheckData(Deserializer& source, const SnapshotLayout& sceneLayout, const SnapshotLayout& nodeLayout,
+    const Vector<SnapshotLayout>& layouts, const PODVector<SnapshotComponentRecord>& componentRecords, unsigned numNodes)
+{
+    // Read through the data with null objects, which skips it
+    PODVector<Serializable*> objects;
+    SetNullObjects(objects, 1);
+    if (!ReadAttributes(source, sceneLayout, objects))
+        return false;
+
+    if (numNodes > 1)
+    {
+        if (!HasRoomFor(source, numNodes - 1, NODE_STATE_SIZE))
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+        rawData_.Resize((numNodes - 1) * NODE_STATE_SIZE);
+        if (source.Read(&rawData_[0], rawData_.Size()) != rawData_.Size())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+    }
+
+    SetNullObjects(objects, numNodes - 1);
+    if (!ReadAttributes(source, nodeLayout, objects))
+        return false;
+
+    PODVector<unsigned> typeCounts(layouts.Size());
+    for (unsigned i = 0; i < typeCounts.Size(); ++i)
+        typeCounts[i] = 0;
+    for (unsigned i = 0; i < componentRecords.Size(); ++i)
+        ++typeCounts[componentRecords[i].typeIndex_];
+    for (unsigned i = 0; i < layouts.Size(); ++i)
+    {
+        SetNullObjects(objects, typeCounts[i]);
+        if (!(layouts[i].perObject_ ? ReadObjects(source, objects) : ReadAttributes(source, layouts[i], objects)))
+            return false;
+    }
+
+    return true;
+}
+
+bool SceneSnapshot::WriteObjects(Serializer& dest, const PODVector<Serializable*>& objects)
+{
+    VectorBuffer buffer;
+    for (unsigned i = 0; i < objects.Size(); ++i)
+    {
+        buffer.Clear();
+        if (!objects[i]->Save(buffer))
+            return false;
+        dest.WriteVLE(buffer.GetSize());
+        if (dest.Write(buffer.GetData(), buffer.GetSize()) != buffer.GetSize())
+        {
+            LOGERROR("Could not save scene snapshot, writing to stream failed");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SceneSnapshot::ReadObjects(Deserializer& source, const PODVector<Serializable*>& objects)
+{
+    for (unsigned i = 0; i < objects.Size(); ++i)
+    {
+        if (source.IsEof())
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " is truncated");
+            return false;
+        }
+
+        // Components save their type and ID first, which have already been read from the hierarchy
+        unsigned size = source.ReadVLE();
+        if (size < sizeof(StringHash) + sizeof(unsigned) || !HasRoomFor(source, size, 1))
+        {
+            LOGERROR("Scene snapshot " + source.GetName() + " has invalid component data");
+            return false;
+        }
+
+        VectorBuffer buffer(source, size);
+        if (objects[i])
+        {
+            buffer.ReadStringHash();
+            buffer.ReadUInt();
+            objects[i]->Load(buffer);
+        }
+    }
+
+    return true;
+}
+
+}
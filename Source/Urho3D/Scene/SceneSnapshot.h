@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Attribute.h"
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Scene;
+class Serializable;
+class Serializer;
+struct SnapshotComponentRecord;
+
+/// Current scene snapshot format version.
+static const unsigned SCENE_SNAPSHOT_VERSION = 1;
+
+/// Return the size of an attribute when it can be copied as raw memory, or zero if it must be accessed through a variant.
+URHO3D_API unsigned GetRawAttributeSize(const AttributeInfo& attr);
+
+/// Attribute of an object type in a scene snapshot.
+struct SnapshotAttribute
+{
+    /// Construct.
+    SnapshotAttribute() :
+        type_(VAR_NONE),
+        size_(0),
+        rawOffset_(0),
+        index_(M_MAX_UNSIGNED),
+        offset_(0),
+        direct_(false)
+    {
+    }
+
+    /// Attribute name.
+    String name_;
+    /// Attribute type.
+    VariantType type_;
+    /// Size when stored as raw memory, or zero when stored as a variant.
+    unsigned size_;
+    /// Offset within the object's raw data.
+    unsigned rawOffset_;
+    /// Index of the matching attribute of the current type, or M_MAX_UNSIGNED if none.
+    unsigned index_;
+    /// Byte offset of the matching attribute in the object.
+    unsigned offset_;
+    /// Whether the attribute is accessed directly in the object's memory instead of through a variant.
+    bool direct_;
+};
+
+/// Attribute layout of an object type in a scene snapshot.
+struct SnapshotLayout
+{
+    /// Construct.
+    SnapshotLayout() :
+        rawSize_(0),
+        perObject_(false),
+        directNetworkAttributes_(false)
+    {
+    }
+
+    /// Object type.
+    StringHash type_;
+    /// File attributes in the snapshot.
+    Vector<SnapshotAttribute> attributes_;
+    /// Size of the raw data per object.
+    unsigned rawSize_;
+    /// Whether the objects are saved and loaded one at a time through Save() and Load() instead of by attribute.
+    bool perObject_;
+    /// Whether network attributes are copied directly, so that the objects must be marked for network update.
+    bool directNetworkAttributes_;
+};
+
+/// Saves and restores whole scenes in a compact binary format. The node hierarchy is stored first, then the node transforms, and then the attributes of the nodes and the components grouped by type, so that the plain data attributes of each type form one contiguous block which is copied directly to and from the objects. Types that do not allow raw attribute access are saved and loaded one object at a time. Node and component IDs are preserved. Plain data is stored in the native byte order. Attributes are matched by name and type when loading, so attributes added or removed since saving are tolerated.
+class URHO3D_API SceneSnapshot
+{
+public:
+    /// Construct.
+    SceneSnapshot();
+    /// Destruct.
+    ~SceneSnapshot();
+
+    /// Save a scene. Return true if successful.
+    bool Save(Scene* scene, Serializer& dest);
+    /// Restore a scene. Removes all existing child nodes and components first, unless the snapshot is invalid. The source must be seekable. Return true if successful.
+    bool Load(Scene* scene, Deserializer& source);
+
+private:
+    /// Build the layout of an object type from its current attributes.
+    void BuildLayout(SnapshotLayout& layout, StringHash type, const Vector<AttributeInfo>* attributes, bool allowRaw);
+    /// Write a layout.
+    bool WriteLayout(Serializer& dest, const SnapshotLayout& layout);
+    /// Read a layout.
+    bool ReadLayout(Deserializer& source, SnapshotLayout& layout);
+    /// Match a read layout to the current attributes of an object type.
+    void MatchLayout(SnapshotLayout& layout, const Vector<AttributeInfo>* attributes, bool allowRaw);
+    /// Read through the attribute data without applying it. Return true if it is complete.
+    bool CheckData(Deserializer& source, const SnapshotLayout& sceneLayout, const SnapshotLayout& nodeLayout,
+        const Vector<SnapshotLayout>& layouts, const PODVector<SnapshotComponentRecord>& componentRecords, unsigned numNodes);
+    /// Write the attributes of objects sharing a layout.
+    bool WriteAttributes(Serializer& dest, const SnapshotLayout& layout, const PODVector<Serializable*>& objects);
+    /// Read the attributes of objects sharing a layout. Objects that could not be created are null, and their data is skipped.
+    bool ReadAttributes(Deserializer& source, const SnapshotLayout& layout, const PODVector<Serializable*>& objects);
+    /// Write objects one at a time through Save().
+    bool WriteObjects(Serializer& dest, const PODVector<Serializable*>& objects);
+    /// Read objects one at a time through Load(). Objects that could not be created are null, and their data is skipped.
+    bool ReadObjects(Deserializer& source, const PODVector<Serializable*>& objects);
+
+    /// Raw attribute data buffer.
+    PODVector<unsigned char> rawData_;
+};
+
+}
@@ -0,0 +1,737 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+#include "../Scene/SceneStreamer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* SCENE_CATEGORY;
+
+static const float DEFAULT_CELL_SIZE = 64.0f;
+static const float DEFAULT_LOAD_DISTANCE = 128.0f;
+static const float DEFAULT_UNLOAD_DISTANCE = 192.0f;
+static const int DEFAULT_LOADING_MS = 5;
+
+/// Compare cells by distance from the nearest observer.
+static bool CompareCells(StreamingCell* lhs, StreamingCell* rhs)
+{
+    return lhs->distance_ < rhs->distance_;
+}
+
+/// Add a resource to a cell's resource list if not added yet.
+static void AddCellResource(ResourceCache* cache, StringHash type, const String& name, Vector<ResourceRef>& resources,
+    HashSet<StringHash>& names)
+{
+    // Sanitate the name beforehand so that it matches the name in the background loaded event
+    String sanitatedName = cache->SanitateResourceName(name);
+    if (sanitatedName.Empty())
+        return;
+
+    StringHash nameHash(sanitatedName);
+    if (!names.Contains(nameHash))
+    {
+        names.Insert(nameHash);
+        resources.Push(ResourceRef(type, sanitatedName));
+    }
+}
+
+/// Collect the resources used by the components of a node and its children.
+static void CollectCellResources(ResourceCache* cache, Node* node, Vector<ResourceRef>& resources, HashSet<StringHash>& names)
+{
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        const Vector<AttributeInfo>* attributes = component->GetAttributes();
+        if (component->IsTemporary() || !attributes)
+            continue;
+
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            const AttributeInfo& attr = attributes->At(j);
+            if (!(attr.mode_ & AM_FILE))
+                continue;
+
+            if (attr.type_ == VAR_RESOURCEREF)
+            {
+                ResourceRef ref = component->GetAttribute(j).GetResourceRef();
+                AddCellResource(cache, ref.type_, ref.name_, resources, names);
+            }
+            else if (attr.type_ == VAR_RESOURCEREFLIST)
+            {
+                ResourceRefList refList = component->GetAttribute(j).GetResourceRefList();
+                for (unsigned k = 0; k < refList.names_.Size(); ++k)
+                    AddCellResource(cache, refList.type_, refList.names_[k], resources, names);
+            }
+        }
+    }
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (!children[i]->IsTemporary())
+            CollectCellResources(cache, children[i], resources, names);
+    }
+}
+
+SceneStreamer::SceneStreamer(Context* context) :
+    Component(context),
+    cellSize_(DEFAULT_CELL_SIZE),
+    loadDistance_(DEFAULT_LOAD_DISTANCE),
+    unloadDistance_(DEFAULT_UNLOAD_DISTANCE),
+    loadingMs_(DEFAULT_LOADING_MS)
+{
+}
+
+SceneStreamer::~SceneStreamer()
+{
+}
+
+void SceneStreamer::RegisterObject(Context* context)
+{
+    context->RegisterFactory<SceneStreamer>(SCENE_CATEGORY);
+
+    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell Path", GetCellPath, SetCellPath, String, String::EMPTY, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Load Distance", GetLoadDistance, SetLoadDistance, float, DEFAULT_LOAD_DISTANCE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Unload Distance", GetUnloadDistance, SetUnloadDistance, float, DEFAULT_UNLOAD_DISTANCE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Loading Ms", GetLoadingMs, SetLoadingMs, int, DEFAULT_LOADING_MS, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Cells", GetCellsAttr, SetCellsAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
+}
+
+bool SceneStreamer::SaveCells(const String& directory, bool removeNodes)
+{
+    PROFILE(SaveStreamingCells);
+
+    if (!node_)
+    {
+        LOGERROR("No scene node to save cells from");
+        return false;
+    }
+
+    String path = AddTrailingSlash(directory);
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->CreateDir(path))
+        return false;
+
+    // Finish the cells being loaded so that none of their content is lost
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        if (cell.state_ == CELL_PRELOADING || cell.state_ == CELL_LOADING)
+            LoadCellImmediately(cell);
+    }
+
+    const Vector<SharedPtr<Node> >& children = node_->GetChildren();
+    bool success = true;
+
+    // Load the unloaded cells that new nodes are saved into, so that the content in their files is not overwritten. Nodes
+    // of cells that can not be loaded are left unsaved. Collect the cells first, as loading adds children
+    HashSet<IntVector2> mergeCells;
+    HashSet<IntVector2> skippedCells;
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (children[i]->IsTemporary())
+            continue;
+
+        IntVector2 coords = GetCellCoords(children[i]->GetPosition());
+        HashMap<IntVector2, StreamingCell>::Iterator j = cells_.Find(coords);
+        if (j != cells_.End() && (j->second_.state_ == CELL_UNLOADED || j->second_.state_ == CELL_FAILED))
+            mergeCells.Insert(coords);
+    }
+    for (HashSet<IntVector2>::Iterator i = mergeCells.Begin(); i != mergeCells.End(); ++i)
+    {
+        StreamingCell& cell = cells_[*i];
+        if (cell.state_ == CELL_FAILED)
+            UnloadCell(cell);
+        if (!LoadCellImmediately(cell))
+        {
+            LOGERROR("Could not load cell " + i->ToString() + " to merge new nodes into it, not saving the cell");
+            skippedCells.Insert(*i);
+            success = false;
+        }
+    }
+
+    // Partition the nodes of the loaded cells and the other persistent child nodes. Loaded cells are always written so that
+    // nodes removed or moved out of them do not remain in their files
+    HashMap<IntVector2, PODVector<Node*> > partition;
+    HashSet<Node*> cellNodes;
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ != CELL_LOADED)
+            continue;
+
+        partition[i->first_];
+        for (unsigned j = 0; j < i->second_.nodes_.Size(); ++j)
+        {
+            if (i->second_.nodes_[j])
+                cellNodes.Insert(i->second_.nodes_[j]);
+        }
+    }
+
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        Node* child = children[i];
+        if (!child->IsTemporary() || cellNodes.Contains(child))
+        {
+            IntVector2 coords = GetCellCoords(child->GetPosition());
+            if (!skippedCells.Contains(coords))
+                partition[coords].Push(child);
+        }
+    }
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    HashSet<Node*> savedNodes;
+
+    for (HashMap<IntVector2, PODVector<Node*> >::Iterator i = partition.Begin(); i != partition.End(); ++i)
+    {
+        const IntVector2& coords = i->first_;
+        const PODVector<Node*>& nodes = i->second_;
+        String fileName = path + GetCellFileName(coords);
+
+        // Cells left empty are removed
+        if (nodes.Empty())
+        {
+            fileSystem->Delete(fileName);
+            cells_.Erase(i->first_);
+            continue;
+        }
+
+        File file(context_, fileName, FILE_WRITE);
+        if (!file.IsOpen())
+        {
+            success = false;
+            continue;
+        }
+
+        // Store the resources used by the cell first for background loading
+        Vector<ResourceRef> resources;
+        HashSet<StringHash> resourceNames;
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+            CollectCellResources(cache, nodes[j], resources, resourceNames);
+
+        file.WriteFileID("UCEL");
+        file.WriteVLE(resources.Size());
+        for (unsigned j = 0; j < resources.Size(); ++j)
+        {
+            file.WriteStringHash(resources[j].type_);
+            file.WriteString(resources[j].name_);
+        }
+
+        file.WriteVLE(nodes.Size());
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+        {
+            if (!nodes[j]->Save(file))
+            {
+                LOGERROR("Failed to save node " + String(nodes[j]->GetID()) + " to " + fileName);
+                success = false;
+            }
+        }
+
+        StreamingCell& cell = cells_[i->first_];
+        cell.coords_ = coords;
+        cell.numNodes_ = nodes.Size();
+        cell.dataSize_ = file.GetSize();
+        cell.resources_ = resources;
+        cell.nodes_.Clear();
+
+        if (removeNodes)
+        {
+            for (unsigned j = 0; j < nodes.Size(); ++j)
+                savedNodes.Insert(nodes[j]);
+            cell.loadedNodes_ = 0;
+            cell.state_ = CELL_UNLOADED;
+        }
+        else
+        {
+            // The nodes are now content of the cell, which is saved in the cell file instead of the scene
+            for (unsigned j = 0; j < nodes.Size(); ++j)
+            {
+                nodes[j]->SetTemporary(true);
+                cell.nodes_.Push(WeakPtr<Node>(nodes[j]));
+            }
+            cell.loadedNodes_ = cell.numNodes_;
+            cell.state_ = CELL_LOADED;
+        }
+    }
+
+    // Remove from the end of the child list to avoid moving the remaining children
+    for (unsigned i = children.Size() - 1; i < children.Size(); --i)
+    {
+        if (savedNodes.Contains(children[i]))
+            children[i]->Remove();
+    }
+
+    LOGDEBUG("Saved " + String(partition.Size()) + " cells to " + path);
+    return success;
+}
+
+void SceneStreamer::AddObserver(Node* node)
+{
+    if (!node)
+        return;
+
+    WeakPtr<Node> observer(node);
+    if (!observers_.Contains(observer))
+        observers_.Push(observer);
+}
+
+void SceneStreamer::RemoveObserver(Node* node)
+{
+    observers_.Remove(WeakPtr<Node>(node));
+}
+
+void SceneStreamer::RemoveAllObservers()
+{
+    observers_.Clear();
+}
+
+void SceneStreamer::Update()
+{
+    if (!node_ || cells_.Empty())
+        return;
+
+    PROFILE(UpdateSceneStreaming);
+
+    // Get the observer positions in the scene node's space
+    Matrix3x4 inverseTransform = node_->GetWorldTransform().Inverse();
+    PODVector<Vector3> positions;
+    for (Vector<WeakPtr<Node> >::Iterator i = observers_.Begin(); i != observers_.End();)
+    {
+        if (*i)
+        {
+            positions.Push(inverseTransform * (*i)->GetWorldPosition());
+            ++i;
+        }
+        else
+            i = observers_.Erase(i);
+    }
+
+    // Cells are loaded within the load distance of any observer, and stay until beyond the unload distance of all of them
+    float unloadDistance = Max(unloadDistance_, loadDistance_);
+    PODVector<StreamingCell*> loadCells;
+    PODVector<StreamingCell*> unloadCells;
+
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        cell.distance_ = M_INFINITY;
+        for (unsigned j = 0; j < positions.Size(); ++j)
+            cell.distance_ = Min(cell.distance_, GetCellDistance(cell.coords_, positions[j]));
+
+        if (cell.state_ == CELL_UNLOADED)
+        {
+            if (cell.distance_ <= loadDistance_)
+                loadCells.Push(&cell);
+        }
+        else if (cell.state_ == CELL_FAILED)
+            continue;
+        else if (cell.distance_ > unloadDistance)
+            unloadCells.Push(&cell);
+        else if (cell.state_ != CELL_LOADED)
+            loadCells.Push(&cell);
+    }
+
+    // Unload first to release memory
+    for (unsigned i = 0; i < unloadCells.Size(); ++i)
+        UnloadCell(*unloadCells[i]);
+
+    if (loadCells.Empty())
+        return;
+
+    // Start preloading all wanted cells, but create nodes for the nearest cells first until the time budget is used
+    Sort(loadCells.Begin(), loadCells.End(), CompareCells);
+
+    HiresTimer loadTimer;
+    long long budget = loadingMs_ * 1000;
+
+    for (unsigned i = 0; i < loadCells.Size(); ++i)
+    {
+        StreamingCell& cell = *loadCells[i];
+        // Cells that fail to load stay in the failed state, so that loading is not retried each update
+        if (cell.state_ == CELL_UNLOADED && !BeginLoading(cell))
+            continue;
+
+        // If resources left to load, do not load nodes yet
+        if (cell.state_ == CELL_PRELOADING)
+        {
+            if (!cell.pendingResources_.Empty())
+                continue;
+            cell.preloadTime_ = cell.preloadTimer_.GetUSec(false) / 1000.0f;
+            cell.state_ = CELL_LOADING;
+        }
+
+        long long startTime = loadTimer.GetUSec(false);
+        if (startTime >= budget)
+            continue;
+
+        while (cell.loadedNodes_ < cell.numNodes_ && loadTimer.GetUSec(false) < budget)
+        {
+            if (!LoadNode(cell))
+                break;
+        }
+        if (cell.state_ == CELL_FAILED)
+            continue;
+
+        cell.loadTime_ += (loadTimer.GetUSec(false) - startTime) / 1000.0f;
+        ++cell.loadFrames_;
+
+        if (cell.loadedNodes_ >= cell.numNodes_)
+            FinishLoading(cell);
+    }
+}
+
+void SceneStreamer::UnloadAllCells()
+{
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ != CELL_UNLOADED)
+            UnloadCell(i->second_);
+    }
+}
+
+void SceneStreamer::SetCellSize(float size)
+{
+    cellSize_ = Max(size, M_EPSILON);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetCellPath(const String& path)
+{
+    cellPath_ = path.Empty() ? path : AddTrailingSlash(path);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetLoadDistance(float distance)
+{
+    loadDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetUnloadDistance(float distance)
+{
+    unloadDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetLoadingMs(int ms)
+{
+    loadingMs_ = Max(ms, 1);
+    MarkNetworkUpdate();
+}
+
+unsigned SceneStreamer::GetNumLoadedCells() const
+{
+    unsigned ret = 0;
+    for (HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ == CELL_LOADED)
+            ++ret;
+    }
+    return ret;
+}
+
+bool SceneStreamer::IsLoading() const
+{
+    for (HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ == CELL_PRELOADING || i->second_.state_ == CELL_LOADING)
+            return true;
+    }
+    return false;
+}
+
+IntVector2 SceneStreamer::GetCellCoords(const Vector3& position) const
+{
+    return IntVector2((int)floorf(position.x_ / cellSize_), (int)floorf(position.z_ / cellSize_));
+}
+
+const StreamingCell* SceneStreamer::GetCell(const IntVector2& coords) const
+{
+    HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Find(coords);
+    return i != cells_.End() ? &i->second_ : 0;
+}
+
+StreamingCellState SceneStreamer::GetCellState(const IntVector2& coords) const
+{
+    const StreamingCell* cell = GetCell(coords);
+    return cell ? cell->state_ : CELL_UNLOADED;
+}
+
+String SceneStreamer::GetCellFileName(const IntVector2& coords) const
+{
+    return "Cell_" + String(coords.x_) + "_" + String(coords.y_) + ".bin";
+}
+
+void SceneStreamer::SetCellsAttr(const VariantVector& value)
+{
+    UnloadAllCells();
+    cells_.Clear();
+
+    for (unsigned i = 0; i < value.Size(); ++i)
+    {
+        IntVector2 coords = value[i].GetIntVector2();
+        cells_[coords].coords_ = coords;
+    }
+}
+
+VariantVector SceneStreamer::GetCellsAttr() const
+{
+    VariantVector ret;
+    ret.Reserve(cells_.Size());
+    for (HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+        ret.Push(i->second_.coords_);
+    return ret;
+}
+
+void SceneStreamer::OnSceneSet(Scene* scene)
+{
+    if (scene)
+    {
+        SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(SceneStreamer, HandleSceneUpdate));
+        SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, HANDLER(SceneStreamer, HandleResourceBackgroundLoaded));
+    }
+    else
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+        UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
+    }
+}
+
+bool SceneStreamer::BeginLoading(StreamingCell& cell)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    String fileName = cellPath_ + GetCellFileName(cell.coords_);
+    SharedPtr<File> file = cache->GetFile(fileName);
+    if (!file)
+    {
+        cell.state_ = CELL_FAILED;
+        return false;
+    }
+
+    if (file->ReadFileID() != "UCEL")
+    {
+        LOGERROR(fileName + " is not a valid streaming cell file");
+        cell.state_ = CELL_FAILED;
+        return false;
+    }
+
+    cell.resources_.Clear();
+    cell.pendingResources_.Clear();
+    cell.preloadTimer_.Reset();
+
+    // Queue the resources for background loading. Also wait for the resources already queued for other cells
+    unsigned numResources = file->ReadVLE();
+    for (unsigned i = 0; i < numResources; ++i)
+    {
+        StringHash type = file->ReadStringHash();
+        String name = cache->SanitateResourceName(file->ReadString());
+        StringHash nameHash(name);
+        if (cache->BackgroundLoadResource(type, name))
+        {
+            loadingResources_.Insert(nameHash);
+            cell.pendingResources_.Insert(nameHash);
+        }
+        else if (loadingResources_.Contains(nameHash))
+            cell.pendingResources_.Insert(nameHash);
+        cell.resources_.Push(ResourceRef(type, name));
+    }
+
+    cell.file_ = file;
+    cell.resolver_.Reset();
+    cell.numNodes_ = file->ReadVLE();
+    cell.loadedNodes_ = 0;
+    cell.dataSize_ = file->GetSize();
+    cell.preloadTime_ = 0.0f;
+    cell.loadTime_ = 0.0f;
+    cell.loadFrames_ = 0;
+    cell.state_ = CELL_PRELOADING;
+    return true;
+}
+
+bool SceneStreamer::LoadNode(StreamingCell& cell)
+{
+    // Rewrite IDs, as the saved IDs may have been taken while the cell was unloaded
+    unsigned nodeID = cell.file_->ReadUInt();
+    CreateMode mode = nodeID < FIRST_LOCAL_ID ? REPLICATED : LOCAL;
+    Node* newNode = node_->CreateChild(0, mode);
+    cell.resolver_.AddNode(nodeID, newNode);
+    ++cell.loadedNodes_;
+
+    if (!newNode->Load(*cell.file_, cell.resolver_, true, true, mode))
+    {
+        LOGERROR("Failed to load node " + String(nodeID) + " from " + cell.file_->GetName());
+        newNode->Remove();
+        // The rest of the cell file can not be read. Do not keep the cell partially loaded, as saving it would lose the rest
+        UnloadCell(cell);
+        cell.state_ = CELL_FAILED;
+        return false;
+    }
+
+    // Cell content is saved in the cell file instead of the scene
+    newNode->SetTemporary(true);
+    cell.nodes_.Push(WeakPtr<Node>(newNode));
+    return true;
+}
+
+bool SceneStreamer::LoadCellImmediately(StreamingCell& cell)
+{
+    if (cell.state_ == CELL_FAILED || (cell.state_ == CELL_UNLOADED && !BeginLoading(cell)))
+        return false;
+    if (cell.state_ == CELL_LOADED)
+        return true;
+
+    // Resources still being loaded in the background will be waited for as the nodes request them
+    cell.state_ = CELL_LOADING;
+    while (cell.loadedNodes_ < cell.numNodes_)
+    {
+        if (!LoadNode(cell))
+            return false;
+    }
+
+    FinishLoading(cell);
+    return true;
+}
+
+void SceneStreamer::FinishLoading(StreamingCell& cell)
+{
+    HiresTimer finishTimer;
+
+    cell.resolver_.Resolve();
+    for (unsigned i = 0; i < cell.nodes_.Size(); ++i)
+    {
+        if (cell.nodes_[i])
+            cell.nodes_[i]->ApplyAttributes();
+    }
+
+    cell.file_.Reset();
+    cell.loadTime_ += finishTimer.GetUSec(false) / 1000.0f;
+    cell.state_ = CELL_LOADED;
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    cell.resourceMemory_ = 0;
+    for (unsigned i = 0; i < cell.resources_.Size(); ++i)
+    {
+        Resource* resource = cache->GetExistingResource(cell.resources_[i].type_, cell.resources_[i].name_);
+        if (resource)
+            cell.resourceMemory_ += resource->GetMemoryUse();
+    }
+
+    LOGDEBUG("Loaded cell " + cell.coords_.ToString() + " with " + String(cell.nodes_.Size()) + " nodes in " +
+        String(cell.loadTime_) + " ms over " + String(cell.loadFrames_) + " updates");
+
+    using namespace StreamingCellLoaded;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_SCENE] = GetScene();
+    eventData[P_NODE] = node_;
+    eventData[P_CELL] = cell.coords_;
+    eventData[P_NUMNODES] = cell.nodes_.Size();
+    eventData[P_DATASIZE] = cell.dataSize_;
+    eventData[P_RESOURCEMEMORY] = cell.resourceMemory_;
+    eventData[P_PRELOADTIME] = cell.preloadTime_;
+    eventData[P_LOADTIME] = cell.loadTime_;
+    eventData[P_LOADFRAMES] = cell.loadFrames_;
+    SendEvent(E_STREAMINGCELLLOADED, eventData);
+}
+
+void SceneStreamer::UnloadCell(StreamingCell& cell)
+{
+    HiresTimer unloadTimer;
+    bool wasLoaded = cell.state_ == CELL_LOADED;
+
+    // Remove in reverse order of creation, as the most recently created nodes are at the end of the child list
+    for (unsigned i = cell.nodes_.Size() - 1; i < cell.nodes_.Size(); --i)
+    {
+        if (cell.nodes_[i])
+            cell.nodes_[i]->Remove();
+    }
+
+    cell.nodes_.Clear();
+    cell.file_.Reset();
+    cell.resolver_.Reset();
+    cell.pendingResources_.Clear();
+    cell.loadedNodes_ = 0;
+    cell.state_ = CELL_UNLOADED;
+    cell.unloadTime_ = unloadTimer.GetUSec(false) / 1000.0f;
+
+    if (!wasLoaded)
+        return;
+
+    using namespace StreamingCellUnloaded;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_SCENE] = GetScene();
+    eventData[P_NODE] = node_;
+    eventData[P_CELL] = cell.coords_;
+    eventData[P_UNLOADTIME] = cell.unloadTime_;
+    SendEvent(E_STREAMINGCELLUNLOADED, eventData);
+}
+
+float SceneStreamer::GetCellDistance(const IntVector2& coords, const Vector3& position) const
+{
+    float minX = coords.x_ * cellSize_;
+    float minZ = coords.y_ * cellSize_;
+    float dx = Max(Max(minX - position.x_, position.x_ - (minX + cellSize_)), 0.0f);
+    float dz = Max(Max(minZ - position.z_, position.z_ - (minZ + cellSize_)), 0.0f);
+    return sqrtf(dx * dx + dz * dz);
+}
+
+void SceneStreamer::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+    if (IsEnabledEffective())
+        Update();
+}
+
+void SceneStreamer::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ResourceBackgroundLoaded;
+
+    // The event is sent also when loading fails, in which case the nodes will not find the resource either
+    StringHash nameHash(eventData[P_RESOURCENAME].GetString());
+    if (!loadingResources_.Erase(nameHash))
+        return;
+
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ == CELL_PRELOADING)
+            i->second_.pendingResources_.Erase(nameHash);
+    }
+}
+
+}
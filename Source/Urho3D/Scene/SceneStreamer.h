@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashSet.h"
+#include "../Core/Timer.h"
+#include "../Scene/Component.h"
+#include "../Scene/SceneResolver.h"
+
+namespace Urho3D
+{
+
+class File;
+
+/// Loading state of a streamed scene cell.
+enum StreamingCellState
+{
+    CELL_UNLOADED = 0,
+    CELL_PRELOADING,
+    CELL_LOADING,
+    CELL_LOADED,
+    CELL_FAILED
+};
+
+/// Spatial cell of streamed scene content.
+struct StreamingCell
+{
+    /// Construct.
+    StreamingCell() :
+        state_(CELL_UNLOADED),
+        distance_(M_INFINITY),
+        numNodes_(0),
+        loadedNodes_(0),
+        dataSize_(0),
+        resourceMemory_(0),
+        preloadTime_(0.0f),
+        loadTime_(0.0f),
+        unloadTime_(0.0f),
+        loadFrames_(0)
+    {
+    }
+
+    /// Cell coordinates on the XZ plane.
+    IntVector2 coords_;
+    /// Loading state.
+    StreamingCellState state_;
+    /// Distance from the nearest observer.
+    float distance_;
+    /// Cell file while loading.
+    SharedPtr<File> file_;
+    /// Resolver for the node and component IDs of the cell.
+    SceneResolver resolver_;
+    /// Resources still being loaded in the background.
+    HashSet<StringHash> pendingResources_;
+    /// Resources used by the cell.
+    Vector<ResourceRef> resources_;
+    /// Root nodes created from the cell.
+    Vector<WeakPtr<Node> > nodes_;
+    /// Timer for resource preloading.
+    HiresTimer preloadTimer_;
+    /// Number of root nodes in the cell file.
+    unsigned numNodes_;
+    /// Number of root nodes loaded so far.
+    unsigned loadedNodes_;
+    /// Size of the cell file in bytes.
+    unsigned dataSize_;
+    /// Memory use of the resources used by the cell when it was loaded, including resources shared with other cells.
+    unsigned resourceMemory_;
+    /// Time in milliseconds spent waiting for the background resource loading.
+    float preloadTime_;
+    /// Time in milliseconds spent creating the nodes.
+    float loadTime_;
+    /// Time in milliseconds spent removing the nodes when last unloaded.
+    float unloadTime_;
+    /// Number of updates the nodes were created over.
+    unsigned loadFrames_;
+};
+
+/// %Scene streaming component. Partitions the child nodes of its scene node into square cells on the XZ plane, which are saved as separate cell files, and loads and unloads the cells around observer nodes. Loading a cell preloads the resources it uses in the background first, and then creates its nodes within a per-update time budget. Cell content is always reloaded from the cell file; changes made to the nodes of a loaded cell are lost on unload unless the cells are saved again. A cell whose file can not be loaded is kept in the failed state and not retried until it is unloaded with UnloadAllCells().
+class URHO3D_API SceneStreamer : public Component
+{
+    OBJECT(SceneStreamer);
+
+public:
+    /// Construct.
+    SceneStreamer(Context* context);
+    /// Destruct.
+    virtual ~SceneStreamer();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Partition the child nodes into cells and save the cells into a directory, which should be the cell path in one of the resource directories. Cells still being loaded are finished first, and unloaded cells that receive new nodes are loaded to merge with them. Nodes in cells that can not be loaded are not saved. Optionally remove the saved nodes, leaving the cells unloaded. Return true if successful.
+    bool SaveCells(const String& directory, bool removeNodes = true);
+    /// Add an observer node. Cells are loaded around the observers.
+    void AddObserver(Node* node);
+    /// Remove an observer node.
+    void RemoveObserver(Node* node);
+    /// Remove all observer nodes.
+    void RemoveAllObservers();
+    /// Load and unload cells according to the observer positions within the time budget. Called on each scene update when enabled.
+    void Update();
+    /// Unload all cells immediately.
+    void UnloadAllCells();
+    /// Set cell size. Cells must be saved again after changing.
+    void SetCellSize(float size);
+    /// Set resource path of the cell files.
+    void SetCellPath(const String& path);
+    /// Set distance from an observer within which cells are loaded.
+    void SetLoadDistance(float distance);
+    /// Set distance from the observers beyond which cells are unloaded. Never less than the load distance.
+    void SetUnloadDistance(float distance);
+    /// Set time budget in milliseconds for loading cell nodes per update.
+    void SetLoadingMs(int ms);
+
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+    /// Return resource path of the cell files.
+    const String& GetCellPath() const { return cellPath_; }
+    /// Return load distance.
+    float GetLoadDistance() const { return loadDistance_; }
+    /// Return unload distance.
+    float GetUnloadDistance() const { return unloadDistance_; }
+    /// Return time budget in milliseconds for loading cell nodes per update.
+    int GetLoadingMs() const { return loadingMs_; }
+    /// Return number of observer nodes.
+    unsigned GetNumObservers() const { return observers_.Size(); }
+    /// Return number of saved cells.
+    unsigned GetNumCells() const { return cells_.Size(); }
+    /// Return number of loaded cells.
+    unsigned GetNumLoadedCells() const;
+    /// Return whether any cells are being loaded.
+    bool IsLoading() const;
+    /// Return the coordinates of the cell containing a position in the scene node's space.
+    IntVector2 GetCellCoords(const Vector3& position) const;
+    /// Return a cell, or null if no cell has been saved at the coordinates.
+    const StreamingCell* GetCell(const IntVector2& coords) const;
+    /// Return loading state of a cell.
+    StreamingCellState GetCellState(const IntVector2& coords) const;
+    /// Return file name of a cell, without the cell path.
+    String GetCellFileName(const IntVector2& coords) const;
+
+    /// Set saved cells attribute.
+    void SetCellsAttr(const VariantVector& value);
+    /// Return saved cells attribute.
+    VariantVector GetCellsAttr() const;
+
+protected:
+    /// Handle scene being assigned.
+    virtual void OnSceneSet(Scene* scene);
+
+private:
+    /// Open a cell file and queue its resources for background loading. Return true if successful, or mark the cell failed.
+    bool BeginLoading(StreamingCell& cell);
+    /// Create the next root node of a loading cell. Return true if successful, or unload the cell and mark it failed.
+    bool LoadNode(StreamingCell& cell);
+    /// Load a cell completely without a time budget. Return true if successful.
+    bool LoadCellImmediately(StreamingCell& cell);
+    /// Resolve and apply the attributes of a loaded cell and send the loaded event.
+    void FinishLoading(StreamingCell& cell);
+    /// Remove the nodes of a cell and reset its loading state.
+    void UnloadCell(StreamingCell& cell);
+    /// Return the distance from a position to a cell on the XZ plane.
+    float GetCellDistance(const IntVector2& coords, const Vector3& position) const;
+    /// Handle scene update.
+    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle a background loaded resource.
+    void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
+
+    /// Cells by coordinates.
+    HashMap<IntVector2, StreamingCell> cells_;
+    /// Observer nodes.
+    Vector<WeakPtr<Node> > observers_;
+    /// Resources queued for background loading by the cells.
+    HashSet<StringHash> loadingResources_;
+    /// Resource path of the cell files.
+    String cellPath_;
+    /// Cell size.
+    float cellSize_;
+    /// Load distance.
+    float loadDistance_;
+    /// Unload distance.
+    float unloadDistance_;
+    /// Time budget in milliseconds for loading cell nodes per update.
+    int loadingMs_;
+};
+
+}
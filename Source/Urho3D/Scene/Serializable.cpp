@@ -54,6 +54,18 @@ static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, con
     return netAttrIndex; // Could not remap
 }
 
+bool AttributeAccessor::Write(const Serializable* ptr, Serializer& dest) const
+{
+    Variant value;
+    Get(ptr, value);
+    return dest.WriteVariantData(value);
+}
+
+void AttributeAccessor::Read(Serializable* ptr, Deserializer& source, VariantType type)
+{
+    Set(ptr, source.ReadVariant(type));
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     networkState_(0),
@@ -286,11 +298,14 @@ bool Serializable::Load(Deserializer& source, bool setInstanceDefault)
             return false;
         }
 
-        Variant varValue = source.ReadVariant(attr.type_);
-        OnSetAttribute(attr, varValue);
-
         if (setInstanceDefault)
+        {
+            Variant varValue = source.ReadVariant(attr.type_);
+            OnSetAttribute(attr, varValue);
             SetInstanceDefault(attr.name_, varValue);
+        }
+        else
+            ReadAttributeData(attr, source);
     }
 
     return true;
@@ -302,17 +317,13 @@ bool Serializable::Save(Serializer& dest) const
     if (!attributes)
         return true;
 
-    Variant value;
-
     for (unsigned i = 0; i < attributes->Size(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
         if (!(attr.mode_ & AM_FILE))
             continue;
 
-        OnGetAttribute(attr, value);
-
-        if (!dest.WriteVariantData(value))
+        if (!WriteAttributeData(attr, dest))
         {
             LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
             return false;
@@ -683,7 +694,7 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
             const AttributeInfo& attr = attributes->At(i);
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                ReadAttributeData(attr, source);
                 changed = true;
             }
             else
@@ -723,7 +734,7 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
         {
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                ReadAttributeData(attr, source);
                 changed = true;
             }
             else
@@ -744,6 +755,190 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
     return changed;
 }
 
+bool Serializable::WriteAttributeData(const AttributeInfo& attr, Serializer& dest) const
+{
+    // Subclasses may handle attribute access themselves, so go through OnGetAttribute() in that case
+    if (!AllowRawAttributeAccess())
+    {
+        Variant value;
+        OnGetAttribute(attr, value);
+        return dest.WriteVariantData(value);
+    }
+
+    if (attr.accessor_)
+        return attr.accessor_->Write(this, dest);
+
+    // Calculate the source address
+    const void* src = attr.ptr_ ? attr.ptr_ : reinterpret_cast<const unsigned char*>(this) + attr.offset_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        // If enum type, use the low 8 bits only
+        if (attr.enumNames_)
+            return dest.WriteInt(*(reinterpret_cast<const unsigned char*>(src)));
+        else
+            return dest.WriteInt(*(reinterpret_cast<const int*>(src)));
+
+    case VAR_BOOL:
+        return dest.WriteBool(*(reinterpret_cast<const bool*>(src)));
+
+    case VAR_FLOAT:
+        return dest.WriteFloat(*(reinterpret_cast<const float*>(src)));
+
+    case VAR_VECTOR2:
+        return dest.WriteVector2(*(reinterpret_cast<const Vector2*>(src)));
+
+    case VAR_VECTOR3:
+        return dest.WriteVector3(*(reinterpret_cast<const Vector3*>(src)));
+
+    case VAR_VECTOR4:
+        return dest.WriteVector4(*(reinterpret_cast<const Vector4*>(src)));
+
+    case VAR_QUATERNION:
+        return dest.WriteQuaternion(*(reinterpret_cast<const Quaternion*>(src)));
+
+    case VAR_COLOR:
+        return dest.WriteColor(*(reinterpret_cast<const Color*>(src)));
+
+    case VAR_STRING:
+        return dest.WriteString(*(reinterpret_cast<const String*>(src)));
+
+    case VAR_BUFFER:
+        return dest.WriteBuffer(*(reinterpret_cast<const PODVector<unsigned char>*>(src)));
+
+    case VAR_RESOURCEREF:
+        return dest.WriteResourceRef(*(reinterpret_cast<const ResourceRef*>(src)));
+
+    case VAR_RESOURCEREFLIST:
+        return dest.WriteResourceRefList(*(reinterpret_cast<const ResourceRefList*>(src)));
+
+    case VAR_VARIANTVECTOR:
+        return dest.WriteVariantVector(*(reinterpret_cast<const VariantVector*>(src)));
+
+    case VAR_VARIANTMAP:
+        return dest.WriteVariantMap(*(reinterpret_cast<const VariantMap*>(src)));
+
+    case VAR_INTRECT:
+        return dest.WriteIntRect(*(reinterpret_cast<const IntRect*>(src)));
+
+    case VAR_INTVECTOR2:
+        return dest.WriteIntVector2(*(reinterpret_cast<const IntVector2*>(src)));
+
+    case VAR_DOUBLE:
+        return dest.WriteDouble(*(reinterpret_cast<const double*>(src)));
+
+    default:
+        {
+            Variant value;
+            OnGetAttribute(attr, value);
+            return dest.WriteVariantData(value);
+        }
+    }
+}
+
+void Serializable::ReadAttributeData(const AttributeInfo& attr, Deserializer& source)
+{
+    // Subclasses may react to attribute changes, so go through OnSetAttribute() in that case
+    if (!AllowRawAttributeAccess())
+    {
+        OnSetAttribute(attr, source.ReadVariant(attr.type_));
+        return;
+    }
+
+    if (attr.accessor_)
+    {
+        attr.accessor_->Read(this, source, attr.type_);
+        return;
+    }
+
+    // Calculate the destination address
+    void* dest = attr.ptr_ ? attr.ptr_ : reinterpret_cast<unsigned char*>(this) + attr.offset_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        // If enum type, use the low 8 bits only
+        if (attr.enumNames_)
+            *(reinterpret_cast<unsigned char*>(dest)) = source.ReadInt();
+        else
+            *(reinterpret_cast<int*>(dest)) = source.ReadInt();
+        break;
+
+    case VAR_BOOL:
+        *(reinterpret_cast<bool*>(dest)) = source.ReadBool();
+        break;
+
+    case VAR_FLOAT:
+        *(reinterpret_cast<float*>(dest)) = source.ReadFloat();
+        break;
+
+    case VAR_VECTOR2:
+        *(reinterpret_cast<Vector2*>(dest)) = source.ReadVector2();
+        break;
+
+    case VAR_VECTOR3:
+        *(reinterpret_cast<Vector3*>(dest)) = source.ReadVector3();
+        break;
+
+    case VAR_VECTOR4:
+        *(reinterpret_cast<Vector4*>(dest)) = source.ReadVector4();
+        break;
+
+    case VAR_QUATERNION:
+        *(reinterpret_cast<Quaternion*>(dest)) = source.ReadQuaternion();
+        break;
+
+    case VAR_COLOR:
+        *(reinterpret_cast<Color*>(dest)) = source.ReadColor();
+        break;
+
+    case VAR_STRING:
+        *(reinterpret_cast<String*>(dest)) = source.ReadString();
+        break;
+
+    case VAR_BUFFER:
+        *(reinterpret_cast<PODVector<unsigned char>*>(dest)) = source.ReadBuffer();
+        break;
+
+    case VAR_RESOURCEREF:
+        *(reinterpret_cast<ResourceRef*>(dest)) = source.ReadResourceRef();
+        break;
+
+    case VAR_RESOURCEREFLIST:
+        *(reinterpret_cast<ResourceRefList*>(dest)) = source.ReadResourceRefList();
+        break;
+
+    case VAR_VARIANTVECTOR:
+        *(reinterpret_cast<VariantVector*>(dest)) = source.ReadVariantVector();
+        break;
+
+    case VAR_VARIANTMAP:
+        *(reinterpret_cast<VariantMap*>(dest)) = source.ReadVariantMap();
+        break;
+
+    case VAR_INTRECT:
+        *(reinterpret_cast<IntRect*>(dest)) = source.ReadIntRect();
+        break;
+
+    case VAR_INTVECTOR2:
+        *(reinterpret_cast<IntVector2*>(dest)) = source.ReadIntVector2();
+        break;
+
+    case VAR_DOUBLE:
+        *(reinterpret_cast<double*>(dest)) = source.ReadDouble();
+        break;
+
+    default:
+        OnSetAttribute(attr, source.ReadVariant(attr.type_));
+        return;
+    }
+
+    // If it is a network attribute then mark it for next network update
+    if (attr.mode_ & AM_NET)
+        MarkNetworkUpdate();
+}
+
 Variant Serializable::GetAttribute(unsigned index) const
 {
     Variant ret;
@@ -24,6 +24,8 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
 
 #include <cstddef>
 
@@ -31,8 +33,6 @@ namespace Urho3D
 {
 
 class Connection;
-class Deserializer;
-class Serializer;
 class XMLElement;
 
 struct DirtyBits;
@@ -70,6 +70,9 @@ public:
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
     virtual void ApplyAttributes() { }
 
+    /// Return whether the attributes may be saved and restored in bulk, copying offset attributes directly in memory and bypassing OnGetAttribute(), OnSetAttribute() and Load(). Used by scene snapshots, which otherwise save and load the object through Save() and Load(). Subclasses that override OnSetAttribute() or Load() to react to attribute changes should return false. Default true.
+    virtual bool AllowRawAttributeAccess() const { return true; }
+
     /// Return whether should save default-valued attributes into XML. Default false.
     virtual bool SaveDefaultAttributes() const { return false; }
 
@@ -100,6 +103,10 @@ public:
     bool ReadDeltaUpdate(Deserializer& source);
     /// Read and apply a network latest data update. Return true if attributes were changed.
     bool ReadLatestDataUpdate(Deserializer& source);
+    /// Write an attribute to a stream in the same format as its variant data. When raw attribute access is allowed, offset attributes are written directly from memory and accessor attributes through their typed get function, without converting to a variant. Return true if successful.
+    bool WriteAttributeData(const AttributeInfo& attr, Serializer& dest) const;
+    /// Read an attribute from a stream in the same format as its variant data and set it. When raw attribute access is allowed, bypasses OnSetAttribute() and the conversion to a variant.
+    void ReadAttributeData(const AttributeInfo& attr, Deserializer& source);
 
     /// Return attribute value by index. Return empty if illegal index.
     Variant GetAttribute(unsigned index) const;
@@ -139,6 +146,84 @@ private:
     bool temporary_;
 };
 
+/// Write an attribute value to a stream in the same format as its variant data. Types without a matching serializer function are converted to a variant.
+template <typename T> inline bool WriteAttributeValue(Serializer& dest, const T& value) { return dest.WriteVariantData(Variant(value)); }
+/// Write an int attribute value.
+inline bool WriteAttributeValue(Serializer& dest, int value) { return dest.WriteInt(value); }
+/// Write an unsigned attribute value.
+inline bool WriteAttributeValue(Serializer& dest, unsigned value) { return dest.WriteUInt(value); }
+/// Write a bool attribute value.
+inline bool WriteAttributeValue(Serializer& dest, bool value) { return dest.WriteBool(value); }
+/// Write a float attribute value.
+inline bool WriteAttributeValue(Serializer& dest, float value) { return dest.WriteFloat(value); }
+/// Write a double attribute value.
+inline bool WriteAttributeValue(Serializer& dest, double value) { return dest.WriteDouble(value); }
+/// Write a Vector2 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector2& value) { return dest.WriteVector2(value); }
+/// Write a Vector3 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector3& value) { return dest.WriteVector3(value); }
+/// Write a Vector4 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector4& value) { return dest.WriteVector4(value); }
+/// Write a Quaternion attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Quaternion& value) { return dest.WriteQuaternion(value); }
+/// Write a Color attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Color& value) { return dest.WriteColor(value); }
+/// Write a String attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const String& value) { return dest.WriteString(value); }
+/// Write a buffer attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const PODVector<unsigned char>& value) { return dest.WriteBuffer(value); }
+/// Write a ResourceRef attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRef& value) { return dest.WriteResourceRef(value); }
+/// Write a ResourceRefList attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRefList& value) { return dest.WriteResourceRefList(value); }
+/// Write a VariantVector attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const VariantVector& value) { return dest.WriteVariantVector(value); }
+/// Write a VariantMap attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const VariantMap& value) { return dest.WriteVariantMap(value); }
+/// Write an IntRect attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const IntRect& value) { return dest.WriteIntRect(value); }
+/// Write an IntVector2 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const IntVector2& value) { return dest.WriteIntVector2(value); }
+
+/// Read an attribute value from a stream in the same format as its variant data. Types without a matching deserializer function are read as a variant.
+template <typename T> inline void ReadAttributeValue(Deserializer& source, T& value) { value = source.ReadVariant(GetVariantType<T>()).template Get<T>(); }
+/// Read an int attribute value.
+inline void ReadAttributeValue(Deserializer& source, int& value) { value = source.ReadInt(); }
+/// Read an unsigned attribute value.
+inline void ReadAttributeValue(Deserializer& source, unsigned& value) { value = source.ReadUInt(); }
+/// Read a bool attribute value.
+inline void ReadAttributeValue(Deserializer& source, bool& value) { value = source.ReadBool(); }
+/// Read a float attribute value.
+inline void ReadAttributeValue(Deserializer& source, float& value) { value = source.ReadFloat(); }
+/// Read a double attribute value.
+inline void ReadAttributeValue(Deserializer& source, double& value) { value = source.ReadDouble(); }
+/// Read a Vector2 attribute value.
+inline void ReadAttributeValue(Deserializer& source, Vector2& value) { value = source.ReadVector2(); }
+/// Read a Vector3 attribute value.
+inline void ReadAttributeValue(Deserializer& source, Vector3& value) { value = source.ReadVector3(); }
+/// Read a Vector4 attribute value.
+inline void ReadAttributeValue(Deserializer& source, Vector4& value) { value = source.ReadVector4(); }
+/// Read a Quaternion attribute value.
+inline void ReadAttributeValue(Deserializer& source, Quaternion& value) { value = source.ReadQuaternion(); }
+/// Read a Color attribute value.
+inline void ReadAttributeValue(Deserializer& source, Color& value) { value = source.ReadColor(); }
+/// Read a String attribute value.
+inline void ReadAttributeValue(Deserializer& source, String& value) { value = source.ReadString(); }
+/// Read a buffer attribute value.
+inline void ReadAttributeValue(Deserializer& source, PODVector<unsigned char>& value) { value = source.ReadBuffer(); }
+/// Read a ResourceRef attribute value.
+inline void ReadAttributeValue(Deserializer& source, ResourceRef& value) { value = source.ReadResourceRef(); }
+/// Read a ResourceRefList attribute value.
+inline void ReadAttributeValue(Deserializer& source, ResourceRefList& value) { value = source.ReadResourceRefList(); }
+/// Read a VariantVector attribute value.
+inline void ReadAttributeValue(Deserializer& source, VariantVector& value) { value = source.ReadVariantVector(); }
+/// Read a VariantMap attribute value.
+inline void ReadAttributeValue(Deserializer& source, VariantMap& value) { value = source.ReadVariantMap(); }
+/// Read an IntRect attribute value.
+inline void ReadAttributeValue(Deserializer& source, IntRect& value) { value = source.ReadIntRect(); }
+/// Read an IntVector2 attribute value.
+inline void ReadAttributeValue(Deserializer& source, IntVector2& value) { value = source.ReadIntVector2(); }
+
 /// Template implementation of the enum attribute accessor invoke helper class.
 template <typename T, typename U> class EnumAttributeAccessorImpl : public AttributeAccessor
 {
@@ -171,6 +256,28 @@ public:
         (classPtr->*setFunction_)((U)value.GetInt());
     }
 
+    /// Invoke getter function and write the value as an int.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return dest.WriteInt((int)(classPtr->*getFunction_)());
+    }
+
+    /// Read the value as an int and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        if (type != VAR_INT)
+        {
+            AttributeAccessor::Read(ptr, source, type);
+            return;
+        }
+
+        T* classPtr = static_cast<T*>(ptr);
+        (classPtr->*setFunction_)((U)source.ReadInt());
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -253,6 +360,30 @@ public:
         (classPtr->*setFunction_)(value.Get < U > ());
     }
 
+    /// Invoke getter function and write the value without converting it to a variant.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return WriteAttributeValue(dest, (classPtr->*getFunction_)());
+    }
+
+    /// Read the value without converting it to a variant and invoke setter function.
+    virtual void Read(Serializable* ptr, Deserializer& source, VariantType type)
+    {
+        assert(ptr);
+        if (type != GetVariantType<U>())
+        {
+            AttributeAccessor::Read(ptr, source, type);
+            return;
+        }
+
+        T* classPtr = static_cast<T*>(ptr);
+        U value;
+        ReadAttributeValue(source, value);
+        (classPtr->*setFunction_)(value);
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -31,6 +31,10 @@
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ValueAnimation.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -43,6 +47,65 @@ const char* interpMethodNames[] =
     0
 };
 
+/// Return the number of floats in a value type that can be evaluated as floats, or zero for other types.
+static unsigned GetNumFloatComponents(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_FLOAT:
+        return 1;
+
+    case VAR_VECTOR2:
+        return 2;
+
+    case VAR_VECTOR3:
+        return 3;
+
+    case VAR_VECTOR4:
+    case VAR_QUATERNION:
+    case VAR_COLOR:
+        return 4;
+
+    default:
+        return 0;
+    }
+}
+
+/// Copy a value as floats.
+static void CopyFloatData(const Variant& value, unsigned numComponents, float* dest)
+{
+    switch (value.GetType())
+    {
+    case VAR_FLOAT:
+        dest[0] = value.GetFloat();
+        return;
+
+    case VAR_VECTOR2:
+        memcpy(dest, value.GetVector2().Data(), numComponents * sizeof(float));
+        return;
+
+    case VAR_VECTOR3:
+        memcpy(dest, value.GetVector3().Data(), numComponents * sizeof(float));
+        return;
+
+    case VAR_VECTOR4:
+        memcpy(dest, value.GetVector4().Data(), numComponents * sizeof(float));
+        return;
+
+    case VAR_QUATERNION:
+        memcpy(dest, value.GetQuaternion().Data(), numComponents * sizeof(float));
+        return;
+
+    case VAR_COLOR:
+        memcpy(dest, value.GetColor().Data(), numComponents * sizeof(float));
+        return;
+
+    default:
+        memset(dest, 0, numComponents * sizeof(float));
+        return;
+    }
+}
+
 ValueAnimation::ValueAnimation(Context* context) :
     Resource(context),
     owner_(0),
@@ -52,7 +115,9 @@ ValueAnimation::ValueAnimation(Context* context) :
     interpolatable_(false),
     beginTime_(M_INFINITY),
     endTime_(-M_INFINITY),
-    splineTangentsDirty_(false)
+    splineTangentsDirty_(false),
+    dataComponents_(0),
+    animationDataDirty_(true)
 {
 }
 
@@ -176,6 +241,7 @@ void ValueAnimation::SetValueType(VariantType valueType)
     eventFrames_.Clear();
     beginTime_ = M_INFINITY;
     endTime_ = -M_INFINITY;
+    animationDataDirty_ = true;
 }
 
 void ValueAnimation::SetOwner(void* owner)
@@ -194,12 +260,14 @@ void ValueAnimation::SetInterpolationMethod(InterpMethod method)
 
     interpolationMethod_ = method;
     splineTangentsDirty_ = true;
+    animationDataDirty_ = true;
 }
 
 void ValueAnimation::SetSplineTension(float tension)
 {
     splineTension_ = tension;
     splineTangentsDirty_ = true;
+    animationDataDirty_ = true;
 }
 
 bool ValueAnimation::SetKeyFrame(float time, const Variant& value)
@@ -233,6 +301,7 @@ bool ValueAnimation::SetKeyFrame(float time, const Variant& value)
     beginTime_ = Min(time, beginTime_);
     endTime_ = Max(time, endTime_);
     splineTangentsDirty_ = true;
+    animationDataDirty_ = true;
 
     return true;
 }
@@ -285,6 +354,116 @@ Variant ValueAnimation::GetAnimationValue(float scaledTime)
     }
 }
 
+unsigned ValueAnimation::PrepareAnimationData()
+{
+    if (!animationDataDirty_)
+        return dataComponents_;
+
+    keyTimes_.Clear();
+    keyData_.Clear();
+    tangentData_.Clear();
+    dataComponents_ = IsValid() ? GetNumFloatComponents(valueType_) : 0;
+
+    if (dataComponents_)
+    {
+        unsigned numKeyFrames = keyFrames_.Size();
+        keyTimes_.Resize(numKeyFrames);
+        keyData_.Resize(numKeyFrames * dataComponents_);
+        for (unsigned i = 0; i < numKeyFrames; ++i)
+        {
+            keyTimes_[i] = keyFrames_[i].time_;
+            CopyFloatData(keyFrames_[i].value_, dataComponents_, &keyData_[i * dataComponents_]);
+        }
+
+        if (interpolationMethod_ == IM_SPLINE)
+        {
+            if (splineTangentsDirty_)
+                UpdateSplineTangents();
+
+            tangentData_.Resize(numKeyFrames * dataComponents_);
+            for (unsigned i = 0; i < numKeyFrames; ++i)
+                CopyFloatData(splineTangents_[i], dataComponents_, &tangentData_[i * dataComponents_]);
+        }
+    }
+
+    animationDataDirty_ = false;
+    return dataComponents_;
+}
+
+void ValueAnimation::GetAnimationData(float scaledTime, float* dest) const
+{
+    unsigned numComponents = dataComponents_;
+    unsigned numKeyFrames = keyTimes_.Size();
+
+    // Find the first key frame after the time, starting from the second as in GetAnimationValue()
+    unsigned index = 1;
+    unsigned end = numKeyFrames;
+    while (index < end)
+    {
+        unsigned middle = (index + end) >> 1;
+        if (scaledTime < keyTimes_[middle])
+            end = middle;
+        else
+            index = middle + 1;
+    }
+
+    if (index >= numKeyFrames)
+    {
+        memcpy(dest, &keyData_[(numKeyFrames - 1) * numComponents], numComponents * sizeof(float));
+        return;
+    }
+
+    const float* v1 = &keyData_[(index - 1) * numComponents];
+    const float* v2 = v1 + numComponents;
+    float t = (scaledTime - keyTimes_[index - 1]) / (keyTimes_[index] - keyTimes_[index - 1]);
+
+    if (interpolationMethod_ == IM_LINEAR)
+    {
+        if (valueType_ == VAR_QUATERNION)
+        {
+            Quaternion q = Quaternion(v1[0], v1[1], v1[2], v1[3]).Slerp(Quaternion(v2[0], v2[1], v2[2], v2[3]), t);
+            memcpy(dest, q.Data(), 4 * sizeof(float));
+            return;
+        }
+
+        float s = 1.0f - t;
+#ifdef URHO3D_SSE
+        if (numComponents == 4)
+        {
+            _mm_storeu_ps(dest, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v1), _mm_set1_ps(s)), _mm_mul_ps(_mm_loadu_ps(v2),
+                _mm_set1_ps(t))));
+            return;
+        }
+#endif
+        for (unsigned i = 0; i < numComponents; ++i)
+            dest[i] = v1[i] * s + v2[i] * t;
+    }
+    else
+    {
+        float tt = t * t;
+        float ttt = t * tt;
+
+        float h1 = 2.0f * ttt - 3.0f * tt + 1.0f;
+        float h2 = -2.0f * ttt + 3.0f * tt;
+        float h3 = ttt - 2.0f * tt + t;
+        float h4 = ttt - tt;
+
+        const float* t1 = &tangentData_[(index - 1) * numComponents];
+        const float* t2 = t1 + numComponents;
+#ifdef URHO3D_SSE
+        if (numComponents == 4)
+        {
+            __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v1), _mm_set1_ps(h1)), _mm_mul_ps(_mm_loadu_ps(v2), _mm_set1_ps(h2)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(t1), _mm_set1_ps(h3)));
+            _mm_storeu_ps(dest, _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(t2), _mm_set1_ps(h4))));
+            return;
+        }
+#endif
+        for (unsigned i = 0; i < numComponents; ++i)
+            dest[i] = v1[i] * h1 + v2[i] * h2 + t1[i] * h3 + t2[i] * h4;
+    }
+}
+
 void ValueAnimation::GetEventFrames(float beginTime, float endTime, PODVector<const VAnimEventFrame*>& eventFrames) const
 {
     for (unsigned i = 0; i < eventFrames_.Size(); ++i)
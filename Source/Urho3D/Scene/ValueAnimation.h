@@ -118,6 +118,10 @@ public:
 
     /// Return animation value.
     Variant GetAnimationValue(float scaledTime);
+    /// Prepare the key frames for GetAnimationData(). Must be called from the main thread before evaluating a changed animation. Return the number of floats per value, or zero if the value type can not be evaluated as floats.
+    unsigned PrepareAnimationData();
+    /// Evaluate the animation value into floats laid out as in the value type. Requires PrepareAnimationData() to have been called. Does not modify the animation, so it may be called from worker threads.
+    void GetAnimationData(float scaledTime, float* dest) const;
 
     /// Has event frames.
     bool HasEventFrames() const { return !eventFrames_.Empty(); }
@@ -157,6 +161,16 @@ protected:
     bool splineTangentsDirty_;
     /// Event frames.
     Vector<VAnimEventFrame> eventFrames_;
+    /// Key frame times for evaluation as floats.
+    PODVector<float> keyTimes_;
+    /// Key frame values as floats.
+    PODVector<float> keyData_;
+    /// Spline tangents as floats.
+    PODVector<float> tangentData_;
+    /// Number of floats per value, or zero if not evaluated as floats.
+    unsigned dataComponents_;
+    /// Float key frame data dirty.
+    bool animationDataDirty_;
 };
 
 }
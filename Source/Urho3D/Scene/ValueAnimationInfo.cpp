@@ -71,32 +71,44 @@ bool ValueAnimationInfo::Update(float timeStep)
     if (!animation_ || !target_)
         return true;
 
+    float scaledTime;
+    bool finished = false;
+    if (!AdvanceTime(timeStep, scaledTime, finished))
+        return true;
+
+    // Apply to the target object
+    ApplyValue(animation_->GetAnimationValue(scaledTime));
+
+    SendEventFrames(scaledTime);
+
+    return finished;
+}
+
+bool ValueAnimationInfo::AdvanceTime(float timeStep, float& scaledTime, bool& finished)
+{
     currentTime_ += timeStep * speed_;
 
     if (!animation_->IsValid())
-        return true;
-
-    bool finished = false;
+        return false;
 
     // Calculate scale time by wrap mode
-    float scaledTime = CalculateScaledTime(currentTime_, finished);
-
-    // Apply to the target object
-    ApplyValue(animation_->GetAnimationValue(scaledTime));
+    scaledTime = CalculateScaledTime(currentTime_, finished);
+    return true;
+}
 
+void ValueAnimationInfo::SendEventFrames(float scaledTime)
+{
     // Send keyframe event if necessary
     if (animation_->HasEventFrames())
     {
         PODVector<const VAnimEventFrame*> eventFrames;
         GetEventFrames(lastScaledTime_, scaledTime, eventFrames);
 
-        for (unsigned i = 0; i < eventFrames.Size(); ++i)
+        for (unsigned i = 0; i < eventFrames.Size() && target_; ++i)
             target_->SendEvent(eventFrames[i]->eventType_, const_cast<VariantMap&>(eventFrames[i]->eventData_));
     }
 
     lastScaledTime_ = scaledTime;
-
-    return finished;
 }
 
 Object* ValueAnimationInfo::GetTarget() const
@@ -47,6 +47,10 @@ public:
 
     /// Update. Return true when the animation is finished. No-op when the target object is not defined.
     bool Update(float timeStep);
+    /// Advance the current time and calculate the scaled time to evaluate the animation at, for updating without Update(). Set finished when the animation is finished. Return false if the animation is not valid.
+    bool AdvanceTime(float timeStep, float& scaledTime, bool& finished);
+    /// Send the event frames passed since the last update and store the scaled time. Called after the value at the scaled time has been applied.
+    void SendEventFrames(float scaledTime);
 
     /// Set wrap mode.
     void SetWrapMode(WrapMode wrapMode) { wrapMode_ = wrapMode; }
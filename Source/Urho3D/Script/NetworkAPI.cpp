@@ -45,6 +45,29 @@ static void RegisterNetworkPriority(asIScriptEngine* engine)
     engine->RegisterObjectMethod("NetworkPriority", "bool get_alwaysUpdateOwner() const", asMETHOD(NetworkPriority, GetAlwaysUpdateOwner), asCALL_THISCALL);
 }
 
+static void ConstructNetworkStatistics(NetworkStatistics* ptr)
+{
+    new(ptr) NetworkStatistics();
+}
+
+static void ConstructNetworkStatisticsCopy(const NetworkStatistics& stats, NetworkStatistics* ptr)
+{
+    new(ptr) NetworkStatistics(stats);
+}
+
+static void RegisterNetworkStatistics(asIScriptEngine* engine)
+{
+    engine->RegisterObjectType("NetworkStatistics", sizeof(NetworkStatistics), asOBJ_VALUE | asOBJ_POD | asOBJ_APP_CLASS_C);
+    engine->RegisterObjectBehaviour("NetworkStatistics", asBEHAVE_CONSTRUCT, "void f()", asFUNCTION(ConstructNetworkStatistics), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectBehaviour("NetworkStatistics", asBEHAVE_CONSTRUCT, "void f(const NetworkStatistics&in)", asFUNCTION(ConstructNetworkStatisticsCopy), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("NetworkStatistics", "void Reset()", asMETHOD(NetworkStatistics, Reset), asCALL_THISCALL);
+    engine->RegisterObjectProperty("NetworkStatistics", "uint messagesIn", offsetof(NetworkStatistics, messagesIn_));
+    engine->RegisterObjectProperty("NetworkStatistics", "uint messagesOut", offsetof(NetworkStatistics, messagesOut_));
+    engine->RegisterObjectProperty("NetworkStatistics", "uint bytesIn", offsetof(NetworkStatistics, bytesIn_));
+    engine->RegisterObjectProperty("NetworkStatistics", "uint bytesOut", offsetof(NetworkStatistics, bytesOut_));
+    engine->RegisterObjectProperty("NetworkStatistics", "uint serializationTime", offsetof(NetworkStatistics, serializationTime_));
+}
+
 void SendRemoteEvent(const String& eventType, bool inOrder, const VariantMap& eventData, Connection* ptr)
 {
     ptr->SendRemoteEvent(eventType, inOrder, eventData);
@@ -67,6 +90,14 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "Scene@+ get_scene() const", asMETHOD(Connection, GetScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_logStatistics(bool)", asMETHOD(Connection, SetLogStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_logStatistics() const", asMETHOD(Connection, GetLogStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void ResetStatistics()", asMETHOD(Connection, ResetStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void AddPredictedNode(Node@+)", asMETHOD(Connection, AddPredictedNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void RemovePredictedNode(Node@+)", asMETHOD(Connection, RemovePredictedNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void RemoveAllPredictedNodes()", asMETHOD(Connection, RemoveAllPredictedNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "bool IsPredicted(Node@+) const", asMETHOD(Connection, IsPredicted), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "uint8 get_serverTimeStamp() const", asMETHOD(Connection, GetServerTimeStamp), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "bool get_replaying() const", asMETHOD(Connection, IsReplaying), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "const NetworkStatistics& get_statistics() const", asMETHOD(Connection, GetStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_client() const", asMETHOD(Connection, IsClient), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_connected() const", asMETHOD(Connection, IsConnected), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_connectPending() const", asMETHOD(Connection, IsConnectPending), asCALL_THISCALL);
@@ -144,11 +175,38 @@ static void NetworkUnregisterRemoteEvent(const String& eventType, Network* ptr)
     ptr->UnregisterRemoteEvent(eventType);
 }
 
+static bool NetworkRegisterRemoteEventSchema(const String& eventType, CScriptArray* paramNames, CScriptArray* paramTypes, Network* ptr)
+{
+    Vector<StringHash> names;
+    PODVector<VariantType> types;
+    if (paramNames)
+    {
+        for (unsigned i = 0; i < paramNames->GetSize(); ++i)
+            names.Push(StringHash(*(static_cast<String*>(paramNames->At(i)))));
+    }
+    if (paramTypes)
+    {
+        for (unsigned i = 0; i < paramTypes->GetSize(); ++i)
+            types.Push(*(static_cast<VariantType*>(paramTypes->At(i))));
+    }
+    return ptr->RegisterRemoteEventSchema(eventType, names, types);
+}
+
+static void NetworkUnregisterRemoteEventSchema(const String& eventType, Network* ptr)
+{
+    ptr->UnregisterRemoteEventSchema(eventType);
+}
+
 static bool NetworkCheckRemoteEvent(const String& eventType, Network* ptr)
 {
     return ptr->CheckRemoteEvent(eventType);
 }
 
+static NetworkStatistics NetworkGetSerializationStatistics(const String& type, Network* ptr)
+{
+    return ptr->GetSerializationStatistics(type);
+}
+
 static HttpRequest* NetworkMakeHttpRequest(const String& url, const String& verb, CScriptArray* headers, const String& postData, Network* ptr)
 {
     SharedPtr<HttpRequest> request = ptr->MakeHttpRequest(url, verb, ArrayToVector<String>(headers), postData);
@@ -173,9 +231,15 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "void RegisterRemoteEvent(const String&in) const", asFUNCTION(NetworkRegisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterRemoteEvent(const String&in) const", asFUNCTION(NetworkUnregisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterAllRemoteEvents()", asMETHOD(Network, UnregisterAllRemoteEvents), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool RegisterRemoteEventSchema(const String&in, Array<String>@+, Array<VariantType>@+)", asFUNCTION(NetworkRegisterRemoteEventSchema), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void UnregisterRemoteEventSchema(const String&in)", asFUNCTION(NetworkUnregisterRemoteEventSchema), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "bool CheckRemoteEvent(const String&in) const", asFUNCTION(NetworkCheckRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "HttpRequest@ MakeHttpRequest(const String&in, const String&in verb = String(), Array<String>@+ headers = null, const String&in postData = String())", asFUNCTION(NetworkMakeHttpRequest), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void SendPackageToClients(Scene@+, PackageFile@+)", asMETHOD(Network, SendPackageToClients), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void ResetStatistics()", asMETHOD(Network, ResetStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "NetworkStatistics GetMessageStatistics(int) const", asMETHODPR(Network, GetMessageStatistics, (int) const, NetworkStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "NetworkStatistics GetSerializationStatistics(const String&in) const", asFUNCTION(NetworkGetSerializationStatistics), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "String PrintStatistics() const", asMETHOD(Network, PrintStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_updateFps(int)", asMETHOD(Network, SetUpdateFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "int get_updateFps() const", asMETHOD(Network, GetUpdateFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_simulatedLatency(int)", asMETHOD(Network, SetSimulatedLatency), asCALL_THISCALL);
@@ -184,6 +248,16 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "float get_simulatedPacketLoss() const", asMETHOD(Network, GetSimulatedPacketLoss), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_packageCacheDir(const String&in)", asMETHOD(Network, SetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_packageCacheDir() const", asMETHOD(Network, GetPackageCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_maxPackageDownloads(uint)", asMETHOD(Network, SetMaxPackageDownloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "uint get_maxPackageDownloads() const", asMETHOD(Network, GetMaxPackageDownloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageCompression(bool)", asMETHOD(Network, SetPackageCompression), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_packageCompression() const", asMETHOD(Network, GetPackageCompression), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_statisticsEnabled(bool)", asMETHOD(Network, SetStatisticsEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_statisticsEnabled() const", asMETHOD(Network, GetStatisticsEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_statisticsInterval(int)", asMETHOD(Network, SetStatisticsInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "int get_statisticsInterval() const", asMETHOD(Network, GetStatisticsInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_statisticsFileName(const String&in)", asMETHOD(Network, SetStatisticsFileName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "const String& get_statisticsFileName() const", asMETHOD(Network, GetStatisticsFileName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool get_serverRunning() const", asMETHOD(Network, IsServerRunning), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Connection@+ get_serverConnection() const", asMETHOD(Network, GetServerConnection), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Array<Connection@>@ get_clientConnections() const", asFUNCTION(NetworkGetClientConnections), asCALL_CDECL_OBJLAST);
@@ -193,6 +267,7 @@ void RegisterNetwork(asIScriptEngine* engine)
 void RegisterNetworkAPI(asIScriptEngine* engine)
 {
     RegisterNetworkPriority(engine);
+    RegisterNetworkStatistics(engine);
     RegisterConnection(engine);
     RegisterHttpRequest(engine);
     RegisterNetwork(engine);
@@ -83,6 +83,41 @@ static unsigned ResourceCacheGetMemoryUse(const String& type, ResourceCache* ptr
     return ptr->GetMemoryUse(type);
 }
 
+static void ResourceCacheSetEvictionPriority(const String& type, int priority, ResourceCache* ptr)
+{
+    ptr->SetEvictionPriority(type, priority);
+}
+
+static int ResourceCacheGetEvictionPriority(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetEvictionPriority(type);
+}
+
+static void ResourceCacheSetResourcePinned(const String& type, const String& name, bool enable, ResourceCache* ptr)
+{
+    ptr->SetResourcePinned(type, name, enable);
+}
+
+static bool ResourceCacheIsResourcePinned(const String& type, const String& name, ResourceCache* ptr)
+{
+    return ptr->IsResourcePinned(type, name);
+}
+
+static unsigned ResourceCacheGetNumHits(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumHits(type);
+}
+
+static unsigned ResourceCacheGetNumMisses(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumMisses(type);
+}
+
+static unsigned ResourceCacheGetNumEvictions(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumEvictions(type);
+}
+
 static ResourceCache* GetResourceCache()
 {
     return GetScriptContext()->GetSubsystem<ResourceCache>();
@@ -98,13 +133,37 @@ static CScriptArray* ResourceCacheGetPackageFiles(ResourceCache* ptr)
     return VectorToHandleArray<PackageFile>(ptr->GetPackageFiles(), "Array<PackageFile@>");
 }
 
-static bool ResourceCacheBackgroundLoadResource(const String& type, const String& name, bool sendEventOnFailure, ResourceCache* ptr)
+static bool ResourceCacheBackgroundLoadResource(const String& type, const String& name, bool sendEventOnFailure, int priority, ResourceCache* ptr)
 {
-    return ptr->BackgroundLoadResource(type, name, sendEventOnFailure);
+    return ptr->BackgroundLoadResource(type, name, sendEventOnFailure, 0, priority);
+}
+
+static void ResourceCacheSetMaxConcurrentBackgroundLoads(const String& type, unsigned num, ResourceCache* ptr)
+{
+    ptr->SetMaxConcurrentBackgroundLoads(type, num);
+}
+
+static unsigned ResourceCacheGetMaxConcurrentBackgroundLoads(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetMaxConcurrentBackgroundLoads(type);
+}
+
+static bool ResourceCacheSaveLoadRecordsCSV(File* file, ResourceCache* ptr)
+{
+    return file && ptr->SaveLoadRecordsCSV(*file);
+}
+
+static bool ResourceCacheSaveLoadTrace(File* file, ResourceCache* ptr)
+{
+    return file && ptr->SaveLoadTrace(*file);
 }
 
 static void RegisterResourceCache(asIScriptEngine* engine)
 {
+    engine->RegisterEnum("ResourceEvictionPolicy");
+    engine->RegisterEnumValue("ResourceEvictionPolicy", "EVICT_LRU", EVICT_LRU);
+    engine->RegisterEnumValue("ResourceEvictionPolicy", "EVICT_LFU", EVICT_LFU);
+
     RegisterObject<ResourceCache>(engine, "ResourceCache");
     engine->RegisterObjectMethod("ResourceCache", "bool AddResourceDir(const String&in, uint priority = M_MAX_UNSIGNED)", asMETHOD(ResourceCache, AddResourceDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool AddPackageFile(PackageFile@+, uint priority = M_MAX_UNSIGNED)", asMETHODPR(ResourceCache, AddPackageFile, (PackageFile*, unsigned), bool), asCALL_THISCALL);
@@ -130,15 +189,41 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(StringHash, const String&in, bool sendEventOnFailure = true)", asMETHODPR(ResourceCache, GetResource, (StringHash, const String&, bool), Resource*), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(const String&in, const String&in)", asFUNCTION(ResourceCacheGetExistingResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(StringHash, const String&in)", asMETHODPR(ResourceCache, GetExistingResource, (StringHash, const String&), Resource*), asCALL_THISCALL);
-    engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, bool sendEventOnFailure = true)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, bool sendEventOnFailure = true, int priority = 0)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "void SetMaxConcurrentBackgroundLoads(const String&in, uint)", asFUNCTION(ResourceCacheSetMaxConcurrentBackgroundLoads), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint GetMaxConcurrentBackgroundLoads(const String&in) const", asFUNCTION(ResourceCacheGetMaxConcurrentBackgroundLoads), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "void SetResourcePinned(const String&in, const String&in, bool)", asFUNCTION(ResourceCacheSetResourcePinned), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "bool IsResourcePinned(const String&in, const String&in) const", asFUNCTION(ResourceCacheIsResourcePinned), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "void PrefetchResources(const ResourceRefList&in, int priority = 0)", asMETHOD(ResourceCache, PrefetchResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint EvictResources(const ResourceRefList&in)", asMETHOD(ResourceCache, EvictResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void ResetStatistics()", asMETHOD(ResourceCache, ResetStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void ClearLoadRecords()", asMETHOD(ResourceCache, ClearLoadRecords), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool SaveLoadRecordsCSV(File@+) const", asFUNCTION(ResourceCacheSaveLoadRecordsCSV), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "bool SaveLoadTrace(File@+) const", asFUNCTION(ResourceCacheSaveLoadTrace), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_memoryBudget(const String&in, uint)", asFUNCTION(ResourceCacheSetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryBudget(const String&in) const", asFUNCTION(ResourceCacheGetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryUse(const String&in) const", asFUNCTION(ResourceCacheGetMemoryUse), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_totalMemoryUse() const", asMETHOD(ResourceCache, GetTotalMemoryUse), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_totalMemoryBudget(uint)", asMETHOD(ResourceCache, SetTotalMemoryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_totalMemoryBudget() const", asMETHOD(ResourceCache, GetTotalMemoryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_evictionPolicy(ResourceEvictionPolicy)", asMETHOD(ResourceCache, SetEvictionPolicy), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "ResourceEvictionPolicy get_evictionPolicy() const", asMETHOD(ResourceCache, GetEvictionPolicy), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_evictionPriority(const String&in, int)", asFUNCTION(ResourceCacheSetEvictionPriority), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "int get_evictionPriority(const String&in) const", asFUNCTION(ResourceCacheGetEvictionPriority), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numHits(const String&in) const", asFUNCTION(ResourceCacheGetNumHits), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numMisses(const String&in) const", asFUNCTION(ResourceCacheGetNumMisses), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numEvictions(const String&in) const", asFUNCTION(ResourceCacheGetNumEvictions), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_totalNumHits() const", asMETHOD(ResourceCache, GetTotalNumHits), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_totalNumMisses() const", asMETHOD(ResourceCache, GetTotalNumMisses), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_totalNumEvictions() const", asMETHOD(ResourceCache, GetTotalNumEvictions), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Array<String>@ get_resourceDirs() const", asFUNCTION(ResourceCacheGetResourceDirs), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Array<PackageFile@>@ get_packageFiles() const", asFUNCTION(ResourceCacheGetPackageFiles), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_searchPackagesFirst(bool)", asMETHOD(ResourceCache, SetSearchPackagesFirst), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_seachPackagesFirst() const", asMETHOD(ResourceCache, GetSearchPackagesFirst), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_memoryMapPackages(bool)", asMETHOD(ResourceCache, SetMemoryMapPackages), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_memoryMapPackages() const", asMETHOD(ResourceCache, GetMemoryMapPackages), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_asyncFileReads(bool)", asMETHOD(ResourceCache, SetAsyncFileReads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_asyncFileReads() const", asMETHOD(ResourceCache, GetAsyncFileReads), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_autoReloadResources(bool)", asMETHOD(ResourceCache, SetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_autoReloadResources() const", asMETHOD(ResourceCache, GetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_returnFailedResources(bool)", asMETHOD(ResourceCache, SetReturnFailedResources), asCALL_THISCALL);
@@ -146,6 +231,11 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "void set_finishBackgroundResourcesMs(int)", asMETHOD(ResourceCache, SetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "int get_finishBackgroundResourcesMs() const", asMETHOD(ResourceCache, GetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadResources() const", asMETHOD(ResourceCache, GetNumBackgroundLoadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_numBackgroundLoadThreads(uint)", asMETHOD(ResourceCache, SetNumBackgroundLoadThreads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadThreads() const", asMETHOD(ResourceCache, GetNumBackgroundLoadThreads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_loadTraceEnabled(bool)", asMETHOD(ResourceCache, SetLoadTraceEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_loadTraceEnabled() const", asMETHOD(ResourceCache, IsLoadTraceEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numLoadRecords() const", asMETHOD(ResourceCache, GetNumLoadRecords), asCALL_THISCALL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_resourceCache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_cache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
 }
@@ -192,6 +282,8 @@ static void RegisterImage(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Image", "void SavePNG(const String&in) const", asMETHOD(Image, SavePNG), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SaveTGA(const String&in) const", asMETHOD(Image, SaveTGA), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SaveJPG(const String&in, int) const", asMETHOD(Image, SaveJPG), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Image", "bool SaveDDS(const String&in) const", asMETHOD(Image, SaveDDS), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Image", "bool Compress(CompressedFormat)", asMETHOD(Image, Compress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "Color GetPixel(int, int) const", asMETHODPR(Image, GetPixel, (int, int) const, Color), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "Color GetPixel(int, int, int) const", asMETHODPR(Image, GetPixel, (int, int, int) const, Color), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "uint GetPixelInt(int, int) const", asMETHODPR(Image, GetPixelInt, (int, int) const, unsigned), asCALL_THISCALL);
@@ -26,7 +26,9 @@
 #include "../IO/PackageFile.h"
 #include "../Script/APITemplates.h"
 #include "../Scene/ObjectAnimation.h"
+#include "../Scene/Prefab.h"
 #include "../Scene/Scene.h"
+#include "../Scene/SceneStreamer.h"
 #include "../Scene/SmoothedTransform.h"
 #include "../Scene/SplinePath.h"
 #include "../Scene/ValueAnimation.h"
@@ -162,6 +164,26 @@ static bool SceneSaveXMLVectorBuffer(VectorBuffer& buffer, const String& indenta
     return ptr->SaveXML(buffer, indentation);
 }
 
+static bool SceneLoadSnapshot(File* file, Scene* ptr)
+{
+    return file && ptr->LoadSnapshot(*file);
+}
+
+static bool SceneLoadSnapshotVectorBuffer(VectorBuffer& buffer, Scene* ptr)
+{
+    return ptr->LoadSnapshot(buffer);
+}
+
+static bool SceneSaveSnapshot(File* file, Scene* ptr)
+{
+    return file && ptr->SaveSnapshot(*file);
+}
+
+static bool SceneSaveSnapshotVectorBuffer(VectorBuffer& buffer, Scene* ptr)
+{
+    return ptr->SaveSnapshot(buffer);
+}
+
 static Node* SceneInstantiate(File* file, const Vector3& position, const Quaternion& rotation, CreateMode mode, Scene* ptr)
 {
     return file ? ptr->Instantiate(*file, position, rotation, mode) : 0;
@@ -192,6 +214,16 @@ static CScriptArray* SceneGetRequiredPackageFiles(Scene* ptr)
     return VectorToHandleArray<PackageFile>(ptr->GetRequiredPackageFiles(), "Array<PackageFile@>");
 }
 
+static CScriptArray* SceneGetComponentsByType(const String& typeName, Scene* ptr)
+{
+    return VectorToHandleArray<Component>(ptr->GetComponentsByType(typeName), "Array<Component@>");
+}
+
+static unsigned SceneGetNumComponentsByType(const String& typeName, Scene* ptr)
+{
+    return ptr->GetNumComponentsByType(typeName);
+}
+
 static CScriptArray* GetObjectCategories()
 {
     Vector<String> categories = GetScriptContext()->GetObjectCategories().Keys();
@@ -277,6 +309,10 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "bool LoadXML(VectorBuffer&)", asFUNCTION(SceneLoadXMLVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(File@+, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXML), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(VectorBuffer&, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXMLVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool LoadSnapshot(File@+)", asFUNCTION(SceneLoadSnapshot), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool LoadSnapshot(VectorBuffer&)", asFUNCTION(SceneLoadSnapshotVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveSnapshot(File@+)", asFUNCTION(SceneSaveSnapshot), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveSnapshot(VectorBuffer&)", asFUNCTION(SceneSaveSnapshotVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool LoadAsync(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsync), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool LoadAsyncXML(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsyncXML), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void StopAsyncLoading()", asMETHOD(Scene, StopAsyncLoading), asCALL_THISCALL);
@@ -293,9 +329,12 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "void UnregisterVar(const String&in)", asMETHOD(Scene, UnregisterVar), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void UnregisterAllVars(const String&in)", asMETHOD(Scene, UnregisterAllVars), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Component@+ GetComponent(uint)", asMETHODPR(Scene, GetComponent, (unsigned) const, Component*), asCALL_THISCALL);
-    engine->RegisterObjectMethod("Scene", "Node@+ GetNode(uint)", asMETHOD(Scene, GetNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "Array<Component@>@ GetComponentsByType(const String&in) const", asFUNCTION(SceneGetComponentsByType), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "uint GetNumComponentsByType(const String&in) const", asFUNCTION(SceneGetNumComponentsByType), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "Node@+ GetNode(uint)", asMETHODPR(Scene, GetNode, (unsigned) const, Node*), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "const String& GetVarName(StringHash) const", asMETHOD(Scene, GetVarName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void Update(float)", asMETHOD(Scene, Update), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void UpdateTransforms()", asMETHOD(Scene, UpdateTransforms), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_updateEnabled(bool)", asMETHOD(Scene, SetUpdateEnabled), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_updateEnabled() const", asMETHOD(Scene, IsUpdateEnabled), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_timeScale(float)", asMETHOD(Scene, SetTimeScale), asCALL_THISCALL);
@@ -306,12 +345,15 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "float get_smoothingConstant() const", asMETHOD(Scene, GetSmoothingConstant), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_snapThreshold(float)", asMETHOD(Scene, SetSnapThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_snapThreshold() const", asMETHOD(Scene, GetSnapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_transformBatching(bool)", asMETHOD(Scene, SetTransformBatching), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_transformBatching() const", asMETHOD(Scene, GetTransformBatching), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_asyncLoading() const", asMETHOD(Scene, IsAsyncLoading), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_asyncProgress() const", asMETHOD(Scene, GetAsyncProgress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "LoadMode get_asyncLoadMode() const", asMETHOD(Scene, GetAsyncLoadMode), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_asyncLoadingMs(int)", asMETHOD(Scene, SetAsyncLoadingMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "int get_asyncLoadingMs() const", asMETHOD(Scene, GetAsyncLoadingMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "uint get_checksum() const", asMETHOD(Scene, GetChecksum), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "uint get_contentHash()", asMETHOD(Scene, GetContentHash), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "const String& get_fileName() const", asMETHOD(Scene, GetFileName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Array<PackageFile@>@ get_requiredPackageFiles() const", asFUNCTION(SceneGetRequiredPackageFiles), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Node", "Scene@+ get_scene() const", asMETHOD(Node, GetScene), asCALL_THISCALL);
@@ -321,6 +363,56 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterGlobalFunction("Array<String>@ GetObjectsByCategory(const String&in)", asFUNCTION(GetObjectsByCategory), asCALL_CDECL);
 }
 
+static void RegisterPrefab(asIScriptEngine* engine)
+{
+    RegisterResource<Prefab>(engine, "Prefab");
+    engine->RegisterObjectMethod("Prefab", "bool Define(Node@+)", asMETHOD(Prefab, Define), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "Node@+ Instantiate(Node@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asMETHOD(Prefab, Instantiate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "bool Release(Node@+)", asMETHOD(Prefab, Release), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "void Prepare(uint)", asMETHOD(Prefab, Prepare), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "void ClearPool()", asMETHOD(Prefab, ClearPool), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "void set_maxPoolSize(uint)", asMETHOD(Prefab, SetMaxPoolSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_maxPoolSize() const", asMETHOD(Prefab, GetMaxPoolSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_poolSize() const", asMETHOD(Prefab, GetPoolSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_numNodes() const", asMETHOD(Prefab, GetNumNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_numComponents() const", asMETHOD(Prefab, GetNumComponents), asCALL_THISCALL);
+}
+
+static void RegisterSceneStreamer(asIScriptEngine* engine)
+{
+    engine->RegisterEnum("StreamingCellState");
+    engine->RegisterEnumValue("StreamingCellState", "CELL_UNLOADED", CELL_UNLOADED);
+    engine->RegisterEnumValue("StreamingCellState", "CELL_PRELOADING", CELL_PRELOADING);
+    engine->RegisterEnumValue("StreamingCellState", "CELL_LOADING", CELL_LOADING);
+    engine->RegisterEnumValue("StreamingCellState", "CELL_LOADED", CELL_LOADED);
+    engine->RegisterEnumValue("StreamingCellState", "CELL_FAILED", CELL_FAILED);
+
+    RegisterComponent<SceneStreamer>(engine, "SceneStreamer");
+    engine->RegisterObjectMethod("SceneStreamer", "bool SaveCells(const String&in, bool removeNodes = true)", asMETHOD(SceneStreamer, SaveCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void AddObserver(Node@+)", asMETHOD(SceneStreamer, AddObserver), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void RemoveObserver(Node@+)", asMETHOD(SceneStreamer, RemoveObserver), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void RemoveAllObservers()", asMETHOD(SceneStreamer, RemoveAllObservers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void Update()", asMETHOD(SceneStreamer, Update), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void UnloadAllCells()", asMETHOD(SceneStreamer, UnloadAllCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "IntVector2 GetCellCoords(const Vector3&in) const", asMETHOD(SceneStreamer, GetCellCoords), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "StreamingCellState GetCellState(const IntVector2&in) const", asMETHOD(SceneStreamer, GetCellState), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "String GetCellFileName(const IntVector2&in) const", asMETHOD(SceneStreamer, GetCellFileName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_cellSize(float)", asMETHOD(SceneStreamer, SetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_cellSize() const", asMETHOD(SceneStreamer, GetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_cellPath(const String&in)", asMETHOD(SceneStreamer, SetCellPath), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "const String& get_cellPath() const", asMETHOD(SceneStreamer, GetCellPath), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_loadDistance(float)", asMETHOD(SceneStreamer, SetLoadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_loadDistance() const", asMETHOD(SceneStreamer, GetLoadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_unloadDistance(float)", asMETHOD(SceneStreamer, SetUnloadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_unloadDistance() const", asMETHOD(SceneStreamer, GetUnloadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_loadingMs(int)", asMETHOD(SceneStreamer, SetLoadingMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "int get_loadingMs() const", asMETHOD(SceneStreamer, GetLoadingMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "uint get_numObservers() const", asMETHOD(SceneStreamer, GetNumObservers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "uint get_numCells() const", asMETHOD(SceneStreamer, GetNumCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "uint get_numLoadedCells() const", asMETHOD(SceneStreamer, GetNumLoadedCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "bool get_loading() const", asMETHOD(SceneStreamer, IsLoading), asCALL_THISCALL);
+}
+
 void RegisterSceneAPI(asIScriptEngine* engine)
 {
     RegisterSerializable(engine);
@@ -331,6 +423,8 @@ void RegisterSceneAPI(asIScriptEngine* engine)
     RegisterSmoothedTransform(engine);
     RegisterSplinePath(engine);
     RegisterScene(engine);
+    RegisterPrefab(engine);
+    RegisterSceneStreamer(engine);
 }
 
 }
@@ -68,6 +68,8 @@ public:
 
     /// Handle attribute write access.
     virtual void OnSetAttribute(const AttributeInfo& attr, const Variant& src);
+    /// Return false, as attribute changes are handled in OnSetAttribute().
+    virtual bool AllowRawAttributeAccess() const { return false; }
     /// Handle attribute read access.
     virtual void OnGetAttribute(const AttributeInfo& attr, Variant& dest) const;
 
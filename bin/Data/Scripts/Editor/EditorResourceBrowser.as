@@ -75,6 +75,7 @@ const StringHash XML_TYPE_SPRITER_DATA("spriter_data");
 const StringHash BINARY_TYPE_SCENE("USCN");
 const StringHash BINARY_TYPE_PACKAGE("UPAK");
 const StringHash BINARY_TYPE_COMPRESSED_PACKAGE("ULZ4");
+const StringHash BINARY_TYPE_BLOCK_COMPRESSED_PACKAGE("ULZB");
 const StringHash BINARY_TYPE_ANGLESCRIPT("ASBC");
 const StringHash BINARY_TYPE_MODEL("UMDL");
 const StringHash BINARY_TYPE_SHADER("USHD");
@@ -1034,6 +1035,8 @@ int GetResourceType(StringHash fileType)
         return RESOURCE_TYPE_UNUSABLE;
     else if (fileType == BINARY_TYPE_COMPRESSED_PACKAGE)
         return RESOURCE_TYPE_UNUSABLE;
+    else if (fileType == BINARY_TYPE_BLOCK_COMPRESSED_PACKAGE)
+        return RESOURCE_TYPE_UNUSABLE;
     else if (fileType == BINARY_TYPE_ANGLESCRIPT)
         return RESOURCE_TYPE_SCRIPTFILE;
     else if (fileType == BINARY_TYPE_MODEL)
@@ -1201,6 +1204,8 @@ bool GetBinaryType(String path, StringHash &out fileType, bool useCache = false)
         fileType = BINARY_TYPE_PACKAGE;
     else if (type == BINARY_TYPE_COMPRESSED_PACKAGE)
         fileType = BINARY_TYPE_COMPRESSED_PACKAGE;
+    else if (type == BINARY_TYPE_BLOCK_COMPRESSED_PACKAGE)
+        fileType = BINARY_TYPE_BLOCK_COMPRESSED_PACKAGE;
     else if (type == BINARY_TYPE_ANGLESCRIPT)
         fileType = BINARY_TYPE_ANGLESCRIPT;
     else if (type == BINARY_TYPE_MODEL)